@@ -0,0 +1,81 @@
+// =============================================================================
+// clockSync.ts — Device clock offset and per-event latency attribution
+// Pure functions over the PKT_TIME / Time and PKT_EVENT_TIMES / Event Times
+// payloads.  Host times are any 32-bit µs clock of the app's own, e.g.
+// Math.floor(performance.now() * 1000) >>> 0; all arithmetic is mod 2^32.
+// =============================================================================
+import {
+  TIME_SYNC_BYTES,
+  EVENT_TIMES_HEADER_BYTES,
+  EVENT_TIMES_RECORD_BYTES
+} from './protocolConstants'
+
+export interface ClockSample {
+  offsetUs: number   // device − host, u32
+  delayUs: number    // round trip, both ways
+}
+
+export interface EventTimes {
+  seq: number
+  captureUs: number  // device clock
+  queuedUs: number   // after capture
+  sentUs: number     // device clock
+}
+
+export interface LatencyParts {
+  debounceUs: number    // first edge → event ring
+  queueUs: number       // ring → frame handed to the link
+  transportUs: number   // link, to arrival on the host
+  hostUs: number        // arrival → handled by the app
+}
+
+const be32 = (d: Uint8Array, i: number): number =>
+  ((d[i] << 24) | (d[i + 1] << 16) | (d[i + 2] << 8) | d[i + 3]) >>> 0
+
+const i32 = (v: number): number => v | 0
+
+// The CMD_TIME_SYNC payload for host time t1
+export function syncRequest(t1: number): Uint8Array {
+  return new Uint8Array([t1 >>> 24, (t1 >>> 16) & 0xff, (t1 >>> 8) & 0xff, t1 & 0xff])
+}
+
+// One reply, t4 = host clock when it arrived.  Null if it answers another request.
+export function clockSample(d: Uint8Array, t1: number, t4: number): ClockSample | null {
+  if (d.length < TIME_SYNC_BYTES || be32(d, 0) !== t1 >>> 0) return null
+  const t2 = be32(d, 4)
+  const t3 = be32(d, 8)
+  return {
+    offsetUs: Math.trunc((i32(t2 - t1) + i32(t3 - t4)) / 2) >>> 0,
+    delayUs: (i32(t4 - t1) - i32(t3 - t2)) >>> 0
+  }
+}
+
+// The offset is right to within delay / 2: keep the lowest-delay sample
+export function bestSample(samples: ClockSample[]): ClockSample | null {
+  return samples.reduce<ClockSample | null>((b, s) => (!b || s.delayUs < b.delayUs ? s : b), null)
+}
+
+export function unpackTimes(d: Uint8Array): EventTimes[] {
+  const out: EventTimes[] = []
+  if (d.length < EVENT_TIMES_HEADER_BYTES) return out
+  const sentUs = be32(d, 1)
+  for (let i = 0, p = EVENT_TIMES_HEADER_BYTES;
+       i < d[0] && p + EVENT_TIMES_RECORD_BYTES <= d.length;
+       i++, p += EVENT_TIMES_RECORD_BYTES) {
+    out.push({ seq: d[p], captureUs: be32(d, p + 1), queuedUs: (d[p + 5] << 8) | d[p + 6], sentUs })
+  }
+  return out
+}
+
+// Split one event's latency.  arrivedUs / handledUs are host clock; transport
+// is only as good as the sync sample, ± delay / 2.
+export function attribute(t: EventTimes, sync: ClockSample,
+                          arrivedUs: number, handledUs: number): LatencyParts {
+  const arrivedOnDevice = (arrivedUs + sync.offsetUs) >>> 0
+  return {
+    debounceUs: t.queuedUs,
+    queueUs: i32(t.sentUs - t.captureUs - t.queuedUs),
+    transportUs: i32(arrivedOnDevice - t.sentUs),
+    hostUs: i32(handledUs - arrivedUs)
+  }
+}
@@ -314,6 +314,10 @@ ipcMain.on('encoder:button', (_e, pressed: boolean, btnMapType: number,
     btnKeyCode: number, btnModifiers: number) => {
     keySender.handleEncoderButton(pressed, btnMapType, btnKeyCode, btnModifiers)
 })
+// Sent alongside CMD_SET_HID_MODE so keys are not typed twice
+ipcMain.on('hid:mode', (_e, on: boolean) => {
+    keySender.setDeviceHid(on)
+})
 
 // Profiles — all config lives on PC, never on ESP
 ipcMain.handle('profiles:get-all', () => {
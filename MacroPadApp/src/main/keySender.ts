@@ -132,6 +132,27 @@ class KeySender {
   private ready = false
   private queue: string[] = []
   private readyPromise: Promise<void> | null = null
+  // The device sends these as HID reports itself (CMD_SET_HID_MODE)
+  private deviceHid = false
+
+  /** Device HID mode on/off: skip what the device already sends */
+  setDeviceHid(on: boolean): void {
+    this.deviceHid = on
+  }
+
+  private onDevice(mapType: number, keyCode: number, modifiers: number, macro = ''): boolean {
+    if (!this.deviceHid || !(keyCode || modifiers)) return false
+    switch (mapType) {
+      case MAP_SINGLE_KEY:
+      case MAP_MEDIA_KEY:
+      case MAP_SHORTCUT:
+        return true
+      case MAP_MODIFIER_COMBO:
+        return !macro.startsWith('[')
+      default:
+        return false
+    }
+  }
 
   /** Start the PowerShell worker. Call once at app startup. */
   init(): Promise<void> {
@@ -211,6 +232,7 @@ class KeySender {
 
   /** Simulate a mapped key press (key down) */
   handleKeyDown(mapType: number, keyCode: number, modifiers: number, macro: string): void {
+    if (this.onDevice(mapType, keyCode, modifiers, macro ?? '')) return
     switch (mapType) {
       case MAP_SINGLE_KEY:
       case MAP_MEDIA_KEY: {
@@ -343,6 +365,7 @@ class KeySender {
 
   /** Simulate a mapped key release (key up) */
   handleKeyUp(mapType: number, keyCode: number, modifiers: number): void {
+    if (this.onDevice(mapType, keyCode, modifiers)) return
     switch (mapType) {
       case MAP_SINGLE_KEY:
       case MAP_MEDIA_KEY: {
@@ -366,6 +389,7 @@ class KeySender {
   handleEncoderRotation(mode: number, direction: number, _steps: number,
                         cwKey: number, ccwKey: number,
                         cwMod: number, ccwMod: number): void {
+    if (this.deviceHid && mode) return
     const isCW = direction === 0x01
     switch (mode) {
       case ENC_MODE_VOLUME:
@@ -401,6 +425,7 @@ class KeySender {
   handleEncoderButton(pressed: boolean, btnMapType: number,
                       btnKeyCode: number, btnModifiers: number): void {
     if (btnMapType === 0) return // MAP_NONE
+    if (this.onDevice(btnMapType, btnKeyCode, btnModifiers)) return
     const vk = HID_TO_VK[btnKeyCode]
     if (!vk) return
     const mods = modBitsToVkList(btnModifiers)
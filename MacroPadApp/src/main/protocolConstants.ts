@@ -11,6 +11,11 @@ export const MAP_MODIFIER_COMBO = 0x03
 export const MAP_TEXT_MACRO     = 0x04
 export const MAP_SHORTCUT       = 0x05
 export const MAP_LAUNCH_APP     = 0x06
+// Resolved on the device once a key map is uploaded (CFG_KEYMAP_*)
+export const MAP_LAYER_HOLD     = 0x07   // code = layer, on while held
+export const MAP_LAYER_TOGGLE   = 0x08   // code = layer, flips on each press
+export const MAP_SEQUENCE       = 0x09   // code = sequence index
+export const MAP_TRANSPARENT    = 0x0A   // next active layer below
 
 // Encoder modes
 export const ENC_MODE_VOLUME     = 0x01
@@ -22,6 +27,9 @@ export const ENC_MODE_CUSTOM     = 0x05
 // Event types
 export const EVT_KEY_PRESS          = 0x01
 export const EVT_KEY_RELEASE        = 0x02
+export const EVT_KEY_TAP            = 0x03   // gestures: resolved on the device (CMD_SET_GESTURE),
+export const EVT_KEY_HOLD           = 0x04   // sent after the press / release they came from,
+export const EVT_KEY_DOUBLE_TAP     = 0x05   // stamped at the gesture's first press
 export const EVT_ENCODER_ROTATE     = 0x10
 export const EVT_ENCODER_BTN_PRESS  = 0x11
 export const EVT_ENCODER_BTN_RELEASE = 0x12
@@ -29,3 +37,178 @@ export const EVT_ENCODER_BTN_RELEASE = 0x12
 // Direction
 export const DIR_CW  = 0x01
 export const DIR_CCW = 0xff
+
+// Serial packet types (firmware SerialBridge.h)
+export const PKT_EVENT_BATCH = 0x09
+export const PKT_SNAPSHOT    = 0x0A
+export const PKT_TRACE       = 0x0B
+export const PKT_STATS       = 0x0C
+export const PKT_LINK        = 0x0D
+export const PKT_TIME        = 0x0E
+export const PKT_EVENT_TIMES = 0x0F
+export const PKT_CAPTURE     = 0x10
+
+// Commands (app → device)
+export const CMD_SET_KEY_MAP      = 0x08   // [key] [type] [code] [mods] [macro len] [macro]; RAM-only
+export const CMD_SET_ENCODER_MODE = 0x09   // [mode] [cw key] [cw mods] [ccw key] [ccw mods] [btn type] [btn key] [btn mods]
+export const CMD_GET_SNAPSHOT = 0x0B
+export const CMD_GET_TRACE    = 0x0C   // serial only, payload [since u32 BE]
+export const CMD_GET_STATS    = 0x0D
+export const CMD_SET_ENCODER_RATE_LIVE = 0x0E   // uint16 BE Hz, 0 = every scan; RAM-only
+export const CMD_SET_LINK_PROFILE = 0x0F   // uint8 LINK_*; RAM-only
+export const CMD_GET_LINK         = 0x10
+export const CMD_SET_HID_MODE     = 0x11   // uint8 on; the device sends HID reports for mapped keys
+export const CMD_SET_SCAN_GOVERNOR = 0x12  // uint8 GOV_MODE_*; RAM-only
+export const CMD_TIME_SYNC        = 0x13   // [host µs u32 BE]; the link it came in on replies
+export const CMD_SET_LATENCY_TRACE = 0x14  // uint8 on, per link; off on reconnect / handshake
+export const CMD_SET_CAPTURE      = 0x15   // uint8 on; serial only, streams PKT_CAPTURE
+export const CMD_GET_DEBOUNCE     = 0x16   // replies CFG_DEBOUNCE_PROFILE on both links
+export const CMD_SET_GESTURE      = 0x17   // [key] [hold ms u16 BE] [double tap ms u16 BE]; key 0xFF = all,
+                                           // [key] alone = defaults (200 / 250), 0 / 0 = off; RAM-only
+// CMD_SET_DEBOUNCE (0x03) takes [ms u16 BE] to fix every key's window, or
+// [ms u16 BE] [1] to keep per-key windows learned below ms (the default, 20)
+
+// Handshake feature flags — optional 4th byte of PKT_HANDSHAKE, echoed in the ACK
+export const HS_FLAG_BATCH = 0x01
+export const HS_FLAG_CRC16 = 0x02   // 2-byte CRC-16/CCITT-FALSE trailer instead of XOR
+                                    // (handshake + ACK stay XOR-framed)
+
+// Batched events (PKT_EVENT_BATCH payload / Event Batch characteristic)
+//   [count] [seq0] [t0 µs u32 BE] then count × [dt µs u16 BE] [type] [a] [b] [speed u16 BE]
+export const EVENT_BATCH_CHAR_UUID    = 'e5e60008-b594-4841-8a6c-5b0d12e7e4a8'
+export const EVENT_BATCH_HEADER_BYTES = 6
+export const EVENT_BATCH_RECORD_BYTES = 7
+
+// Device info (PKT_DEVICE_INFO payload / Device Info characteristic), 8 bytes
+//   [fw major] [fw minor] [fw patch] [rows] [cols] [has encoder] [has battery] [key count]
+// Key indexes are row-major, 0 … key count − 1; 2×5, 4×6 and 6×16 boards exist.
+export const DEVICE_INFO_BYTES = 8
+export const DEVICE_INFO_KEYS  = 7   // byte offset of the key count
+
+// Pressed-key snapshot (PKT_SNAPSHOT payload / State characteristic)
+//   [seq] [encoder button] [key count] [pressed mask, ceil(keys / 8) bytes, LSB first]
+// Key/encoder event packets carry the event's 8-bit sequence number in byte 3.
+export const STATE_CHAR_UUID = 'e5e60009-b594-4841-8a6c-5b0d12e7e4a8'
+
+// Trace dump (PKT_TRACE payload)
+//   [first u32 BE] [end u32 BE] [count] then count × [tUs u32 BE] [id] [a] [b] [c]
+export const TRACE_HEADER_BYTES = 9
+export const TRACE_RECORD_BYTES = 8
+
+// Trace record ids (firmware Trace.h)
+export const TR_EVENT          = 0x01   // type, key / signed steps / button, seq
+export const TR_COMMAND        = 0x02   // cmd, payload len
+export const TR_CONFIG_WRITE   = 0x03   // type, len
+export const TR_DEBOUNCE       = 0x04   // 0, ms hi, ms lo
+export const TR_BATTERY        = 0x05   // pct, mV hi, mV lo
+export const TR_SLEEP          = 0x06
+export const TR_WAKE           = 0x07   // ESP_SLEEP_WAKEUP_* cause, WAKE_* sources
+export const TR_BLE_CONNECT    = 0x08   // 0, MTU hi, MTU lo
+export const TR_BLE_DISCONNECT = 0x09   // 0, reason hi, reason lo
+export const TR_BLE_SUBSCRIBE  = 0x0A   // 1, on
+export const TR_HANDSHAKE      = 0x0B   // feature flags
+export const TR_BLE_MTU        = 0x0C   // 0, MTU hi, MTU lo
+export const TR_ENCODER_RATE   = 0x0D   // 0, Hz hi, Hz lo
+export const TR_LINK_REQUEST   = 0x0E   // profile, interval min, interval max
+export const TR_LINK_PARAMS    = 0x0F   // interval hi, interval lo, latency
+export const TR_LINK_PHY       = 0x10   // tx PHY, rx PHY
+export const TR_HID_MODE       = 0x11   // on
+export const TR_KEYMAP         = 0x12   // status, layers, sequences
+export const TR_LAYER          = 0x13   // active layer mask, top layer
+export const TR_SCAN_TIER      = 0x14   // tier (0 full, 1 idle, 2 deep), GOV_MODE_*, 1 = woken
+export const TR_ADVERTISE      = 0x15   // ADV_* phase, min interval hi, lo (0.625 ms)
+export const TR_WAKE_EVENT     = 0x16   // 0, µs hi, µs lo: light-sleep wake → first event sent
+
+// TR_WAKE sources and TR_ADVERTISE phases
+export const WAKE_KEY     = 0x01
+export const WAKE_ENCODER = 0x02
+export const WAKE_BUTTON  = 0x04
+export const ADV_DIRECTED = 1     // at the bonded host
+export const ADV_FAST     = 2
+export const ADV_SLOW     = 3
+
+// Performance counters (PKT_STATS payload / Stats characteristic), all BE
+//   [version] [uptime ms u32] [scan period hist] [scan work max µs u32]
+//   [latency hist] [ring dropped u32] [ring high-water u16]
+//   [notify failed u32] [notify skipped u32] [ble retried u32] [ble dropped u32]
+//   [ble coalesced u32] [tx deferred u32] [tx dropped u32]
+//   [rx bad u32] [rx oversize u32] [encoder isr hits u32] [heap free u32] [heap min free u32]
+// A histogram is 8 × count u32 then max µs u32.
+export const STATS_CHAR_UUID = 'e5e6000a-b594-4841-8a6c-5b0d12e7e4a8'
+export const STATS_VERSION   = 2
+export const STATS_BYTES     = 135
+export const SCAN_PERIOD_EDGES_US   = [900, 1100, 1500, 2000, 5000, 10000, 50000]
+export const EVENT_LATENCY_EDGES_US = [1000, 2000, 5000, 10000, 20000, 50000, 100000]
+
+// BLE link parameters (PKT_LINK payload / Link characteristic), all BE
+//   [mode] [profile, 0 = not connected] [interval u16, 1.25 ms] [latency u16]
+//   [timeout u16, 10 ms] [tx PHY] [rx PHY] [data length u16, requested] [MTU u16]
+// PHY 1 = 1M, 2 = 2M.  Notified whenever the parameters change.
+export const LINK_CHAR_UUID    = 'e5e6000b-b594-4841-8a6c-5b0d12e7e4a8'
+export const LINK_PARAMS_BYTES = 14
+export const LINK_AUTO         = 0   // performance while typing, battery after 10 s idle
+export const LINK_PERFORMANCE  = 1
+export const LINK_BATTERY      = 2
+
+// Clock sync reply (PKT_TIME payload / Time characteristic), all BE
+//   [t1: host µs, echoed u32] [t2: device µs at receipt u32] [t3: device µs at send u32]
+// With t4 the host clock on arrival (clockSync.ts):
+//   offset (device − host) = ((t2 − t1) + (t3 − t4)) / 2, right to within delay / 2
+//   delay = (t4 − t1) − (t3 − t2)
+export const TIME_CHAR_UUID  = 'e5e6000c-b594-4841-8a6c-5b0d12e7e4a8'
+export const TIME_SYNC_BYTES = 12
+
+// Latency trace (PKT_EVENT_TIMES payload / Event Times characteristic), all BE,
+// right behind each event frame or notify while CMD_SET_LATENCY_TRACE is on
+//   [count] [sent µs u32] then count × [seq] [capture µs u32] [queued, µs after capture u16]
+// Device micros(): capture = first edge, queued = debounce done, sent = frame to the link.
+export const EVENT_TIMES_CHAR_UUID    = 'e5e6000d-b594-4841-8a6c-5b0d12e7e4a8'
+export const EVENT_TIMES_HEADER_BYTES = 5
+export const EVENT_TIMES_RECORD_BYTES = 7
+
+// Raw pin capture (PKT_CAPTURE payload), while CMD_SET_CAPTURE is on
+//   [count] [key count] then count × [t µs u32 BE] [levels] [raw keys, ⌈keys/8⌉ bytes, LSB first]
+// levels: bit 2 A, bit 1 B, bit 0 button, 1 = HIGH (open), plus the CAP_* marks.
+// Saved as .mpcap for macropad_replay: "MPCAP" [version] [rows] [cols] [rate u16 BE] + records.
+export const CAP_FIRST  = 0x80   // capture started; every level as found
+export const CAP_LAST   = 0x40   // capture stopped
+export const CAP_LOST   = 0x20   // ring was full; changes before this record lost
+export const CAP_LEVELS = 0x07
+export const CAPTURE_HEADER_BYTES      = 2
+export const CAPTURE_RECORD_BASE_BYTES = 5   // + ⌈key count / 8⌉
+
+// Scan governor modes (CMD_SET_SCAN_GOVERNOR)
+export const GOV_MODE_FIXED = 0   // 1 kHz always
+export const GOV_MODE_AUTO  = 1   // slower scans when idle, full rate on the first edge (default)
+export const GOV_MODE_POLL  = 2   // slower scans when idle, no edge wake
+
+// Key map upload: Config characteristic / PKT_CONFIG_DATA writes, [type] [data]
+//   image = [version] [layers] [keys] [sequences]
+//           layers × keys × [type] [code] [mods]
+//           sequences × ([steps] steps × [code] [mods])
+// Key events then carry the layer they resolved on in byte 2 (batch: b).
+export const CFG_KEYMAP_BEGIN  = 0x01   // [image bytes u16 BE]
+export const CFG_KEYMAP_DATA   = 0x02   // [offset u16 BE] [bytes]
+export const CFG_KEYMAP_COMMIT = 0x03   // [CRC-16/CCITT-FALSE u16 BE]
+export const CFG_KEYMAP_STATUS = 0x04   // device → app: [status] [layers] [sequences] [CRC u16 BE]
+// device → app: [adaptive] [ceiling ms] [keys]  keys × [window ms] [longest burst ms]
+//               [chattering key mask, LSB first]
+export const CFG_DEBOUNCE_PROFILE = 0x05
+export const KEYMAP_VERSION    = 1
+export const KEYMAP_LAYERS     = 4
+export const KEYMAP_OK         = 0
+export const KEYMAP_ERR_SIZE   = 1
+export const KEYMAP_ERR_CRC    = 2
+export const KEYMAP_ERR_FORMAT = 3
+export const KEYMAP_ERR_ORDER  = 4
+
+// HID over GATT input reports (service 1812), used while HID mode is on.
+// The device handles SINGLE, MEDIA, SHORTCUT and COMBO without a recorded
+// macro, plus every encoder mode; text, macros and launch stay on the app.
+export const HID_REPORT_KEYBOARD = 1   // [mods] [0] [6 × usage]
+export const HID_REPORT_CONSUMER = 2   // [usage u16 LE]
+export const HID_REPORT_MOUSE    = 3   // [buttons] [x] [y] [wheel] [pan]
+
+// Encoder rotate events carry the measured speed: bytes 4-5 of the 6-byte
+// Encoder Event packet, and the last two bytes of a batch record.
+export const ENCODER_SPEED_SCALE = 10   // speed / 10 = steps per second
@@ -0,0 +1,3405 @@
+// =============================================================================
+// Bench.cpp — Scan-to-wire benchmark for the MacroPad firmware (host build)
+//
+// Every scenario scripts real-world waveforms (contact bounce, quadrature
+// spins, host command bursts) against the simulated board, runs the unmodified
+// firmware loop() until the script is done, and reports:
+//   · host cost per loop() iteration (ns and TSC cycles, p50/p99/max)
+//   · first-edge → SerialBridge frame and → BLE central latency (virtual ms;
+//     notifies wait for a connection event and take air time on the link)
+//   · capture timestamp error (batched events carry their capture time)
+//   · heap allocations, Stream::write() calls, frames and notifies per event;
+//     any allocation on a firmware task or in an ISR fails the run
+//   · corrupted host frames the device accepted (XOR vs CRC-16 framing)
+//   · RX parser fuzz (noise, truncated and bogus frames) and bulk throughput
+//   · sequence gaps, and how fast a lossy host resyncs from snapshots
+//   · text log bytes mixed into the serial stream, and a trace-ring fetch
+//   · on-device performance counters, checked against what was scripted
+//   · BLE connection profiles as negotiated, against what the device reports
+//   · HID keyboard / consumer / mouse reports against a model of the keys held
+//   · a RAM key map upload, layers and sequences resolved on the device
+//   · scan governor: idle duty cycle against first-event latency, per mode
+//   · light sleep: the waking press or detent, and advertising after the wake
+//   · clock sync over each link, and per-event latency split from the trace
+//   · raw pin capture: every scripted level change back within one sample
+//   · the native host bridge: strokes out of device frames, lossless and lossy
+//   · battery: filtered, curve-mapped charge over a noisy discharge; spread-out reads
+//   · adaptive debounce: learned per-key windows, worn and chattering keys flagged
+//   · gestures: tap / hold / double-tap resolved on the device, and by a host from BLE arrivals
+//   · BLE congestion: refused notifies retried in order, keys never given up for rotations
+//   · missed / spurious events, which make the run exit non-zero
+//
+// Usage: macropad_bench [scenario …] [--save-capture FILE]   (no scenarios = all)
+// =============================================================================
+#include "Harness.h"
+#include "Capture.h"
+#include "Session.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace harness;
+
+namespace {
+
+// ── Expected vs observed events ──────────────────────────────────────────────
+struct Expect {
+    uint8_t  evt;
+    uint8_t  id;                 // key index, or 0xFF for "any"
+    uint64_t tUs;                // first physical edge
+    bool     serialSeen = false;
+    bool     bleSeen    = false;
+};
+
+struct Observed {
+    uint64_t tUs;
+    uint8_t  evt;
+    uint8_t  a;
+    uint8_t  b;
+    uint8_t  seq   = 0;
+    uint64_t capUs = 0;          // device capture time, batched events only
+    uint16_t speed = 0;          // rotation, steps/s × 10
+};
+
+struct Result {
+    const char* name;
+    LoopStats   loops;
+    Samples     serialLatMs;         // press / rotate edges
+    Samples     serialRelMs;         // release edges
+    Samples     bleLatMs;
+    Samples     bleRelMs;
+    Samples     captureUs;           // capture timestamp − first edge
+    Samples     resyncMs;            // sequence gap seen → snapshot applied
+    Samples     scanUs;              // input sampling period
+    bool        histogram = false;
+    uint32_t    expected  = 0;
+    uint32_t    reported  = 0;       // serial frames carrying input events
+    uint32_t    missed    = 0;
+    uint32_t    spurious  = 0;
+    uint32_t    seqGaps   = 0;       // either link; lossless scenarios expect 0
+    uint64_t    allocs    = 0;
+    uint64_t    fwAllocs  = 0;       // on the board, whole scenario (main())
+    uint32_t    txWrites  = 0;
+    size_t      textBytes = 0;       // serial bytes outside any frame
+    uint32_t    frames    = 0;       // serial frames carrying input events
+    uint32_t    notifies  = 0;       // notifies carrying input events
+    uint32_t    isrs      = 0;
+    uint32_t    ringDropped = 0;
+    uint32_t    ringHigh    = 0;
+    std::string note;
+};
+
+struct Window {
+    size_t   txStart;
+    size_t   notifyStart;
+    uint64_t allocStart;
+    uint32_t isrStart;
+    uint32_t droppedStart;
+};
+
+Window openWindow() {
+    sim::txClear();
+    sim::strobeClear();
+    return { sim::txCount(), sim::notifyCount(), allocCount(), sim::isrCalls(),
+             inputRing.dropped() };
+}
+
+// Device micros() wraps at 32 bits; put it back on the 64-bit virtual clock.
+uint64_t widen(uint32_t us, uint64_t near) {
+    uint64_t t = (near & ~0xFFFFFFFFull) | us;
+    return t > near ? t - (1ull << 32) : t;
+}
+
+// One Observed per record of a PKT_EVENT_BATCH / Event Batch payload
+void unpackBatch(uint64_t tUs, const uint8_t* d, uint16_t len, std::vector<Observed>& out) {
+    if (len < EventBatch::HEADER_BYTES) return;
+    uint32_t t0 = ((uint32_t)d[2] << 24) | ((uint32_t)d[3] << 16) | ((uint32_t)d[4] << 8) | d[5];
+    const uint8_t* p = d + EventBatch::HEADER_BYTES;
+    for (uint8_t i = 0; i < d[0] && p + EventBatch::RECORD_BYTES <= d + len; i++) {
+        uint32_t cap = t0 + (((uint32_t)p[0] << 8) | p[1]);
+        out.push_back({ tUs, p[2], p[3], p[4], (uint8_t)(d[1] + i), widen(cap, tUs),
+                        (uint16_t)(p[5] << 8 | p[6]) });
+        p += EventBatch::RECORD_BYTES;
+    }
+}
+
+uint32_t seqGaps(const std::vector<Observed>& obs) {
+    uint32_t gaps = 0;
+    for (size_t i = 1; i < obs.size(); i++)
+        if (obs[i].seq != (uint8_t)(obs[i - 1].seq + 1)) gaps++;
+    return gaps;
+}
+
+void closeWindow(const Window& w, Result& r,
+                 std::vector<Observed>& serial, std::vector<Observed>& ble) {
+    r.allocs   = allocCount() - w.allocStart;
+    r.txWrites = sim::txWriteCalls();
+    r.isrs     = sim::isrCalls() - w.isrStart;
+    r.ringDropped = inputRing.dropped() - w.droppedStart;
+    r.ringHigh    = inputRing.highWater();
+    for (size_t i = 0; i < sim::strobeCount(); i++) r.scanUs.add(sim::strobeIntervalAt(i));
+
+    std::vector<Frame> frames;
+    size_t cursor = w.txStart;
+    decodeFrames(&cursor, frames, &r.textBytes);
+    for (const Frame& f : frames) {
+        if (f.type == PKT_KEY_EVENT || f.type == PKT_ENCODER_EVENT) {
+            uint16_t speed = f.len >= 6 ? (uint16_t)(f.data[4] << 8 | f.data[5]) : 0;
+            serial.push_back({ f.tUs, f.data[0], f.data[1], f.data[2], f.data[3], 0, speed });
+            r.frames++;
+        } else if (f.type == PKT_EVENT_BATCH) {
+            unpackBatch(f.tUs, f.data, f.len, serial);
+            r.frames++;
+        }
+    }
+
+    const NimBLECharacteristic* keyChr   = sim::bleFind(KEY_EVENT_CHAR_UUID);
+    const NimBLECharacteristic* encChr   = sim::bleFind(ENCODER_EVENT_CHAR_UUID);
+    const NimBLECharacteristic* batchChr = sim::bleFind(EVENT_BATCH_CHAR_UUID);
+    for (size_t i = w.notifyStart; i < sim::notifyCount(); i++) {
+        const sim::Notify& n = sim::notifyAt(i);
+        if (n.chr == keyChr || n.chr == encChr) {
+            uint16_t speed = n.len >= 6 ? (uint16_t)(n.data[4] << 8 | n.data[5]) : 0;
+            ble.push_back({ n.hostUs, n.data[0], n.data[1], n.data[2], n.data[3], 0, speed });
+            r.notifies++;
+        } else if (n.chr == batchChr) {
+            unpackBatch(n.hostUs, n.data, n.len, ble);
+            r.notifies++;
+        }
+    }
+    r.reported = (uint32_t)serial.size();
+    r.seqGaps  = seqGaps(serial) + seqGaps(ble);
+    r.missed  += r.seqGaps;
+}
+
+// Pair each observed event with the oldest unmatched expectation of the same
+// kind.  Anything left over on either side is a missed or spurious event.
+void match(std::vector<Expect>& exp, const std::vector<Observed>& obs,
+           bool ble, Samples& lat, Samples& rel, Result& r) {
+    for (const Observed& o : obs) {
+        bool found = false;
+        for (Expect& e : exp) {
+            bool& seen = ble ? e.bleSeen : e.serialSeen;
+            if (seen || e.evt != o.evt || e.tUs > o.tUs) continue;
+            if (e.id != 0xFF && e.id != o.a) continue;
+            seen  = true;
+            found = true;
+            bool release = e.evt == EVT_KEY_RELEASE || e.evt == EVT_ENCODER_BTN_RELEASE;
+            (release ? rel : lat).add((o.tUs - e.tUs) / 1000.0);
+            if (o.capUs && !ble) r.captureUs.add((double)((int64_t)o.capUs - (int64_t)e.tUs));
+            break;
+        }
+        if (!found) r.spurious++;
+    }
+    for (const Expect& e : exp)
+        if (!(ble ? e.bleSeen : e.serialSeen)) r.missed++;
+}
+
+void printLatency(const char* label, const Samples& s) {
+    if (!s.count()) return;
+    printf("  %s  ms p50 %6.2f  p99 %6.2f  max %6.2f   (%zu samples)\n",
+           label, s.pct(50), s.pct(99), s.max(), s.count());
+}
+
+void printHistogram(const Samples& s) {
+    static const uint32_t EDGES[] = { 900, 1100, 1500, 2000, 5000, 10000 };
+    static const char*    LABEL[] = { "<0.9", "0.9-1.1", "1.1-1.5", "1.5-2",
+                                      "2-5", "5-10", "≥10" };
+    uint32_t bins[7] = {};
+    for (size_t i = 0; i < s.count(); i++) {
+        size_t b = 0;
+        while (b < 6 && s.at(i) >= EDGES[b]) b++;
+        bins[b]++;
+    }
+    printf("  scan period histogram (ms):");
+    for (size_t b = 0; b < 7; b++) printf("  %s:%u", LABEL[b], bins[b]);
+    printf("\n");
+}
+
+void print(const Result& r) {
+    printf("── %s ", r.name);
+    for (size_t i = strlen(r.name); i < 72; i++) printf("─");
+    printf("\n");
+    printf("  loop()      %8llu iters   ns p50 %7.0f  p99 %7.0f  max %7.0f   cyc p50 %7.0f\n",
+           (unsigned long long)r.loops.loops,
+           r.loops.hostNs.pct(50), r.loops.hostNs.pct(99), r.loops.hostNs.max(),
+           r.loops.cycles.pct(50));
+    if (r.scanUs.count())
+        printf("  scan period µs p50 %6.0f  p99 %6.0f  max %6.0f\n",
+               r.scanUs.pct(50), r.scanUs.pct(99), r.scanUs.max());
+    if (r.histogram) printHistogram(r.scanUs);
+    printLatency("edge→serial", r.serialLatMs);
+    printLatency("  release  ", r.serialRelMs);
+    printLatency("edge→BLE   ", r.bleLatMs);
+    printLatency("  release  ", r.bleRelMs);
+    printLatency("gap→resync ", r.resyncMs);
+    if (r.captureUs.count())
+        printf("  capture     µs p50 %6.0f  p99 %6.0f  max %6.0f   (stamp − first edge)\n",
+               r.captureUs.pct(50), r.captureUs.pct(99), r.captureUs.max());
+    double perEvt = r.reported ? 1.0 / r.reported : 0;
+    printf("  events      expected %u  reported %u  missed %u  spurious %u  seq gaps %u\n",
+           r.expected, r.reported, r.missed, r.spurious, r.seqGaps);
+    printf("  per event   allocs %.2f  Stream::write %.2f  frames %.2f  notifies %.2f  text bytes %.1f   isr hits %u\n",
+           r.allocs * perEvt, r.txWrites * perEvt, r.frames * perEvt, r.notifies * perEvt,
+           r.textBytes * perEvt, r.isrs);
+    printf("  event ring  dropped %u  high-water since boot %u/%u\n",
+           r.ringDropped, r.ringHigh, inputRing.capacity());
+    if (r.fwAllocs)
+        printf("  heap        %llu allocation(s) on the board, the last in %s\n",
+               (unsigned long long)r.fwAllocs, lastFirmwareAlloc());
+    if (!r.note.empty()) printf("  %s\n", r.note.c_str());
+}
+
+// =============================================================================
+// Scenarios
+// =============================================================================
+Result idle() {
+    Result r{ "idle" };
+    Window w = openWindow();
+    runLoops(5000, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    r.spurious = (uint32_t)s.size();
+    return r;
+}
+
+// Every key, five rounds: 4-edge bounce over 1.5 ms on make and break.
+Result typeAllKeys(const char* name) {
+    Result r{ name };
+    std::vector<Expect> exp;
+    uint64_t t = sim::nowUs() + 5000;
+    for (int round = 0; round < 5; round++) {
+        for (uint8_t k = 0; k < NUM_KEYS; k++) {
+            scriptKey(k, t, true, 4, 1500);
+            scriptKey(k, t + 60000, false, 4, 1500);
+            exp.push_back({ EVT_KEY_PRESS,   k, t });
+            exp.push_back({ EVT_KEY_RELEASE, k, t + 60000 });
+            t += 100000;
+        }
+    }
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(t + 50000, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    match(exp, s, false, r.serialLatMs, r.serialRelMs, r);
+    Result ble{ "" };
+    match(exp, b, true, r.bleLatMs, r.bleRelMs, ble);
+    return r;
+}
+
+Result keys() { return typeAllKeys("keys"); }
+
+// Same script against an app that never opted into batching.
+Result keysLegacy() {
+    attachHost(0, false);
+    Result r = typeAllKeys("keys-legacy");
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+    return r;
+}
+
+// Same script with presses reported on their first edge.
+Result keysEager() {
+    keyMatrix.setEagerPress(true);
+    Result r = typeAllKeys("keys-eager");
+    keyMatrix.setEagerPress(DEFAULT_EAGER_PRESS);
+    return r;
+}
+
+// Three-key chords landing within 2 ms of each other.
+Result chord() {
+    Result r{ "chord" };
+    std::vector<Expect> exp;
+    static const uint8_t CHORD[3] = { 0, 5, 6 };
+    uint64_t t = sim::nowUs() + 5000;
+    for (int n = 0; n < 20; n++) {
+        for (int i = 0; i < 3; i++) {
+            uint64_t tp = t + i * 700;
+            scriptKey(CHORD[i], tp, true, 2, 800);
+            scriptKey(CHORD[i], tp + 80000, false, 2, 800);
+            exp.push_back({ EVT_KEY_PRESS,   CHORD[i], tp });
+            exp.push_back({ EVT_KEY_RELEASE, CHORD[i], tp + 80000 });
+        }
+        t += 150000;
+    }
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(t + 50000, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    match(exp, s, false, r.serialLatMs, r.serialRelMs, r);
+    return r;
+}
+
+// Slow then fast spins in both directions.  Reported steps must add up.
+Result encoderSpin() {
+    Result r{ "encoder" };
+    struct Spin { int8_t dir; uint16_t detents; uint32_t edgeUs; };
+    static const Spin SPINS[] = {
+        { +1, 10, 5000 }, { -1, 10, 5000 },     // ~50 detents/s
+        { +1, 40,  500 }, { -1, 40,  500 },     // ~500 detents/s
+    };
+    uint8_t sens = DEFAULT_ENCODER_SENSITIVITY;
+
+    // The same spins reported on every scan, then at ENCODER_REPORT_HZ
+    static const uint16_t RATES[2] = { 0, ENCODER_REPORT_HZ };
+    size_t   events[2] = {};
+    double   minGapMs = 1e9, worstSpeed = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        const uint8_t cmd[3] = { CMD_SET_ENCODER_RATE_LIVE, (uint8_t)(RATES[pass] >> 8), (uint8_t)RATES[pass] };
+        hostSendPacket(PKT_COMMAND, cmd, sizeof(cmd));
+        runLoops(5, nullptr);
+
+        uint64_t t = sim::nowUs() + 5000;
+        std::vector<uint64_t> starts, ends;
+        int32_t expectCw = 0, expectCcw = 0;
+        for (const Spin& sp : SPINS) {
+            starts.push_back(t);
+            uint64_t end = scriptSpin(t, sp.dir, sp.detents, sp.edgeUs);
+            ends.push_back(end);
+            (sp.dir > 0 ? expectCw : expectCcw) += sp.detents * 4 / sens;
+            t = end + 100000;
+        }
+
+        // Only the rate-limited pass feeds the printed per-event numbers
+        Result  scratch{ "encoder" };
+        Result& into = pass ? r : scratch;
+        Window  w    = openWindow();
+        runUntil(t, pass ? &r.loops : nullptr);
+        std::vector<Observed> s, b;
+        closeWindow(w, into, s, b);
+        r.missed  += pass ? 0 : scratch.missed;
+        events[pass] = s.size();
+
+        int32_t  gotCw = 0, gotCcw = 0;
+        size_t   si = 0;
+        uint64_t prevUs = 0;
+        for (const Observed& o : s) {
+            if (o.evt != EVT_ENCODER_ROTATE) { r.spurious++; continue; }
+            (o.a == DIR_CW ? gotCw : gotCcw) += o.b;
+
+            // Speed against the scripted edge rate of the spin it belongs to
+            size_t k = 0;
+            while (k + 1 < starts.size() && starts[k + 1] <= o.capUs) k++;
+            double want = 1e7 / ((double)SPINS[k].edgeUs * sens);
+            worstSpeed = std::max(worstSpeed, fabs(o.speed - want) / want);
+            if (pass && prevUs && o.capUs <= ends[k] && prevUs >= starts[k])
+                minGapMs = std::min(minGapMs, (o.tUs - prevUs) / 1000.0);
+            prevUs = o.tUs;
+
+            // First report after each spin start gives the response latency
+            while (pass && si < starts.size() && starts[si] <= o.tUs &&
+                   (si + 1 == starts.size() || starts[si + 1] > o.tUs)) {
+                r.serialLatMs.add((o.tUs - starts[si]) / 1000.0);
+                si++;
+            }
+        }
+        r.missed += (uint32_t)(abs(expectCw - gotCw) + abs(expectCcw - gotCcw));
+        if (pass) {
+            r.expected = (uint32_t)(expectCw + expectCcw);
+            char buf[96];
+            snprintf(buf, sizeof(buf), "steps       cw %d/%d  ccw %d/%d", gotCw, expectCw, gotCcw, expectCcw);
+            r.note = buf;
+        }
+    }
+    // Speeds off by more than 5%, or reports closer than one period, fail
+    double periodMs = 1000.0 / ENCODER_REPORT_HZ;
+    if (worstSpeed > 0.05) r.missed++;
+    if (minGapMs < periodMs - 1) r.spurious++;
+
+    char buf[200];
+    snprintf(buf, sizeof(buf),
+             "\n  reports     every scan %zu  at %u Hz %zu   min gap %.1f ms   speed error max %.1f%%",
+             events[0], ENCODER_REPORT_HZ, events[1], minGapMs, 100 * worstSpeed);
+    r.note += buf;
+    return r;
+}
+
+// Encoder push-button with a nasty 6-edge, 3 ms bounce.
+Result encoderButton() {
+    Result r{ "enc-button" };
+    std::vector<Expect> exp;
+    uint64_t t = sim::nowUs() + 5000;
+    for (int n = 0; n < 10; n++) {
+        scriptEncButton(t, true, 6, 3000);
+        scriptEncButton(t + 70000, false, 6, 3000);
+        exp.push_back({ EVT_ENCODER_BTN_PRESS,   0xFF, t });
+        exp.push_back({ EVT_ENCODER_BTN_RELEASE, 0xFF, t + 70000 });
+        t += 150000;
+    }
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(t + 50000, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    match(exp, s, false, r.serialLatMs, r.serialRelMs, r);
+    return r;
+}
+
+// Host bursts: 100 identify commands plus a run of 200-byte config writes,
+// all queued at once.  Shows how long one loop() can be held up by RX.
+Result serialBurst() {
+    Result r{ "serial-rx" };
+    uint8_t cmd[1] = { CMD_IDENTIFY };
+    for (int i = 0; i < 100; i++) hostSendPacket(PKT_COMMAND, cmd, 1);
+    uint8_t cfg[200];
+    for (size_t i = 0; i < sizeof(cfg); i++) cfg[i] = (uint8_t)i;
+    for (int i = 0; i < 20; i++) hostSendPacket(PKT_CONFIG_DATA, cfg, sizeof(cfg));
+
+    Window w = openWindow();
+    runLoops(50, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    r.spurious = (uint32_t)s.size();
+
+    std::vector<Frame> frames;
+    size_t cursor = 0;
+    decodeFrames(&cursor, frames);
+    uint32_t infos = 0;
+    for (const Frame& f : frames) if (f.type == PKT_DEVICE_INFO) infos++;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "replies     %u/100 device-info frames", infos);
+    r.note = buf;
+    if (infos != 100) r.missed += 100 - infos;
+    return r;
+}
+
+// Identify commands padded to 9 data bytes, each with two random bit flips
+// in the padding or checksum, sent once XOR-framed and once CRC-framed.
+// Every device-info reply is a corrupted frame the device accepted.  A run of
+// clean frames afterwards must still get through.
+Result rxCorrupt() {
+    Result r{ "rx-corrupt" };
+    static const int FRAMES = 2000, CLEAN = 10;
+    uint32_t seed = 0x2F6E2B1u;
+    auto rnd = [&seed](uint32_t n) { seed = seed * 1664525u + 1013904223u; return (seed >> 8) % n; };
+
+    uint32_t accepted[2] = {}, rejected[2] = {};
+    for (int mode = 0; mode < 2; mode++) {
+        attachHost(HS_FLAG_BATCH | (mode ? HS_FLAG_CRC16 : 0), true);
+        uint32_t bad0 = serialBridge.rxBadFrames();
+
+        uint8_t cmd[9] = { CMD_IDENTIFY };
+        for (int i = 0; i < FRAMES + CLEAN; i++) {
+            for (int k = 1; k < 9; k++) cmd[k] = (uint8_t)rnd(256);
+            uint8_t f[16];
+            size_t  n = buildFrame(PKT_COMMAND, cmd, sizeof(cmd), f);
+            if (i < FRAMES) {
+                // Two distinct bits from padding (data[1..8]) + checksum
+                uint32_t span = (uint32_t)(n - 5) * 8, a = rnd(span), b;
+                do b = rnd(span); while (b == a);
+                f[5 + a / 8] ^= (uint8_t)(1u << (a % 8));
+                f[5 + b / 8] ^= (uint8_t)(1u << (b % 8));
+            }
+            sim::hostWrite(f, n);
+            if (i == FRAMES - 1) {
+                // Count the corrupted batch's replies before the clean frames
+                Window w = openWindow();
+                runLoops(20, &r.loops);
+                std::vector<Frame> frames;
+                size_t cursor = w.txStart;
+                decodeFrames(&cursor, frames);
+                for (const Frame& fr : frames) if (fr.type == PKT_DEVICE_INFO) accepted[mode]++;
+            }
+        }
+        rejected[mode] = serialBridge.rxBadFrames() - bad0;
+
+        Window w = openWindow();
+        runLoops(20, &r.loops);
+        std::vector<Frame> frames;
+        size_t cursor = w.txStart;
+        decodeFrames(&cursor, frames);
+        uint32_t clean = 0;
+        for (const Frame& fr : frames) if (fr.type == PKT_DEVICE_INFO) clean++;
+        r.expected += CLEAN;
+        r.reported += clean;
+        if (clean < CLEAN) r.missed += CLEAN - clean;
+    }
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+
+    // Any corrupted frame that CRC-16 lets through fails the run
+    r.spurious = accepted[1];
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "corrupted   XOR accepted %u/%d (%.1f%%) rejected %u   CRC-16 accepted %u/%d rejected %u",
+             accepted[0], FRAMES, 100.0 * accepted[0] / FRAMES, rejected[0],
+             accepted[1], FRAMES, rejected[1]);
+    r.note = buf;
+    return r;
+}
+
+// ── RX parser fuzz and throughput ────────────────────────────────────────────
+// A Stream over a byte buffer for a SerialBridge of the bench's own: only the
+// first `exposed` bytes are available yet, so reads split where the script says.
+// TX is thrown away.
+class MemStream : public Stream {
+public:
+    void load(const std::vector<uint8_t>& d) { _d = &d; _pos = _end = 0; reads = 0; }
+    void expose(size_t end)  { _end = std::min(end, _d->size()); }
+    bool drained() const     { return _pos == _d->size(); }
+
+    int available() override { return (int)(_end - _pos); }
+    int read() override      { reads++; return _pos < _end ? (*_d)[_pos++] : -1; }
+    int peek() override      { return _pos < _end ? (*_d)[_pos] : -1; }
+    size_t readBytes(uint8_t* buf, size_t n) override {
+        reads++;
+        n = std::min(n, _end - _pos);
+        memcpy(buf, _d->data() + _pos, n);
+        _pos += n;
+        return n;
+    }
+    size_t write(uint8_t) override                   { return 1; }
+    size_t write(const uint8_t*, size_t n) override  { return n; }
+    int    availableForWrite() override              { return 1 << 16; }
+
+    uint32_t reads = 0;
+
+private:
+    const std::vector<uint8_t>* _d = nullptr;
+    size_t _pos = 0, _end = 0;
+};
+
+// Commands the fuzzed bridge parsed: FUZZ_CMD [index u32 BE] [padding]
+const uint8_t         FUZZ_CMD = 0xF5;
+std::vector<uint32_t> g_fuzzSeen;
+uint32_t              g_fuzzOther = 0;
+
+void onFuzzCommand(uint8_t cmd, const uint8_t* d, size_t n) {
+    if (cmd != FUZZ_CMD || n < 4) { g_fuzzOther++; return; }
+    g_fuzzSeen.push_back((uint32_t)d[0] << 24 | (uint32_t)d[1] << 16 | (uint32_t)d[2] << 8 | d[3]);
+}
+
+// One FUZZ_CMD frame carrying `index` and `pad` random bytes
+size_t fuzzFrame(uint32_t index, uint16_t pad, uint32_t (*rnd)(uint32_t), uint8_t* out) {
+    uint8_t d[SERIAL_RX_BUF_SIZE] = { FUZZ_CMD, (uint8_t)(index >> 24), (uint8_t)(index >> 16),
+                                      (uint8_t)(index >> 8), (uint8_t)index };
+    for (uint16_t k = 0; k < pad; k++) d[5 + k] = (uint8_t)rnd(256);
+    return buildFrame(PKT_COMMAND, d, (uint16_t)(5 + pad), out);
+}
+
+uint32_t g_fuzzSeed = 0x5EED17u;
+uint32_t fuzzRnd(uint32_t n) { g_fuzzSeed = g_fuzzSeed * 1664525u + 1013904223u; return (g_fuzzSeed >> 8) % n; }
+
+// Feed `bytes` to `bridge`, exposing 1 … maxStep more at a time (0 = all at
+// once), until it has read everything.  Wall-clock ns per byte.  Then let
+// SERIAL_RX_TIMEOUT_MS pass, for frames held behind a start byte at the end.
+double feedBridge(SerialBridge& bridge, MemStream& io, const std::vector<uint8_t>& bytes,
+                  uint32_t maxStep) {
+    io.load(bytes);
+    auto t0 = std::chrono::steady_clock::now();
+    size_t end = 0;
+    while (!io.drained()) {
+        end = maxStep ? end + 1 + fuzzRnd(maxStep) : bytes.size();
+        io.expose(end);
+        bridge.update();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() /
+                bytes.size();
+    runUntil(sim::nowUs() + (SERIAL_RX_TIMEOUT_MS + 1) * 1000, nullptr);
+    bridge.update();
+    return ns;
+}
+
+// Three parts.  Fuzz: 20000 command frames, each behind noise, a truncated
+// frame, a header no host sends or a frame with bit flips, fed to a bridge of
+// the bench's own in reads of 1-300 bytes.  Every clean frame must come out,
+// once and in order, and nothing else.  Throughput: 1 MB of 262-byte frames
+// read in bulk, in host ns per byte.  Upload: 16 KB of padded identify
+// commands land while keys are typed, with 2 µs per driver read call.  Every
+// command must be answered, and no event may leave more than 1 ms later after
+// its capture stamp than with the link quiet.
+Result rxFuzz() {
+    Result r{ "rx-fuzz" };
+    static SerialBridge bridge;
+    static MemStream    io;
+    bridge.begin(io);
+    bridge.setCommandCallback(onFuzzCommand);
+    const uint8_t hello[] = { HANDSHAKE_MAGIC_0, HANDSHAKE_MAGIC_1, HANDSHAKE_MAGIC_2, HS_FLAG_CRC16 };
+    std::vector<uint8_t> hs(16);
+    hs.resize(buildFrame(PKT_HANDSHAKE, hello, sizeof(hello), hs.data()));
+    feedBridge(bridge, io, hs, 0);
+
+    // Fuzz
+    static const uint32_t FRAMES = 20000;
+    std::vector<uint8_t> bytes;
+    bytes.reserve(FRAMES * 80);
+    uint8_t f[SERIAL_RX_FRAME_MAX];
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        switch (fuzzRnd(5)) {
+        case 1:                                  // noise, one byte in 8 a start byte
+            for (uint32_t k = fuzzRnd(24); k-- > 0;)
+                bytes.push_back(fuzzRnd(8) ? (uint8_t)fuzzRnd(256) : PKT_START);
+            break;
+        case 2: {                                // a frame cut short
+            size_t n = fuzzFrame(~i, (uint16_t)fuzzRnd(200), fuzzRnd, f);
+            bytes.insert(bytes.end(), f, f + 1 + fuzzRnd((uint32_t)n - 1));
+            break;
+        }
+        case 3:                                  // a header with any type and length
+            bytes.insert(bytes.end(), { PKT_START, (uint8_t)fuzzRnd(256),
+                                        (uint8_t)fuzzRnd(256), (uint8_t)fuzzRnd(256) });
+            break;
+        case 4: {                                // one or two distinct bits flipped past the start
+            size_t   n    = fuzzFrame(~i, (uint16_t)fuzzRnd(40), fuzzRnd, f);
+            uint32_t span = (uint32_t)(n - 1) * 8, a = fuzzRnd(span), b = a;
+            if (fuzzRnd(2)) do b = fuzzRnd(span); while (b == a);
+            f[1 + a / 8] ^= (uint8_t)(1u << (a % 8));
+            if (b != a) f[1 + b / 8] ^= (uint8_t)(1u << (b % 8));
+            bytes.insert(bytes.end(), f, f + n);
+            break;
+        }
+        default:
+            break;
+        }
+        size_t n = fuzzFrame(i, (uint16_t)fuzzRnd(41), fuzzRnd, f);
+        bytes.insert(bytes.end(), f, f + n);
+    }
+    g_fuzzSeen.clear();
+    g_fuzzSeen.reserve(FRAMES);
+    g_fuzzOther = 0;
+    uint32_t bad0 = bridge.rxBadFrames(), hdr0 = bridge.rxOversize();
+    uint64_t allocs0 = allocCount();
+    double   fuzzNs  = feedBridge(bridge, io, bytes, 300);
+    uint32_t inOrder = 0;
+    for (size_t i = 0; i < g_fuzzSeen.size(); i++) inOrder += g_fuzzSeen[i] == inOrder;
+    r.expected += FRAMES;
+    r.missed   += FRAMES - inOrder;
+    r.spurious += (uint32_t)g_fuzzSeen.size() - inOrder + g_fuzzOther;
+    uint32_t fuzzBad = bridge.rxBadFrames() - bad0, fuzzHdr = bridge.rxOversize() - hdr0;
+    size_t   fuzzBytes = bytes.size();
+
+    // Throughput
+    bytes.clear();
+    static const uint32_t BULK = 4000;
+    for (uint32_t i = 0; i < BULK; i++) {
+        size_t n = fuzzFrame(i, SERIAL_RX_BUF_SIZE - 5, fuzzRnd, f);
+        bytes.insert(bytes.end(), f, f + n);
+    }
+    g_fuzzSeen.clear();
+    double   bulkNs = feedBridge(bridge, io, bytes, 0);
+    uint32_t bulkReads = io.reads;
+    if (g_fuzzSeen.size() != BULK) r.missed += BULK - (uint32_t)std::min<size_t>(g_fuzzSeen.size(), BULK);
+    uint64_t parseAllocs = allocCount() - allocs0;
+    if (parseAllocs) r.spurious++;
+
+    // Upload while typing, on the firmware
+    sim::Costs c;
+    c.serialReadUs = 2;
+    sim::setCosts(c);
+    Samples  quiet, busy;                    // capture stamp → serial frame, per pass
+    uint32_t replies = 0, reads = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<Expect> exp;
+        uint64_t t = sim::nowUs() + 5000;
+        for (uint8_t k = 0; k < 10; k++) {
+            uint8_t key = k % NUM_KEYS;
+            scriptKey(key, t, true, 4, 1500);
+            scriptKey(key, t + 30000, false, 4, 1500);
+            exp.push_back({ EVT_KEY_PRESS,   key, t });
+            exp.push_back({ EVT_KEY_RELEASE, key, t + 30000 });
+            t += 40000;
+        }
+        r.expected += (uint32_t)exp.size();
+
+        Window   w      = openWindow();
+        uint32_t reads0 = sim::rxReadCalls();
+        runUntil(exp[0].tUs, &r.loops);
+        if (pass) {
+            // Lands with the first press's bounce
+            uint8_t cmd[SERIAL_RX_BUF_SIZE] = { CMD_IDENTIFY };
+            for (int i = 0; i < 64; i++) hostSendPacket(PKT_COMMAND, cmd, 250);
+        }
+        runUntil(t + 50000, &r.loops);
+        reads = sim::rxReadCalls() - reads0;
+        std::vector<Observed> s, b;
+        closeWindow(w, r, s, b);
+        r.serialLatMs.clear();                   // what prints is the upload pass
+        r.serialRelMs.clear();
+        match(exp, s, false, r.serialLatMs, r.serialRelMs, r);
+        for (const Observed& o : s) (pass ? busy : quiet).add((o.tUs - o.capUs) / 1000.0);
+
+        std::vector<Frame> frames;
+        size_t cursor = w.txStart;
+        decodeFrames(&cursor, frames);
+        if (pass) for (const Frame& fr : frames) if (fr.type == PKT_DEVICE_INFO) replies++;
+    }
+    sim::setCosts(sim::Costs());
+    r.reported += inOrder;                   // closeWindow() counted the key events
+    if (replies != 64) r.missed += 64 - std::min(replies, 64u);
+    if (busy.max() > quiet.max() + 1.0) r.missed++;
+
+    char buf[400];
+    snprintf(buf, sizeof(buf),
+             "fuzz        %u/%u frames in order, %u other   %zu bytes, %.1f ns/byte   bad %u  headers %u\n"
+             "  bulk        %u frames, %.2f ns/byte (%.0f MB/s)   %.0f bytes per read   allocs %llu\n"
+             "  upload      64 × 256 B while typing: replies %u/64   %u driver reads   "
+             "capture→serial max %.2f ms (quiet %.2f)",
+             inOrder, FRAMES, g_fuzzOther, fuzzBytes, fuzzNs, fuzzBad, fuzzHdr,
+             BULK, bulkNs, 1e3 / bulkNs, (double)bytes.size() / bulkReads,
+             (unsigned long long)parseAllocs, replies, reads, busy.max(), quiet.max());
+    r.note = buf;
+    return r;
+}
+
+// CMD_SET_SCAN_GOVERNOR over BLE, which works with or without a USB host;
+// the input task restarts at full rate
+void setGovernor(uint8_t mode) {
+    const uint8_t cmd[2] = { CMD_SET_SCAN_GOVERNOR, mode };
+    sim::bleWrite(COMMAND_CHAR_UUID, cmd, sizeof(cmd));
+    runUntil(sim::nowUs() + 2000, nullptr);
+}
+
+// Typing, a fast spin and a host command burst at once, over a 115200-baud
+// UART and a BLE link whose notify() blocks for 3 ms.  Shows how much the
+// transport can push the input sampling period around.
+Result jitter() {
+    Result r{ "jitter" };
+    r.histogram = true;
+    setGovernor(GOV_MODE_FIXED);        // the histogram shows the transport alone
+
+    sim::Costs slow;
+    slow.serialByteNs = 86805;
+    slow.notifyUs     = 3000;
+    slow.analogReadUs = 50;
+    sim::setCosts(slow);
+
+    std::vector<Expect> exp;
+    uint64_t t0 = sim::nowUs() + 5000;
+    uint64_t t  = t0;
+    for (uint8_t k = 0; k < NUM_KEYS; k++) {
+        scriptKey(k, t, true, 4, 1500);
+        scriptKey(k, t + 45000, false, 4, 1500);
+        exp.push_back({ EVT_KEY_PRESS,   k, t });
+        exp.push_back({ EVT_KEY_RELEASE, k, t + 45000 });
+        t += 60000;
+    }
+    scriptSpin(t0 + 100000, +1, 60, 1000);
+    uint8_t cmd[1] = { CMD_IDENTIFY };
+    for (int i = 0; i < 20; i++) hostSendPacket(PKT_COMMAND, cmd, 1);
+    r.expected = (uint32_t)exp.size();
+
+    // Leave the transport time to drain its backlog over the slow links
+    Window   w  = openWindow();
+    uint32_t d0 = serialBridge.txDeferred(), x0 = serialBridge.txDropped();
+    runUntil(t + 500000, &r.loops);
+    sim::setCosts(sim::Costs());
+    setGovernor(DEFAULT_GOV_MODE);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+
+    std::vector<Observed> keysOnly;
+    for (const Observed& o : s)
+        if (o.evt == EVT_KEY_PRESS || o.evt == EVT_KEY_RELEASE) keysOnly.push_back(o);
+    match(exp, keysOnly, false, r.serialLatMs, r.serialRelMs, r);
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "serial tx   frames deferred %u  events dropped %u",
+             serialBridge.txDeferred() - d0, serialBridge.txDropped() - x0);
+    r.note = buf;
+    return r;
+}
+
+// Host-side view of the pressed keys, built from BLE notifies
+struct HostView {
+    bool     useSeq;             // watch sequence numbers and apply snapshots
+    std::bitset<NUM_KEYS> pressed;
+    uint8_t  last    = 0;        // newest sequence number applied
+    bool     synced  = false;
+    uint32_t gaps    = 0;
+    uint64_t gapUs   = 0;        // 0 = no resync outstanding
+    Samples  resyncMs{ 64 };
+
+    explicit HostView(bool seq) : useSeq(seq) {}
+
+    // true = a gap was just seen and a snapshot should be requested
+    bool event(uint8_t type, uint8_t a, uint8_t seq, uint64_t tUs) {
+        bool gap = false;
+        if (useSeq && synced) {
+            if ((int8_t)(seq - last) <= 0) return false;        // already covered
+            if (seq != (uint8_t)(last + 1)) {
+                gaps++;
+                gap = gapUs == 0;
+                if (gap) gapUs = tUs;
+            }
+        }
+        last   = seq;
+        synced = true;
+        if (type == EVT_KEY_PRESS   && a < NUM_KEYS) pressed.set(a);
+        if (type == EVT_KEY_RELEASE && a < NUM_KEYS) pressed.reset(a);
+        return gap;
+    }
+
+    void snapshot(const uint8_t* d, uint16_t len, uint64_t tUs) {
+        if (!useSeq || len < 3) return;
+        if (synced && (int8_t)(d[0] - last) < 0) return;       // older than what we have
+        pressed.reset();
+        for (uint8_t k = 0; k < d[2] && k < NUM_KEYS && 3 + k / 8 < len; k++)
+            pressed[k] = (d[3 + k / 8] >> (k % 8)) & 1;
+        last   = d[0];
+        synced = true;
+        if (gapUs) { resyncMs.add((tUs - gapUs) / 1000.0); gapUs = 0; }
+    }
+};
+
+// Chords held for different lengths over a BLE link that loses every third
+// event notify.  A host that ignores sequence numbers is compared with one
+// that requests a snapshot on every gap (and takes the periodic ones); both
+// are scored against a host that saw every notify.
+Result resync() {
+    Result r{ "resync" };
+    static const uint32_t HOLD_MS[4] = { 90, 180, 420, 700 };
+    uint64_t t = sim::nowUs() + 5000;
+    for (int n = 0; n < 24; n++) {
+        uint8_t k1 = (uint8_t)(n % NUM_KEYS), k2 = (uint8_t)((n * 3 + 1) % NUM_KEYS);
+        if (k2 == k1) k2 = (uint8_t)((k1 + 1) % NUM_KEYS);
+        scriptKey(k1, t, true, 2, 800);
+        scriptKey(k2, t + 30000, true, 2, 800);
+        scriptKey(k2, t + 30000 + HOLD_MS[n % 4] * 500, false, 2, 800);
+        scriptKey(k1, t + HOLD_MS[n % 4] * 1000, false, 2, 800);
+        t += (HOLD_MS[n % 4] + 150) * 1000;
+    }
+    r.expected = 24 * 4;
+
+    HostView ref(false), naive(false), seq(true);
+    const NimBLECharacteristic* batchChr = sim::bleFind(EVENT_BATCH_CHAR_UUID);
+    const NimBLECharacteristic* stateChr = sim::bleFind(STATE_CHAR_UUID);
+    uint32_t eventNotifies = 0, lost = 0, snapshots = 0, requests = 0;
+    uint64_t divergeNaive = 0, divergeSeq = 0;
+
+    std::vector<Observed> obs;
+    obs.reserve(EventBatch::MAX_EVENTS);
+    Window w = openWindow();
+    size_t next = w.notifyStart;
+    while (sim::nowUs() < t + 300000) {
+        runLoops(1, &r.loops);
+        for (; next < sim::notifyCount(); next++) {
+            const sim::Notify& nt = sim::notifyAt(next);
+            if (nt.chr == stateChr) {
+                snapshots++;
+                seq.snapshot(nt.data, nt.len, nt.tUs);
+                continue;
+            }
+            if (nt.chr != batchChr) continue;
+            obs.clear();
+            unpackBatch(nt.tUs, nt.data, nt.len, obs);
+            bool drop = ++eventNotifies % 3 == 0;
+            lost += drop;
+            bool ask = false;
+            for (const Observed& o : obs) {
+                ref.event(o.evt, o.a, o.seq, o.tUs);
+                if (drop) continue;
+                naive.event(o.evt, o.a, o.seq, o.tUs);
+                ask |= seq.event(o.evt, o.a, o.seq, o.tUs);
+            }
+            if (ask) {
+                const uint8_t cmd[1] = { CMD_GET_SNAPSHOT };
+                sim::bleWrite(COMMAND_CHAR_UUID, cmd, 1);
+                requests++;
+            }
+        }
+        divergeNaive += (naive.pressed ^ ref.pressed).count();
+        divergeSeq   += (seq.pressed ^ ref.pressed).count();
+    }
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    r.seqGaps = 0;                      // the loss is deliberate here
+    r.missed  = (uint32_t)seq.pressed.count();
+    for (size_t i = 0; i < seq.resyncMs.count(); i++) r.resyncMs.add(seq.resyncMs.at(i));
+
+    char buf[240];
+    snprintf(buf, sizeof(buf),
+             "lossy host  notifies lost %u/%u  gaps %u  requests %u  snapshots %u\n"
+             "  stuck       key·ms  no-seq %llu  seq+snapshot %llu   stuck at end  %d vs %d keys",
+             lost, eventNotifies, seq.gaps, requests, snapshots,
+             (unsigned long long)divergeNaive, (unsigned long long)divergeSeq,
+             (int)naive.pressed.count(), (int)seq.pressed.count());
+    r.note = buf;
+    return r;
+}
+
+// Host-side decoder for one PKT_TRACE record
+std::string describeTrace(const uint8_t* p) {
+    uint32_t t = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    uint8_t  a = p[5], b = p[6], c = p[7];
+    char     buf[96];
+    int      n = snprintf(buf, sizeof(buf), "%10.3f ms  ", t / 1000.0);
+    switch (p[4]) {
+    case TR_EVENT:
+        if (a == EVT_KEY_PRESS || a == EVT_KEY_RELEASE)
+            snprintf(buf + n, sizeof(buf) - n, "key %u %s  seq %u", b, a == EVT_KEY_PRESS ? "down" : "up", c);
+        else if (a == EVT_ENCODER_ROTATE)
+            snprintf(buf + n, sizeof(buf) - n, "enc %+d  seq %u", (int8_t)b, c);
+        else
+            snprintf(buf + n, sizeof(buf) - n, "enc btn %s  seq %u", a == EVT_ENCODER_BTN_PRESS ? "down" : "up", c);
+        break;
+    case TR_COMMAND:        snprintf(buf + n, sizeof(buf) - n, "cmd 0x%02X len %u", a, b);           break;
+    case TR_CONFIG_WRITE:   snprintf(buf + n, sizeof(buf) - n, "cfg 0x%02X ignored", a);             break;
+    case TR_DEBOUNCE:       snprintf(buf + n, sizeof(buf) - n, "debounce %u ms%s", b << 8 | c, a ? " adaptive" : ""); break;
+    case TR_BATTERY:        snprintf(buf + n, sizeof(buf) - n, "battery %u%% %u mV", a, b << 8 | c); break;
+    case TR_SLEEP:          snprintf(buf + n, sizeof(buf) - n, "sleep");                             break;
+    case TR_WAKE:           snprintf(buf + n, sizeof(buf) - n, "wake cause %u sources 0x%02X", a, b); break;
+    case TR_BLE_CONNECT:    snprintf(buf + n, sizeof(buf) - n, "ble connect mtu %u", b << 8 | c);    break;
+    case TR_BLE_DISCONNECT: snprintf(buf + n, sizeof(buf) - n, "ble disconnect %u", b << 8 | c);     break;
+    case TR_BLE_SUBSCRIBE:  snprintf(buf + n, sizeof(buf) - n, "ble subscribe %u %s", a, b ? "on" : "off"); break;
+    case TR_HANDSHAKE:      snprintf(buf + n, sizeof(buf) - n, "handshake flags 0x%02X", a);         break;
+    case TR_BLE_MTU:        snprintf(buf + n, sizeof(buf) - n, "ble mtu %u", b << 8 | c);            break;
+    case TR_ENCODER_RATE:   snprintf(buf + n, sizeof(buf) - n, "encoder rate %u Hz", b << 8 | c);    break;
+    case TR_LINK_REQUEST:   snprintf(buf + n, sizeof(buf) - n, "link profile %u asked %u-%u", a, b, c); break;
+    case TR_LINK_PARAMS:    snprintf(buf + n, sizeof(buf) - n, "link interval %u latency %u", a << 8 | b, c); break;
+    case TR_LINK_PHY:       snprintf(buf + n, sizeof(buf) - n, "link phy tx %u rx %u", a, b);        break;
+    case TR_SCAN_TIER:      snprintf(buf + n, sizeof(buf) - n, "scan tier %u mode %u%s", a, b, c ? " woken" : ""); break;
+    case TR_ADVERTISE:      snprintf(buf + n, sizeof(buf) - n, "advertise phase %u interval %u", a, b << 8 | c); break;
+    case TR_WAKE_EVENT:     snprintf(buf + n, sizeof(buf) - n, "wake → first event %u µs", b << 8 | c); break;
+    case TR_CHATTER:        snprintf(buf + n, sizeof(buf) - n, "key %u chatters, bursts %u ms, window %u ms", a, b, c); break;
+    case TR_GESTURE:        snprintf(buf + n, sizeof(buf) - n, "gestures key %u hold %u0 double %u0 ms", a, b, c); break;
+    case TR_BLE_CONGESTION: snprintf(buf + n, sizeof(buf) - n, "ble %s, %u waiting, %u buffers free", a ? "congested" : "clear", b, c); break;
+    default:                snprintf(buf + n, sizeof(buf) - n, "id 0x%02X %u %u %u", p[4], a, b, c); break;
+    }
+    return buf;
+}
+
+// Fetch the trace ring from `since`; returns the dump's end index.
+uint32_t fetchTrace(uint32_t since, std::vector<std::string>& lines,
+                    std::vector<std::array<uint8_t, 3>>& events, uint32_t* frames,
+                    uint32_t* skipped, double* fetchMs) {
+    const uint8_t cmd[5] = { CMD_GET_TRACE, (uint8_t)(since >> 24), (uint8_t)(since >> 16),
+                             (uint8_t)(since >> 8), (uint8_t)since };
+    size_t   cursor = sim::txCount();
+    uint64_t t0     = sim::nowUs();
+    hostSendPacket(PKT_COMMAND, cmd, sizeof(cmd));
+
+    uint32_t next = since, end = 0;
+    bool     done = false;
+    for (int i = 0; i < 200 && !done; i++) {
+        runLoops(1, nullptr);
+        std::vector<Frame> fr;
+        decodeFrames(&cursor, fr);
+        for (const Frame& f : fr) {
+            if (f.type != PKT_TRACE || f.len < TRACE_HEADER_BYTES) continue;
+            uint32_t first = ((uint32_t)f.data[0] << 24) | ((uint32_t)f.data[1] << 16) |
+                             ((uint32_t)f.data[2] << 8) | f.data[3];
+            end = ((uint32_t)f.data[4] << 24) | ((uint32_t)f.data[5] << 16) |
+                  ((uint32_t)f.data[6] << 8) | f.data[7];
+            uint8_t count = f.data[8];
+            if (first > next) *skipped += first - next;
+            (*frames)++;
+            for (uint8_t k = 0; k < count; k++) {
+                const uint8_t* p = f.data + TRACE_HEADER_BYTES + k * TRACE_RECORD_BYTES;
+                lines.push_back(describeTrace(p));
+                if (p[4] == TR_EVENT) events.push_back({ p[5], p[6], p[7] });
+            }
+            next = first + count;
+            if (next == end) { done = true; *fetchMs = (f.tUs - t0) / 1000.0; }
+        }
+    }
+    return end;
+}
+
+// Type every key once (as many as the ring holds the events of on a large
+// board), then pull the trace ring over serial and decode it on the host.
+// Every key event sent must be in the trace with its sequence number, and a
+// second fetch from the returned end must hold nothing but its own request.
+Result traceFetch() {
+    Result r{ "trace" };
+    const uint8_t typed = NUM_KEYS < TRACE_RING_SIZE / 4 ? NUM_KEYS : TRACE_RING_SIZE / 4;
+    std::vector<Expect> exp;
+    uint64_t t = sim::nowUs() + 5000;
+    for (uint8_t k = 0; k < typed; k++) {
+        scriptKey(k, t, true, 4, 1500);
+        scriptKey(k, t + 40000, false, 4, 1500);
+        exp.push_back({ EVT_KEY_PRESS,   k, t });
+        exp.push_back({ EVT_KEY_RELEASE, k, t + 40000 });
+        t += 60000;
+    }
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(t + 50000, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    match(exp, s, false, r.serialLatMs, r.serialRelMs, r);
+
+    std::vector<std::string>            lines, again;
+    std::vector<std::array<uint8_t, 3>> events, none;
+    uint32_t frames = 0, skipped = 0, frames2 = 0;
+    double   fetchMs = 0, fetchMs2 = 0;
+    uint32_t end = fetchTrace(0, lines, events, &frames, &skipped, &fetchMs);
+    fetchTrace(end, again, none, &frames2, &skipped, &fetchMs2);
+
+    // Each key event on the wire must appear in the trace
+    uint32_t traced = 0;
+    for (const Observed& o : s)
+        for (const auto& e : events)
+            if (e[0] == o.evt && e[1] == o.a && e[2] == o.seq) { traced++; break; }
+    r.missed += (uint32_t)s.size() - traced;
+    bool onlyRequest = again.size() == 1 && again[0].find("cmd 0x0C") != std::string::npos;
+    if (!onlyRequest) r.spurious += (uint32_t)again.size();
+
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "trace       %zu records in %u frames, %.1f ms  (%u key events traced of %zu)  "
+             "refetch %zu record\n    last: %s",
+             lines.size(), frames, fetchMs, traced, s.size(), again.size(),
+             lines.empty() ? "-" : lines.back().c_str());
+    r.note = buf;
+    return r;
+}
+
+// Host-side decoder for a PKT_STATS payload / Stats characteristic value
+struct StatsView {
+    struct Hist { uint32_t count[HIST_BUCKETS]; uint32_t max; uint32_t total; };
+
+    bool     ok = false;
+    uint32_t uptimeMs, scanWorkMaxUs, ringDropped, notifyFailed, notifySkipped;
+    uint32_t bleRetried, bleDropped, bleCoalesced;
+    uint32_t txDeferred, txDropped, rxBad, rxOversize, isrHits, heapFree, heapMinFree;
+    uint16_t ringHigh;
+    Hist     scan, latency;
+
+    static uint32_t u32(const uint8_t*& p) {
+        uint32_t v = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        p += 4;
+        return v;
+    }
+    static Hist hist(const uint8_t*& p) {
+        Hist h{};
+        for (int b = 0; b < HIST_BUCKETS; b++) h.total += h.count[b] = u32(p);
+        h.max = u32(p);
+        return h;
+    }
+
+    StatsView(const uint8_t* d, uint16_t len) {
+        if (len < STATS_MAX_BYTES || d[0] != STATS_VERSION) return;
+        const uint8_t* p = d + 1;
+        uptimeMs      = u32(p);
+        scan          = hist(p);
+        scanWorkMaxUs = u32(p);
+        latency       = hist(p);
+        ringDropped   = u32(p);
+        ringHigh      = (uint16_t)(p[0] << 8 | p[1]);
+        p += 2;
+        notifyFailed  = u32(p);
+        notifySkipped = u32(p);
+        bleRetried    = u32(p);
+        bleDropped    = u32(p);
+        bleCoalesced  = u32(p);
+        txDeferred    = u32(p);
+        txDropped     = u32(p);
+        rxBad         = u32(p);
+        rxOversize    = u32(p);
+        isrHits       = u32(p);
+        heapFree      = u32(p);
+        heapMinFree   = u32(p);
+        ok = true;
+    }
+};
+
+// Send CMD_GET_STATS over serial (or BLE) and wait for the serial reply; the
+// BLE reply to the same request, if any, lands in *ble.
+std::vector<uint8_t> fetchStats(bool overBle, std::vector<uint8_t>* ble, double* fetchMs) {
+    const uint8_t cmd[1] = { CMD_GET_STATS };
+    size_t   cursor = sim::txCount(), next = sim::notifyCount();
+    uint64_t t0     = sim::nowUs();
+    if (overBle) sim::bleWrite(COMMAND_CHAR_UUID, cmd, 1);
+    else         hostSendPacket(PKT_COMMAND, cmd, 1);
+
+    const NimBLECharacteristic* statsChr = sim::bleFind(STATS_CHAR_UUID);
+    std::vector<uint8_t> out;
+    for (int i = 0; i < 50 && out.empty(); i++) {
+        runLoops(1, nullptr);
+        std::vector<Frame> fr;
+        decodeFrames(&cursor, fr);
+        for (const Frame& f : fr)
+            if (f.type == PKT_STATS) {
+                out.assign(f.data, f.data + f.len);
+                *fetchMs = (f.tUs - t0) / 1000.0;
+            }
+    }
+    for (; ble && next < sim::notifyCount(); next++) {
+        const sim::Notify& n = sim::notifyAt(next);
+        if (n.chr == statsChr) ble->assign(n.data, n.data + n.len);
+    }
+    return out;
+}
+
+// Typing and a spin while every fifth notify() is refused, plus corrupt and
+// oversized host frames.  The counters read over serial before and over BLE
+// after must account for exactly what was scripted, and both links must
+// carry the same bytes.  Every refused notify is retried: BLE must show no
+// sequence gap.
+Result statsFetch() {
+    Result r{ "stats" };
+    static const uint16_t DETENTS = 20;
+    std::vector<Expect> exp;
+    uint64_t t = sim::nowUs() + 5000;
+    for (uint8_t k = 0; k < NUM_KEYS; k++) {
+        scriptKey(k, t, true, 4, 1500);
+        scriptKey(k, t + 40000, false, 4, 1500);
+        exp.push_back({ EVT_KEY_PRESS,   k, t });
+        exp.push_back({ EVT_KEY_RELEASE, k, t + 40000 });
+        t += 60000;
+    }
+    uint64_t end = scriptSpin(t, +1, DETENTS, 2000);
+    r.expected = (uint32_t)exp.size();
+
+    double fetchMs = 0;
+    StatsView a = [&] { auto v = fetchStats(false, nullptr, &fetchMs); return StatsView(v.data(), (uint16_t)v.size()); }();
+    uint64_t  ta = sim::nowUs();
+
+    // Three frames with a flipped checksum, one whose length overflows the
+    // RX buffer (payload of zeros, so nothing in it looks like a frame)
+    static const int BAD = 3;
+    for (int i = 0; i < BAD; i++) {
+        uint8_t cmd[1] = { CMD_IDENTIFY }, f[16];
+        size_t  n = buildFrame(PKT_COMMAND, cmd, 1, f);
+        f[n - 1] ^= 0x01;
+        sim::hostWrite(f, n);
+    }
+    static uint8_t big[4 + 300] = { PKT_START, PKT_COMMAND, 300 >> 8, 300 & 0xFF };
+    sim::hostWrite(big, sizeof(big));
+
+    uint32_t refused0 = sim::notifyRefused();
+    sim::bleFailNotifies(5);
+    Window w = openWindow();
+    runUntil(end + 50000, &r.loops);
+    sim::bleFailNotifies(0);
+    uint32_t refused = sim::notifyRefused() - refused0;
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+
+    std::vector<Observed> keysOnly;
+    for (const Observed& o : s)
+        if (o.evt == EVT_KEY_PRESS || o.evt == EVT_KEY_RELEASE) keysOnly.push_back(o);
+    match(exp, keysOnly, false, r.serialLatMs, r.serialRelMs, r);
+
+    std::vector<uint8_t> bleBytes;
+    std::vector<uint8_t> serialBytes = fetchStats(true, &bleBytes, &fetchMs);
+    uint64_t  tb = sim::nowUs();
+    StatsView z(serialBytes.data(), (uint16_t)serialBytes.size());
+
+    // Every check that fails counts as one missed event
+    uint32_t scans   = z.scan.total - a.scan.total;
+    uint32_t onTime  = z.scan.count[1] - a.scan.count[1];
+    uint32_t elapsed = (uint32_t)((tb - ta) / 1000);
+    uint32_t lat     = z.latency.total - a.latency.total;
+    uint32_t isr     = z.isrHits - a.isrHits;
+    bool checks[] = {
+        a.ok && z.ok,
+        bleBytes == serialBytes,
+        scans + 2 >= elapsed && scans <= elapsed + 2,
+        onTime == scans,
+        lat == (uint32_t)s.size(),
+        z.notifyFailed - a.notifyFailed == refused,
+        z.bleRetried - a.bleRetried == refused && z.bleDropped == a.bleDropped,
+        z.rxBad - a.rxBad == BAD,
+        z.rxOversize - a.rxOversize == 1,
+        isr == DETENTS * 4u,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+
+    char buf[400];
+    snprintf(buf, sizeof(buf),
+             "stats       %zu bytes, %.1f ms   serial == BLE %s\n"
+             "  scan        %u periods in %u ms, %u in 0.9-1.1 ms, max %u µs   work max %u µs\n"
+             "  latency     %u events  <1 ms %u  1-2 ms %u  ≥2 ms %u  max %.2f ms\n"
+             "  counters    notify failed %u (sim refused %u)  retried %u  skipped %u   rx bad %u  oversize %u"
+             "   encoder isr %u/%u   heap %u free, %u min",
+             serialBytes.size(), fetchMs, bleBytes == serialBytes ? "yes" : "NO",
+             scans, elapsed, onTime, z.scan.max, z.scanWorkMaxUs,
+             lat, z.latency.count[0] - a.latency.count[0], z.latency.count[1] - a.latency.count[1],
+             lat - (z.latency.count[0] - a.latency.count[0]) - (z.latency.count[1] - a.latency.count[1]),
+             z.latency.max / 1000.0,
+             z.notifyFailed - a.notifyFailed, refused, z.bleRetried - a.bleRetried,
+             z.notifySkipped - a.notifySkipped,
+             z.rxBad - a.rxBad, z.rxOversize - a.rxOversize, isr, DETENTS * 4u,
+             z.heapFree, z.heapMinFree);
+    r.note = buf;
+    return r;
+}
+
+// Host-side decoder for a PKT_LINK payload / Link characteristic value
+struct LinkView {
+    bool     ok = false;
+    uint8_t  mode = 0, profile = 0, txPhy = 0, rxPhy = 0;         // 0 when too short
+    uint16_t interval = 0, latency = 0, timeout = 0, dataLen = 0, mtu = 0;
+
+    LinkView(const uint8_t* d, uint16_t len) {
+        if (len < LINK_PARAMS_BYTES) return;
+        mode     = d[0];
+        profile  = d[1];
+        interval = (uint16_t)(d[2] << 8 | d[3]);
+        latency  = (uint16_t)(d[4] << 8 | d[5]);
+        timeout  = (uint16_t)(d[6] << 8 | d[7]);
+        txPhy    = d[8];
+        rxPhy    = d[9];
+        dataLen  = (uint16_t)(d[10] << 8 | d[11]);
+        mtu      = (uint16_t)(d[12] << 8 | d[13]);
+        ok = true;
+    }
+
+    // What the simulated link is actually using.  The device only knows the
+    // data length it asked for; the controllers settle it between themselves.
+    bool matchesLink() const {
+        const NimBLEConnInfo& c = sim::bleLink();
+        return ok && interval == c.getConnInterval() && latency == c.getConnLatency() &&
+               timeout == c.getConnTimeout() && txPhy == sim::blePhy() &&
+               rxPhy == sim::blePhy() && dataLen == LINK_DATA_LEN && mtu == c.getMTU();
+    }
+};
+
+// CMD_GET_LINK over serial; both links must answer with the same bytes and
+// they must describe the link as it is.  Returns false on any mismatch.
+bool checkLink(std::vector<uint8_t>* out) {
+    const uint8_t cmd[1] = { CMD_GET_LINK };
+    size_t cursor = sim::txCount(), next = sim::notifyCount();
+    hostSendPacket(PKT_COMMAND, cmd, 1);
+
+    const NimBLECharacteristic* linkChr = sim::bleFind(LINK_CHAR_UUID);
+    std::vector<uint8_t> ble;
+    out->clear();
+    for (int i = 0; i < 50 && out->empty(); i++) {
+        runLoops(1, nullptr);
+        std::vector<Frame> fr;
+        decodeFrames(&cursor, fr);
+        for (const Frame& f : fr)
+            if (f.type == PKT_LINK) out->assign(f.data, f.data + f.len);
+    }
+    for (; next < sim::notifyCount(); next++) {
+        const sim::Notify& n = sim::notifyAt(next);
+        if (n.chr == linkChr) ble.assign(n.data, n.data + n.len);
+    }
+    return !out->empty() && ble == *out && LinkView(out->data(), (uint16_t)out->size()).matchesLink();
+}
+
+// Eager presses on up to ten keys, spaced so they land at every phase of
+// the connection interval.  BLE press latency goes to `lat`.
+void typeOverLink(Result& r, Samples& lat) {
+    const uint8_t keys = NUM_KEYS < 10 ? NUM_KEYS : 10;
+    std::vector<Expect> exp;
+    uint64_t t = sim::nowUs() + 5000;
+    for (int round = 0; round < 3; round++) {
+        for (uint8_t k = 0; k < keys; k++) {
+            scriptKey(k, t, true, 4, 1500);
+            scriptKey(k, t + 40000, false, 4, 1500);
+            exp.push_back({ EVT_KEY_PRESS,   k, t });
+            exp.push_back({ EVT_KEY_RELEASE, k, t + 40000 });
+            t += 61300;
+        }
+    }
+
+    Result scratch{ "" };
+    Window w = openWindow();
+    runUntil(t + 100000, &r.loops);
+    std::vector<Observed> s, b;
+    closeWindow(w, scratch, s, b);
+    Samples rel;
+    match(exp, s, false, r.serialLatMs, r.serialRelMs, scratch);
+    match(exp, b, true, lat, rel, scratch);
+    r.expected += (uint32_t)exp.size();
+    r.reported += scratch.reported;
+    r.frames   += scratch.frames;
+    r.notifies += scratch.notifies;
+    r.allocs   += scratch.allocs;
+    r.missed   += scratch.missed;
+    r.spurious += scratch.spurious;
+}
+
+void reconnect(const sim::BleCentral& central) {
+    sim::bleDisconnect();
+    sim::bleConnect(247, central);
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+    runUntil(sim::nowUs() + 500000, nullptr);       // PHY and parameter updates
+}
+
+// One line of the report; `want` false counts as a missed event
+void linkLine(Result& r, const char* label, bool want, const Samples& lat) {
+    std::vector<uint8_t> v;
+    bool     ok = checkLink(&v) && want;
+    LinkView l(v.data(), (uint16_t)v.size());
+    char     buf[200];
+    int      n = snprintf(buf, sizeof(buf), "%s%-14s %6.2f ms  latency %u  %s  %3u B",
+                          r.note.empty() ? "" : "\n  ", label, l.interval * 1.25, l.latency,
+                          l.txPhy == BLE_GAP_LE_PHY_2M ? "2M" : "1M", sim::bleDataLen());
+    if (lat.count())
+        n += snprintf(buf + n, sizeof(buf) - n, "   press→BLE p50 %5.2f  max %5.2f ms", lat.pct(50), lat.max());
+    snprintf(buf + n, sizeof(buf) - n, "%s", ok ? "" : "  MISMATCH");
+    r.note += buf;
+    if (!ok) r.missed++;
+}
+
+// Connection profiles, eager presses over each.  A central that ignores
+// parameter requests leaves the link on its own 30 ms interval; one that
+// accepts them gets the performance profile, 2M PHY and the long data
+// length shortly after connecting.  CMD_SET_LINK_PROFILE over BLE pins the
+// battery profile.  In auto mode the link drops to battery after
+// LINK_IDLE_MS without input and the next press brings performance back.
+// Each time the device's report must match what the link is using.
+Result linkProfiles() {
+    Result r{ "link" };
+    keyMatrix.setEagerPress(true);
+
+    sim::BleCentral stubborn;
+    stubborn.acceptParams = false;
+    stubborn.phy2M        = false;
+    stubborn.maxDataLen   = 27;
+    reconnect(stubborn);
+    Samples fixed;
+    typeOverLink(r, fixed);
+    const NimBLEConnInfo& c = sim::bleLink();
+    linkLine(r, "central's own", c.getConnInterval() == stubborn.interval, fixed);
+
+    reconnect(sim::BleCentral());
+    Samples perf;
+    typeOverLink(r, perf);
+    r.bleLatMs = perf;
+    linkLine(r, "performance", c.getConnInterval() >= LINK_PERF_INTERVAL_MIN &&
+                               c.getConnInterval() <= LINK_PERF_INTERVAL_MAX &&
+                               sim::blePhy() == BLE_GAP_LE_PHY_2M &&
+                               sim::bleDataLen() == LINK_DATA_LEN, perf);
+
+    const uint8_t battery[2] = { CMD_SET_LINK_PROFILE, LINK_BATTERY };
+    sim::bleWrite(COMMAND_CHAR_UUID, battery, sizeof(battery));
+    runUntil(sim::nowUs() + 300000, nullptr);
+    Samples batt;
+    typeOverLink(r, batt);
+    bool pinned = c.getConnInterval() >= LINK_BATT_INTERVAL_MIN &&
+                  c.getConnInterval() <= LINK_BATT_INTERVAL_MAX &&
+                  c.getConnLatency() == LINK_BATT_LATENCY;
+    linkLine(r, "battery", pinned, batt);
+    double idleWakes = 1e6 / (c.getConnInterval() * 1250.0 * (c.getConnLatency() + 1));
+
+    // Auto: idle out, then one press
+    const uint8_t autoMode[2] = { CMD_SET_LINK_PROFILE, LINK_AUTO };
+    hostSendPacket(PKT_COMMAND, autoMode, sizeof(autoMode));
+    runUntil(sim::nowUs() + LINK_IDLE_MS * 1000ull + 1000000, nullptr);
+    bool idled = c.getConnLatency() == LINK_BATT_LATENCY;
+    Samples none, wake;
+    linkLine(r, "auto, idle", idled, none);
+
+    uint64_t t = sim::nowUs() + 5000;
+    scriptKey(0, t, true, 4, 1500);
+    scriptKey(0, t + 40000, false, 4, 1500);
+    std::vector<Expect> exp = { { EVT_KEY_PRESS, 0, t }, { EVT_KEY_RELEASE, 0, t + 40000 } };
+    Window w = openWindow();
+    runUntil(t + 40000 + (sim::UPDATE_EVENTS + 2) * LINK_BATT_INTERVAL_MAX * 1250ull, nullptr);
+    std::vector<Observed> s, b;
+    Result scratch{ "" };
+    closeWindow(w, scratch, s, b);
+    Samples rel;
+    match(exp, b, true, wake, rel, scratch);
+    r.expected += (uint32_t)exp.size();
+    r.missed   += scratch.missed;
+    r.spurious += scratch.spurious;
+    linkLine(r, "auto, typing", c.getConnLatency() == LINK_PERF_LATENCY &&
+                                c.getConnInterval() <= LINK_PERF_INTERVAL_MAX, wake);
+
+    char buf[120];
+    snprintf(buf, sizeof(buf), "\n  idle radio  battery %.1f connection events/s, performance %.1f",
+             idleWakes, 1e6 / (LINK_PERF_INTERVAL_MIN * 1250.0));
+    r.note += buf;
+
+    reconnect(sim::BleCentral());
+    keyMatrix.setEagerPress(DEFAULT_EAGER_PRESS);
+    return r;
+}
+
+// ── HID over GATT ────────────────────────────────────────────────────────────
+using KbReport = std::array<uint8_t, HID_KEYBOARD_BYTES>;
+
+struct HidExpect {
+    KbReport kb;                 // keyboard page, or
+    uint16_t usage;              // consumer page when `consumer`
+    bool     consumer;
+    uint64_t edgeUs;             // physical edge that causes it, 0 = not timed
+    bool     release;
+};
+
+struct HidSeen {
+    KbReport kb;
+    uint16_t usage;
+    bool     consumer;
+    uint64_t hostUs;
+};
+
+KbReport kbReport(uint8_t mods, std::initializer_list<uint8_t> codes) {
+    KbReport r{};
+    r[0] = mods;
+    uint8_t i = 2;
+    for (uint8_t c : codes) r[i++] = c;
+    return r;
+}
+
+void sendKeyMap(uint8_t key, uint8_t type, uint8_t code, uint8_t mods, const char* macro = "") {
+    uint8_t cmd[32] = { CMD_SET_KEY_MAP, key, type, code, mods, (uint8_t)strlen(macro) };
+    memcpy(cmd + 6, macro, strlen(macro));
+    sim::bleWrite(COMMAND_CHAR_UUID, cmd, 6 + strlen(macro));
+}
+
+// Every key type the device maps, held-key rollover, a remap while a key is
+// down, the encoder button, volume taps and scroll, then HID turned off.
+// The reports the central receives must be exactly the ones an independent
+// model of the key state expects; the raw events keep flowing either way.
+Result hidReports() {
+    Result r{ "hid" };
+    if (!HID_ENABLED) { r.note = "hid         built with HID_ENABLED 0"; return r; }
+    const uint8_t on[2] = { CMD_SET_HID_MODE, 1 };
+    hostSendPacket(PKT_COMMAND, on, sizeof(on));
+    for (uint8_t k = 0; k < 7; k++) sendKeyMap(k, MAP_SINGLE_KEY, 0x04 + k, 0);   // a … g
+    sendKeyMap(7, MAP_SHORTCUT,   0x29, 0x03);                                   // Ctrl+Shift+Esc
+    sendKeyMap(8, MAP_MEDIA_KEY,  0xE9, 0);                                      // volume up
+    sendKeyMap(9, MAP_TEXT_MACRO, 0,    0, "hi");                                // app only
+    const uint8_t enc[9] = { CMD_SET_ENCODER_MODE, ENC_MODE_VOLUME, 0, 0, 0, 0,
+                             MAP_SINGLE_KEY, 0x2C, 0 };                          // button = space
+    sim::bleWrite(COMMAND_CHAR_UUID, enc, sizeof(enc));
+    runLoops(5, nullptr);
+
+    std::vector<HidExpect> exp;
+    std::vector<Expect>    raw;
+    auto key = [&](uint8_t k, uint64_t t, bool press) {
+        scriptKey(k, t, press, 4, 1500);
+        raw.push_back({ (uint8_t)(press ? EVT_KEY_PRESS : EVT_KEY_RELEASE), k, t });
+    };
+    auto kb = [&](KbReport rep, uint64_t t, bool release) {
+        exp.push_back({ rep, 0, false, t, release });
+    };
+    auto media = [&](uint16_t usage, uint64_t t, bool release) {
+        exp.push_back({ {}, usage, true, t, release });
+    };
+
+    // One key at a time
+    uint64_t t = sim::nowUs() + 5000;
+    for (uint8_t k = 0; k < 10; k++) {
+        key(k, t, true);
+        key(k, t + 40000, false);
+        if (k < 7)  { kb(kbReport(0, { (uint8_t)(0x04 + k) }), t, false); kb({}, t + 40000, true); }
+        if (k == 7) { kb(kbReport(0x03, { 0x29 }), t, false);              kb({}, t + 40000, true); }
+        if (k == 8) { media(0xE9, t, false);                               media(0, t + 40000, true); }
+        t += 60000;
+    }
+
+    // Seven held: six usages, then ErrorRollOver until one lets go
+    std::vector<uint8_t> held;
+    for (uint8_t k = 0; k < 7; k++, t += 5000) {
+        key(k, t, true);
+        held.push_back((uint8_t)(0x04 + k));
+        KbReport rep{};
+        for (size_t i = 0; i < 6 && i < held.size(); i++) rep[2 + i] = held.size() > 6 ? 0x01 : held[i];
+        kb(rep, t, false);
+    }
+    t += 100000;
+    for (int k = 6; k >= 0; k--, t += 10000) {
+        key((uint8_t)k, t, false);
+        held.pop_back();
+        KbReport rep{};
+        for (size_t i = 0; i < 6 && i < held.size(); i++) rep[2 + i] = held[i];
+        kb(rep, t, true);
+    }
+
+    // Remapped while down: the release still lifts what was pressed
+    t += 60000;
+    key(0, t, true);
+    kb(kbReport(0, { 0x04 }), t, false);
+    uint64_t remapAt = t + 20000 + 10000;
+    key(0, t + 80000, false);
+    kb({}, t + 80000, true);
+    t += 140000;
+
+    // Encoder button, then volume taps both ways
+    scriptEncButton(t, true, 6, 3000);
+    scriptEncButton(t + 60000, false, 6, 3000);
+    kb(kbReport(0, { 0x2C }), t, false);
+    kb({}, t + 60000, true);
+    t += 120000;
+    uint8_t  sens = DEFAULT_ENCODER_SENSITIVITY;
+    uint32_t up   = 3 * 4 / sens, down = 2 * 4 / sens;
+    t = scriptSpin(t, +1, 3, 5000) + 60000;
+    for (uint32_t i = 0; i < up; i++)   { media(0xE9, 0, false); media(0, 0, true); }
+    t = scriptSpin(t, -1, 2, 5000) + 60000;
+    for (uint32_t i = 0; i < down; i++) { media(0xEA, 0, false); media(0, 0, true); }
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(remapAt, &r.loops);
+    sendKeyMap(0, MAP_SINGLE_KEY, 0x1D, 0);                                      // a → z
+    runUntil(t, &r.loops);
+
+    // Scroll: the wheel must add up to the steps turned
+    const uint8_t scroll[2] = { CMD_SET_ENCODER_MODE, ENC_MODE_SCROLL };
+    sim::bleWrite(COMMAND_CHAR_UUID, scroll, sizeof(scroll));
+    t = scriptSpin(t + 5000, -1, 5, 5000) + 60000;
+    int32_t wantWheel = -(int32_t)(5 * 4 / sens);
+    runUntil(t, &r.loops);
+
+    // HID off: raw events only
+    const uint8_t off[2] = { CMD_SET_HID_MODE, 0 };
+    hostSendPacket(PKT_COMMAND, off, sizeof(off));
+    t += 5000;
+    key(0, t, true);
+    key(0, t + 40000, false);
+    runUntil(t + 100000, &r.loops);
+
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    std::vector<Observed> keysOnly;
+    for (const Observed& o : s)
+        if (o.evt == EVT_KEY_PRESS || o.evt == EVT_KEY_RELEASE) keysOnly.push_back(o);
+    Result scratch{ "" };
+    match(raw, keysOnly, false, r.serialLatMs, r.serialRelMs, scratch);
+    r.missed   += scratch.missed;
+    r.spurious += scratch.spurious;
+
+    const NimBLECharacteristic* kbChr    = sim::bleHidInput(HID_REPORT_KEYBOARD);
+    const NimBLECharacteristic* mediaChr = sim::bleHidInput(HID_REPORT_CONSUMER);
+    const NimBLECharacteristic* mouseChr = sim::bleHidInput(HID_REPORT_MOUSE);
+    std::vector<HidSeen> seen;
+    int32_t wheel = 0;
+    uint32_t reports = 0;
+    for (size_t i = w.notifyStart; i < sim::notifyCount(); i++) {
+        const sim::Notify& n = sim::notifyAt(i);
+        HidSeen h{};
+        h.hostUs = n.hostUs;
+        if (n.chr == kbChr && n.len == HID_KEYBOARD_BYTES) {
+            memcpy(h.kb.data(), n.data, HID_KEYBOARD_BYTES);
+        } else if (n.chr == mediaChr && n.len == HID_CONSUMER_BYTES) {
+            h.consumer = true;
+            h.usage    = (uint16_t)(n.data[0] | n.data[1] << 8);
+        } else if (n.chr == mouseChr && n.len == HID_MOUSE_BYTES) {
+            wheel += (int8_t)n.data[3];
+            reports++;
+            continue;
+        } else {
+            continue;
+        }
+        seen.push_back(h);
+        reports++;
+    }
+
+    // In order, per page: anything expected and not seen is missed, anything
+    // seen and not expected is spurious
+    size_t   cursor[2] = {};
+    uint32_t matched   = 0;
+    for (const HidExpect& e : exp) {
+        size_t& c = cursor[e.consumer];
+        while (c < seen.size() &&
+               (seen[c].consumer != e.consumer ||
+                (e.consumer ? seen[c].usage != e.usage : seen[c].kb != e.kb)))
+            c++;
+        if (c == seen.size()) { r.missed++; continue; }
+        if (e.edgeUs) (e.release ? r.bleRelMs : r.bleLatMs).add((seen[c].hostUs - e.edgeUs) / 1000.0);
+        matched++;
+        c++;
+    }
+    r.spurious += (uint32_t)seen.size() - matched;
+    if (wheel != wantWheel) r.missed++;
+    r.reported = matched;
+
+    char buf[200];
+    snprintf(buf, sizeof(buf),
+             "hid         %u reports (%zu key/consumer matched %u of %zu expected)   wheel %d/%d   "
+             "report map %u bytes",
+             reports, seen.size(), matched, exp.size(), wheel, wantWheel, HID_REPORT_MAP_BYTES);
+    r.note = buf;
+    return r;
+}
+
+// ── Key map & action engine ──────────────────────────────────────────────────
+struct KeyStamp {
+    uint8_t evt;
+    uint8_t key;
+    uint8_t layer;
+};
+
+// A CFG_KEYMAP_* upload, chunked to the link; crc 0 = the image's own CRC
+void uploadKeymap(const std::vector<uint8_t>& img, bool ble, uint16_t crc = 0) {
+    auto send = [&](const uint8_t* d, size_t n) {
+        if (ble) sim::bleWrite(CONFIG_CHAR_UUID, d, n);
+        else     hostSendPacket(PKT_CONFIG_DATA, d, (uint16_t)n);
+    };
+    uint16_t size    = (uint16_t)img.size();
+    uint8_t  begin[] = { CFG_KEYMAP_BEGIN, (uint8_t)(size >> 8), (uint8_t)size };
+    send(begin, sizeof(begin));
+    size_t chunk = ble ? sim::bleLink().getMTU() - 3 - 3 : 200;
+    for (size_t off = 0; off < size; off += chunk) {
+        uint8_t d[256] = { CFG_KEYMAP_DATA, (uint8_t)(off >> 8), (uint8_t)off };
+        size_t  n      = std::min(chunk, size - off);
+        memcpy(d + 3, img.data() + off, n);
+        send(d, 3 + n);
+    }
+    if (!crc) crc = crc16(img.data(), size);
+    uint8_t commit[] = { CFG_KEYMAP_COMMIT, (uint8_t)(crc >> 8), (uint8_t)crc };
+    send(commit, sizeof(commit));
+    runLoops(5, nullptr);
+}
+
+// CFG_KEYMAP_STATUS replies since notify / TX index `n`, `s`: [status, layers]
+std::vector<std::array<uint8_t, 2>> keymapReplies(size_t n, size_t s, bool ble) {
+    std::vector<std::array<uint8_t, 2>> out;
+    if (ble) {
+        const NimBLECharacteristic* cfg = sim::bleFind(CONFIG_CHAR_UUID);
+        for (; n < sim::notifyCount(); n++) {
+            const sim::Notify& x = sim::notifyAt(n);
+            if (x.chr == cfg && x.len == KEYMAP_STATUS_BYTES && x.data[0] == CFG_KEYMAP_STATUS)
+                out.push_back({ x.data[1], x.data[2] });
+        }
+    } else {
+        std::vector<Frame> frames;
+        decodeFrames(&s, frames);
+        for (const Frame& f : frames)
+            if (f.type == PKT_CONFIG_DATA && f.len == KEYMAP_STATUS_BYTES &&
+                f.data[0] == CFG_KEYMAP_STATUS)
+                out.push_back({ f.data[1], f.data[2] });
+    }
+    return out;
+}
+
+// Three layers and two sequences, uploaded over BLE; then shift, a sequence,
+// a momentary layer (released before the key it changed), a toggled layer
+// with a media key, and a corrupt upload over serial that must be refused.
+// The HID reports must match a model of the map, and every raw key event
+// must carry the layer it resolved on.  Finally the engine alone, timed.
+Result keymapActions() {
+    Result r{ "keymap" };
+    const uint8_t L1 = 1, L2 = 2, SHIFT = 0x02, CTRL = 0x01;
+    auto at = [](std::vector<uint8_t>& img, uint8_t layer, uint8_t key, KeyAction a) {
+        uint8_t* p = img.data() + KEYMAP_HEADER_BYTES + (layer * NUM_KEYS + key) * 3;
+        p[0] = a.type; p[1] = a.code; p[2] = a.mods;
+    };
+    std::vector<uint8_t> img = { KEYMAP_VERSION, 3, NUM_KEYS, 2 };
+    img.resize(KEYMAP_HEADER_BYTES + 3 * NUM_KEYS * 3);
+    for (uint8_t k = 0; k < NUM_KEYS; k++) {
+        at(img, 1, k, { MAP_TRANSPARENT, 0, 0 });
+        at(img, 2, k, { MAP_TRANSPARENT, 0, 0 });
+    }
+    at(img, 0, 0, { MAP_SINGLE_KEY,   0x04, 0 });         // a
+    at(img, 0, 1, { MAP_SINGLE_KEY,   0x05, 0 });         // b
+    at(img, 0, 2, { MAP_SHORTCUT,     0,    SHIFT });     // a plain modifier key
+    at(img, 0, 3, { MAP_SEQUENCE,     0,    0 });
+    at(img, 0, 4, { MAP_LAYER_HOLD,   L1,   0 });
+    at(img, 0, 5, { MAP_LAYER_TOGGLE, L2,   0 });
+    at(img, 0, 6, { MAP_TEXT_MACRO,   0,    0 });         // the app's
+    at(img, 1, 0, { MAP_SINGLE_KEY,   0x3A, 0 });         // F1
+    at(img, 1, 3, { MAP_SEQUENCE,     1,    0 });
+    at(img, 2, 0, { MAP_MEDIA_KEY,    0xE9, 0 });         // volume up
+    at(img, 2, 1, { MAP_SINGLE_KEY,   0x1B, 0 });         // x
+    const uint8_t seqs[] = { 2, 0x0B, SHIFT, 0x0C, 0,          // "Hi"
+                             2, 0x06, CTRL,  0x19, CTRL };     // copy, paste
+    img.insert(img.end(), seqs, seqs + sizeof(seqs));
+
+    const uint8_t on[2] = { CMD_SET_HID_MODE, 1 };
+    hostSendPacket(PKT_COMMAND, on, sizeof(on));
+    size_t n0 = sim::notifyCount();
+    uploadKeymap(img, true);
+    auto okBle = keymapReplies(n0, 0, true);
+
+    std::vector<HidExpect> exp;
+    std::vector<KeyStamp>  stamps;
+    std::vector<Expect>    raw;
+    uint64_t t = sim::nowUs() + 5000;
+    auto key = [&](uint8_t k, bool press, uint8_t layer) {
+        scriptKey(k, t, press, 4, 1500);
+        uint8_t evt = press ? EVT_KEY_PRESS : EVT_KEY_RELEASE;
+        raw.push_back({ evt, k, t });
+        stamps.push_back({ evt, k, layer });
+    };
+    auto kb = [&](KbReport rep) { exp.push_back({ rep, 0, false, t, false }); };
+    auto media = [&](uint16_t usage) { exp.push_back({ {}, usage, true, t, false }); };
+    auto next = [&](uint32_t us = 40000) { t += us; };
+
+    key(0, true, 0);  kb(kbReport(0, { 0x04 }));  next();
+    key(0, false, 0); kb({});                     next();
+
+    // Shift held under a key
+    key(2, true, 0);  kb(kbReport(SHIFT, {}));         next();
+    key(0, true, 0);  kb(kbReport(SHIFT, { 0x04 }));   next();
+    key(0, false, 0); kb(kbReport(SHIFT, {}));         next();
+    key(2, false, 0); kb({});                          next();
+
+    // Sequence: taps on press, nothing on release
+    key(3, true, 0);
+    kb(kbReport(SHIFT, { 0x0B })); kb({}); kb(kbReport(0, { 0x0C })); kb({});
+    next();
+    key(3, false, 0); next();
+
+    // Momentary layer 1: F1, b through a transparent entry, copy / paste
+    key(4, true, 0);  next();
+    key(0, true, 1);  kb(kbReport(0, { 0x3A })); next();
+    key(0, false, 1); kb({});                     next();
+    key(1, true, 0);  kb(kbReport(0, { 0x05 })); next();
+    key(1, false, 0); kb({});                     next();
+    key(3, true, 1);
+    kb(kbReport(CTRL, { 0x06 })); kb({}); kb(kbReport(CTRL, { 0x19 })); kb({});
+    next();
+    key(3, false, 1); next();
+    // Layer key let go first: the held key still releases F1
+    key(0, true, 1);  kb(kbReport(0, { 0x3A })); next();
+    key(4, false, 0); next();
+    key(0, false, 1); kb({});                     next();
+    key(0, true, 0);  kb(kbReport(0, { 0x04 })); next();
+    key(0, false, 0); kb({});                     next();
+
+    // Toggled layer 2: media on 0, x on 1, toggled back off
+    key(5, true, 0);  next();
+    key(5, false, 0); next();
+    key(0, true, 2);  media(0xE9);                next();
+    key(0, false, 2); media(0);                   next();
+    key(1, true, 2);  kb(kbReport(0, { 0x1B })); next();
+    key(1, false, 2); kb({});                     next();
+    key(5, true, 0);  next();                     // transparent on layer 2
+    key(5, false, 0); next();
+    key(1, true, 0);  kb(kbReport(0, { 0x05 })); next();
+    key(1, false, 0); kb({});                     next();
+    key(6, true, 0);  next();                     // text macro: no report
+    key(6, false, 0); next();
+    uint64_t corruptAt = t;
+    next(60000);
+
+    // After a refused upload the map is unchanged
+    key(1, true, 0);  kb(kbReport(0, { 0x05 })); next();
+    key(1, false, 0); kb({});                     next();
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(corruptAt, &r.loops);
+    size_t tx0 = sim::txCount();
+    uploadKeymap(img, false, (uint16_t)(crc16(img.data(), img.size()) ^ 0x0100));
+    runUntil(t + 60000, &r.loops);
+
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    auto badSerial = keymapReplies(0, tx0, false);
+    std::vector<Observed> keysOnly;
+    for (const Observed& o : s)
+        if (o.evt == EVT_KEY_PRESS || o.evt == EVT_KEY_RELEASE) keysOnly.push_back(o);
+    Result scratch{ "" };
+    match(raw, keysOnly, false, r.serialLatMs, r.serialRelMs, scratch);
+    r.missed   += scratch.missed;
+    r.spurious += scratch.spurious;
+    uint32_t stamped = 0;
+    for (size_t i = 0; i < keysOnly.size() && i < stamps.size(); i++)
+        if (keysOnly[i].evt == stamps[i].evt && keysOnly[i].a == stamps[i].key &&
+            keysOnly[i].b == stamps[i].layer)
+            stamped++;
+    r.missed += (uint32_t)stamps.size() - stamped;
+
+    const NimBLECharacteristic* kbChr    = sim::bleHidInput(HID_REPORT_KEYBOARD);
+    const NimBLECharacteristic* mediaChr = sim::bleHidInput(HID_REPORT_CONSUMER);
+    std::vector<HidSeen> seen;
+    for (size_t i = w.notifyStart; i < sim::notifyCount(); i++) {
+        const sim::Notify& x = sim::notifyAt(i);
+        HidSeen h{};
+        h.hostUs = x.hostUs;
+        if (x.chr == kbChr && x.len == HID_KEYBOARD_BYTES) {
+            memcpy(h.kb.data(), x.data, HID_KEYBOARD_BYTES);
+        } else if (x.chr == mediaChr && x.len == HID_CONSUMER_BYTES) {
+            h.consumer = true;
+            h.usage    = (uint16_t)(x.data[0] | x.data[1] << 8);
+        } else {
+            continue;
+        }
+        seen.push_back(h);
+    }
+    // Every report in order, across both pages; layers and stamps only
+    // when HID is compiled out
+    if (!HID_ENABLED) exp.clear();
+    uint32_t matched = 0;
+    for (size_t i = 0; i < exp.size() && i < seen.size(); i++) {
+        const HidExpect& e = exp[i];
+        const HidSeen&   h = seen[i];
+        if (h.consumer != e.consumer || (e.consumer ? h.usage != e.usage : h.kb != e.kb)) break;
+        matched++;
+    }
+    r.missed   += (uint32_t)exp.size() - matched;
+    r.spurious += (uint32_t)(seen.size() > exp.size() ? seen.size() - exp.size() : 0);
+    r.reported  = matched;
+
+    bool uploadOk = okBle.size() == 1 && okBle[0][0] == KEYMAP_OK && okBle[0][1] == 3;
+    bool refused  = badSerial.size() == 1 && badSerial[0][0] == KEYMAP_ERR_CRC;
+    if (!uploadOk || !refused) r.missed++;
+
+    // The engine alone: resolve presses and releases on every layer
+    static ActionEngine eng;
+    eng.load(img.data(), (uint16_t)img.size());
+    eng.setHidMode(true);
+    const uint8_t script[][2] = { { EVT_KEY_PRESS, 4 }, { EVT_KEY_PRESS, 0 }, { EVT_KEY_RELEASE, 0 },
+                                  { EVT_KEY_RELEASE, 4 }, { EVT_KEY_PRESS, 5 }, { EVT_KEY_RELEASE, 5 },
+                                  { EVT_KEY_PRESS, 1 }, { EVT_KEY_RELEASE, 1 }, { EVT_KEY_PRESS, 2 },
+                                  { EVT_KEY_PRESS, 3 }, { EVT_KEY_RELEASE, 3 }, { EVT_KEY_RELEASE, 2 } };
+    const uint32_t rounds = 20000;
+    HidReport out[HID_REPORTS_MAX];
+    uint64_t  allocs0 = allocCount(), reports = 0;
+    auto      t0      = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++)
+        for (const auto& s : script) {
+            InputEvent e = { 0, s[0], s[1], 0, 0, 0, 0, 0 };
+            reports += eng.onEvent(e, out);
+        }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() /
+                (rounds * (sizeof(script) / sizeof(script[0])));
+    uint64_t engAllocs = allocCount() - allocs0;
+    if (engAllocs) r.spurious++;
+
+    char buf[240];
+    snprintf(buf, sizeof(buf),
+             "keymap      upload %s (%zu bytes)   bad CRC %s   reports %u/%zu   layer stamps %u/%zu\n"
+             "  engine      %.0f ns per event   %.2f reports per event   %llu allocs   RAM map %zu bytes",
+             uploadOk ? "ok" : "FAILED", img.size(), refused ? "refused" : "ACCEPTED",
+             matched, exp.size(), stamped, stamps.size(), ns,
+             (double)reports / (rounds * (sizeof(script) / sizeof(script[0]))),
+             (unsigned long long)engAllocs, sizeof(ActionEngine));
+    r.note = buf;
+    return r;
+}
+
+// ── Scan governor ────────────────────────────────────────────────────────────
+struct DutyCycle {
+    double awakePct, sleepPct, wakeupsPerS, scansPerS;
+};
+
+DutyCycle measureIdle(uint64_t us) {
+    sim::CpuTime a     = sim::cpuTime();
+    uint32_t     scans = governor.scans();
+    runUntil(sim::nowUs() + us, nullptr);
+    sim::CpuTime z = sim::cpuTime();
+    double       s = us / 1e6;
+    uint64_t     idle = (z.idleUs - a.idleUs) + (z.sleepUs - a.sleepUs);
+    return { 100.0 * (us - idle) / us, 100.0 * (z.sleepUs - a.sleepUs) / us,
+             (z.wakeups - a.wakeups) / s, (governor.scans() - scans) / s };
+}
+
+// A battery unit: the USB host goes away, so serial RX may poll slowly too.
+// For each governor mode the pad first idles into its deepest tier and the
+// duty cycle is measured there; then single clean presses land after idle
+// gaps that end in each tier, at different phases of the scan period.  First-
+// event latency is capture stamp − first edge, the part the governor adds.
+// Leaving light sleep is taken to cost 300 µs.  Edge wake must keep the
+// latency within a full-rate scan and the idle scan rate must follow the mode.
+Result scanGovernor() {
+    Result r{ "governor" };
+    static const uint64_t GAPS[]  = { 8000000, 1000000, 100000 };   // µs
+    static const int      PRESSES = 4;
+    static const uint64_t HOLD    = (GOV_DEEP_PERIOD_MS + 10) * 1000ull;   // poll sees every press
+    static const struct { const char* label; uint8_t mode; } MODES[] = {
+        { "fixed", GOV_MODE_FIXED }, { "poll ", GOV_MODE_POLL }, { "auto ", GOV_MODE_AUTO },
+    };
+
+    sim::Costs c;
+    c.sleepExitUs = 300;
+    sim::setCosts(c);
+    serialBridge.begin(Serial);
+    keyMatrix.setEagerPress(true);
+
+    char buf[160];
+    r.note = "governor    idle: awake   light sleep  wakeups/s  scans/s    first event ms p50/max"
+             " after 8 s · 1 s · 0.1 s idle";
+    for (const auto& m : MODES) {
+        setGovernor(m.mode);
+        runUntil(sim::nowUs() + (GOV_DEEP_AFTER_MS + 1000) * 1000ull, nullptr);
+        DutyCycle d = measureIdle(10000000);
+
+        std::vector<Expect>   exp;
+        std::vector<uint64_t> pressUs;
+        uint64_t t = sim::nowUs();
+        for (uint64_t gap : GAPS) {
+            for (int i = 0; i < PRESSES; i++) {
+                t += gap + i * 1700;
+                uint8_t k = (uint8_t)(exp.size() / 2 % NUM_KEYS);
+                scriptKey(k, t, true, 0, 0);
+                scriptKey(k, t + HOLD, false, 0, 0);
+                exp.push_back({ EVT_KEY_PRESS,   k, t });
+                exp.push_back({ EVT_KEY_RELEASE, k, t + HOLD });
+                pressUs.push_back(t);
+                t += HOLD;
+            }
+        }
+        r.expected += (uint32_t)exp.size();
+
+        Window w = openWindow();
+        runUntil(t + 200000, nullptr);
+        std::vector<Observed> s, b;
+        Result scratch{ "" };
+        closeWindow(w, scratch, s, b);
+        Samples lat, rel;
+        match(exp, b, true, lat, rel, scratch);
+        r.missed   += scratch.missed;
+        r.spurious += scratch.spurious;
+        r.bleLatMs  = lat;
+
+        Samples first[3];
+        size_t  n = 0;
+        for (const Observed& o : b)
+            if (o.evt == EVT_KEY_PRESS && n < pressUs.size()) {
+                first[n / PRESSES].add(((int64_t)o.capUs - (int64_t)pressUs[n]) / 1000.0);
+                n++;
+            }
+
+        snprintf(buf, sizeof(buf),
+                 "\n  %s       %6.2f%%  %6.2f%%     %8.0f  %7.0f    %.2f/%.2f · %.2f/%.2f · %.2f/%.2f",
+                 m.label, d.awakePct, d.sleepPct, d.wakeupsPerS, d.scansPerS,
+                 first[0].pct(50), first[0].max(), first[1].pct(50), first[1].max(),
+                 first[2].pct(50), first[2].max());
+        r.note += buf;
+
+        // Every check that fails counts as one missed event
+        double fullRate = SCAN_RATE_HZ, deepRate = 1000.0 / GOV_DEEP_PERIOD_MS;
+        bool checks[] = {
+            n == pressUs.size(),
+            m.mode == GOV_MODE_FIXED ? d.scansPerS >= fullRate - 1
+                                     : d.scansPerS <= deepRate + 1,
+            m.mode != GOV_MODE_AUTO || first[0].max() <= 1000.0 / SCAN_RATE_HZ,
+        };
+        for (bool ok : checks) if (!ok) r.missed++;
+    }
+
+    setGovernor(DEFAULT_GOV_MODE);
+    keyMatrix.setEagerPress(DEFAULT_EAGER_PRESS);
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+    sim::setCosts(sim::Costs());
+    return r;
+}
+
+// ── Light sleep & wake ───────────────────────────────────────────────────────
+// A battery unit with a 1 s sleep timeout; leaving light sleep is taken to
+// cost 500 µs.  Each round the pad falls asleep and is woken by a key press —
+// every fourth one bouncing — or by an encoder spin.  Every press and step
+// must arrive; a clean waking press must carry a capture stamp within the
+// wake-up cost of its first edge.  The device's own wake → first event time
+// comes from the trace ring.  Last the central goes away and the pad sleeps
+// again: after the wake it must advertise directed at the bonded host, then
+// fast, then slow.
+Result wakeFromSleep() {
+    Result r{ "wake" };
+    static const uint32_t TIMEOUT_MS = 1000;
+    static const int      KEY_ROUNDS = 8, SPIN_ROUNDS = 2;
+    static const uint64_t HOLD       = 60000;
+    const uint8_t         sens       = DEFAULT_ENCODER_SENSITIVITY;
+
+    sim::Costs c;
+    c.sleepExitUs = 500;
+    sim::setCosts(c);
+    serialBridge.begin(Serial);
+    sleepTimeoutMs = TIMEOUT_MS;
+    sim::bleBond(true);
+
+    std::vector<Expect>   exp;
+    std::vector<uint64_t> pressUs;
+    std::vector<bool>     clean;
+    int32_t  wantSteps = 0;
+    uint64_t t         = sim::nowUs();
+    for (int i = 0; i < KEY_ROUNDS + SPIN_ROUNDS; i++) {
+        t += (TIMEOUT_MS + 500) * 1000ull + i * 3300;      // asleep; a different phase each
+        if (i < KEY_ROUNDS) {
+            uint8_t k      = (uint8_t)(i * 3 % NUM_KEYS);
+            bool    bounce = i % 4 == 3;
+            scriptKey(k, t, true, bounce ? 4 : 0, bounce ? 2000 : 0);
+            scriptKey(k, t + HOLD, false, bounce ? 4 : 0, bounce ? 2000 : 0);
+            exp.push_back({ EVT_KEY_PRESS,   k, t });
+            exp.push_back({ EVT_KEY_RELEASE, k, t + HOLD });
+            pressUs.push_back(t);
+            clean.push_back(!bounce);
+            t += HOLD;
+        } else {
+            t = scriptSpin(t, i % 2 ? +1 : -1, 4, 3000);
+            wantSteps += 4 * 4 / sens;
+        }
+    }
+    r.expected = (uint32_t)exp.size() + wantSteps;
+
+    uint32_t sleeps    = sim::sleepCount();
+    uint32_t traceFrom = traceRing.head();
+    Window   w         = openWindow();
+    runUntil(t + 200000, &r.loops);
+    std::vector<Observed> s, b, keys;
+    closeWindow(w, r, s, b);
+    int32_t gotSteps = 0;
+    for (const Observed& o : b) {
+        if (o.evt == EVT_ENCODER_ROTATE) gotSteps += o.b;
+        else                             keys.push_back(o);
+    }
+    match(exp, keys, true, r.bleLatMs, r.bleRelMs, r);
+    r.missed += (uint32_t)abs(wantSteps - gotSteps);
+
+    size_t n = 0;
+    for (const Observed& o : keys)
+        if (o.evt == EVT_KEY_PRESS && n < pressUs.size()) {
+            if (clean[n]) r.captureUs.add((double)((int64_t)o.capUs - (int64_t)pressUs[n]));
+            n++;
+        }
+
+    // TR_WAKE per sleep, with what woke it; TR_WAKE_EVENT when the wake
+    // scan itself had an event.  A bouncing contact may be open again by
+    // the time the chip looks at its pins.
+    int     gpioWakes = 0, keyWakes = 0, spinWakes = 0;
+    Samples toEvent;
+    for (uint32_t i = traceFrom; i < traceRing.head(); i++) {
+        TraceRecord rec;
+        if (!traceRing.read(i, rec)) continue;
+        if (rec.id == TR_WAKE && rec.a == ESP_SLEEP_WAKEUP_GPIO) {
+            gpioWakes++;
+            if (rec.b & WAKE_KEY)     keyWakes++;
+            if (rec.b & WAKE_ENCODER) spinWakes++;
+        }
+        if (rec.id == TR_WAKE_EVENT) toEvent.add(rec.b << 8 | rec.c);
+    }
+    uint32_t slept      = sim::sleepCount() - sleeps;
+    int      cleanPress = (int)std::count(clean.begin(), clean.end(), true);
+
+    // The central leaves; after the next sleep the wake starts advertising
+    // over, directed at the bond first.  The pad then stays up to be seen.
+    sim::bleDisconnect();
+    t = sim::nowUs() + (TIMEOUT_MS + 500) * 1000ull;
+    scriptKey(0, t, true, 0, 0);
+    scriptKey(0, t + HOLD, false, 0, 0);
+    const NimBLEAdvertising* adv = NimBLEDevice::getAdvertising();
+    runUntil(t + 2000, nullptr);
+    bool     directed = adv->directed() && adv->minInterval() == ADV_FAST_INTERVAL_MIN;
+    sleepTimeoutMs = DEFAULT_SLEEP_TIMEOUT_MS;
+    runUntil(t + (ADV_DIRECTED_MS + 100) * 1000ull, nullptr);
+    bool     fast = adv->isAdvertising() && !adv->directed() &&
+                    adv->minInterval() == ADV_FAST_INTERVAL_MIN;
+    runUntil(t + (ADV_DIRECTED_MS + ADV_FAST_MS + 100) * 1000ull, nullptr);
+    bool     slow = adv->isAdvertising() && adv->minInterval() == ADV_SLOW_INTERVAL_MIN;
+
+    char buf[240];
+    snprintf(buf, sizeof(buf),
+             "wake        %u sleeps   woken by key %d/%d  spin %d/%d   steps %d/%d   "
+             "wake → first event µs p50 %.0f max %.0f (%zu)\n"
+             "  advertise   after the wake: directed %s · fast after %u ms %s · slow after %u s %s",
+             slept, keyWakes, KEY_ROUNDS, spinWakes, SPIN_ROUNDS,
+             gotSteps, wantSteps, toEvent.pct(50), toEvent.max(), toEvent.count(),
+             directed ? "yes" : "NO", ADV_DIRECTED_MS, fast ? "yes" : "NO",
+             (ADV_DIRECTED_MS + ADV_FAST_MS) / 1000, slow ? "yes" : "NO");
+    r.note = buf;
+
+    // Every check that fails counts as one missed event
+    bool checks[] = {
+        slept == KEY_ROUNDS + SPIN_ROUNDS && gpioWakes == (int)slept,
+        keyWakes >= cleanPress && spinWakes == SPIN_ROUNDS,
+        r.captureUs.count() && r.captureUs.max() <= c.sleepExitUs + 1000.0 / SCAN_RATE_HZ,
+        toEvent.count() >= r.captureUs.count(),
+        directed, fast, slow,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+
+    sim::bleBond(false);
+    sim::setCosts(sim::Costs());
+    sim::bleConnect(247);
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+    return r;
+}
+
+// ── Clock sync and the latency trace ─────────────────────────────────────────
+// The bench plays a host whose µs clock is HOST_OFFSET ahead of the device's.
+const uint32_t HOST_OFFSET = 0x9E3779B9u;
+
+uint32_t hostClock(uint64_t virtualUs) { return (uint32_t)(virtualUs + HOST_OFFSET); }
+
+uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+struct ClockSync {
+    uint32_t offset  = 0;              // device − host, mod 2^32
+    uint32_t delay   = UINT32_MAX;     // round trip of the exchange it came from
+    int      replies = 0;
+};
+
+// CMD_TIME_SYNC exchanges over one link, a different phase of the connection
+// interval each; the one with the lowest delay wins.  Replies on the other
+// link go to *stray.
+ClockSync syncClock(bool overBle, int exchanges, int* stray) {
+    const NimBLECharacteristic* timeChr = sim::bleFind(TIME_CHAR_UUID);
+    ClockSync s;
+    for (int i = 0; i < exchanges; i++) {
+        uint32_t t1     = hostClock(sim::nowUs());
+        uint8_t  cmd[5] = { CMD_TIME_SYNC, (uint8_t)(t1 >> 24), (uint8_t)(t1 >> 16),
+                            (uint8_t)(t1 >> 8), (uint8_t)t1 };
+        size_t   cursor = sim::txCount(), next = sim::notifyCount();
+        if (overBle) sim::bleWrite(COMMAND_CHAR_UUID, cmd, sizeof(cmd));
+        else         hostSendPacket(PKT_COMMAND, cmd, sizeof(cmd));
+        runUntil(sim::nowUs() + 60000 + i * 1370, nullptr);
+
+        std::vector<std::pair<const uint8_t*, uint64_t>> replies;
+        std::vector<Frame> fr;
+        decodeFrames(&cursor, fr);
+        for (const Frame& f : fr)
+            if (f.type == PKT_TIME && f.len == TIME_SYNC_BYTES) {
+                if (overBle) (*stray)++;
+                else         replies.push_back({ f.data, f.tUs });
+            }
+        for (; next < sim::notifyCount(); next++) {
+            const sim::Notify& n = sim::notifyAt(next);
+            if (n.chr != timeChr) continue;
+            if (overBle) replies.push_back({ n.data, n.hostUs });
+            else         (*stray)++;
+        }
+
+        for (const auto& p : replies) {
+            if (be32(p.first) != t1) continue;
+            uint32_t t2 = be32(p.first + 4), t3 = be32(p.first + 8), t4 = hostClock(p.second);
+            uint32_t delay = (t4 - t1) - (t3 - t2);
+            s.replies++;
+            if (delay >= s.delay) continue;
+            s.delay  = delay;
+            s.offset = (uint32_t)(((int64_t)(int32_t)(t2 - t1) + (int32_t)(t3 - t4)) / 2);
+        }
+    }
+    return s;
+}
+
+// One PKT_EVENT_TIMES / Event Times record, with its sent stamp
+struct EventTimes {
+    uint8_t  seq;
+    uint32_t captureUs;
+    uint16_t queuedUs;
+    uint32_t sentUs;
+};
+
+void unpackTimes(const uint8_t* d, uint16_t len, std::vector<EventTimes>& out) {
+    if (len < EventBatch::TIMES_HEADER_BYTES) return;
+    uint32_t       sent = be32(d + 1);
+    const uint8_t* p    = d + EventBatch::TIMES_HEADER_BYTES;
+    for (uint8_t i = 0; i < d[0] && p + EventBatch::TIMES_RECORD_BYTES <= d + len; i++) {
+        out.push_back({ p[0], be32(p + 1), (uint16_t)(p[5] << 8 | p[6]), sent });
+        p += EventBatch::TIMES_RECORD_BYTES;
+    }
+}
+
+// Split each event's latency from its first edge to the host: debounce
+// (capture → ring), queueing (ring → frame sent) and transport, measured on
+// the host clock and moved onto the device's with the synced offset.  How
+// far that transport lands from the one on the virtual clock goes to
+// *worstErr.  Events without exactly one matching times record are counted.
+struct LatencySplit {
+    Samples  debounceMs, queueMs, transportMs;
+    uint32_t untraced = 0;
+    int32_t  worstErr = 0;
+};
+
+void splitLatency(const std::vector<Observed>& obs, const std::vector<EventTimes>& times,
+                  const ClockSync& sync, LatencySplit& out) {
+    for (const Observed& o : obs) {
+        const EventTimes* t = nullptr;
+        int               n = 0;
+        for (const EventTimes& x : times)
+            if (x.seq == o.seq) { t = &x; n++; }
+        if (n != 1 || t->captureUs != (uint32_t)o.capUs) { out.untraced++; continue; }
+
+        uint32_t queued    = t->captureUs + t->queuedUs;
+        uint32_t arrival   = hostClock(o.tUs) + sync.offset;          // device clock
+        int32_t  transport = (int32_t)(arrival - t->sentUs);
+        int32_t  err       = transport - (int32_t)((uint32_t)o.tUs - t->sentUs);
+        out.debounceMs.add(t->queuedUs / 1000.0);
+        out.queueMs.add((int32_t)(t->sentUs - queued) / 1000.0);
+        out.transportMs.add(transport / 1000.0);
+        if (abs(err) > abs(out.worstErr)) out.worstErr = err;
+    }
+}
+
+void splitLine(Result& r, const char* label, const ClockSync& s, const LatencySplit& l) {
+    char buf[240];
+    snprintf(buf, sizeof(buf),
+             "%s  sync %d replies, best delay %5u µs   debounce p50 %5.2f  queue p50 %5.2f "
+             "p99 %5.2f  transport p50 %5.2f p99 %5.2f ms   (est − true ≤ %d µs, untraced %u)\n  ",
+             label, s.replies, s.delay, l.debounceMs.pct(50), l.queueMs.pct(50),
+             l.queueMs.pct(99), l.transportMs.pct(50), l.transportMs.pct(99),
+             abs(l.worstErr), l.untraced);
+    r.note += buf;
+}
+
+// Sync the host clock to the device over each link, then type with the
+// latency trace on.  Each link may only answer the sync sent over it; every
+// event must carry one times record matching its sequence and capture
+// stamp; and the synced offset must put the device clock within delay / 2
+// of the truth, so transport measured across the two clocks agrees with the
+// virtual one just as closely.
+Result clockSync() {
+    Result r{ "clock" };
+    static const int EXCHANGES = 8;
+    const uint32_t   trueOffset = 0u - HOST_OFFSET;
+
+    int       stray  = 0;
+    ClockSync serial = syncClock(false, EXCHANGES, &stray);
+    ClockSync ble    = syncClock(true, EXCHANGES, &stray);
+    int32_t   serialErr = (int32_t)(serial.offset - trueOffset);
+    int32_t   bleErr    = (int32_t)(ble.offset - trueOffset);
+
+    const uint8_t on[2] = { CMD_SET_LATENCY_TRACE, 1 };
+    hostSendPacket(PKT_COMMAND, on, 2);
+    sim::bleWrite(COMMAND_CHAR_UUID, on, 2);
+
+    const uint8_t       keys = NUM_KEYS < 8 ? NUM_KEYS : 8;
+    std::vector<Expect> exp;
+    uint64_t t = sim::nowUs() + 5000;
+    for (int round = 0; round < 3; round++) {
+        for (uint8_t k = 0; k < keys; k++) {
+            bool bounce = (k + round) % 3 == 0;
+            scriptKey(k, t, true, bounce ? 4 : 0, bounce ? 1500 : 0);
+            scriptKey(k, t + 30000, false, bounce ? 4 : 0, bounce ? 1500 : 0);
+            exp.push_back({ EVT_KEY_PRESS,   k, t });
+            exp.push_back({ EVT_KEY_RELEASE, k, t + 30000 });
+            t += 47300;
+        }
+        t = scriptSpin(t, round % 2 ? -1 : +1, 4, 2500) + 40000;
+    }
+    r.expected = (uint32_t)exp.size();
+
+    Window w = openWindow();
+    runUntil(t + 100000, &r.loops);
+    std::vector<Observed> s, b, sKeys, bKeys;
+    closeWindow(w, r, s, b);
+    for (const Observed& o : s) if (o.evt != EVT_ENCODER_ROTATE) sKeys.push_back(o);
+    for (const Observed& o : b) if (o.evt != EVT_ENCODER_ROTATE) bKeys.push_back(o);
+    match(exp, sKeys, false, r.serialLatMs, r.serialRelMs, r);
+    match(exp, bKeys, true, r.bleLatMs, r.bleRelMs, r);
+
+    std::vector<EventTimes> sTimes, bTimes;
+    std::vector<Frame>      fr;
+    size_t cursor = w.txStart;
+    decodeFrames(&cursor, fr);
+    for (const Frame& f : fr)
+        if (f.type == PKT_EVENT_TIMES) unpackTimes(f.data, f.len, sTimes);
+    const NimBLECharacteristic* timesChr = sim::bleFind(EVENT_TIMES_CHAR_UUID);
+    for (size_t i = w.notifyStart; i < sim::notifyCount(); i++) {
+        const sim::Notify& n = sim::notifyAt(i);
+        if (n.chr == timesChr) unpackTimes(n.data, n.len, bTimes);
+    }
+    LatencySplit sSplit, bSplit;
+    splitLatency(s, sTimes, serial, sSplit);
+    splitLatency(b, bTimes, ble, bSplit);
+
+    // Trace off: no more times records on either link
+    const uint8_t off[2] = { CMD_SET_LATENCY_TRACE, 0 };
+    hostSendPacket(PKT_COMMAND, off, 2);
+    sim::bleWrite(COMMAND_CHAR_UUID, off, 2);
+    size_t next = sim::notifyCount();
+    cursor      = sim::txCount();
+    t           = sim::nowUs() + 5000;
+    scriptKey(0, t, true, 0, 0);
+    scriptKey(0, t + 30000, false, 0, 0);
+    runUntil(t + 100000, nullptr);
+    int after = 0;
+    fr.clear();
+    decodeFrames(&cursor, fr);
+    for (const Frame& f : fr) after += f.type == PKT_EVENT_TIMES;
+    for (; next < sim::notifyCount(); next++) after += sim::notifyAt(next).chr == timesChr;
+
+    splitLine(r, "serial", serial, sSplit);
+    splitLine(r, "BLE   ", ble, bSplit);
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "offset err  serial %d µs  BLE %d µs   times records %zu/%zu serial %zu/%zu BLE   "
+             "stray replies %d  after trace off %d",
+             serialErr, bleErr, sTimes.size(), s.size(), bTimes.size(), b.size(), stray, after);
+    r.note += buf;
+
+    // Every check that fails counts as one missed event
+    bool checks[] = {
+        serial.replies == EXCHANGES && ble.replies == EXCHANGES && stray == 0,
+        (uint32_t)abs(serialErr) <= serial.delay / 2 + 1,
+        (uint32_t)abs(bleErr) <= ble.delay / 2 + 1,
+        !sSplit.untraced && !bSplit.untraced,
+        sTimes.size() == s.size() && bTimes.size() == b.size(),
+        abs(sSplit.worstErr) == abs(serialErr) && abs(bSplit.worstErr) == abs(bleErr),
+        sSplit.queueMs.count() && sSplit.queueMs.pct(0) >= 0 && bSplit.queueMs.pct(0) >= 0,
+        after == 0,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+    return r;
+}
+
+// ── Pin capture ──────────────────────────────────────────────────────────────
+const char* g_captureOut = nullptr;      // --save-capture FILE
+
+// Level changes one scripted contact makes (Harness scriptContact): bounce
+// edges alternate from the new level, and the final level is a change only
+// after an even number of them.
+void contactEdges(uint64_t t, uint8_t edges, uint32_t bounceUs, std::vector<uint64_t>& out) {
+    if (!edges) { out.push_back(t); return; }
+    for (uint8_t i = 0; i < edges; i++) out.push_back(t + (uint64_t)i * bounceUs / edges);
+    if (edges % 2 == 0) out.push_back(t + bounceUs);
+}
+
+// Capture on over serial, then bouncy presses, a glitch too short for any
+// debounce, a spin each way and a bouncy encoder button.  Every scripted
+// level change must come back as one record no later than one sample period
+// (and no earlier than the row strobes before it); the events must still
+// come out as without capture, with a scan pass every millisecond; the
+// capture must open with CAP_FIRST, close with CAP_LAST and lose nothing.
+// --save-capture writes the records for macropad_replay.
+Result pinCapture() {
+    Result r{ "capture" };
+    static const uint32_t SAMPLE_US = 1000000 / CAPTURE_RATE_HZ;
+    const uint8_t         keys      = NUM_KEYS < 6 ? NUM_KEYS : 6;
+    const uint8_t         A = NUM_KEYS, B = NUM_KEYS + 1, BTN = NUM_KEYS + 2;
+
+    const uint8_t on[2] = { CMD_SET_CAPTURE, 1 };
+    Window w = openWindow();
+    hostSendPacket(PKT_COMMAND, on, 2);
+    runLoops(GOV_IDLE_POLL_MS + 5, nullptr);
+    uint32_t scans0 = governor.scans();
+    uint64_t t0     = sim::nowUs();
+
+    std::vector<std::vector<uint64_t>> want(NUM_KEYS + 3);
+    std::vector<Expect>                exp;
+    uint64_t t = t0 + 5000;
+    for (uint8_t k = 0; k < keys; k++) {
+        uint8_t edges = (uint8_t)(2 + k % 3 * 2 - (k & 1));         // 2, 3, 6, 1, 4, 5
+        uint32_t us   = edges * 400u;
+        scriptKey(k, t, true, edges, us);
+        scriptKey(k, t + 60000, false, 2, 800);
+        contactEdges(t, edges, us, want[k]);
+        contactEdges(t + 60000, 2, 800, want[k]);
+        exp.push_back({ EVT_KEY_PRESS,   k, t });
+        exp.push_back({ EVT_KEY_RELEASE, k, t + 60000 });
+        t += 110300;                                                // a new scan phase each
+    }
+    scriptKey(0, t, true, 0, 0);                                    // 300 µs glitch
+    scriptKey(0, t + 300, false, 0, 0);
+    want[0].push_back(t);
+    want[0].push_back(t + 300);
+    t += 50000;
+
+    uint64_t spin = t;
+    t = scriptSpin(t, +1, 4, 1000) + 30000;
+    uint64_t back = t;
+    t = scriptSpin(t, -1, 2, 500) + 30000;
+    for (int d = 0; d < 4 * 4 + 4 * 2; d++) {
+        bool     cw = d < 16;
+        uint64_t at = cw ? spin + d * 1000ull : back + (d - 16) * 500ull;
+        want[(d % 2 == 0) == cw ? A : B].push_back(at);            // CW: A leads
+    }
+    scriptEncButton(t, true, 4, 1600);
+    scriptEncButton(t + 60000, false, 2, 800);
+    contactEdges(t, 4, 1600, want[BTN]);
+    contactEdges(t + 60000, 2, 800, want[BTN]);
+    exp.push_back({ EVT_ENCODER_BTN_PRESS,   0xFF, t });
+    exp.push_back({ EVT_ENCODER_BTN_RELEASE, 0xFF, t + 60000 });
+    t += 120000;
+    r.expected = (uint32_t)exp.size();
+
+    // The window opened before the script, to catch capture's first frames;
+    // the script's vectors and scheduled edges are the bench's, not the board's
+    w.allocStart = allocCount();
+    runUntil(t, &r.loops);
+    uint32_t scans = governor.scans() - scans0;
+    uint64_t ms    = (sim::nowUs() - t0) / 1000;
+    const uint8_t off[2] = { CMD_SET_CAPTURE, 0 };
+    hostSendPacket(PKT_COMMAND, off, 2);
+    runLoops(GOV_IDLE_POLL_MS + 5, nullptr);
+
+    std::vector<Observed> s, b, sKeys;
+    closeWindow(w, r, s, b);
+    int32_t cw = 0, ccw = 0;
+    for (const Observed& o : s) {
+        if (o.evt != EVT_ENCODER_ROTATE) sKeys.push_back(o);
+        else (o.a == DIR_CW ? cw : ccw) += o.b;
+    }
+    match(exp, sKeys, false, r.serialLatMs, r.serialRelMs, r);
+
+    // Records back on the virtual clock, then every channel's changes
+    std::vector<replay::Record> recs;
+    std::vector<Frame>          fr;
+    size_t cursor = w.txStart, bytes = 0;
+    int    badFrames = 0;
+    decodeFrames(&cursor, fr);
+    uint64_t firstFrameUs = 0;
+    for (const Frame& f : fr) {
+        if (f.type != PKT_CAPTURE) continue;
+        if (!firstFrameUs) firstFrameUs = f.tUs;
+        bytes += f.len;
+        if (!replay::unpack(f.data, f.len, NUM_KEYS, recs)) badFrames++;
+    }
+    int firsts = 0, lasts = 0, losts = 0;
+    for (const replay::Record& rec : recs) {
+        firsts += (rec.levels & CAP_FIRST) != 0;
+        lasts  += (rec.levels & CAP_LAST) != 0;
+        losts  += (rec.levels & CAP_LOST) != 0;
+    }
+
+    uint32_t unmatched = 0;
+    Samples  lagUs;
+    if (!recs.empty()) {
+        uint64_t shift = widen((uint32_t)recs[0].tUs, firstFrameUs) - recs[0].tUs;
+        std::vector<std::vector<uint64_t>> got(NUM_KEYS + 3);
+        for (size_t i = 1; i < recs.size(); i++) {
+            const replay::Record &p = recs[i - 1], &c = recs[i];
+            for (uint8_t k = 0; k < NUM_KEYS; k++)
+                if (p.key(k) != c.key(k)) got[k].push_back(c.tUs + shift);
+            if ((p.levels ^ c.levels) & 0x04) got[A].push_back(c.tUs + shift);
+            if ((p.levels ^ c.levels) & 0x02) got[B].push_back(c.tUs + shift);
+            if ((p.levels ^ c.levels) & 0x01) got[BTN].push_back(c.tUs + shift);
+        }
+        for (size_t ch = 0; ch < want.size(); ch++) {
+            if (got[ch].size() != want[ch].size()) {
+                unmatched += (uint32_t)std::max(got[ch].size(), want[ch].size());
+                continue;
+            }
+            for (size_t i = 0; i < want[ch].size(); i++) {
+                int64_t lag = (int64_t)got[ch][i] - (int64_t)want[ch][i];
+                lagUs.add((double)lag);
+                if (lag < -(int64_t)NUM_ROWS * 10 || lag > (int64_t)(SAMPLE_US + NUM_ROWS * 10))
+                    unmatched++;
+            }
+        }
+    }
+
+    // Off again: no more records, and the scan timer back at SCAN_RATE_HZ
+    cursor = sim::txCount();
+    sim::strobeClear();
+    t = sim::nowUs() + 5000;
+    scriptKey(1, t, true, 0, 0);
+    scriptKey(1, t + 80000, false, 0, 0);
+    runUntil(t + 60000, nullptr);
+    Samples after;
+    for (size_t i = 0; i < sim::strobeCount(); i++) after.add(sim::strobeIntervalAt(i));
+    runUntil(t + 150000, nullptr);
+    int stray = 0;
+    fr.clear();
+    decodeFrames(&cursor, fr);
+    for (const Frame& f : fr) stray += f.type == PKT_CAPTURE;
+
+    if (g_captureOut) {
+        replay::Header h;
+        h.rows   = NUM_ROWS;
+        h.cols   = NUM_COLS;
+        h.rateHz = CAPTURE_RATE_HZ;
+        if (!replay::save(g_captureOut, h, recs)) r.missed++;
+    }
+
+    // Every value is small; a note that still would not fit is cut at the buffer
+    char buf[320];
+    int  len = snprintf(buf, sizeof(buf),
+                        "records %zu (%zu B in PKT_CAPTURE)  first/last/lost marks %d/%d/%d  edges off %u  "
+                        "sample lag µs min %.0f max %.0f\n  scans %u in %llu ms  rotate steps +%d −%d  "
+                        "scan period after off µs p50 %.0f  records after off %d",
+                        recs.size(), bytes, firsts, lasts, losts, unmatched,
+                        lagUs.count() ? lagUs.pct(0) : 0.0, lagUs.count() ? lagUs.max() : 0.0,
+                        scans, (unsigned long long)ms, cw, ccw, after.count() ? after.pct(50) : 0.0, stray);
+    r.note.append(buf, (size_t)std::min(std::max(len, 0), (int)sizeof(buf) - 1));
+
+    const int32_t steps = 4 / DEFAULT_ENCODER_SENSITIVITY;
+    bool checks[] = {
+        !recs.empty() && badFrames == 0,
+        firsts == 1 && lasts == 1 && losts == 0 && (recs.front().levels & CAP_FIRST) &&
+            (recs.back().levels & CAP_LAST),
+        unmatched == 0,
+        cw == 4 * steps && ccw == 2 * steps,
+        scans + 2 >= ms && scans <= ms + 2,
+        after.count() && after.pct(50) == 1000.0,
+        stray == 0,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+    return r;
+}
+
+// ── Host bridge ──────────────────────────────────────────────────────────────
+// The native bridge library (bridge/) against the firmware: the Session does
+// the handshake through the sim's serial RX, and the device's TX bytes reach
+// it in random 1 … 64 byte reads after every millisecond, with a log line
+// and a stray start byte slipped in between frames.
+class SimLink : public bridge::Link {
+public:
+    bool write(const uint8_t* data, size_t n) override { sim::hostWrite(data, n); return true; }
+};
+
+struct Stroke {
+    bridge::SinkKind kind;
+    uint16_t         code;
+    int16_t          value;
+    uint64_t         edgeUs = 0;         // first stroke of a scripted action: its edge
+};
+
+struct BridgePump {
+    bridge::Session&     session;
+    size_t               cursor   = 0;
+    uint32_t             seed     = 0xB41D6Eu;
+    bool                 dropNext = false;   // lose the next input-event frame
+    bool                 noise    = false;   // slip in junk between frames
+    uint32_t             noiseStarts = 0;
+    uint64_t             feedAllocs  = 0;
+    std::vector<uint8_t> buf;
+
+    uint32_t rnd(uint32_t n) { seed = seed * 1664525u + 1013904223u; return (seed >> 8) % n; }
+
+    // The new TX bytes, less the frame dropNext asks for, plus the junk
+    void collect() {
+        buf.clear();
+        size_t end = sim::txCount();
+        std::vector<Frame> fr;
+        size_t c = cursor;
+        if (dropNext || noise) decodeFrames(&c, fr);
+        uint64_t skipFrom = UINT64_MAX;
+        for (const Frame& f : fr)
+            if (dropNext && (f.type == PKT_EVENT_BATCH || f.type == PKT_KEY_EVENT)) {
+                skipFrom = f.tUs;
+                break;
+            }
+        size_t skipLeft = 0;
+        for (size_t i = cursor; i < end; i++) {
+            const sim::TxByte& b = sim::txAt(i);
+            if (skipLeft == 0 && b.tUs == skipFrom && b.b == PKT_START && dropNext) {
+                // The frame is header + payload + CRC-16
+                size_t len = i + 3 < end ? ((size_t)sim::txAt(i + 2).b << 8 | sim::txAt(i + 3).b) : 0;
+                skipLeft = 4 + len + 2;
+                dropNext = false;
+            }
+            if (skipLeft) { skipLeft--; continue; }
+            if (noise && b.b == PKT_START && !buf.empty()) {
+                static const char junk[] = "I (123) log\n";
+                buf.insert(buf.end(), junk, junk + sizeof(junk) - 1);
+                buf.push_back(PKT_START);                    // and a start byte of nothing
+                buf.push_back(0x00);
+                noiseStarts++;
+                noise = false;
+            }
+            buf.push_back(b.b);
+        }
+        cursor = end;
+    }
+
+    void step() {
+        runLoops(1, nullptr);
+        collect();
+        uint64_t a0 = allocCount();
+        for (size_t at = 0; at < buf.size();) {
+            size_t n = std::min(buf.size() - at, (size_t)(1 + rnd(64)));
+            session.feed(buf.data() + at, n, sim::nowUs());
+            at += n;
+        }
+        session.tick(sim::nowUs());
+        feedAllocs += allocCount() - a0;
+    }
+
+    void runUntil(uint64_t tUs) { while (sim::nowUs() < tUs) step(); }
+};
+
+// Sink entries without the syncs, neighbouring wheel detents summed: the
+// same for an action however the device split it into events
+std::vector<Stroke> strokes(const std::vector<bridge::SinkEntry>& in, size_t from,
+                            std::vector<uint64_t>* stamps = nullptr) {
+    std::vector<Stroke> out;
+    for (size_t i = from; i < in.size(); i++) {
+        const bridge::SinkEntry& e = in[i];
+        if (e.kind == bridge::SINK_SYNC) continue;
+        if (e.kind == bridge::SINK_WHEEL && !out.empty() && out.back().kind == bridge::SINK_WHEEL) {
+            out.back().value = (int16_t)(out.back().value + e.value);
+            continue;
+        }
+        out.push_back({ e.kind, e.code, e.value });
+        if (stamps) stamps->push_back(e.tUs);
+    }
+    return out;
+}
+
+void expectTap(std::vector<Stroke>& out, const bridge::Action& a, uint64_t edgeUs) {
+    size_t first = out.size();
+    auto key = [&out](uint16_t code, bool down) { out.push_back({ bridge::SINK_KEY, code, down }); };
+    switch (a.type) {
+    case MAP_SINGLE_KEY:
+        key(a.code, true);
+        key(a.code, false);
+        break;
+    case MAP_MEDIA_KEY: {
+        uint16_t u = a.code == 0xEA ? 0x00E2 : a.code == 0xE8 ? 0x00EA : a.code;
+        out.push_back({ bridge::SINK_CONSUMER, u, 1 });
+        out.push_back({ bridge::SINK_CONSUMER, u, 0 });
+        break;
+    }
+    case MAP_MODIFIER_COMBO:
+    case MAP_SHORTCUT:
+        for (int b = 0; b < 8; b++) if (a.mods & (1 << b)) key((uint16_t)(0xE0 + b), true);
+        key(a.code, true);
+        key(a.code, false);
+        for (int b = 7; b >= 0; b--) if (a.mods & (1 << b)) key((uint16_t)(0xE0 + b), false);
+        break;
+    }
+    if (out.size() > first) out[first].edgeUs = edgeUs;
+}
+
+bool sameStrokes(const std::vector<Stroke>& a, const std::vector<Stroke>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].kind != b[i].kind || a[i].code != b[i].code || a[i].value != b[i].value)
+            return false;
+    return true;
+}
+
+// Lossless first: taps of every action type, a spin in each of three encoder
+// modes and a button click must come out stroke for stroke, one sync per
+// event, with nothing allocated while feeding.  Then lossy: the frame with a
+// held key's release is lost (the device's own snapshot after the release
+// must let it go), and the one with a press is lost (its release must do
+// nothing, and the gap must fetch a snapshot).
+Result hostBridge() {
+    Result r{ "bridge" };
+    const uint32_t steps = 4 / DEFAULT_ENCODER_SENSITIVITY;
+
+    bridge::KeyMap map;
+    map.set(0, 0, { MAP_SINGLE_KEY, 0x04, 0 });                    // A
+    map.set(0, 1, { MAP_SHORTCUT, 0x06, 0x01 });                   // Ctrl+C
+    map.set(0, 2, { MAP_MEDIA_KEY, 0xEA, 0 });                     // mute
+    map.set(0, 3, { MAP_MODIFIER_COMBO, 0x1D, 0x03 });             // Ctrl+Shift+Z
+    map.set(0, 4, { MAP_NONE, 0, 0 });
+    map.encoder().cw     = { MAP_SHORTCUT, 0x52, 0 };              // up arrow
+    map.encoder().button = { MAP_MEDIA_KEY, 0xE9, 0 };
+
+    SimLink            link;
+    bridge::MemorySink sink([] { return sim::nowUs(); }, 1u << 14);
+    bridge::Session    session(link, sink, map);
+    BridgePump         pump{ session };
+
+    Window w = openWindow();
+    pump.cursor = sim::txCount();
+    session.start(sim::nowUs());
+    for (int i = 0; i < GOV_IDLE_POLL_MS + 20 && !session.device().keys; i++) pump.step();
+    const bridge::DeviceInfo& dev = session.device();
+
+    // ── Lossless ──
+    std::vector<Expect> exp;
+    std::vector<Stroke> want;
+    uint64_t t = sim::nowUs() + 5000;
+    for (uint8_t k = 0; k < 5; k++) {
+        scriptKey(k, t, true, 4, 1500);
+        scriptKey(k, t + 50000, false, 4, 1500);
+        exp.push_back({ EVT_KEY_PRESS,   k, t });
+        exp.push_back({ EVT_KEY_RELEASE, k, t + 50000 });
+        expectTap(want, map.at(0, k), t);
+        t += 100000;
+    }
+    scriptEncButton(t, true, 4, 1500);
+    scriptEncButton(t + 50000, false, 4, 1500);
+    exp.push_back({ EVT_ENCODER_BTN_PRESS,   0xFF, t });
+    exp.push_back({ EVT_ENCODER_BTN_RELEASE, 0xFF, t + 50000 });
+    expectTap(want, map.encoder().button, t);
+    t += 100000;
+
+    pump.noise = true;
+    pump.runUntil(t);
+    const struct { uint8_t mode; int8_t dir; uint16_t detents; } SPINS[] = {
+        { ENC_MODE_VOLUME, +1, 4 }, { ENC_MODE_SCROLL, -1, 3 }, { ENC_MODE_CUSTOM, +1, 2 },
+    };
+    for (const auto& sp : SPINS) {
+        map.encoder().mode = sp.mode;
+        uint64_t end = scriptSpin(t, sp.dir, sp.detents, 1500);
+        uint32_t n   = sp.detents * steps;
+        if (sp.mode == ENC_MODE_VOLUME)
+            for (uint32_t i = 0; i < n; i++) {
+                want.push_back({ bridge::SINK_CONSUMER, 0x00E9, 1 });
+                want.push_back({ bridge::SINK_CONSUMER, 0x00E9, 0 });
+            }
+        else if (sp.mode == ENC_MODE_SCROLL)
+            want.push_back({ bridge::SINK_WHEEL, 0, (int16_t)(sp.dir * (int)n) });
+        else
+            for (uint32_t i = 0; i < n; i++) expectTap(want, map.encoder().cw, 0);
+        pump.runUntil(end + 60000);
+        t = sim::nowUs() + 5000;
+    }
+    pump.runUntil(t + 20000);
+
+    std::vector<uint64_t> stamps;
+    std::vector<Stroke>   got    = strokes(sink.entries(), 0, &stamps);
+    uint32_t              events = session.stats().events, syncs = 0;
+    for (const bridge::SinkEntry& e : sink.entries()) syncs += e.kind == bridge::SINK_SYNC;
+    bool lossless = sameStrokes(got, want);
+    if (lossless)
+        for (size_t i = 0; i < want.size(); i++)
+            if (want[i].edgeUs) r.serialLatMs.add((stamps[i] - want[i].edgeUs) / 1000.0);
+    uint32_t gaps0 = session.stats().gaps, snaps0 = session.stats().snapshots;
+
+    // ── Lossy ──
+    size_t from = sink.entries().size();
+    std::vector<Stroke> want2;
+    t = sim::nowUs() + 5000;
+    scriptKey(0, t, true, 0, 0);                                    // release lost
+    scriptKey(0, t + 600000, false, 0, 0);
+    exp.push_back({ EVT_KEY_PRESS,   0, t });
+    exp.push_back({ EVT_KEY_RELEASE, 0, t + 600000 });
+    expectTap(want2, map.at(0, 0), t);
+    uint64_t lostRelease = t + 600000;
+    pump.runUntil(lostRelease - 2000);
+    pump.dropNext = true;
+    pump.runUntil(lostRelease + 100000);
+    uint64_t stuckUs = 0;
+    for (size_t i = from; i < sink.entries().size(); i++)
+        if (sink.entries()[i].kind == bridge::SINK_KEY && sink.entries()[i].value == 0)
+            stuckUs = sink.entries()[i].tUs - lostRelease;
+    uint32_t corrected = session.stats().corrected;
+
+    t = sim::nowUs() + 5000;
+    scriptKey(2, t, true, 0, 0);                                    // press lost
+    scriptKey(2, t + 50000, false, 0, 0);
+    exp.push_back({ EVT_KEY_PRESS,   2, t });
+    exp.push_back({ EVT_KEY_RELEASE, 2, t + 50000 });
+    pump.runUntil(t - 2000);
+    pump.dropNext = true;
+    pump.runUntil(t + 150000);
+
+    t = sim::nowUs() + 5000;
+    scriptKey(3, t, true, 0, 0);
+    scriptKey(3, t + 50000, false, 0, 0);
+    exp.push_back({ EVT_KEY_PRESS,   3, t });
+    exp.push_back({ EVT_KEY_RELEASE, 3, t + 50000 });
+    expectTap(want2, map.at(0, 3), t);
+    pump.runUntil(t + 150000);
+    bool lossy = sameStrokes(strokes(sink.entries(), from), want2);
+    r.expected = (uint32_t)exp.size();
+
+    std::vector<Observed> s, b, sKeys;
+    closeWindow(w, r, s, b);
+    for (const Observed& o : s) if (o.evt != EVT_ENCODER_ROTATE) sKeys.push_back(o);
+    match(exp, sKeys, false, r.bleLatMs, r.bleRelMs, r);      // device side, for scale
+    r.allocs = pump.feedAllocs;
+    r.seqGaps = 0;                                                  // the lossy half is deliberate
+
+    const bridge::SessionStats& st = session.stats();
+    const bridge::ParserStats&  ps = session.parser();
+    char buf[320];
+    snprintf(buf, sizeof(buf),
+             "edge→serial above is edge→bridge stroke; edge→BLE is edge→serial frame\n"
+             "  device %u.%u.%u %ux%u  features 0x%02X  frames %u (%u stitched)  refused %u "
+             "(%u planted)  strokes %zu/%zu  syncs %u/%u events\n"
+             "  lossy  gaps %u  snapshots %u  corrected %u  lost release let go after %.1f ms",
+             dev.fw[0], dev.fw[1], dev.fw[2], dev.rows, dev.cols, session.features(),
+             ps.frames, ps.stitched, ps.refused, pump.noiseStarts, got.size(), want.size(),
+             syncs, events, st.gaps - gaps0, st.snapshots - snaps0, corrected, stuckUs / 1000.0);
+    r.note += buf;
+
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+
+    bool checks[] = {
+        session.features() == (HS_FLAG_BATCH | HS_FLAG_CRC16) && st.handshakes == 1,
+        dev.keys == NUM_KEYS && dev.rows == NUM_ROWS && dev.cols == NUM_COLS,
+        lossless && syncs == events,
+        ps.stitched > 0 && ps.refused == pump.noiseStarts && pump.noiseStarts == 1,
+        pump.feedAllocs == 0,
+        lossy && corrected == 1 && st.gaps - gaps0 == 1 && st.snapshots > snaps0,
+        stuckUs > 0 && stuckUs <= (SNAPSHOT_PERIOD_MS + 10) * 1000ull,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+    return r;
+}
+
+// ── Battery ──────────────────────────────────────────────────────────────────
+// An 11 h discharge from 4.18 V to 3.40 V, read every BATTERY_SAMPLE_MS with
+// ±40 mV of ADC noise and a 150 mV radio-burst sag on every 50th reading.
+// The monitor alone first: once the filter has settled its percentage may
+// only go down, never more than 6 points off the true voltage's, and each
+// callback must carry a new value.
+// The 16-reading linear average it replaced is run on the same trace for
+// comparison.  Built with BATTERY_ENABLED, the firmware then types over a
+// steady cell (no battery frames, at most one conversion per housekeeping
+// pass) and over a cell dropping to 3.75 V (frames that only go down).
+Result batteryModel() {
+    Result r{ "battery" };
+    const uint32_t SAMPLES = 20000;
+    auto toRaw = [](int mv) { return (uint16_t)(mv * 4095 / (int)(3300 * BATTERY_DIVIDER)); };
+
+    BatteryMonitor       m;
+    std::vector<uint8_t> reported;
+    reported.reserve(256);
+
+    uint32_t seed = 0xBA77u, rises = 0, repeats = 0, legacyReports = 0, legacyRises = 0;
+    int      worst = 0, legacyPct = -1;
+    uint64_t legacySum = 0;
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        int trueMv = 4180 - (int)(780ull * i / SAMPLES);
+        seed       = seed * 1664525u + 1013904223u;
+        int mv     = trueMv + (int)((seed >> 8) % 81) - 40 - (i % 50 == 49 ? 150 : 0);
+        size_t before  = reported.size();
+        bool   settled = i > (1u << BATTERY_EMA_SHIFT) * 4;
+        if (m.sample(toRaw(mv))) reported.push_back(m.getPercentage());
+        if (reported.size() != before && before && settled) {
+            uint8_t prev = reported[before - 1], now = reported.back();
+            rises   += now > prev;
+            repeats += now == prev;
+        }
+        int truth = (BatteryMonitor::chargeTenths((uint16_t)trueMv) + 5) / 10;
+        if (settled) worst = std::max(worst, abs(m.getPercentage() - truth));
+
+        // Before: 16 readings averaged every 30 s, mapped linearly
+        legacySum += (uint64_t)mv;
+        if (i % 16 == 15) {
+            int avg = (int)(legacySum / 16);
+            legacySum = 0;
+            int pct = avg >= BATTERY_FULL_MV ? 100 : avg <= BATTERY_EMPTY_MV ? 0
+                    : (avg - BATTERY_EMPTY_MV) * 100 / (BATTERY_FULL_MV - BATTERY_EMPTY_MV);
+            if (legacyPct >= 0 && pct != legacyPct) {
+                legacyReports++;
+                legacyRises += pct > legacyPct;
+            }
+            legacyPct = pct;
+        }
+    }
+    uint32_t reports = (uint32_t)reported.size();
+
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "model       %u readings  %u reports (%u going up)  worst %d %% off  "
+             "ends at %u %% / %u mV\n"
+             "  legacy    %u reports (%u going up)",
+             SAMPLES, reports, rises, worst, m.getPercentage(), m.getVoltageMv(),
+             legacyReports, legacyRises);
+    r.note = buf;
+
+    bool fw = true;
+#if BATTERY_ENABLED
+    sim::Costs c;
+    c.analogReadUs = 50;
+    sim::setCosts(c);
+    Window   w      = openWindow();
+    uint32_t reads0 = sim::analogReads();
+    uint64_t t0     = sim::nowUs();
+
+    // Typing over a steady cell, then over one that sags to 3.75 V
+    std::vector<Expect> exp;
+    uint64_t t = t0 + 5000;
+    for (int phase = 0; phase < 2; phase++) {
+        if (phase == 1) sim::setAnalog(BATTERY_ADC_PIN, toRaw(3750));
+        for (int i = 0; i < 40; i++, t += 100000) {
+            uint8_t k = (uint8_t)(i % NUM_KEYS);
+            scriptKey(k, t, true, 4, 1500);
+            scriptKey(k, t + 50000, false, 4, 1500);
+            exp.push_back({ EVT_KEY_PRESS,   k, t });
+            exp.push_back({ EVT_KEY_RELEASE, k, t + 50000 });
+        }
+        runUntil(t, &r.loops);
+        if (phase == 0) t = sim::nowUs() + 60000000;           // a minute for the filter
+        runUntil(t, nullptr);
+        t += 5000;
+    }
+    r.expected = (uint32_t)exp.size();
+    uint32_t reads  = sim::analogReads() - reads0;
+    uint64_t spanMs = (sim::nowUs() - t0) / 1000;
+    sim::setCosts(sim::Costs());
+
+    std::vector<Observed> s, b;
+    closeWindow(w, r, s, b);
+    match(exp, s, false, r.serialLatMs, r.serialRelMs, r);
+
+    std::vector<Frame> frames;
+    size_t cursor = w.txStart;
+    decodeFrames(&cursor, frames);
+    std::vector<uint8_t> levels;
+    uint64_t steadyEndUs = t0 + 4000000 + 5000;
+    uint32_t steady = 0, up = 0;
+    for (const Frame& f : frames) {
+        if (f.type != PKT_BATTERY || f.len < 1) continue;
+        steady += f.tUs < steadyEndUs;
+        if (!levels.empty()) up += f.data[0] >= levels.back();
+        levels.push_back(f.data[0]);
+    }
+    sim::setAnalog(BATTERY_ADC_PIN, toRaw(4180));
+
+    snprintf(buf, sizeof(buf),
+             "\n  firmware  %u conversions in %llu ms  battery frames %zu (%u steady, %u not lower)  "
+             "ends at %u %%",
+             reads, (unsigned long long)spanMs, levels.size(), steady, up, battery.getPercentage());
+    r.note += buf;
+    fw = reads <= spanMs / BATTERY_SAMPLE_MS + 1 && steady == 0 && up == 0 && !levels.empty();
+#endif
+
+    bool checks[] = {
+        rises == 0 && repeats == 0,
+        reports > 1 && reports <= 101,
+        worst <= 6,
+        fw,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+    return r;
+}
+
+// ── Adaptive debounce ────────────────────────────────────────────────────────
+// Learning starts over (CMD_SET_DEBOUNCE_LIVE with the adaptive byte), then
+// 16 rounds tap each of a few keys.  Most switches bounce for 1.5 ms.  Key 0
+// is worn (12 ms), key 1 wears from 1 ms to 10 ms over the rounds, and key 2
+// is healthy until round 10, after which its contact reopens for 7 ms, longer
+// than the window it learned.  No event may be missed or doubled.  Once
+// learned, a healthy press must arrive in under 8 ms, where the 20 ms ceiling
+// took 21.  The profile from CMD_GET_DEBOUNCE must show short windows on the
+// healthy keys, key 0 at the ceiling and flagged, key 2 flagged for chatter.
+// A fixed override must put every key back on one window.
+void setDebounce(uint16_t ms, bool adaptive) {
+    const uint8_t cmd[4] = { CMD_SET_DEBOUNCE_LIVE, (uint8_t)(ms >> 8), (uint8_t)ms, adaptive };
+    hostSendPacket(PKT_COMMAND, cmd, adaptive ? 4 : 3);
+    runUntil(sim::nowUs() + 5000, nullptr);
+}
+
+Result learnDebounce() {
+    Result r{ "debounce" };
+    const uint8_t  WORN = 0, WEARING = 1, SUDDEN = 2;
+    const uint8_t  KEYS = NUM_KEYS < 9 ? NUM_KEYS : 9;
+    const int      ROUNDS = 16, LEARNED = DEBOUNCE_LEARN_BURSTS / 2;    // a tap is two bursts
+    setDebounce(DEFAULT_DEBOUNCE_MS, true);
+    uint16_t chatter0 = keyMatrix.chatterCount();
+
+    std::vector<Expect> expA, expB;
+    uint64_t t = sim::nowUs() + 5000, learnedUs = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        if (i == LEARNED) learnedUs = t;
+        for (uint8_t k = 0; k < KEYS; k++, t += 100000) {
+            uint8_t  edges  = 4;
+            uint32_t bounce = 1500;
+            if (k == WORN)                  bounce = 12000;
+            if (k == WEARING)               bounce = 1000 + 600 * i;
+            if (k == SUDDEN && i >= 10)     { edges = 2; bounce = 14000; }
+            scriptKey(k, t, true, edges, bounce);
+            scriptKey(k, t + 50000, false, edges, bounce);
+            std::vector<Expect>& exp = i < LEARNED ? expA : expB;
+            exp.push_back({ EVT_KEY_PRESS,   k, t });
+            exp.push_back({ EVT_KEY_RELEASE, k, t + 50000 });
+        }
+    }
+    Window w = openWindow();
+    runUntil(t + 50000, &r.loops);
+    std::vector<Observed> s, b, sA, sB;
+    closeWindow(w, r, s, b);
+    r.expected = (uint32_t)(expA.size() + expB.size());
+
+    // The learned profile, as the host gets it
+    size_t cursor = sim::txCount();
+    const uint8_t get = CMD_GET_DEBOUNCE;
+    hostSendPacket(PKT_COMMAND, &get, 1);
+    runUntil(sim::nowUs() + 10000, nullptr);
+    std::vector<Frame> frames;
+    decodeFrames(&cursor, frames);
+    const Frame* prof = nullptr;
+    for (const Frame& f : frames)
+        if (f.type == PKT_CONFIG_DATA && f.len && f.data[0] == CFG_DEBOUNCE_PROFILE) prof = &f;
+
+    for (const Observed& o : s)
+        if (o.evt == EVT_KEY_PRESS || o.evt == EVT_KEY_RELEASE) (o.tUs < learnedUs ? sA : sB).push_back(o);
+    Samples firstLat, firstRel;
+    match(expA, sA, false, firstLat, firstRel, r);
+    match(expB, sB, false, r.serialLatMs, r.serialRelMs, r);
+
+    bool    profOk = prof && prof->len == KeyMatrix::PROFILE_BYTES && prof->data[1] == 1 &&
+                     prof->data[2] == DEFAULT_DEBOUNCE_MS && prof->data[3] == NUM_KEYS;
+    auto    window  = [&](uint8_t k) { return prof->data[4 + 2 * k]; };
+    auto    burst   = [&](uint8_t k) { return prof->data[5 + 2 * k]; };
+    auto    flagged = [&](uint8_t k) { return (prof->data[4 + 2 * NUM_KEYS + k / 8] >> (k % 8)) & 1; };
+    uint8_t healthyMax = 0;
+    bool    healthyClean = true;
+    if (profOk)
+        for (uint8_t k = SUDDEN + 1; k < KEYS; k++) {
+            healthyMax    = std::max(healthyMax, window(k));
+            healthyClean &= !flagged(k);
+        }
+
+    char buf[320];
+    if (profOk)
+        snprintf(buf, sizeof(buf),
+                 "press p50  %.2f ms learning at the ceiling, %.2f ms learned\n"
+                 "  windows    healthy ≤ %u ms  worn %u ms (%u ms bursts%s)  wearing %u ms (%u ms)  "
+                 "sudden %u ms (%u ms%s)",
+                 firstLat.pct(50), r.serialLatMs.pct(50), healthyMax,
+                 window(WORN), burst(WORN), flagged(WORN) ? ", flagged" : "",
+                 window(WEARING), burst(WEARING), window(SUDDEN), burst(SUDDEN),
+                 flagged(SUDDEN) ? ", flagged" : "");
+    else
+        snprintf(buf, sizeof(buf), "no CFG_DEBOUNCE_PROFILE reply");
+    r.note = buf;
+
+    // The override: one window for every key, until learning is asked for again
+    setDebounce(DEFAULT_DEBOUNCE_MS, false);
+    bool fixed = !keyMatrix.adaptiveDebounce();
+    for (uint8_t k = 0; k < NUM_KEYS; k++) fixed &= keyMatrix.keyWindowMs(k) == DEFAULT_DEBOUNCE_MS;
+    setDebounce(DEFAULT_DEBOUNCE_MS, true);
+
+    bool checks[] = {
+        profOk,
+        profOk && healthyClean && healthyMax <= 6 && r.serialLatMs.pct(50) < 8.0,
+        profOk && window(WORN) == DEFAULT_DEBOUNCE_MS && flagged(WORN),
+        profOk && !flagged(WEARING) && burst(WEARING) >= 9 && window(WEARING) > healthyMax,
+        profOk && flagged(SUDDEN) && keyMatrix.chatterCount() - chatter0 == 1,
+        fixed,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+    return r;
+}
+
+// ── Gestures ─────────────────────────────────────────────────────────────────
+// CMD_SET_GESTURE puts every key on the defaults (hold 200 ms, double tap
+// 250 ms), then key 1 on a 400 ms hold with no double tap and key 2 off.
+// Four rounds play bouncy presses 5 ms either side of each threshold over a
+// 30 ms connection the central will not shorten, each round at a different
+// scan phase.  Every gesture must arrive on both links, of the right kind and
+// stamped within 3 ms of its first press; key 2 must give none, and every
+// press and release must still arrive.  The same engine run on the BLE
+// arrival times, as a host classifying by itself would, is reported for
+// comparison, not judged.  Then, with a key map loaded, a tap and a double
+// tap under a held layer key must carry layer 1 on both links.  Last, the
+// engine alone: ns per scan while typing.
+struct GesturePlay {
+    uint8_t  key;
+    uint16_t ms[3];              // press, gap, second press; 0 = no second press
+    uint8_t  want[2];            // gestures, stamped at the first and second press
+};
+
+void setGesture(uint8_t key, uint16_t holdMs, uint16_t doubleMs) {
+    const uint8_t cmd[6] = { CMD_SET_GESTURE, key, (uint8_t)(holdMs >> 8), (uint8_t)holdMs,
+                             (uint8_t)(doubleMs >> 8), (uint8_t)doubleMs };
+    hostSendPacket(PKT_COMMAND, cmd, sizeof(cmd));
+    runUntil(sim::nowUs() + 5000, nullptr);
+}
+
+bool isGesture(uint8_t evt) { return isKeyEvent(evt) && evt != EVT_KEY_PRESS && evt != EVT_KEY_RELEASE; }
+
+Result gestureScenario() {
+    Result r{ "gestures" };
+    sim::BleCentral stubborn;
+    stubborn.acceptParams = false;
+    reconnect(stubborn);
+    const uint8_t defaults[2] = { CMD_SET_GESTURE, 0xFF };
+    hostSendPacket(PKT_COMMAND, defaults, sizeof(defaults));
+    setGesture(1, 400, 0);
+    setGesture(2, 0, 0);
+
+    const uint16_t H = GESTURE_HOLD_MS, D = GESTURE_DOUBLE_TAP_MS;
+    const GesturePlay PLAYS[] = {
+        { 0, { 120,   0,   0 }, { EVT_KEY_TAP, 0 } },
+        { 0, { (uint16_t)(H - 5), 0, 0 }, { EVT_KEY_TAP, 0 } },
+        { 0, { (uint16_t)(H + 5), 0, 0 }, { EVT_KEY_HOLD, 0 } },
+        { 0, { 80, (uint16_t)(D - 5), 80 }, { EVT_KEY_DOUBLE_TAP, 0 } },
+        { 0, { 80, (uint16_t)(D + 5), 80 }, { EVT_KEY_TAP, EVT_KEY_TAP } },
+        { 0, { 80, 150, (uint16_t)(H + 100) }, { EVT_KEY_TAP, EVT_KEY_HOLD } },
+        { 1, { 395,   0,   0 }, { EVT_KEY_TAP, 0 } },
+        { 1, { 405,   0,   0 }, { EVT_KEY_HOLD, 0 } },
+        { 1, { 80,  100,  80 }, { EVT_KEY_TAP, EVT_KEY_TAP } },
+        { 2, { 80,  100,  80 }, { 0, 0 } },
+    };
+    const int ROUNDS = 4;
+
+    std::vector<Expect> expKeys, expGest;
+    uint64_t t = sim::nowUs() + 20000;
+    for (int i = 0; i < ROUNDS; i++) {
+        t += 317 * i;                                        // another scan phase
+        for (const GesturePlay& p : PLAYS) {
+            uint64_t press[2] = { t, t + (uint64_t)(p.ms[0] + p.ms[1]) * 1000 };
+            int      presses  = p.ms[2] ? 2 : 1;
+            for (int n = 0; n < presses; n++) {
+                uint64_t up = press[n] + (uint64_t)p.ms[n ? 2 : 0] * 1000;
+                scriptKey(p.key, press[n], true, 4, 1500);
+                scriptKey(p.key, up, false, 4, 1500);
+                expKeys.push_back({ EVT_KEY_PRESS,   p.key, press[n] });
+                expKeys.push_back({ EVT_KEY_RELEASE, p.key, up });
+                if (p.want[n]) expGest.push_back({ p.want[n], p.key, press[n] });
+                t = up;
+            }
+            t += 1000000;
+        }
+    }
+    Window w = openWindow();
+    runUntil(t, &r.loops);
+    std::vector<Observed> s, b, sKeys, bKeys, sGest, bGest;
+    closeWindow(w, r, s, b);
+    r.expected = (uint32_t)(expKeys.size() + expGest.size());
+
+    for (const Observed& o : s) (isGesture(o.evt) ? sGest : sKeys).push_back(o);
+    for (const Observed& o : b) (isGesture(o.evt) ? bGest : bKeys).push_back(o);
+    Samples gestLat, gestRel, stampUs;
+    match(expKeys, sKeys, false, r.serialLatMs, r.serialRelMs, r);
+    match(expKeys, bKeys, true, r.bleLatMs, r.bleRelMs, r);
+    Result scratch{ "" };
+    match(expGest, sGest, false, gestLat, gestRel, scratch);
+    match(expGest, bGest, true, gestLat, gestRel, scratch);
+    r.missed   += scratch.missed;
+    r.spurious += scratch.spurious;
+    for (size_t i = 0; i < scratch.captureUs.count(); i++) stampUs.add(scratch.captureUs.at(i));
+    bool stamped = stampUs.count() == expGest.size() && stampUs.max() <= 3000;
+
+    // A host classifying BLE arrivals with the same thresholds
+    static GestureEngine host;
+    static EventRing     hostRing;
+    host.begin();
+    hostRing.begin();
+    host.setEventRing(&hostRing);
+    for (uint8_t k = 0; k < NUM_KEYS; k++) host.setKey(k, gestures.holdMs(k), gestures.doubleTapMs(k));
+    KeyMask  down = {};
+    uint32_t at[NUM_KEYS] = {};
+    std::vector<uint8_t> hostSeq[3], wantSeq[3];
+    auto drain = [&]() {
+        InputEvent e;
+        while (hostRing.pop(e))
+            if (e.id < 3) hostSeq[e.id].push_back(e.type);
+    };
+    for (const Observed& o : bKeys) {
+        if (o.evt == EVT_KEY_PRESS) maskSet(down, o.a);
+        else                        maskClear(down, o.a);
+        at[o.a] = (uint32_t)o.tUs;
+        host.update(down, KeyMask{}, at, (uint32_t)o.tUs);
+        drain();
+    }
+    host.update(down, KeyMask{}, at, (uint32_t)sim::nowUs());
+    drain();
+    for (const Expect& e : expGest) wantSeq[e.id].push_back(e.evt);
+    uint32_t hostWrong = 0;
+    for (int k = 0; k < 3; k++) {
+        size_t n = std::min(hostSeq[k].size(), wantSeq[k].size());
+        for (size_t i = 0; i < n; i++) hostWrong += hostSeq[k][i] != wantSeq[k][i];
+        hostWrong += (uint32_t)(std::max(hostSeq[k].size(), wantSeq[k].size()) - n);
+    }
+
+    // Under a held layer key: a tap and a double tap on a key mapped on
+    // layer 1 must carry layer 1, though each resolves after its release
+    std::vector<uint8_t> img = { KEYMAP_VERSION, 2, NUM_KEYS, 0 };
+    img.resize(KEYMAP_HEADER_BYTES + 2 * NUM_KEYS * 3);
+    for (uint8_t k = 0; k < NUM_KEYS; k++)
+        img[KEYMAP_HEADER_BYTES + (NUM_KEYS + k) * 3] = MAP_TRANSPARENT;
+    const uint8_t layerKey[3] = { MAP_LAYER_HOLD, 1, 0 }, f1[3] = { MAP_SINGLE_KEY, 0x3A, 0 };
+    memcpy(img.data() + KEYMAP_HEADER_BYTES + 4 * 3, layerKey, 3);
+    memcpy(img.data() + KEYMAP_HEADER_BYTES + NUM_KEYS * 3, f1, 3);
+    uploadKeymap(img, false);
+    setGesture(4, 0, 0);
+    t = sim::nowUs() + 20000;
+    scriptKey(4, t, true, 4, 1500);
+    uint64_t taps[3] = { t + 50000, t + 1000000, t + 1180000 };      // a tap, then a double tap
+    for (uint64_t at0 : taps) {
+        scriptKey(0, at0, true, 4, 1500);
+        scriptKey(0, at0 + 80000, false, 4, 1500);
+    }
+    scriptKey(4, t + 2000000, false, 4, 1500);
+    Result layered{ "" };
+    Window lw = openWindow();
+    runUntil(t + 2200000, nullptr);
+    std::vector<Observed> ls, lb;
+    closeWindow(lw, layered, ls, lb);
+    uint32_t layerGest = 0, layerWrong = 0;
+    for (const std::vector<Observed>* link : { &ls, &lb }) {
+        uint8_t want[2] = { EVT_KEY_TAP, EVT_KEY_DOUBLE_TAP }, got = 0;
+        for (const Observed& o : *link) {
+            if (!isGesture(o.evt) || o.a != 0) continue;
+            layerGest++;
+            if (o.b != 1 || got >= 2 || o.evt != want[got]) layerWrong++;
+            got++;
+        }
+        if (got != 2) layerWrong++;
+    }
+
+    // The engine alone, once per 1 ms scan: a key changes every 40 scans
+    host.begin();
+    for (uint8_t k = 0; k < NUM_KEYS; k++) host.setKey(k, H, D);
+    const uint32_t scans = 200000;
+    uint64_t allocs0 = allocCount();
+    auto     t0      = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < scans; i++) {
+        uint32_t nowUs = i * 1000;
+        if (i % 40 == 0) {
+            uint8_t k = (uint8_t)((i / 80) % NUM_KEYS);
+            if (maskTest(down, k)) maskClear(down, k);
+            else                   maskSet(down, k);
+            at[k] = nowUs;
+        }
+        host.update(down, KeyMask{}, at, nowUs);
+        InputEvent e;
+        while (hostRing.pop(e)) {}
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / scans;
+    uint64_t engAllocs = allocCount() - allocs0;
+
+    char buf[320];
+    snprintf(buf, sizeof(buf),
+             "device      %zu/%zu gestures over serial, %zu over BLE   stamp − first press µs max %.0f\n"
+             "  host-side %u of %zu wrong from BLE arrivals at 30 ms   engine %.0f ns per scan   %llu allocs\n"
+             "  layer 1     %u/4 gestures, %u wrong",
+             sGest.size(), expGest.size(), bGest.size(), stampUs.count() ? stampUs.max() : 0.0,
+             hostWrong, expGest.size(), ns, (unsigned long long)engAllocs, layerGest, layerWrong);
+    r.note = buf;
+
+    setGesture(0xFF, 0, 0);
+    reconnect(sim::BleCentral());
+
+    bool checks[] = {
+        stamped,
+        gestures.resolved() > 0 && !gestures.pending(),
+        engAllocs == 0,
+        layerWrong == 0,
+    };
+    for (bool ok : checks) if (!ok) r.missed++;
+    return r;
+}
+
+// A fast spin while typing, over a stubborn 30 ms central in RF noise: lost
+// PDUs hold TX buffers for extra connection events, and notifies wait for
+// one.  Each must go out later, in order, and no key press or release may be
+// given up for rotation data; batched, then one notify per event.  Every step
+// turned has to reach the host either way, and under congestion the encoder
+// reports less often with more steps each.  Last, one notify per event again
+// with the stack down to a single TX buffer and a wiggled knob, so turns in
+// both directions wait together: the queue must fill, and still lose no step.
+// There the only BLE seq gaps allowed are the seqs of rotations folded away.
+Result bleCongestion() {
+    Result r{ "ble-tx" };
+    const uint8_t hidOff[2] = { CMD_SET_HID_MODE, 0 };              // app events only
+    hostSendPacket(PKT_COMMAND, hidOff, sizeof(hidOff));
+    sim::BleCentral stubborn;
+    stubborn.acceptParams = false;
+    reconnect(stubborn);
+    sim::bleNoise(30);
+    uint8_t sens = DEFAULT_ENCODER_SENSITIVITY;
+
+    char buf[600];
+    int  n = 0;
+    for (int pass = 0; pass < 3; pass++) {
+        bool batched = pass == 0, flood = pass == 2;
+        attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, batched);
+        runUntil(sim::nowUs() + 100000, nullptr);
+        if (flood) {
+            sim::bleTxBuffers(1);
+            sim::bleNoise(80);
+        }
+
+        std::vector<Expect> exp;
+        uint64_t t   = sim::nowUs() + 5000;
+        uint64_t end = t;
+        uint32_t detents = 0;
+        if (flood)
+            for (int i = 0; i < 20; i++, detents += 30)          // back and forth
+                end = scriptSpin(end, i % 2 ? -1 : +1, 30, 1000) + 150000;
+        else
+            end = scriptSpin(t, pass ? -1 : +1, detents = 750, 1000);
+        uint64_t every = flood ? 400000 : 70000;
+        for (uint8_t k = 0; t + every < end; k++, t += every) {
+            uint8_t key = (uint8_t)(k % NUM_KEYS);
+            scriptKey(key, t, true, 4, 1500);
+            scriptKey(key, t + 40000, false, 4, 1500);
+            exp.push_back({ EVT_KEY_PRESS,   key, t });
+            exp.push_back({ EVT_KEY_RELEASE, key, t + 40000 });
+        }
+
+        uint32_t refused0 = sim::notifyRefused(), retried0 = bleService.txRetried();
+        uint32_t dropped0 = bleService.txDropped(), coalesced0 = bleService.txCoalesced();
+        Result   scratch{ "" };
+        Result&  into = batched ? r : scratch;
+        Window   w    = openWindow();
+        uint8_t  high = 0;
+        if (flood)
+            for (uint64_t at = sim::nowUs(); at < end; at += 2000) {
+                runUntil(at, &into.loops);
+                high = std::max(high, bleService.txWaiting());
+            }
+        runUntil(end + (flood ? 3000000 : 300000), &into.loops);
+        std::vector<Observed> s, b, sKeys, bKeys;
+        closeWindow(w, into, s, b);
+        uint32_t bGaps = flood ? seqGaps(b) : 0;             // each folded rotation's seq
+        r.missed += batched ? 0 : scratch.missed - bGaps;
+        r.expected += (uint32_t)exp.size() * 2;
+
+        uint32_t sSteps = 0, bSteps = 0, bRotations = 0;
+        for (const Observed& o : s) {
+            if (o.evt == EVT_ENCODER_ROTATE) sSteps += o.b;
+            else                             sKeys.push_back(o);
+        }
+        for (const Observed& o : b) {
+            if (o.evt == EVT_ENCODER_ROTATE) { bSteps += o.b; bRotations++; }
+            else                             bKeys.push_back(o);
+        }
+        Samples lat, rel;
+        match(exp, sKeys, false, into.serialLatMs, into.serialRelMs, r);
+        match(exp, bKeys, true, lat, rel, r);
+        for (size_t i = 0; i < lat.count(); i++) into.bleLatMs.add(lat.at(i));
+        for (size_t i = 0; i < rel.count(); i++) into.bleRelMs.add(rel.at(i));
+
+        uint32_t refused   = sim::notifyRefused() - refused0;
+        uint32_t retried   = bleService.txRetried() - retried0;
+        uint32_t dropped   = bleService.txDropped() - dropped0;
+        uint32_t coalesced = bleService.txCoalesced() - coalesced0;
+        uint32_t steps     = detents * 4 / sens;
+        n += snprintf(buf + n, sizeof(buf) - n,
+                      "%s%-9s  steps serial %u BLE %u/%u in %u rotations   held %u  refused %u  "
+                      "coalesced %u  dropped %u   press→BLE p99 %.1f ms",
+                      n ? "\n  " : "", batched ? "batched" : flood ? "flooded" : "per-event", sSteps,
+                      bSteps, steps, bRotations, retried, refused, coalesced, dropped,
+                      lat.count() ? lat.pct(99) : 0.0);
+        if (flood) n += snprintf(buf + n, sizeof(buf) - n, "   queue high %u/%u", high, BLE_TX_QUEUE);
+
+        bool checks[] = {
+            sSteps == steps && bSteps == steps,
+            retried > 0,
+            dropped == 0,
+            !bleService.txWaiting(),
+            !flood || (high == BLE_TX_QUEUE && coalesced > 0 && bGaps <= coalesced),
+        };
+        for (bool ok : checks) if (!ok) r.missed++;
+    }
+    r.note = buf;
+
+    sim::bleNoise(0);
+    sim::bleTxBuffers(sim::TX_BUFS);
+    reconnect(sim::BleCentral());
+    return r;
+}
+
+struct Entry {
+    const char* name;
+    Result    (*fn)();
+};
+
+const Entry SCENARIOS[] = {
+    { "idle",       idle          },
+    { "keys",       keys          },
+    { "keys-legacy", keysLegacy   },
+    { "keys-eager", keysEager     },
+    { "chord",      chord         },
+    { "encoder",    encoderSpin   },
+    { "enc-button", encoderButton },
+    { "serial-rx",  serialBurst   },
+    { "rx-corrupt", rxCorrupt     },
+    { "rx-fuzz",    rxFuzz        },
+    { "jitter",     jitter        },
+    { "resync",     resync        },
+    { "trace",      traceFetch    },
+    { "stats",      statsFetch    },
+    { "link",       linkProfiles  },
+    { "hid",        hidReports    },
+    { "keymap",     keymapActions },
+    { "governor",   scanGovernor  },
+    { "wake",       wakeFromSleep },
+    { "clock",      clockSync     },
+    { "capture",    pinCapture    },
+    { "bridge",     hostBridge    },
+    { "battery",    batteryModel  },
+    { "debounce",   learnDebounce },
+    { "gestures",   gestureScenario },
+    { "ble-tx",     bleCongestion },
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<const char*> names;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save-capture") == 0 && i + 1 < argc) g_captureOut = argv[++i];
+        else names.push_back(argv[i]);
+    }
+
+    bootFirmware();
+
+    printf("MacroPad host bench — FW %u.%u.%u, %ux%u matrix, debounce %u ms\n",
+           FW_VERSION_MAJOR, FW_VERSION_MINOR, FW_VERSION_PATCH,
+           NUM_ROWS, NUM_COLS, debounceMs);
+
+    int failures = 0;
+    for (const Entry& e : SCENARIOS) {
+        bool wanted = names.empty();
+        for (const char* n : names) if (strcmp(n, e.name) == 0) wanted = true;
+        if (!wanted) continue;
+
+        uint64_t fwAllocs = firmwareAllocCount();
+        Result   r        = e.fn();
+        r.fwAllocs = firmwareAllocCount() - fwAllocs;
+        print(r);
+        if (r.missed || r.spurious || r.fwAllocs) failures++;
+    }
+
+    if (failures) printf("\n%d scenario(s) reported missed or spurious events, or "
+                         "allocated on the board\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+// =============================================================================
+// Harness.cpp — Shared plumbing for the host benchmark scenarios
+// =============================================================================
+#include "Harness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ── Heap tracking ────────────────────────────────────────────────────────────
+static uint64_t    g_allocs   = 0;
+static uint64_t    g_fwAllocs = 0;       // made on a firmware task or in an ISR
+static const char* g_fwWhere  = nullptr;
+
+static void countAlloc() {
+    g_allocs++;
+    if (const char* where = sim::firmwareContext()) {
+        g_fwAllocs++;
+        g_fwWhere = where;
+    }
+}
+
+void* operator new(size_t n) {
+    countAlloc();
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) {
+    countAlloc();
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept           { free(p); }
+void operator delete[](void* p) noexcept         { free(p); }
+void operator delete(void* p, size_t) noexcept   { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace harness {
+
+uint64_t    allocCount()         { return g_allocs; }
+uint64_t    firmwareAllocCount() { return g_fwAllocs; }
+const char* lastFirmwareAlloc()  { return g_fwWhere; }
+
+// ── Statistics ───────────────────────────────────────────────────────────────
+double Samples::mean() const {
+    if (_v.empty()) return 0;
+    double s = 0;
+    for (double v : _v) s += v;
+    return s / _v.size();
+}
+
+double Samples::pct(double p) const {
+    if (_v.empty()) return 0;
+    std::vector<double> s(_v);
+    std::sort(s.begin(), s.end());
+    size_t i = (size_t)((p / 100.0) * (s.size() - 1) + 0.5);
+    return s[std::min(i, s.size() - 1)];
+}
+
+double Samples::max() const {
+    return _v.empty() ? 0 : *std::max_element(_v.begin(), _v.end());
+}
+
+// ── Frames ───────────────────────────────────────────────────────────────────
+static bool g_crc = false;              // HS_FLAG_CRC16 agreed by attachHost()
+
+bool crcFraming() { return g_crc; }
+
+void decodeFrames(size_t* cursor, std::vector<Frame>& out, size_t* skipped) {
+    size_t i = *cursor;
+    size_t n = sim::txCount();
+    size_t framed = 0, start = i;
+
+    while (i < n) {
+        if (sim::txAt(i).b != PKT_START) { i++; continue; }
+        if (i + 4 > n) break;
+
+        uint8_t  type = sim::txAt(i + 1).b;
+        uint16_t len  = ((uint16_t)sim::txAt(i + 2).b << 8) | sim::txAt(i + 3).b;
+        bool     crc  = g_crc && type != PKT_HANDSHAKE_ACK;
+        size_t   tail = crc ? 2 : 1;
+        if (len > sizeof(Frame::data)) { i++; continue; }
+        if (i + 4 + len + tail > n) break;
+
+        bool ok;
+        if (crc) {
+            uint16_t c = CRC16_INIT;
+            for (size_t k = 1; k < 4 + (size_t)len; k++) c = crc16Update(c, sim::txAt(i + k).b);
+            ok = sim::txAt(i + 4 + len).b == (uint8_t)(c >> 8) &&
+                 sim::txAt(i + 5 + len).b == (uint8_t)c;
+        } else {
+            uint8_t x = 0;
+            for (size_t k = 1; k < 4 + (size_t)len; k++) x ^= sim::txAt(i + k).b;
+            ok = x == sim::txAt(i + 4 + len).b;
+        }
+        if (!ok) { i++; continue; }
+
+        Frame f;
+        f.tUs  = sim::txAt(i).tUs;
+        f.type = type;
+        f.len  = len;
+        for (uint16_t k = 0; k < len; k++) f.data[k] = sim::txAt(i + 4 + k).b;
+        out.push_back(f);
+        i      += 4 + len + tail;
+        framed += 4 + len + tail;
+    }
+    if (skipped) *skipped += i - start - framed;
+    *cursor = i;
+}
+
+size_t buildFrame(uint8_t type, const uint8_t* data, uint16_t len, uint8_t* out) {
+    out[0] = PKT_START;
+    out[1] = type;
+    out[2] = (uint8_t)(len >> 8);
+    out[3] = (uint8_t)len;
+    if (len) memcpy(out + 4, data, len);
+    if (g_crc && type != PKT_HANDSHAKE) {
+        uint16_t c = crc16(out + 1, 3 + len);
+        out[4 + len] = (uint8_t)(c >> 8);
+        out[5 + len] = (uint8_t)c;
+        return 6 + len;
+    }
+    uint8_t x = 0;
+    for (size_t i = 1; i < 4 + (size_t)len; i++) x ^= out[i];
+    out[4 + len] = x;
+    return 5 + len;
+}
+
+void hostSendPacket(uint8_t type, const uint8_t* data, uint16_t len) {
+    uint8_t buf[6 + SERIAL_RX_BUF_SIZE];
+    sim::hostWrite(buf, buildFrame(type, data, len, buf));
+}
+
+// ── Board driving ────────────────────────────────────────────────────────────
+uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void bootFirmware() {
+    sim::reset();
+    sim::watchStrobe(ROW_PINS[0]);
+    setup();
+
+    sim::bleConnect(247);
+    attachHost(HS_FLAG_BATCH | HS_FLAG_CRC16, true);
+}
+
+void attachHost(uint8_t serialFeatures, bool bleBatch) {
+    const uint8_t hello[] = { HANDSHAKE_MAGIC_0, HANDSHAKE_MAGIC_1, HANDSHAKE_MAGIC_2,
+                              serialFeatures };
+    hostSendPacket(PKT_HANDSHAKE, hello, serialFeatures ? 4 : 3);
+    sim::bleSubscribe(EVENT_BATCH_CHAR_UUID, bleBatch);
+    runLoops(2, nullptr);
+    // With no host attached an idle transport task polls RX only every
+    // GOV_IDLE_POLL_MS
+    for (int i = 0; i < GOV_IDLE_POLL_MS && !serialBridge.isHandshaked(); i++)
+        runLoops(1, nullptr);
+    g_crc = serialBridge.features() & HS_FLAG_CRC16;
+
+    sim::txClear();
+    sim::notifyClear();
+}
+
+// One super-loop iteration, or — once the firmware runs its own FreeRTOS
+// tasks — one millisecond of scheduled board time.
+static void step() {
+    if (sim::tasksRunning()) sim::advanceUs(1000);
+    else                     loop();
+}
+
+static void oneLoop(LoopStats* st) {
+    if (!st) { step(); return; }
+
+    auto     t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = readCycles();
+    step();
+    uint64_t c1 = readCycles();
+    auto     t1 = std::chrono::steady_clock::now();
+
+    st->hostNs.add((double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    st->cycles.add((double)(c1 - c0));
+    st->loops++;
+}
+
+void runLoops(uint64_t n, LoopStats* st) {
+    for (uint64_t i = 0; i < n; i++) oneLoop(st);
+}
+
+void runUntil(uint64_t tUs, LoopStats* st) {
+    while (sim::nowUs() < tUs) oneLoop(st);
+}
+
+// ── Waveforms ────────────────────────────────────────────────────────────────
+static void scriptContact(uint64_t atUs, bool closed, uint8_t edges, uint32_t bounceUs,
+                          void (*emit)(uint64_t, bool, const void*), const void* ctx) {
+    if (edges == 0) { emit(atUs, closed, ctx); return; }
+    for (uint8_t i = 0; i < edges; i++) {
+        bool s = (i % 2 == 0) ? closed : !closed;
+        emit(atUs + (uint64_t)i * bounceUs / edges, s, ctx);
+    }
+    emit(atUs + bounceUs, closed, ctx);
+}
+
+void scriptKey(uint8_t keyIndex, uint64_t atUs, bool press,
+               uint8_t bounceEdges, uint32_t bounceUs) {
+    const uint8_t pins[2] = { ROW_PINS[keyIndex / NUM_COLS], COL_PINS[keyIndex % NUM_COLS] };
+    scriptContact(atUs, press, bounceEdges, bounceUs,
+        [](uint64_t t, bool s, const void* c) {
+            const uint8_t* p = (const uint8_t*)c;
+            sim::scheduleSwitch(t, p[0], p[1], s);
+        }, pins);
+}
+
+void scriptEncButton(uint64_t atUs, bool press, uint8_t bounceEdges, uint32_t bounceUs) {
+    scriptContact(atUs, press, bounceEdges, bounceUs,
+        [](uint64_t t, bool s, const void*) {
+            sim::scheduleLevel(t, ENC_BTN_PIN, s ? LOW : HIGH);
+        }, nullptr);
+}
+
+uint64_t scriptSpin(uint64_t atUs, int8_t dir, uint16_t detents, uint32_t edgeUs) {
+    // Gray sequence from the A=B=HIGH rest position.  CW lets A lead.
+    static const uint8_t CW[4][2]  = { {0, 1}, {0, 0}, {1, 0}, {1, 1} };
+    static const uint8_t CCW[4][2] = { {1, 0}, {0, 0}, {0, 1}, {1, 1} };
+    const uint8_t (*seq)[2] = dir > 0 ? CW : CCW;
+
+    uint8_t  a = 1, b = 1;
+    uint64_t t = atUs;
+    for (uint16_t d = 0; d < detents; d++) {
+        for (int k = 0; k < 4; k++) {
+            if (seq[k][0] != a) { a = seq[k][0]; sim::scheduleLevel(t, ENC_A_PIN, a); }
+            if (seq[k][1] != b) { b = seq[k][1]; sim::scheduleLevel(t, ENC_B_PIN, b); }
+            t += edgeUs;
+        }
+    }
+    return t;
+}
+
+} // namespace harness
@@ -0,0 +1,125 @@
+// =============================================================================
+// Harness.h — Shared plumbing for the host benchmark scenarios
+// Drives setup()/loop(), scripts switch bounce and quadrature waveforms,
+// decodes the SerialBridge frames the firmware writes, and keeps statistics.
+// =============================================================================
+#ifndef HOST_HARNESS_H
+#define HOST_HARNESS_H
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <NimBLEHIDDevice.h>
+#include <esp_sleep.h>
+#include "Sim.h"
+#include "Config.h"
+#include "EventRing.h"
+#include "KeyMatrix.h"
+#include "Encoder.h"
+#include "ScanGovernor.h"
+#include "Battery.h"
+#include "BleService.h"
+#include "SerialBridge.h"
+#include "ActionEngine.h"
+#include "Gestures.h"
+#include "Keymap.h"
+#include "Crc16.h"
+#include "Trace.h"
+
+#include <cstdint>
+#include <vector>
+
+// ── Firmware globals (MacroPadSketch.ino) ────────────────────────────────────
+extern KeyMatrix         keyMatrix;
+extern RotaryEncoder     encoder;
+extern BatteryMonitor    battery;
+extern BleService        bleService;
+extern SerialBridge      serialBridge;
+extern EventRing         inputRing;
+extern ScanGovernor      governor;
+extern GestureEngine     gestures;
+extern volatile uint16_t debounceMs;
+extern uint32_t          sleepTimeoutMs;
+
+void setup();
+void loop();
+
+namespace harness {
+
+// ── Heap tracking (global operator new is replaced in Harness.cpp) ───────────
+// Every allocation, and those the board made itself: on a firmware task or in
+// an ISR (sim::firmwareContext()), with the context of the latest.  Past boot
+// nothing on the board allocates; a scenario that moves the count fails.
+uint64_t    allocCount();
+uint64_t    firmwareAllocCount();
+const char* lastFirmwareAlloc();
+
+// ── Statistics ───────────────────────────────────────────────────────────────
+class Samples {
+public:
+    Samples() : Samples(1u << 16) {}
+    explicit Samples(size_t reserve) { _v.reserve(reserve); }
+    void   add(double v)  { _v.push_back(v); }
+    size_t count() const  { return _v.size(); }
+    double at(size_t i) const { return _v[i]; }
+    void   clear()        { _v.clear(); }
+    double mean() const;
+    double pct(double p) const;          // p in [0, 100]
+    double max() const;
+
+private:
+    std::vector<double> _v;
+};
+
+// ── Decoded device → host frame ──────────────────────────────────────────────
+struct Frame {
+    uint64_t tUs;                        // virtual time of the start byte
+    uint8_t  type;
+    uint16_t len;
+    uint8_t  data[256];
+};
+
+// Decode every valid frame in the TX capture starting at byte *cursor, and
+// advance *cursor past what was consumed.  Text log lines are skipped, and so
+// are frames whose checksum does not match the framing attachHost() agreed;
+// *skipped (if given) is increased by the bytes that were not in a frame.
+void decodeFrames(size_t* cursor, std::vector<Frame>& out, size_t* skipped = nullptr);
+
+// Build and inject a host → device frame in the agreed framing.
+void hostSendPacket(uint8_t type, const uint8_t* data, uint16_t len);
+
+// Frame bytes as hostSendPacket() would inject them (handshakes stay XOR).
+size_t buildFrame(uint8_t type, const uint8_t* data, uint16_t len, uint8_t* out);
+bool   crcFraming();
+
+// ── Board driving ────────────────────────────────────────────────────────────
+struct LoopStats {
+    Samples  hostNs;
+    Samples  cycles;
+    uint64_t loops = 0;
+};
+
+uint64_t readCycles();                   // TSC where available, else ns
+
+void bootFirmware();                     // setup(), USB handshake, BLE connect
+
+// Redo the serial handshake offering HS_FLAG_* features, and (un)subscribe
+// the BLE Event Batch characteristic.  bootFirmware() opts into batching.
+void attachHost(uint8_t serialFeatures, bool bleBatch);
+
+// A "loop" is one loop() call for a super-loop firmware, or 1 ms of board
+// time once the firmware runs its own tasks.
+void runLoops(uint64_t n, LoopStats* st);
+void runUntil(uint64_t tUs, LoopStats* st);
+
+// Waveform scripting.  bounceEdges extra transitions are spread evenly over
+// bounceUs before the contact settles.
+void scriptKey(uint8_t keyIndex, uint64_t atUs, bool press,
+               uint8_t bounceEdges, uint32_t bounceUs);
+void scriptEncButton(uint64_t atUs, bool press,
+                     uint8_t bounceEdges, uint32_t bounceUs);
+// One full quadrature cycle (four edges) per detent, edgeUs apart.
+uint64_t scriptSpin(uint64_t atUs, int8_t dir, uint16_t detents, uint32_t edgeUs);
+
+} // namespace harness
+
+#endif // HOST_HARNESS_H
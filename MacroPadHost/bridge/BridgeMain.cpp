@@ -0,0 +1,133 @@
+// =============================================================================
+// BridgeMain.cpp — macropad_bridged: the MacroPad as a Linux input device
+//
+// Opens the board's serial port, does the handshake and injects its keys and
+// encoder through uinput, mapped per a key map file (KeyMap.h).  One poll()
+// loop: up to 4 KB per read, every byte parsed where it landed.  When the port
+// goes away every held key is released and the port is reopened once a
+// second; the handshake starts over when it comes back.  --print writes the
+// strokes to stdout instead of injecting them, which needs no privileges.
+// SIGINT / SIGTERM release everything and print the session counters.
+//
+// Usage: macropad_bridged DEVICE [--map FILE] [--print]
+// =============================================================================
+#include "KeyMap.h"
+#include "SerialPort.h"
+#include "Session.h"
+#include "UinputSink.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace bridge;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static uint64_t monoUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// ── --print ──────────────────────────────────────────────────────────────────
+class PrintSink : public Sink {
+public:
+    void key(uint8_t usage, bool down) override      { printf(" key %02X %s", usage, down ? "down" : "up"); }
+    void consumer(uint16_t usage, bool down) override { printf(" consumer %03X %s", usage, down ? "down" : "up"); }
+    void wheel(int8_t detents) override               { printf(" wheel %+d", detents); }
+    void sync() override                              { printf("\n"); fflush(stdout); }
+};
+
+static void printStats(const Session& s) {
+    const SessionStats& st = s.stats();
+    const ParserStats&  p  = s.parser();
+    fprintf(stderr, "frames %u (%u stitched)  refused %u  skipped %u B  events %u  gaps %u  "
+                    "snapshots %u  corrected %u  handshakes %u\n",
+            p.frames, p.stitched, p.refused, p.skipped, st.events, st.gaps,
+            st.snapshots, st.corrected, st.handshakes);
+}
+
+int main(int argc, char** argv) {
+    const char* device = nullptr;
+    const char* mapPath = nullptr;
+    bool        print = false, ok = true;
+    for (int i = 1; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) mapPath = argv[++i];
+        else if (strcmp(argv[i], "--print") == 0)         print = true;
+        else if (argv[i][0] != '-' && !device)             device = argv[i];
+        else                                               ok = false;
+    }
+    if (!ok || !device) {
+        fprintf(stderr, "usage: %s DEVICE [--map FILE] [--print]\n", argv[0]);
+        return 2;
+    }
+
+    KeyMap map;
+    int    bad = 0;
+    if (mapPath && !map.load(mapPath, &bad)) {
+        if (bad) fprintf(stderr, "%s:%d: not a key map line\n", mapPath, bad);
+        else     fprintf(stderr, "%s: %s\n", mapPath, strerror(errno));
+        return 2;
+    }
+
+    UinputSink uinput;
+    PrintSink  printer;
+    if (!print && !uinput.open()) {
+        fprintf(stderr, "/dev/uinput: %s (try --print, or run with access to uinput)\n",
+                strerror(errno));
+        return 1;
+    }
+    Sink& sink = print ? (Sink&)printer : (Sink&)uinput;
+
+    signal(SIGINT,  [](int) { g_stop = 1; });
+    signal(SIGTERM, [](int) { g_stop = 1; });
+
+    SerialPort port;
+    Session    session(port, sink, map);
+    uint8_t    buf[4096];
+    bool       waiting = false, announced = false;
+    while (!g_stop) {
+        if (port.fd() < 0) {
+            if (!port.open(device)) {
+                if (!waiting) fprintf(stderr, "%s: %s; retrying\n", device, strerror(errno));
+                waiting = true;
+                sleep(1);
+                continue;
+            }
+            waiting   = false;
+            announced = false;
+            session.start(monoUs());
+        }
+
+        pollfd p = { port.fd(), POLLIN, 0 };
+        int    r = poll(&p, 1, 10);
+        if (r < 0 && errno != EINTR) break;
+
+        ssize_t  n   = r > 0 ? port.read(buf, sizeof(buf)) : 0;
+        uint64_t now = monoUs();
+        if (n > 0) session.feed(buf, (size_t)n, now);
+        if (n < 0 || (n == 0 && (p.revents & (POLLHUP | POLLERR)))) {
+            fprintf(stderr, "%s: gone\n", device);
+            session.releaseAll();
+            port.close();
+            continue;
+        }
+        session.tick(now);
+
+        if (session.ready() && session.device().keys && !announced) {
+            const DeviceInfo& d = session.device();
+            fprintf(stderr, "%s: firmware %u.%u.%u, %ux%u keys, features 0x%02X\n", device,
+                    d.fw[0], d.fw[1], d.fw[2], d.rows, d.cols, session.features());
+            announced = true;
+        }
+    }
+
+    session.releaseAll();
+    printStats(session);
+    return 0;
+}
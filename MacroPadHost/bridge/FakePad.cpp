@@ -0,0 +1,173 @@
+// =============================================================================
+// FakePad.cpp — macropad_fakepad: the firmware on the simulated board, behind a pty
+//
+// A stand-in for the real board when trying the bridge (or the app) on a
+// desk without one.  The unmodified firmware runs on the simulated board
+// (hal/), its tasks kept in step with the wall clock; the pty carries the
+// serial bytes both ways, so to the other end it is the board's CDC port.
+// The slave path is printed on start:
+//
+//   terminal 1:  ./macropad_fakepad             → /dev/pts/7, then commands
+//   terminal 2:  ./macropad_bridged /dev/pts/7 --print
+//
+// Keys and the encoder are played from stdin, one command per line:
+//   tap K | press K | release K     key index K, row-major
+//   spin N                          N detents, negative = counter-clockwise
+//   button                          click the encoder button
+//   quit
+// --demo plays a loop of all of them on its own.  The pad runs until killed
+// or told to quit; the end of stdin just ends the commands.
+//
+// Usage: macropad_fakepad [--demo]
+// =============================================================================
+#include <Arduino.h>
+#include "Sim.h"
+#include "Config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+void setup();
+
+static const uint32_t TAP_US  = 60000;
+static const uint32_t EDGE_US = 2000;    // quadrature edge spacing for `spin`
+static const uint32_t GAP_US  = 30000;   // between queued commands
+
+// ── Playing the board ────────────────────────────────────────────────────────
+static void key(uint16_t k, uint64_t atUs, bool closed) {
+    if (k >= NUM_KEYS) return;
+    sim::scheduleSwitch(atUs, ROW_PINS[k / NUM_COLS], COL_PINS[k % NUM_COLS], closed);
+}
+
+static uint64_t spin(int n, uint64_t atUs) {
+    // Gray sequence from the A=B=HIGH rest position; CW lets A lead
+    static const uint8_t CW[4][2]  = { {0, 1}, {0, 0}, {1, 0}, {1, 1} };
+    static const uint8_t CCW[4][2] = { {1, 0}, {0, 0}, {0, 1}, {1, 1} };
+    const uint8_t (*seq)[2] = n > 0 ? CW : CCW;
+    for (int d = 0; d < abs(n); d++)
+        for (int k = 0; k < 4; k++, atUs += EDGE_US) {
+            sim::scheduleLevel(atUs, ENC_A_PIN, seq[k][0]);
+            sim::scheduleLevel(atUs, ENC_B_PIN, seq[k][1]);
+        }
+    return atUs;
+}
+
+static void button(uint64_t atUs) {
+    sim::scheduleLevel(atUs, ENC_BTN_PIN, LOW);
+    sim::scheduleLevel(atUs + TAP_US, ENC_BTN_PIN, HIGH);
+}
+
+// Commands play one after another, however fast they arrive
+static bool command(const char* line) {
+    static uint64_t freeUs = 0;
+    char what[16];
+    int  n = 0;
+    if (sscanf(line, " %15s %d", what, &n) < 1) return true;
+    uint64_t at = sim::nowUs() + 1000, end = at;
+    if (at < freeUs) at = end = freeUs;
+    if      (strcmp(what, "tap") == 0)     { key(n, at, true); key(n, end = at + TAP_US, false); }
+    else if (strcmp(what, "press") == 0)   key(n, at, true);
+    else if (strcmp(what, "release") == 0) key(n, at, false);
+    else if (strcmp(what, "spin") == 0)    end = spin(n, at);
+    else if (strcmp(what, "button") == 0)  { button(at); end = at + TAP_US; }
+    else if (strcmp(what, "quit") == 0)    return false;
+    else fprintf(stderr, "? tap|press|release K, spin N, button, quit\n");
+    freeUs = end + GAP_US;
+    return true;
+}
+
+// One round of everything, every two seconds
+static void demo(uint64_t nowUs, uint64_t& nextUs, uint16_t& k) {
+    if (nowUs < nextUs) return;
+    key(k, nowUs, true);
+    key(k, nowUs + TAP_US, false);
+    spin(k % 2 ? -3 : 3, nowUs + 500000);
+    button(nowUs + 1000000);
+    k      = (uint16_t)((k + 1) % NUM_KEYS);
+    nextUs = nowUs + 2000000;
+}
+
+// ── pty ──────────────────────────────────────────────────────────────────────
+static int openPty(int& slave) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+    // Holding the slave open keeps the master readable between clients, and
+    // raw mode keeps the line discipline's hands off the frames
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    termios t;
+    if (slave < 0 || tcgetattr(slave, &t) != 0) return -1;
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    return master;
+}
+
+int main(int argc, char** argv) {
+    bool demoMode = argc > 1 && strcmp(argv[1], "--demo") == 0;
+    if (argc > 2 || (argc == 2 && !demoMode)) {
+        fprintf(stderr, "usage: %s [--demo]\n", argv[0]);
+        return 2;
+    }
+    int slave  = -1;
+    int master = openPty(slave);
+    if (master < 0) {
+        perror("pty");
+        return 1;
+    }
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+
+    sim::reset();
+    setup();
+
+    auto     wall0    = std::chrono::steady_clock::now();
+    uint64_t sim0     = sim::nowUs();
+    uint64_t nextUs   = 0;
+    uint16_t demoKey  = 0;
+    bool     commands = !demoMode;
+    char     line[128];
+    size_t   lineLen  = 0;
+    uint8_t  buf[4096];
+
+    for (bool run = true; run;) {
+        pollfd p[2] = { { master, POLLIN, 0 }, { commands ? 0 : -1, POLLIN, 0 } };
+        poll(p, 2, 1);
+
+        ssize_t n;
+        while ((n = read(master, buf, sizeof(buf))) > 0) sim::hostWrite(buf, (size_t)n);
+
+        if (p[1].revents & (POLLIN | POLLHUP)) {
+            char c;
+            if (read(0, &c, 1) != 1) commands = false;                  // end of stdin
+            else if (c != '\n' && lineLen < sizeof(line) - 1) line[lineLen++] = c;
+            else {
+                line[lineLen] = 0;
+                lineLen       = 0;
+                run           = command(line);
+            }
+        }
+
+        // Catch the board up with the wall clock, a millisecond at a time
+        uint64_t wallUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now() - wall0).count();
+        while (sim::nowUs() - sim0 + 1000 <= wallUs) sim::advanceUs(1000);
+        if (demoMode) demo(sim::nowUs(), nextUs, demoKey);
+
+        size_t count = sim::txCount();
+        for (size_t i = 0; i < count;) {
+            size_t m = 0;
+            while (i < count && m < sizeof(buf)) buf[m++] = sim::txAt(i++).b;
+            if (write(master, buf, m) < 0) break;             // nobody reading: drop
+        }
+        sim::txClear();
+    }
+    close(slave);
+    close(master);
+    return 0;
+}
@@ -0,0 +1,162 @@
+// =============================================================================
+// FrameParser.cpp — Device → host frames out of a byte stream, without copying
+// =============================================================================
+#include "FrameParser.h"
+
+#include <cstring>
+
+namespace bridge {
+
+// ── CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) ────────────────────────────
+struct CrcTable {
+    uint16_t v[256];
+    constexpr CrcTable() : v() {
+        for (int i = 0; i < 256; i++) {
+            uint16_t c = (uint16_t)(i << 8);
+            for (int b = 0; b < 8; b++) c = (uint16_t)(c & 0x8000 ? (c << 1) ^ 0x1021 : c << 1);
+            v[i] = c;
+        }
+    }
+};
+static constexpr CrcTable CRC_TABLE;
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+        crc = (uint16_t)((crc << 8) ^ CRC_TABLE.v[(uint8_t)((crc >> 8) ^ data[i])]);
+    return crc;
+}
+
+size_t buildFrame(uint8_t type, const uint8_t* data, uint16_t len, bool crc, uint8_t* out) {
+    out[0] = PKT_START;
+    out[1] = type;
+    out[2] = (uint8_t)(len >> 8);
+    out[3] = (uint8_t)len;
+    if (len) memcpy(out + 4, data, len);
+    if (crc && type != PKT_HANDSHAKE) {
+        uint16_t c = crc16(out + 1, 3 + (size_t)len);
+        out[4 + len] = (uint8_t)(c >> 8);
+        out[5 + len] = (uint8_t)c;
+        return 6 + (size_t)len;
+    }
+    uint8_t x = 0;
+    for (size_t i = 1; i < 4 + (size_t)len; i++) x ^= out[i];
+    out[4 + len] = x;
+    return 5 + (size_t)len;
+}
+
+// ── Parser ───────────────────────────────────────────────────────────────────
+void FrameParser::reset() {
+    _pos = _end = nullptr;
+    _tailLen = _fromSpan = 0;
+    _crc = false;
+}
+
+void FrameParser::feed(const uint8_t* data, size_t n) {
+    _pos      = data;
+    _end      = data + n;
+    _fromSpan = 0;                       // whatever the tail holds is history now
+}
+
+uint8_t FrameParser::checkBytes(uint8_t type) const {
+    return _crc && type != PKT_HANDSHAKE_ACK ? 2 : 1;
+}
+
+uint16_t FrameParser::frameBytes(const uint8_t* p, size_t avail) const {
+    if (avail < 4) return 4;
+    uint16_t len = (uint16_t)(p[2] << 8 | p[3]);
+    if (p[1] == 0 || p[1] > PKT_TYPE_MAX || len > FRAME_PAYLOAD_MAX) return 0;
+    return (uint16_t)(4 + len + checkBytes(p[1]));
+}
+
+bool FrameParser::valid(const uint8_t* p, uint16_t n) const {
+    uint16_t end = (uint16_t)(n - checkBytes(p[1]));
+    if (n - end == 2) return crc16(p + 1, end - 1) == (uint16_t)(p[end] << 8 | p[end + 1]);
+    uint8_t x = 0;
+    for (uint16_t i = 1; i < end; i++) x ^= p[i];
+    return x == p[end];
+}
+
+// The frame begun in an earlier read.  Bytes are taken from the span only as
+// far as that frame reaches; if it turns out not to be one, they are handed
+// back and the search restarts inside what was left over from before.
+FrameParser::Stitch FrameParser::stitch(FrameView& out) {
+    uint16_t need;
+    while ((need = frameBytes(_tail, _tailLen)) != 0 && _tailLen < need) {
+        if (_pos == _end) return WAITING;                // finish it on the next read
+        size_t take = (size_t)(_end - _pos);
+        if (take > (size_t)(need - _tailLen)) take = need - _tailLen;
+        memcpy(_tail + _tailLen, _pos, take);
+        _tailLen  += (uint16_t)take;
+        _fromSpan += (uint16_t)take;
+        _pos      += take;
+    }
+    if (need && valid(_tail, need)) {
+        out = { _tail[1], _tail + 4, (uint16_t)(need - 4 - checkBytes(_tail[1])) };
+        _tailLen = _fromSpan = 0;
+        _stats.frames++;
+        _stats.stitched++;
+        return FRAME;
+    }
+    refuseTail();
+    return REFUSED;
+}
+
+void FrameParser::refuseTail() {
+    _stats.refused++;
+    uint16_t old = (uint16_t)(_tailLen - _fromSpan);
+    _pos -= _fromSpan;
+    _fromSpan = 0;
+    const uint8_t* s = old > 1 ? (const uint8_t*)memchr(_tail + 1, PKT_START, old - 1u) : nullptr;
+    uint16_t from = s ? (uint16_t)(s - _tail) : old;
+    _stats.skipped += from;
+    _tailLen = (uint16_t)(old - from);
+    if (_tailLen) memmove(_tail, _tail + from, _tailLen);
+}
+
+void FrameParser::expire() {
+    if (!_tailLen) return;
+    _fromSpan = 0;                       // the span is used up: every tail byte is old
+    refuseTail();
+}
+
+bool FrameParser::next(FrameView& out) {
+    while (_tailLen) {
+        Stitch s = stitch(out);
+        if (s == FRAME)   return true;
+        if (s == WAITING) return false;
+    }
+
+    while (_pos < _end) {
+        const uint8_t* s = (const uint8_t*)memchr(_pos, PKT_START, (size_t)(_end - _pos));
+        if (!s) {
+            _stats.skipped += (uint32_t)(_end - _pos);
+            _pos = _end;
+            return false;
+        }
+        _stats.skipped += (uint32_t)(s - _pos);
+        _pos = s;
+
+        size_t   avail = (size_t)(_end - _pos);
+        uint16_t need  = frameBytes(_pos, avail);
+        if (need && avail < need) {
+            memcpy(_tail, _pos, avail);                  // finish it on the next read
+            _tailLen = (uint16_t)avail;
+            _pos     = _end;
+            return false;
+        }
+        if (!need || !valid(_pos, need)) {
+            _stats.refused++;
+            _stats.skipped++;
+            _pos++;
+            continue;
+        }
+        out = { _pos[1], _pos + 4, (uint16_t)(need - 4 - checkBytes(_pos[1])) };
+        _pos += need;
+        _stats.frames++;
+        return true;
+    }
+    return false;
+}
+
+} // namespace bridge
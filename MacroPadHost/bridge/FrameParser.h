@@ -0,0 +1,80 @@
+// =============================================================================
+// FrameParser.h — Device → host frames out of a byte stream, without copying
+// feed() hands over one read's worth of bytes; next() then yields the frames
+// in it.  A frame that lies wholly inside the span is returned in place — the
+// view points into the caller's buffer — so the usual case copies nothing.
+// Only a frame split across two reads is put together in a fixed tail buffer.
+// A start byte whose header is impossible, or whose check bytes do not match,
+// is dropped alone and the search resumes one byte on: text log lines and
+// line noise cost a scan, never a frame behind them.
+//
+// Check bytes follow the handshake: XOR until setCrc(true), then CRC-16 on
+// everything but PKT_HANDSHAKE_ACK, exactly as SerialBridge sends them.
+// =============================================================================
+#ifndef BRIDGE_FRAME_PARSER_H
+#define BRIDGE_FRAME_PARSER_H
+
+#include "Protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bridge {
+
+struct FrameView {
+    uint8_t        type;
+    const uint8_t* data;                 // valid until the next feed() / next()
+    uint16_t       len;
+};
+
+struct ParserStats {
+    uint32_t frames   = 0;
+    uint32_t refused  = 0;               // start bytes that did not begin a frame
+    uint32_t skipped  = 0;               // bytes outside any frame
+    uint32_t stitched = 0;               // frames put together across reads
+};
+
+class FrameParser {
+public:
+    void setCrc(bool on) { _crc = on; }
+    bool crc() const     { return _crc; }
+
+    // A new span; the previous one must have been read to the end
+    void feed(const uint8_t* data, size_t n);
+    // The next whole frame, or false once the span is used up
+    bool next(FrameView& out);
+    // Give up on a partial frame that has waited too long: its start byte is
+    // dropped and next() searches what came after it.  Between reads only.
+    void expire();
+    bool partial() const { return _tailLen != 0; }
+
+    void               reset();          // drop a partial frame, back to XOR
+    const ParserStats& stats() const { return _stats; }
+
+private:
+    uint8_t  checkBytes(uint8_t type) const;
+    uint16_t frameBytes(const uint8_t* p, size_t avail) const;   // 4 = need header, 0 = refuse
+    bool     valid(const uint8_t* p, uint16_t n) const;
+    enum Stitch : uint8_t { FRAME, WAITING, REFUSED };
+    Stitch   stitch(FrameView& out);
+    void     refuseTail();
+
+    const uint8_t* _pos      = nullptr;
+    const uint8_t* _end      = nullptr;
+    uint16_t       _tailLen  = 0;
+    uint16_t       _fromSpan = 0;        // tail bytes taken from the current span
+    bool           _crc      = false;
+    ParserStats    _stats;
+    uint8_t        _tail[FRAME_MAX];
+};
+
+// CRC-16/CCITT-FALSE, as Crc16.h on the device
+uint16_t crc16(const uint8_t* data, size_t len);
+
+// A host → device frame in `out` (FRAME_MAX bytes); returns its length.
+// Handshakes are always XOR-framed.
+size_t buildFrame(uint8_t type, const uint8_t* data, uint16_t len, bool crc, uint8_t* out);
+
+} // namespace bridge
+
+#endif
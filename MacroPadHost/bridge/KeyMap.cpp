@@ -0,0 +1,134 @@
+// =============================================================================
+// KeyMap.cpp — What the bridge does for each key, the encoder and its button
+// =============================================================================
+#include "KeyMap.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace bridge {
+
+void KeyMap::clear() {
+    for (uint8_t l = 0; l < LAYERS; l++)
+        for (uint16_t k = 0; k < KEYS; k++) _keys[l][k] = { (uint8_t)(l ? MAP_TRANSPARENT : MAP_NONE), 0, 0 };
+    _encoder = EncoderMap();
+}
+
+void KeyMap::set(uint8_t layer, uint8_t key, const Action& a) {
+    if (layer < LAYERS) _keys[layer][key] = a;
+}
+
+const Action& KeyMap::at(uint8_t layer, uint8_t key) const {
+    uint8_t l = layer < LAYERS ? layer : 0;
+    while (l && _keys[l][key].type == MAP_TRANSPARENT) l--;
+    return _keys[l][key];
+}
+
+// ── Text form ────────────────────────────────────────────────────────────────
+struct Name {
+    const char* s;
+    uint8_t     v;
+};
+
+static const Name ACTIONS[] = {
+    { "none",     MAP_NONE },
+    { "single",   MAP_SINGLE_KEY },
+    { "media",    MAP_MEDIA_KEY },
+    { "combo",    MAP_MODIFIER_COMBO },
+    { "shortcut", MAP_SHORTCUT },
+};
+
+static const Name MODES[] = {
+    { "none",       ENC_MODE_NONE },
+    { "volume",     ENC_MODE_VOLUME },
+    { "scroll",     ENC_MODE_SCROLL },
+    { "zoom",       ENC_MODE_ZOOM },
+    { "brightness", ENC_MODE_BRIGHTNESS },
+    { "custom",     ENC_MODE_CUSTOM },
+};
+
+template <size_t N>
+static bool lookup(const Name (&names)[N], const char* s, uint8_t& v) {
+    for (const Name& n : names)
+        if (strcmp(n.s, s) == 0) { v = n.v; return true; }
+    return false;
+}
+
+// Up to `max` numbers after the words already read; the count, or −1 when
+// something else follows
+static int numbers(const char* p, long* out, int max) {
+    int n = 0;
+    for (;;) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p || *p == '#' || *p == '\n' || *p == '\r') return n;
+        char* e;
+        long  v = strtol(p, &e, 0);
+        if (e == p || n == max || v < 0 || v > 255) return -1;
+        out[n++] = v;
+        p = e;
+    }
+}
+
+bool KeyMap::parseLine(const char* line) {
+    char what[16] = "", kind[16] = "";
+    int  used     = 0;
+    if (sscanf(line, " %15s%n", what, &used) != 1 || what[0] == '#') return true;   // blank
+
+    long v[5];
+    if (strcmp(what, "key") == 0) {
+        int   at = 0;
+        char* e;
+        long  key = strtol(line + used, &e, 0);
+        if (e == line + used || key < 0 || key >= KEYS) return false;
+        used = (int)(e - line);
+        if (sscanf(line + used, " %15s%n", kind, &at) != 1) return false;
+        Action a;
+        int    n = numbers(line + used + at, v, 3);
+        if (!lookup(ACTIONS, kind, a.type) || n < 1) return false;
+        a.code = (uint8_t)v[0];
+        a.mods = n > 1 ? (uint8_t)v[1] : 0;
+        if (n > 2 && v[2] >= LAYERS) return false;
+        set(n > 2 ? (uint8_t)v[2] : 0, (uint8_t)key, a);
+        return true;
+    }
+    int at = 0;
+    if (sscanf(line + used, " %15s%n", kind, &at) != 1) return false;
+    int n = numbers(line + used + at, v, 4);
+    if (strcmp(what, "encoder") == 0) {
+        if (!lookup(MODES, kind, _encoder.mode)) return false;
+        if (_encoder.mode != ENC_MODE_CUSTOM) return n == 0;
+        if (n != 4) return false;
+        _encoder.cw  = { MAP_SHORTCUT, (uint8_t)v[0], (uint8_t)v[1] };
+        _encoder.ccw = { MAP_SHORTCUT, (uint8_t)v[2], (uint8_t)v[3] };
+        return true;
+    }
+    if (strcmp(what, "button") == 0) {
+        Action a;
+        if (!lookup(ACTIONS, kind, a.type) || n < 1 || n > 2) return false;
+        a.code = (uint8_t)v[0];
+        a.mods = n > 1 ? (uint8_t)v[1] : 0;
+        _encoder.button = a;
+        return true;
+    }
+    return false;
+}
+
+bool KeyMap::load(const char* path, int* badLine) {
+    if (badLine) *badLine = 0;
+    clear();
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    for (int n = 1; fgets(line, sizeof(line), f); n++) {
+        if (parseLine(line)) continue;
+        if (badLine) *badLine = n;
+        fclose(f);
+        clear();
+        return false;
+    }
+    fclose(f);
+    return true;
+}
+
+} // namespace bridge
@@ -0,0 +1,64 @@
+// =============================================================================
+// KeyMap.h — What the bridge does for each key, the encoder and its button
+// The host-side half of a mapping, as the desktop app keeps it: per layer and
+// key an action type (MAP_*), a HID keyboard usage and a modifier mask, plus
+// an encoder mode.  Layers above 0 fall through to layer 0 where unset.
+//
+// Text form, one entry per line, '#' starts a comment, numbers in C syntax:
+//   key <index> <none|single|media|combo|shortcut> <code> [mods] [layer]
+//   encoder <none|volume|scroll|zoom|brightness>
+//   encoder custom <cw code> <cw mods> <ccw code> <ccw mods>
+//   button <none|single|media|combo|shortcut> <code> [mods]
+// Media codes are the app's (0xE8 volume down, 0xE9 up, 0xEA mute, or a raw
+// consumer usage); mods is the HID modifier byte (bit 0 left Ctrl … bit 7
+// right GUI).
+// =============================================================================
+#ifndef BRIDGE_KEY_MAP_H
+#define BRIDGE_KEY_MAP_H
+
+#include "Protocol.h"
+
+#include <cstdint>
+
+namespace bridge {
+
+struct Action {
+    uint8_t type = MAP_NONE;
+    uint8_t code = 0;
+    uint8_t mods = 0;
+};
+
+struct EncoderMap {
+    uint8_t mode = ENC_MODE_VOLUME;
+    Action  cw;                          // ENC_MODE_CUSTOM only
+    Action  ccw;
+    Action  button;
+};
+
+class KeyMap {
+public:
+    static const uint8_t  LAYERS = 8;
+    static const uint16_t KEYS   = 256;
+
+    KeyMap() { clear(); }
+
+    void clear();
+    void set(uint8_t layer, uint8_t key, const Action& a);
+    const Action& at(uint8_t layer, uint8_t key) const;
+
+    EncoderMap&       encoder()       { return _encoder; }
+    const EncoderMap& encoder() const { return _encoder; }
+
+    // Replace the map with a file's; false (map cleared) on a bad line, whose
+    // number goes to *badLine (0 when the file could not be read)
+    bool load(const char* path, int* badLine = nullptr);
+    bool parseLine(const char* line);    // one line of the text form
+
+private:
+    Action     _keys[LAYERS][KEYS];
+    EncoderMap _encoder;
+};
+
+} // namespace bridge
+
+#endif
@@ -0,0 +1,71 @@
+// =============================================================================
+// Protocol.h — The MacroPad serial protocol, as the host bridge sees it
+// The bridge builds without the firmware tree, so the values it needs are
+// repeated here, spelled exactly as in SerialBridge.h and Config.h.  The
+// bench includes both: an identical macro may be defined twice, and one that
+// has drifted is a redefinition warning there.
+// =============================================================================
+#ifndef BRIDGE_PROTOCOL_H
+#define BRIDGE_PROTOCOL_H
+
+#include <cstdint>
+
+// ── Framing: [0xAA] [type] [len hi] [len lo] [data…] [XOR | CRC-16 BE] ─────
+#define PKT_START           0xAA
+#define PKT_KEY_EVENT       0x01
+#define PKT_ENCODER_EVENT   0x02
+#define PKT_BATTERY         0x04
+#define PKT_DEVICE_INFO     0x05
+#define PKT_COMMAND         0x06
+#define PKT_HANDSHAKE       0x07
+#define PKT_HANDSHAKE_ACK   0x08
+#define PKT_EVENT_BATCH     0x09
+#define PKT_SNAPSHOT        0x0A
+#define PKT_CAPTURE         0x10
+
+#define HANDSHAKE_MAGIC_0   0x4D
+#define HANDSHAKE_MAGIC_1   0x50
+#define HANDSHAKE_MAGIC_2   0x44
+#define HS_FLAG_BATCH       0x01
+#define HS_FLAG_CRC16       0x02
+
+// ── Commands and events ──────────────────────────────────────────────────────
+#define CMD_GET_SNAPSHOT          0x0B
+#define EVT_KEY_PRESS             0x01
+#define EVT_KEY_RELEASE           0x02
+#define EVT_ENCODER_ROTATE        0x10
+#define EVT_ENCODER_BTN_PRESS     0x11
+#define EVT_ENCODER_BTN_RELEASE   0x12
+#define DIR_CW                    0x01
+
+// ── Key actions the bridge performs (the app's mapping types) ────────────────
+#define MAP_NONE                  0x00
+#define MAP_SINGLE_KEY            0x01
+#define MAP_MEDIA_KEY             0x02
+#define MAP_MODIFIER_COMBO        0x03
+#define MAP_SHORTCUT              0x05
+#define MAP_TRANSPARENT           0x0A
+
+#define ENC_MODE_NONE             0x00
+#define ENC_MODE_VOLUME           0x01
+#define ENC_MODE_SCROLL           0x02
+#define ENC_MODE_ZOOM             0x03
+#define ENC_MODE_BRIGHTNESS       0x04
+#define ENC_MODE_CUSTOM           0x05
+
+namespace bridge {
+
+static const uint8_t  PKT_TYPE_MAX       = PKT_CAPTURE;   // highest type a device sends
+static const uint16_t FRAME_PAYLOAD_MAX  = 1024;          // longer is taken for noise
+static const uint16_t FRAME_MAX          = 4 + FRAME_PAYLOAD_MAX + 2;
+
+// PKT_EVENT_BATCH: [count] [seq0] [t0 µs u32 BE]
+//   then count × [dt µs u16 BE] [type] [a] [b] [speed u16 BE]
+static const uint8_t  BATCH_HEADER_BYTES = 6;
+static const uint8_t  BATCH_RECORD_BYTES = 7;
+// PKT_DEVICE_INFO: [fw major] [minor] [patch] [rows] [cols] [encoder] [battery] [keys]
+static const uint8_t  DEVICE_INFO_BYTES  = 8;
+
+} // namespace bridge
+
+#endif
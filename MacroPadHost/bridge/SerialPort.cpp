@@ -0,0 +1,79 @@
+// =============================================================================
+// SerialPort.cpp — A tty (the board's USB CDC port, or a pty) as the session's Link
+// =============================================================================
+#include "SerialPort.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace bridge {
+
+static speed_t speed(uint32_t baud) {
+    switch (baud) {
+    case 9600:   return B9600;
+    case 57600:  return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return B115200;
+    }
+}
+
+bool SerialPort::open(const char* path, uint32_t baud) {
+    close();
+    _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (_fd < 0) return false;
+
+    termios t;
+    if (tcgetattr(_fd, &t) != 0) {
+        close();
+        return false;
+    }
+    cfmakeraw(&t);
+    cfsetispeed(&t, speed(baud));
+    cfsetospeed(&t, speed(baud));
+    t.c_cflag    |= CLOCAL | CREAD;
+    t.c_cc[VMIN]  = 0;
+    t.c_cc[VTIME] = 0;
+    if (tcsetattr(_fd, TCSANOW, &t) != 0) {
+        close();
+        return false;
+    }
+    tcflush(_fd, TCIOFLUSH);
+    return true;
+}
+
+void SerialPort::close() {
+    if (_fd < 0) return;
+    ::close(_fd);
+    _fd = -1;
+}
+
+ssize_t SerialPort::read(uint8_t* buf, size_t n) {
+    ssize_t r = ::read(_fd, buf, n);
+    if (r > 0) return r;
+    if (r < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+    return -1;                           // EOF: the other end hung up
+}
+
+// Frames are small; a full driver buffer is waited out, briefly
+bool SerialPort::write(const uint8_t* data, size_t n) {
+    while (n) {
+        ssize_t w = ::write(_fd, data, n);
+        if (w > 0) {
+            data += w;
+            n    -= (size_t)w;
+            continue;
+        }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && errno != EAGAIN) return false;
+        pollfd p = { _fd, POLLOUT, 0 };
+        if (poll(&p, 1, 100) <= 0) return false;
+    }
+    return true;
+}
+
+} // namespace bridge
@@ -0,0 +1,33 @@
+// =============================================================================
+// SerialPort.h — A tty (the board's USB CDC port, or a pty) as the session's Link
+// Raw mode, non-blocking.  USB CDC ignores the baud rate; it is set anyway
+// for a real UART adapter.
+// =============================================================================
+#ifndef BRIDGE_SERIAL_PORT_H
+#define BRIDGE_SERIAL_PORT_H
+
+#include "Session.h"
+
+#include <sys/types.h>
+
+namespace bridge {
+
+class SerialPort : public Link {
+public:
+    ~SerialPort() override { close(); }
+
+    bool open(const char* path, uint32_t baud = 115200);   // false: errno says why
+    void close();
+    int  fd() const { return _fd; }
+
+    // Bytes read, 0 when none are waiting, −1 when the port is gone
+    ssize_t read(uint8_t* buf, size_t n);
+    bool    write(const uint8_t* data, size_t n) override;
+
+private:
+    int _fd = -1;
+};
+
+} // namespace bridge
+
+#endif
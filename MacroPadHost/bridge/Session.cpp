@@ -0,0 +1,279 @@
+// =============================================================================
+// Session.cpp — One MacroPad on one serial link, driven from the host
+// =============================================================================
+#include "Session.h"
+
+namespace bridge {
+
+static const uint8_t  USAGE_LEFT_CTRL   = 0xE0;
+static const uint16_t USAGE_VOLUME_UP   = 0x00E9;
+static const uint16_t USAGE_VOLUME_DOWN = 0x00EA;
+static const uint16_t USAGE_MUTE        = 0x00E2;
+static const uint16_t USAGE_BRIGHT_UP   = 0x006F;
+static const uint16_t USAGE_BRIGHT_DOWN = 0x0070;
+
+// The app's media key codes, as HidReports.h reads them on the device
+static uint16_t consumerUsage(uint8_t code) {
+    switch (code) {
+    case 0xE8: return USAGE_VOLUME_DOWN;
+    case 0xE9: return USAGE_VOLUME_UP;
+    case 0xEA: return USAGE_MUTE;
+    default:   return code;
+    }
+}
+
+Session::Session(Link& link, Sink& sink, const KeyMap& map, uint8_t features)
+    : _link(link), _sink(sink), _map(map), _offer(features) {}
+
+void Session::start(uint64_t nowUs) {
+    const uint8_t hello[] = { HANDSHAKE_MAGIC_0, HANDSHAKE_MAGIC_1, HANDSHAKE_MAGIC_2, _offer };
+    _nowUs    = nowUs;
+    _helloUs  = nowUs;
+    _ready    = false;
+    _features = 0;
+    _parser.reset();
+    send(PKT_HANDSHAKE, hello, sizeof(hello));
+    _stats.handshakes++;
+}
+
+void Session::feed(const uint8_t* data, size_t n, uint64_t nowUs) {
+    _nowUs = nowUs;
+    _parser.feed(data, n);
+    drain();
+    _partialUs = _parser.partial() ? nowUs : 0;
+}
+
+void Session::tick(uint64_t nowUs) {
+    _nowUs = nowUs;
+    if (!_ready && nowUs - _helloUs >= HANDSHAKE_RETRY_US) start(nowUs);
+    if (_snapWanted && nowUs - _snapAskedUs >= SNAPSHOT_RETRY_US) requestSnapshot();
+
+    // A start byte whose length runs past the end of the stream.  While bytes
+    // keep coming it completes or fails by itself; once the device goes
+    // quiet, the frames it swallowed still have to come out.
+    if (_partialUs && nowUs - _partialUs >= PARTIAL_EXPIRE_US) {
+        _stats.expired++;
+        _parser.expire();
+        drain();
+        _partialUs = _parser.partial() ? nowUs : 0;
+    }
+}
+
+void Session::drain() {
+    FrameView f;
+    while (_parser.next(f)) handle(f);
+}
+
+void Session::send(uint8_t type, const uint8_t* data, uint16_t len) {
+    _link.write(_tx, buildFrame(type, data, len, _features & HS_FLAG_CRC16, _tx));
+}
+
+void Session::releaseAll() {
+    for (uint16_t k = 0; k < KeyMap::KEYS; k++)
+        if (_down[k]) release((uint8_t)k);
+    button(false);
+    _sink.sync();
+    _ready   = false;
+    _haveSeq = false;
+}
+
+// ── Frames ───────────────────────────────────────────────────────────────────
+void Session::handle(const FrameView& f) {
+    const uint8_t* d = f.data;
+
+    if (f.type == PKT_HANDSHAKE_ACK) {
+        if (f.len < 3 || d[0] != HANDSHAKE_MAGIC_0 || d[1] != HANDSHAKE_MAGIC_1 ||
+            d[2] != HANDSHAKE_MAGIC_2)
+            return;
+        // The next frame is already in the agreed framing
+        _features = f.len >= 4 ? (uint8_t)(d[3] & _offer) : 0;
+        _parser.setCrc(_features & HS_FLAG_CRC16);
+        _ready      = true;
+        _haveSeq    = false;
+        _snapWanted = false;
+        return;
+    }
+    if (!_ready) return;
+
+    switch (f.type) {
+    case PKT_DEVICE_INFO:
+        if (f.len >= DEVICE_INFO_BYTES)
+            _device = { { d[0], d[1], d[2] }, d[3], d[4], d[5], d[6], d[7] };
+        break;
+    case PKT_BATTERY:
+        if (f.len >= 1) _battery = d[0];
+        break;
+    case PKT_KEY_EVENT:
+    case PKT_ENCODER_EVENT:
+        if (f.len >= 4) event(d[0], d[1], d[2], d[3]);
+        break;
+    case PKT_EVENT_BATCH: {
+        if (f.len < BATCH_HEADER_BYTES) break;
+        uint8_t count = d[0];
+        if (f.len < BATCH_HEADER_BYTES + (size_t)count * BATCH_RECORD_BYTES) break;
+        const uint8_t* r = d + BATCH_HEADER_BYTES;
+        for (uint8_t i = 0; i < count; i++, r += BATCH_RECORD_BYTES)
+            event(r[2], r[3], r[4], (uint8_t)(d[1] + i));
+        break;
+    }
+    case PKT_SNAPSHOT:
+        snapshot(d, f.len);
+        break;
+    }
+}
+
+void Session::event(uint8_t type, uint8_t a, uint8_t b, uint8_t seq) {
+    if (_haveSeq && seq != (uint8_t)(_lastSeq + 1)) {
+        _stats.gaps++;
+        requestSnapshot();
+    }
+    _haveSeq = true;
+    _lastSeq = seq;
+    _stats.events++;
+
+    switch (type) {
+    case EVT_KEY_PRESS:           press(a, b);                      break;
+    case EVT_KEY_RELEASE:         release(a);                       break;
+    case EVT_ENCODER_ROTATE:      rotate(a == DIR_CW, b ? b : 1);   break;
+    case EVT_ENCODER_BTN_PRESS:   button(true);                     break;
+    case EVT_ENCODER_BTN_RELEASE: button(false);                    break;
+    default:                      return;
+    }
+    _sink.sync();
+}
+
+// ── Snapshots ────────────────────────────────────────────────────────────────
+void Session::requestSnapshot() {
+    const uint8_t cmd = CMD_GET_SNAPSHOT;
+    send(PKT_COMMAND, &cmd, 1);
+    _snapWanted  = true;
+    _snapAskedUs = _nowUs;
+}
+
+// [seq] [encoder button] [keys] [mask, LSB first].  A snapshot older than the
+// last event seen is out of date before it arrives; one that is newer covers
+// events this side never got.
+void Session::snapshot(const uint8_t* d, uint16_t len) {
+    if (len < 3) return;
+    if (_haveSeq && (int8_t)(d[0] - _lastSeq) < 0) return;
+
+    uint16_t keys = d[2];
+    if (keys > (uint16_t)(len - 3) * 8) keys = (uint16_t)((len - 3) * 8);
+    uint32_t before = _stats.corrected;
+    for (uint16_t k = 0; k < keys; k++) {
+        bool held = (d[3 + k / 8] >> (k % 8)) & 1;
+        if (held == _down[k]) continue;
+        if (held) press((uint8_t)k, _layer);
+        else      release((uint8_t)k);
+        _stats.corrected++;
+    }
+    if ((d[1] != 0) != _btnDown) {
+        button(d[1] != 0);
+        _stats.corrected++;
+    }
+    if (_stats.corrected != before) _sink.sync();
+
+    _haveSeq    = true;
+    _lastSeq    = d[0];
+    _snapWanted = false;
+    _stats.snapshots++;
+}
+
+// ── Actions ──────────────────────────────────────────────────────────────────
+void Session::press(uint8_t key, uint8_t layer) {
+    if (_down[key]) return;
+    _down[key] = true;
+    _held[key] = _map.at(layer, key);
+    _layer     = layer;
+    down(_held[key]);
+}
+
+void Session::release(uint8_t key) {
+    if (!_down[key]) return;
+    _down[key] = false;
+    up(_held[key]);
+}
+
+void Session::button(bool pressed) {
+    if (pressed == _btnDown) return;
+    _btnDown = pressed;
+    if (pressed) {
+        _btnHeld = _map.encoder().button;
+        down(_btnHeld);
+    } else {
+        up(_btnHeld);
+    }
+}
+
+void Session::rotate(bool cw, uint8_t steps) {
+    const EncoderMap& e = _map.encoder();
+    int8_t detents = (int8_t)(steps > 127 ? 127 : steps);
+    switch (e.mode) {
+    case ENC_MODE_VOLUME:
+    case ENC_MODE_BRIGHTNESS: {
+        uint16_t u = e.mode == ENC_MODE_VOLUME ? (cw ? USAGE_VOLUME_UP : USAGE_VOLUME_DOWN)
+                                               : (cw ? USAGE_BRIGHT_UP : USAGE_BRIGHT_DOWN);
+        for (uint8_t i = 0; i < steps; i++) {
+            _sink.consumer(u, true);
+            _sink.consumer(u, false);
+        }
+        break;
+    }
+    case ENC_MODE_SCROLL:
+        _sink.wheel(cw ? detents : (int8_t)-detents);
+        break;
+    case ENC_MODE_ZOOM:
+        _sink.key(USAGE_LEFT_CTRL, true);
+        _sink.wheel(cw ? detents : (int8_t)-detents);
+        _sink.key(USAGE_LEFT_CTRL, false);
+        break;
+    case ENC_MODE_CUSTOM:
+        for (uint8_t i = 0; i < steps; i++) {
+            down(cw ? e.cw : e.ccw);
+            up(cw ? e.cw : e.ccw);
+        }
+        break;
+    }
+}
+
+void Session::down(const Action& a) {
+    switch (a.type) {
+    case MAP_SINGLE_KEY:
+        _sink.key(a.code, true);
+        break;
+    case MAP_MEDIA_KEY:
+        _sink.consumer(consumerUsage(a.code), true);
+        break;
+    case MAP_MODIFIER_COMBO:
+    case MAP_SHORTCUT:
+        mods(a.mods, true);
+        if (a.code) _sink.key(a.code, true);
+        break;
+    }
+}
+
+void Session::up(const Action& a) {
+    switch (a.type) {
+    case MAP_SINGLE_KEY:
+        _sink.key(a.code, false);
+        break;
+    case MAP_MEDIA_KEY:
+        _sink.consumer(consumerUsage(a.code), false);
+        break;
+    case MAP_MODIFIER_COMBO:
+    case MAP_SHORTCUT:
+        if (a.code) _sink.key(a.code, false);
+        mods(a.mods, false);
+        break;
+    }
+}
+
+// Modifier bit i is usage 0xE0 + i; down in bit order, up in reverse
+void Session::mods(uint8_t bits, bool pressed) {
+    for (int i = 0; i < 8; i++) {
+        int b = pressed ? i : 7 - i;
+        if (bits & (1u << b)) _sink.key((uint8_t)(USAGE_LEFT_CTRL + b), pressed);
+    }
+}
+
+} // namespace bridge
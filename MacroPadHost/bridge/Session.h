@@ -0,0 +1,121 @@
+// =============================================================================
+// Session.h — One MacroPad on one serial link, driven from the host
+// Owns the handshake: start() offers HS_FLAG_BATCH | HS_FLAG_CRC16 and tick()
+// repeats it until the ACK, whose features switch the parser's check bytes.
+// Key, encoder and batched events then become key strokes on the Sink, per
+// the KeyMap; a release always undoes what its press did, whatever the layer
+// by then.
+//
+// Every event carries the device's 8-bit sequence number.  A gap means events
+// were lost on the way (the device's TX buffer was full): the session asks
+// for a PKT_SNAPSHOT and, when one arrives that is at least as new as the
+// last event seen, presses and releases keys until its own idea of what is
+// held matches the device's.  The device also pushes snapshots by itself
+// while keys are held, so a lost release cannot leave a key stuck.
+//
+// Nothing allocates after construction.  Single-threaded: feed(), tick() and
+// start() belong to one loop.
+// =============================================================================
+#ifndef BRIDGE_SESSION_H
+#define BRIDGE_SESSION_H
+
+#include "FrameParser.h"
+#include "KeyMap.h"
+#include "Sink.h"
+
+namespace bridge {
+
+// Host → device bytes
+class Link {
+public:
+    virtual ~Link() {}
+    virtual bool write(const uint8_t* data, size_t n) = 0;
+};
+
+struct DeviceInfo {
+    uint8_t fw[3];
+    uint8_t rows;
+    uint8_t cols;
+    uint8_t encoder;
+    uint8_t battery;
+    uint8_t keys;
+};
+
+struct SessionStats {
+    uint32_t handshakes = 0;             // handshakes sent
+    uint32_t events     = 0;             // key and encoder events handled
+    uint32_t gaps       = 0;             // breaks in the sequence numbers
+    uint32_t snapshots  = 0;             // snapshots applied
+    uint32_t corrected  = 0;             // keys a snapshot pressed or released
+    uint32_t expired    = 0;             // partial frames given up on
+};
+
+class Session {
+public:
+    static const uint32_t HANDSHAKE_RETRY_US = 500000;
+    static const uint32_t SNAPSHOT_RETRY_US  = 250000;
+    static const uint32_t PARTIAL_EXPIRE_US  = 50000;
+
+    Session(Link& link, Sink& sink, const KeyMap& map,
+            uint8_t features = HS_FLAG_BATCH | HS_FLAG_CRC16);
+
+    void start(uint64_t nowUs);                         // (re)send the handshake
+    void feed(const uint8_t* data, size_t n, uint64_t nowUs);
+    void tick(uint64_t nowUs);                          // retries; every few ms
+    void releaseAll();                                  // link gone: let go of everything
+
+    bool                ready()    const { return _ready; }
+    uint8_t             features() const { return _features; }
+    const DeviceInfo&   device()   const { return _device; }
+    int                 battery()  const { return _battery; }   // %, −1 = not reported
+    const SessionStats& stats()    const { return _stats; }
+    const ParserStats&  parser()   const { return _parser.stats(); }
+
+private:
+    void drain();
+    void handle(const FrameView& f);
+    void event(uint8_t type, uint8_t a, uint8_t b, uint8_t seq);
+    void snapshot(const uint8_t* d, uint16_t len);
+    void requestSnapshot();
+    void send(uint8_t type, const uint8_t* data, uint16_t len);
+
+    void press(uint8_t key, uint8_t layer);
+    void release(uint8_t key);
+    void button(bool pressed);
+    void rotate(bool cw, uint8_t steps);
+    void down(const Action& a);
+    void up(const Action& a);
+    void mods(uint8_t bits, bool pressed);
+
+    Link&         _link;
+    Sink&         _sink;
+    const KeyMap& _map;
+    FrameParser   _parser;
+    uint8_t       _offer;
+
+    bool          _ready        = false;
+    uint8_t       _features     = 0;
+    DeviceInfo    _device       = {};
+    int           _battery      = -1;
+    uint64_t      _nowUs        = 0;
+    uint64_t      _helloUs      = 0;
+    uint64_t      _partialUs    = 0;
+
+    bool          _haveSeq      = false;
+    uint8_t       _lastSeq      = 0;
+    bool          _snapWanted   = false;
+    uint64_t      _snapAskedUs  = 0;
+
+    uint8_t       _layer        = 0;
+    bool          _down[KeyMap::KEYS] = {};
+    Action        _held[KeyMap::KEYS];
+    bool          _btnDown      = false;
+    Action        _btnHeld;
+
+    SessionStats  _stats;
+    uint8_t       _tx[FRAME_MAX];
+};
+
+} // namespace bridge
+
+#endif
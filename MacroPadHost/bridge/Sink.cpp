@@ -0,0 +1,21 @@
+// =============================================================================
+// Sink.cpp — Where the bridge's key strokes go
+// =============================================================================
+#include "Sink.h"
+
+namespace bridge {
+
+MemorySink::MemorySink(uint64_t (*clock)(), size_t reserve) : _clock(clock) {
+    _entries.reserve(reserve);
+}
+
+void MemorySink::add(SinkKind kind, uint16_t code, int8_t value) {
+    _entries.push_back({ _clock(), kind, code, value });
+}
+
+void MemorySink::key(uint8_t usage, bool down)       { add(SINK_KEY, usage, down); }
+void MemorySink::consumer(uint16_t usage, bool down) { add(SINK_CONSUMER, usage, down); }
+void MemorySink::wheel(int8_t detents)               { add(SINK_WHEEL, 0, detents); }
+void MemorySink::sync()                              { add(SINK_SYNC, 0, 0); }
+
+} // namespace bridge
@@ -0,0 +1,60 @@
+// =============================================================================
+// Sink.h — Where the bridge's key strokes go
+// The session turns device events into HID usages and hands them to a Sink:
+// keyboard-page usages (modifiers are 0xE0–0xE7), consumer-page usages and
+// wheel detents.  sync() closes the strokes of one device event, so a backend
+// can report them together.  UinputSink injects them on Linux; MemorySink
+// keeps them, time-stamped, for the bench.
+// =============================================================================
+#ifndef BRIDGE_SINK_H
+#define BRIDGE_SINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bridge {
+
+class Sink {
+public:
+    virtual ~Sink() {}
+    virtual void key(uint8_t usage, bool down)       = 0;   // HID keyboard page
+    virtual void consumer(uint16_t usage, bool down) = 0;   // HID consumer page
+    virtual void wheel(int8_t detents)               = 0;   // + = away from the user
+    virtual void sync()                              = 0;
+};
+
+// ── In memory ────────────────────────────────────────────────────────────────
+enum SinkKind : uint8_t { SINK_KEY, SINK_CONSUMER, SINK_WHEEL, SINK_SYNC };
+
+struct SinkEntry {
+    uint64_t tUs;
+    SinkKind kind;
+    uint16_t code;                       // usage; 0 for wheel and sync
+    int8_t   value;                      // 1 down / 0 up, or wheel detents
+};
+
+class MemorySink : public Sink {
+public:
+    // `clock` stamps each entry.  Nothing allocates until `reserve` entries
+    // have been kept.
+    explicit MemorySink(uint64_t (*clock)(), size_t reserve = 4096);
+
+    void key(uint8_t usage, bool down) override;
+    void consumer(uint16_t usage, bool down) override;
+    void wheel(int8_t detents) override;
+    void sync() override;
+
+    const std::vector<SinkEntry>& entries() const { return _entries; }
+    void clear() { _entries.clear(); }
+
+private:
+    void add(SinkKind kind, uint16_t code, int8_t value);
+
+    uint64_t (*_clock)();
+    std::vector<SinkEntry> _entries;
+};
+
+} // namespace bridge
+
+#endif
@@ -0,0 +1,138 @@
+// =============================================================================
+// UinputSink.cpp — Key strokes into the Linux input layer through /dev/uinput
+// =============================================================================
+#include "UinputSink.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace bridge {
+
+// ── HID keyboard page → Linux key codes (hid-input's table) ─────────────────
+static const uint16_t KEYBOARD[] = {
+    0, 0, 0, 0,                                                  // 0x00–0x03
+    KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H,      // 0x04
+    KEY_I, KEY_J, KEY_K, KEY_L, KEY_M, KEY_N, KEY_O, KEY_P,      // 0x0C
+    KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X,      // 0x14
+    KEY_Y, KEY_Z,                                                // 0x1C
+    KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8,      // 0x1E
+    KEY_9, KEY_0,                                                // 0x26
+    KEY_ENTER, KEY_ESC, KEY_BACKSPACE, KEY_TAB, KEY_SPACE,       // 0x28
+    KEY_MINUS, KEY_EQUAL, KEY_LEFTBRACE, KEY_RIGHTBRACE,         // 0x2D
+    KEY_BACKSLASH, KEY_BACKSLASH, KEY_SEMICOLON, KEY_APOSTROPHE, // 0x31
+    KEY_GRAVE, KEY_COMMA, KEY_DOT, KEY_SLASH, KEY_CAPSLOCK,      // 0x35
+    KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6,              // 0x3A
+    KEY_F7, KEY_F8, KEY_F9, KEY_F10, KEY_F11, KEY_F12,           // 0x40
+    KEY_SYSRQ, KEY_SCROLLLOCK, KEY_PAUSE, KEY_INSERT, KEY_HOME,  // 0x46
+    KEY_PAGEUP, KEY_DELETE, KEY_END, KEY_PAGEDOWN,               // 0x4B
+    KEY_RIGHT, KEY_LEFT, KEY_DOWN, KEY_UP,                       // 0x4F
+    KEY_NUMLOCK, KEY_KPSLASH, KEY_KPASTERISK, KEY_KPMINUS,       // 0x53
+    KEY_KPPLUS, KEY_KPENTER, KEY_KP1, KEY_KP2, KEY_KP3,          // 0x57
+    KEY_KP4, KEY_KP5, KEY_KP6, KEY_KP7, KEY_KP8, KEY_KP9,        // 0x5C
+    KEY_KP0, KEY_KPDOT, KEY_102ND, KEY_COMPOSE, KEY_POWER,       // 0x62
+    KEY_KPEQUAL,                                                 // 0x67
+    KEY_F13, KEY_F14, KEY_F15, KEY_F16, KEY_F17, KEY_F18,        // 0x68
+    KEY_F19, KEY_F20, KEY_F21, KEY_F22, KEY_F23, KEY_F24,        // 0x6E
+};
+
+static const uint16_t MODIFIERS[8] = {                           // 0xE0–0xE7
+    KEY_LEFTCTRL, KEY_LEFTSHIFT, KEY_LEFTALT, KEY_LEFTMETA,
+    KEY_RIGHTCTRL, KEY_RIGHTSHIFT, KEY_RIGHTALT, KEY_RIGHTMETA,
+};
+
+struct Usage {
+    uint16_t usage;
+    uint16_t key;
+};
+
+static const Usage CONSUMER[] = {
+    { 0x006F, KEY_BRIGHTNESSUP },
+    { 0x0070, KEY_BRIGHTNESSDOWN },
+    { 0x00B5, KEY_NEXTSONG },
+    { 0x00B6, KEY_PREVIOUSSONG },
+    { 0x00B7, KEY_STOPCD },
+    { 0x00CD, KEY_PLAYPAUSE },
+    { 0x00E2, KEY_MUTE },
+    { 0x00E9, KEY_VOLUMEUP },
+    { 0x00EA, KEY_VOLUMEDOWN },
+    { 0x0192, KEY_CALC },
+    { 0x0223, KEY_HOMEPAGE },
+};
+
+static uint16_t keyboardKey(uint8_t usage) {
+    if (usage >= 0xE0 && usage <= 0xE7) return MODIFIERS[usage - 0xE0];
+    return usage < sizeof(KEYBOARD) / sizeof(KEYBOARD[0]) ? KEYBOARD[usage] : 0;
+}
+
+static uint16_t consumerKey(uint16_t usage) {
+    for (const Usage& u : CONSUMER)
+        if (u.usage == usage) return u.key;
+    return 0;
+}
+
+// ── Device ───────────────────────────────────────────────────────────────────
+UinputSink::~UinputSink() { close(); }
+
+bool UinputSink::open(const char* name) {
+    close();
+    _fd = ::open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (_fd < 0) return false;
+
+    bool ok = ioctl(_fd, UI_SET_EVBIT, EV_KEY) == 0 &&
+              ioctl(_fd, UI_SET_EVBIT, EV_REL) == 0 &&
+              ioctl(_fd, UI_SET_EVBIT, EV_SYN) == 0 &&
+              ioctl(_fd, UI_SET_RELBIT, REL_WHEEL) == 0;
+    for (uint16_t k : KEYBOARD)  if (k) ok = ok && ioctl(_fd, UI_SET_KEYBIT, k) == 0;
+    for (uint16_t k : MODIFIERS) ok = ok && ioctl(_fd, UI_SET_KEYBIT, k) == 0;
+    for (const Usage& u : CONSUMER) ok = ok && ioctl(_fd, UI_SET_KEYBIT, u.key) == 0;
+
+    uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_USB;
+    setup.id.vendor  = 0x303A;           // Espressif's USB vendor id
+    setup.id.product = 0x4D50;           // "MP"
+    strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+    ok = ok && ioctl(_fd, UI_DEV_SETUP, &setup) == 0 && ioctl(_fd, UI_DEV_CREATE) == 0;
+    if (!ok) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    return ok;
+}
+
+void UinputSink::close() {
+    if (_fd < 0) return;
+    ioctl(_fd, UI_DEV_DESTROY);
+    ::close(_fd);
+    _fd = -1;
+}
+
+void UinputSink::emit(uint16_t type, uint16_t code, int32_t value) {
+    if (_fd < 0) return;
+    input_event e;
+    memset(&e, 0, sizeof(e));
+    e.type  = type;
+    e.code  = code;
+    e.value = value;
+    if (write(_fd, &e, sizeof(e)) != (ssize_t)sizeof(e)) _dropped++;
+}
+
+void UinputSink::key(uint8_t usage, bool down) {
+    uint16_t k = keyboardKey(usage);
+    if (k) emit(EV_KEY, k, down);
+    else   _unmapped++;
+}
+
+void UinputSink::consumer(uint16_t usage, bool down) {
+    uint16_t k = consumerKey(usage);
+    if (k) emit(EV_KEY, k, down);
+    else   _unmapped++;
+}
+
+void UinputSink::wheel(int8_t detents) { emit(EV_REL, REL_WHEEL, detents); }
+void UinputSink::sync()                { emit(EV_SYN, SYN_REPORT, 0); }
+
+} // namespace bridge
@@ -0,0 +1,41 @@
+// =============================================================================
+// UinputSink.h — Key strokes into the Linux input layer through /dev/uinput
+// Creates one virtual device with the keyboard keys, the media keys and a
+// wheel.  HID usages are translated as the kernel's hid-input does for a real
+// keyboard, so layouts, compositors and games see ordinary key codes.  Usages
+// with no Linux key are counted and skipped.  Needs write access to
+// /dev/uinput (root, or a udev rule for the input group).
+// =============================================================================
+#ifndef BRIDGE_UINPUT_SINK_H
+#define BRIDGE_UINPUT_SINK_H
+
+#include "Sink.h"
+
+namespace bridge {
+
+class UinputSink : public Sink {
+public:
+    ~UinputSink() override;
+
+    bool open(const char* name = "MacroPad Bridge");   // false: errno says why
+    void close();
+
+    void key(uint8_t usage, bool down) override;
+    void consumer(uint16_t usage, bool down) override;
+    void wheel(int8_t detents) override;
+    void sync() override;
+
+    uint32_t unmapped() const { return _unmapped; }   // usages with no Linux key
+    uint32_t dropped()  const { return _dropped; }    // writes the kernel refused
+
+private:
+    void emit(uint16_t type, uint16_t code, int32_t value);
+
+    int      _fd       = -1;
+    uint32_t _unmapped = 0;
+    uint32_t _dropped  = 0;
+};
+
+} // namespace bridge
+
+#endif
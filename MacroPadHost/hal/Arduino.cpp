@@ -0,0 +1,415 @@
+// =============================================================================
+// Arduino.cpp — Simulated GPIO, timers, ADC and serial for the host build
+// Time and scheduling live in Kernel.cpp.
+// =============================================================================
+#include <Arduino.h>
+#include "Kernel.h"
+#include "Sim.h"
+#include <esp_sleep.h>
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
+
+#include <cstdio>
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+namespace {
+
+struct Pin {
+    uint8_t mode     = INPUT;
+    uint8_t out      = HIGH;     // level written while in OUTPUT mode
+    uint8_t ext      = HIGH;     // externally driven level (switch to GND)
+    uint8_t lastSeen = HIGH;     // last level an ISR was told about
+    void  (*isr)(void) = nullptr;
+    int     isrMode  = CHANGE;   // RISING / FALLING / CHANGE
+    int8_t  wake     = -1;       // light-sleep wake level, -1 = none
+};
+
+Pin      g_pins[sim::NUM_PINS];
+uint64_t g_closedRows[sim::NUM_PINS] = {};   // per column: rows switched to it
+uint64_t g_lowOutputs = 0;                   // pins driven LOW as outputs
+uint64_t g_isrPins    = 0;                   // pins with an attached ISR
+
+sim::TxByte g_tx[sim::TX_CAPACITY];
+size_t      g_txLen     = 0;
+uint32_t    g_txCalls   = 0;
+uint64_t    g_wireFreeNs = 0;                // when the last queued byte is out
+
+uint8_t     g_rx[sim::RX_CAPACITY];
+size_t      g_rxHead = 0, g_rxTail = 0;
+uint32_t    g_rxCalls = 0;
+
+uint16_t    g_analog[sim::NUM_PINS];
+uint32_t    g_analogReads = 0;
+
+uint32_t    g_isrCalls = 0;
+uint32_t    g_sleeps   = 0;
+esp_sleep_wakeup_cause_t g_wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+sim::Costs  g_costs;
+
+int         g_strobePin  = -1;
+uint64_t    g_strobeLast = 0;
+uint32_t    g_strobes[sim::STROBE_CAPACITY];
+size_t      g_strobeLen  = 0;
+
+uint64_t lowOutputs() { return g_lowOutputs; }
+
+void trackOutput(uint8_t p) {
+    if (g_pins[p].mode == OUTPUT && g_pins[p].out == LOW) g_lowOutputs |=  (1ull << p);
+    else                                                 g_lowOutputs &= ~(1ull << p);
+}
+
+uint8_t levelOf(uint8_t p, uint64_t lows) {
+    const Pin& pin = g_pins[p];
+    if (pin.mode == OUTPUT) return pin.out;
+
+    // A column reads LOW when a closed switch ties it to a row driven LOW
+    if (g_closedRows[p] & lows) return LOW;
+    return pin.ext;
+}
+
+uint8_t levelOf(uint8_t p) { return levelOf(p, lowOutputs()); }
+
+void fireIsrs() {
+    if (kernel::inIsr()) return;
+    kernel::enterIsr();
+    uint64_t lows = lowOutputs();
+    for (uint64_t m = g_isrPins; m; m &= m - 1) {
+        uint8_t p   = (uint8_t)__builtin_ctzll(m);
+        uint8_t lvl = levelOf(p, lows);
+        if (lvl != g_pins[p].lastSeen) {
+            g_pins[p].lastSeen = lvl;
+            int mode = g_pins[p].isrMode;
+            if ((mode == FALLING && lvl) || (mode == RISING && !lvl)) continue;
+            g_isrCalls++;
+            g_pins[p].isr();
+        }
+    }
+    kernel::leaveIsr();
+}
+
+} // namespace
+
+void gpioApply(const PinEvent& e) {
+    if (e.kind == 0) g_pins[e.a].ext     = e.v;
+    else if (e.v)    g_closedRows[e.b]  |=  (1ull << e.a);
+    else             g_closedRows[e.b]  &= ~(1ull << e.a);
+    fireIsrs();
+}
+
+// ── GPIO ─────────────────────────────────────────────────────────────────────
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= sim::NUM_PINS) return;
+    g_pins[pin].mode = mode;
+    trackOutput(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= sim::NUM_PINS) return;
+    if (pin == g_strobePin && val == LOW && g_pins[pin].out != LOW) {
+        uint64_t now = kernel::nowUs();
+        if (g_strobeLast && g_strobeLen < sim::STROBE_CAPACITY)
+            g_strobes[g_strobeLen++] = (uint32_t)(now - g_strobeLast);
+        g_strobeLast = now;
+    }
+    g_pins[pin].out = val ? HIGH : LOW;
+    trackOutput(pin);
+    fireIsrs();
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= sim::NUM_PINS) return LOW;
+    return levelOf(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    if (pin >= sim::NUM_PINS) return;
+    g_pins[pin].isr      = isr;
+    g_pins[pin].isrMode  = mode;
+    g_pins[pin].lastSeen = levelOf(pin);
+    g_isrPins           |= 1ull << pin;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= sim::NUM_PINS) return;
+    g_pins[pin].isr = nullptr;
+    g_isrPins      &= ~(1ull << pin);
+}
+
+// ── Register access ──────────────────────────────────────────────────────────
+uint32_t hostRegRead(uint32_t reg) {
+    uint8_t first;
+    if      (reg == GPIO_IN_REG)  first = 0;
+    else if (reg == GPIO_IN1_REG) first = 32;
+    else return 0;
+
+    uint32_t in   = 0;
+    uint64_t lows = lowOutputs();
+    for (uint8_t p = first; p < first + 32 && p < sim::NUM_PINS; p++)
+        if (levelOf(p, lows)) in |= 1u << (p - first);
+    return in;
+}
+
+// ── Hardware timers ──────────────────────────────────────────────────────────
+struct hw_timer_s {
+    int      id;
+    uint32_t freq;
+};
+
+hw_timer_t* timerBegin(uint32_t frequency) {
+    return new hw_timer_t{ -1, frequency ? frequency : 1 };
+}
+
+void timerAttachInterrupt(hw_timer_t* t, void (*isr)(void)) {
+    t->id = kernel::timerCreate(isr, true);
+}
+
+void timerAlarm(hw_timer_t* t, uint64_t alarmValue, bool autoreload, uint64_t) {
+    kernel::timerArm(t->id, alarmValue * 1000000ull / t->freq, autoreload);
+}
+
+void timerStart(hw_timer_t* t) { kernel::timerRun(t->id, true); }
+void timerStop(hw_timer_t* t)  { kernel::timerRun(t->id, false); }
+
+// ── ADC ──────────────────────────────────────────────────────────────────────
+uint16_t analogRead(uint8_t pin) {
+    kernel::busyFor(g_costs.analogReadUs);
+    g_analogReads++;
+    return pin < sim::NUM_PINS ? g_analog[pin] : 0;
+}
+void     analogReadResolution(uint8_t) {}
+void     analogSetAttenuation(int)     {}
+
+// ── Time ─────────────────────────────────────────────────────────────────────
+unsigned long millis()                { return (unsigned long)(kernel::nowUs() / 1000); }
+unsigned long micros()                { return (unsigned long)kernel::nowUs(); }
+void          delay(uint32_t ms)      { kernel::sleepFor((uint64_t)ms * 1000); }
+void          delayMicroseconds(uint32_t us) { kernel::busyFor(us); }
+
+// ── ESP-IDF sleep / wake ─────────────────────────────────────────────────────
+// As on the chip, a wake level replaces the pin's edge interrupt, and
+// gpio_wakeup_disable() leaves it disabled until gpio_set_intr_type() or
+// attachInterrupt() sets one again.
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+    if (pin < 0 || pin >= sim::NUM_PINS) return ESP_OK;
+    g_pins[pin].wake = type == GPIO_INTR_HIGH_LEVEL ? HIGH : LOW;
+    g_isrPins       &= ~(1ull << pin);
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) {
+    if (pin < 0 || pin >= sim::NUM_PINS) return ESP_OK;
+    g_pins[pin].wake = -1;
+    g_isrPins       &= ~(1ull << pin);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+    if (pin < 0 || pin >= sim::NUM_PINS || !g_pins[pin].isr) return ESP_OK;
+    if (type == GPIO_INTR_DISABLE) { g_isrPins &= ~(1ull << pin); return ESP_OK; }
+    attachInterrupt((uint8_t)pin, g_pins[pin].isr,
+                    type == GPIO_INTR_POSEDGE ? RISING : type == GPIO_INTR_NEGEDGE ? FALLING : CHANGE);
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() { return ESP_OK; }
+
+static bool wakeLevelHeld() {
+    uint64_t lows = lowOutputs();
+    for (uint8_t p = 0; p < sim::NUM_PINS; p++)
+        if (g_pins[p].wake >= 0 && levelOf(p, lows) == g_pins[p].wake) return true;
+    return false;
+}
+
+esp_err_t esp_light_sleep_start() {
+    // Sleeps until a pin sits at its wake level — at once if one already
+    // does.  If the script runs out first the sleep ends there, with no wake
+    // cause, so a scenario can never hang here.
+    g_sleeps++;
+    g_wakeCause = kernel::haltUntil(wakeLevelHeld) ? ESP_SLEEP_WAKEUP_GPIO
+                                                   : ESP_SLEEP_WAKEUP_UNDEFINED;
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return g_wakeCause; }
+
+// ── Print ────────────────────────────────────────────────────────────────────
+size_t Print::write(const uint8_t* buf, size_t n) {
+    for (size_t i = 0; i < n; i++) write(buf[i]);
+    return n;
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t n) {
+    size_t got = 0;
+    for (int b; got < n && (b = read()) >= 0;) buf[got++] = (uint8_t)b;
+    return got;
+}
+
+size_t Print::print(const char* s) {
+    return write((const uint8_t*)s, strlen(s));
+}
+
+size_t Print::println(const char* s) {
+    size_t n = print(s);
+    return n + write((const uint8_t*)"\r\n", 2);
+}
+
+size_t Print::printf(const char* fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n <= 0) return 0;
+    return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+// ── HardwareSerial ───────────────────────────────────────────────────────────
+size_t HardwareSerial::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+    g_txCalls++;
+    if (g_costs.serialWriteUs) kernel::busyFor(g_costs.serialWriteUs);
+
+    // Queue behind whatever is still on the wire, stamping each byte with the
+    // time it finishes.  The wire is reserved before blocking so a task that
+    // preempts us mid-write queues after these bytes.
+    uint64_t byteNs = g_costs.serialByteNs;
+    uint64_t t      = std::max(kernel::nowUs() * 1000, g_wireFreeNs);
+    for (size_t i = 0; i < n; i++) {
+        t += byteNs;
+        if (g_txLen < sim::TX_CAPACITY) g_tx[g_txLen++] = { (t + 999) / 1000, buf[i] };
+    }
+    g_wireFreeNs = t;
+
+    // Block until everything but the last FIFO-full has gone out
+    uint64_t fifoNs = byteNs * g_costs.serialTxFifo;
+    uint64_t nowNs  = kernel::nowUs() * 1000;
+    if (t > nowNs + fifoNs) kernel::busyFor((t - fifoNs - nowNs + 999) / 1000);
+    return n;
+}
+
+int HardwareSerial::availableForWrite() {
+    uint64_t byteNs = g_costs.serialByteNs;
+    uint64_t nowNs  = kernel::nowUs() * 1000;
+    if (!byteNs || g_wireFreeNs <= nowNs) return (int)g_costs.serialTxFifo;
+    uint64_t queued = (g_wireFreeNs - nowNs + byteNs - 1) / byteNs;
+    return queued >= g_costs.serialTxFifo ? 0 : (int)(g_costs.serialTxFifo - queued);
+}
+
+int HardwareSerial::available() {
+    return (int)((g_rxHead - g_rxTail) & (sim::RX_CAPACITY - 1));
+}
+
+int HardwareSerial::read() {
+    g_rxCalls++;
+    if (g_costs.serialReadUs) kernel::busyFor(g_costs.serialReadUs);
+    if (g_rxHead == g_rxTail) return -1;
+    uint8_t b = g_rx[g_rxTail];
+    g_rxTail  = (g_rxTail + 1) & (sim::RX_CAPACITY - 1);
+    return b;
+}
+
+int HardwareSerial::peek() {
+    return (g_rxHead == g_rxTail) ? -1 : g_rx[g_rxTail];
+}
+
+// One driver call: up to the end of the ring, then from its start
+size_t HardwareSerial::readBytes(uint8_t* buf, size_t n) {
+    g_rxCalls++;
+    if (g_costs.serialReadUs) kernel::busyFor(g_costs.serialReadUs);
+    n = std::min(n, (size_t)available());
+    size_t first = std::min(n, sim::RX_CAPACITY - g_rxTail);
+    memcpy(buf, g_rx + g_rxTail, first);
+    memcpy(buf + first, g_rx, n - first);
+    g_rxTail = (g_rxTail + n) & (sim::RX_CAPACITY - 1);
+    return n;
+}
+
+// =============================================================================
+// sim:: — harness side
+// =============================================================================
+namespace sim {
+
+uint64_t nowUs()                { return kernel::nowUs(); }
+void     advanceUs(uint64_t us) { kernel::advanceIdle(us); }
+bool     tasksRunning()         { return kernel::tasksRunning(); }
+
+const char* firmwareContext() {
+    return kernel::inIsr() ? "ISR" : kernel::currentTask();
+}
+
+void scheduleLevel(uint64_t atUs, uint8_t pin, uint8_t level) {
+    kernel::schedulePin({ atUs, 0, pin, 0, level });
+}
+
+void scheduleSwitch(uint64_t atUs, uint8_t rowPin, uint8_t colPin, bool closed) {
+    kernel::schedulePin({ atUs, 1, rowPin, colPin, (uint8_t)closed });
+}
+
+bool eventsPending() { return kernel::pinsPending(); }
+void clearSchedule() { kernel::clearPins(); }
+
+void setLevel(uint8_t pin, uint8_t level) {
+    gpioApply({ kernel::nowUs(), 0, pin, 0, level });
+}
+
+void setSwitch(uint8_t rowPin, uint8_t colPin, bool closed) {
+    gpioApply({ kernel::nowUs(), 1, rowPin, colPin, (uint8_t)closed });
+}
+
+void hostWrite(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        g_rx[g_rxHead] = data[i];
+        g_rxHead = (g_rxHead + 1) & (RX_CAPACITY - 1);
+    }
+}
+
+size_t        txCount()        { return g_txLen; }
+const TxByte& txAt(size_t i)   { return g_tx[i]; }
+void          txClear()        { g_txLen = 0; g_txCalls = 0; }
+uint32_t      txWriteCalls()   { return g_txCalls; }
+uint32_t      rxReadCalls()    { return g_rxCalls; }
+
+void setCosts(const Costs& c) {
+    g_costs = c;
+    kernel::setSleepModel(c.sleepExitUs, c.sleepMinUs);
+}
+
+const Costs& costs() { return g_costs; }
+
+void     watchStrobe(uint8_t pin)   { g_strobePin = pin; g_strobeLast = 0; g_strobeLen = 0; }
+void     strobeClear()              { g_strobeLen = 0; }
+size_t   strobeCount()              { return g_strobeLen; }
+uint32_t strobeIntervalAt(size_t i) { return g_strobes[i]; }
+
+void     setAnalog(uint8_t pin, uint16_t raw) { if (pin < NUM_PINS) g_analog[pin] = raw; }
+uint32_t analogReads()                       { return g_analogReads; }
+
+CpuTime  cpuTime()    { return kernel::cpuTime(); }
+
+uint32_t isrCalls()   { return g_isrCalls; }
+uint32_t sleepCount() { return g_sleeps; }
+
+void reset() {
+    kernel::reset();
+    bleReset();
+    clearSchedule();
+    for (uint64_t& rows : g_closedRows) rows = 0;
+    for (auto& p : g_pins) { p.ext = HIGH; p.wake = -1; }
+    g_rxHead = g_rxTail = 0;
+    g_rxCalls = 0;
+    txClear();
+    g_wireFreeNs = 0;
+    strobeClear();
+    setCosts(Costs());
+    for (uint16_t& a : g_analog) a = 2600;               // ≈ 4.2 V behind a 1:2 divider
+    g_analogReads = 0;
+    g_isrCalls = 0;
+    g_sleeps   = 0;
+}
+
+} // namespace sim
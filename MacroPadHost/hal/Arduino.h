@@ -0,0 +1,127 @@
+// =============================================================================
+// Arduino.h — Host-side stand-in for the Arduino-ESP32 core
+// Only the subset the MacroPad firmware touches: GPIO, time, ADC, Stream/Print
+// and interrupts.  Time is virtual and only moves when the firmware delays or
+// the harness advances it (see Sim.h).
+// =============================================================================
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+
+#define LOW           0x0
+#define HIGH          0x1
+
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+
+#define RISING        0x01
+#define FALLING       0x02
+#define CHANGE        0x03
+
+#define ADC_11db      3
+
+// ── GPIO ─────────────────────────────────────────────────────────────────────
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// ── Hardware timers (arduino-esp32 3.x API) ──────────────────────────────────
+typedef struct hw_timer_s hw_timer_t;
+
+hw_timer_t* timerBegin(uint32_t frequency);
+void        timerAttachInterrupt(hw_timer_t* timer, void (*isr)(void));
+void        timerAlarm(hw_timer_t* timer, uint64_t alarmValue, bool autoreload,
+                       uint64_t reloadCount);
+void        timerStart(hw_timer_t* timer);
+void        timerStop(hw_timer_t* timer);
+
+// ── ADC ──────────────────────────────────────────────────────────────────────
+uint16_t analogRead(uint8_t pin);
+void     analogReadResolution(uint8_t bits);
+void     analogSetAttenuation(int atten);
+
+// ── Time (virtual) ───────────────────────────────────────────────────────────
+unsigned long millis();
+unsigned long micros();
+void          delay(uint32_t ms);
+void          delayMicroseconds(uint32_t us);
+
+// ── Print / Stream ───────────────────────────────────────────────────────────
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n);
+
+    size_t print(const char* s);
+    size_t println(const char* s = "");
+    size_t printf(const char* fmt, ...);
+    virtual int  availableForWrite() { return 0; }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read()      = 0;
+    virtual int peek()      = 0;
+
+    // Arduino waits up to its timeout for the rest; the sim never waits, so
+    // ask for no more than available()
+    virtual size_t readBytes(uint8_t* buf, size_t n);
+};
+
+// USB-CDC / UART.  TX bytes go through a driver FIFO onto a wire of
+// Costs::serialByteNs per byte and are captured with the virtual time they
+// leave it; write() only blocks while the FIFO is full.  RX bytes are injected
+// by the harness through Sim.h; every read() or readBytes() call costs
+// Costs::serialReadUs, whatever it returns.
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    int    availableForWrite() override;
+    int    available() override;
+    int    read() override;
+    int    peek() override;
+    size_t readBytes(uint8_t* buf, size_t n) override;
+};
+
+extern HardwareSerial Serial;
+
+// ESP.getFreeHeap() and friends.  The firmware never allocates after setup(),
+// so the sim reports a fixed heap, roughly an ESP32-C3 with NimBLE running.
+class EspClass {
+public:
+    uint32_t getHeapSize()    { return 327680; }
+    uint32_t getFreeHeap()    { return 196608; }
+    uint32_t getMinFreeHeap() { return 194560; }
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,398 @@
+// =============================================================================
+// Kernel.cpp — Virtual clock, scripted pin events, hardware timers and a
+//              strict-priority FreeRTOS task simulator for the host build
+// =============================================================================
+#include "Kernel.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ucontext.h>
+#include <vector>
+
+// ── Tasks & queues ───────────────────────────────────────────────────────────
+struct SimTask {
+    enum State { READY, DELAYED, WAIT_NOTIFY, WAIT_QUEUE, DELETED };
+
+    const char*    name  = "";
+    int            prio  = -1;
+    TaskFunction_t fn    = nullptr;
+    void*          arg   = nullptr;
+    ucontext_t     ctx;
+    void*          stack = nullptr;
+    State          state = READY;
+    uint64_t       wakeUs = kernel::NEVER;
+    uint32_t       notify = 0;
+};
+
+struct SimQueue {
+    uint8_t* buf;
+    size_t   itemSize;
+    size_t   length;
+    size_t   head  = 0;
+    size_t   count = 0;
+};
+
+namespace {
+
+const size_t   MAX_TASKS   = 16;
+const size_t   STACK_BYTES = 256 * 1024;   // host frames are far larger than the MCU's
+
+struct Timer {
+    void   (*isr)(void) = nullptr;
+    uint64_t periodUs   = 0;
+    uint64_t nextUs     = kernel::NEVER;
+    bool     reload     = false;
+    bool     running    = false;
+    bool     pmLock     = false;
+};
+
+uint64_t              g_nowUs = 0;
+std::vector<PinEvent> g_pins;
+size_t                g_nextPin = 0;
+Timer                 g_timers[4];
+int                   g_numTimers = 0;
+int                   g_isrDepth  = 0;
+sim::CpuTime          g_cpu       = {};
+uint32_t              g_sleepExitUs = 0;
+uint32_t              g_sleepMinUs  = 3000;
+
+// Slot 0 is the harness / Arduino loop context, below every real task.
+SimTask  g_tasks[MAX_TASKS];
+size_t   g_numTasks = 1;
+SimTask* g_cur      = &g_tasks[0];
+
+uint64_t nextTimerUs() {
+    uint64_t t = kernel::NEVER;
+    for (int i = 0; i < g_numTimers; i++)
+        if (g_timers[i].running) t = std::min(t, g_timers[i].nextUs);
+    return t;
+}
+
+uint64_t nextTaskWakeUs() {
+    uint64_t t = kernel::NEVER;
+    for (size_t i = 0; i < g_numTasks; i++)
+        if (g_tasks[i].state != SimTask::READY && g_tasks[i].state != SimTask::DELETED)
+            t = std::min(t, g_tasks[i].wakeUs);
+    return t;
+}
+
+uint64_t nextWakeUs() {
+    return std::min({ kernel::nextPinUs(), nextTimerUs(), nextTaskWakeUs() });
+}
+
+// Run everything that is due at or before t, in time order.
+void runDue(uint64_t t) {
+    for (;;) {
+        uint64_t m = nextWakeUs();
+        if (m > t) break;
+        if (m > g_nowUs) g_nowUs = m;
+
+        while (g_nextPin < g_pins.size() && g_pins[g_nextPin].t <= g_nowUs) {
+            PinEvent e = g_pins[g_nextPin++];
+            gpioApply(e);
+        }
+        for (int i = 0; i < g_numTimers; i++) {
+            Timer& tm = g_timers[i];
+            if (!tm.running || tm.nextUs > g_nowUs) continue;
+            tm.nextUs = tm.reload ? tm.nextUs + tm.periodUs : kernel::NEVER;
+            tm.running = tm.reload;
+            kernel::enterIsr();
+            tm.isr();
+            kernel::leaveIsr();
+        }
+        for (size_t i = 0; i < g_numTasks; i++) {
+            SimTask& tk = g_tasks[i];
+            if (tk.state == SimTask::READY || tk.state == SimTask::DELETED) continue;
+            if (tk.wakeUs <= g_nowUs) { tk.state = SimTask::READY; tk.wakeUs = kernel::NEVER; }
+        }
+    }
+    if (t > g_nowUs && t != kernel::NEVER) g_nowUs = t;
+}
+
+SimTask* highestReady() {
+    SimTask* best = nullptr;
+    for (size_t i = 0; i < g_numTasks; i++) {
+        SimTask& tk = g_tasks[i];
+        if (tk.state == SimTask::READY && (!best || tk.prio > best->prio)) best = &tk;
+    }
+    return best;
+}
+
+void switchTo(SimTask* next) {
+    if (next == g_cur) return;
+    SimTask* prev = g_cur;
+    g_cur = next;
+    swapcontext(&prev->ctx, &next->ctx);
+}
+
+// Tickless idle: light sleep unless a timer holds the PM lock or a task's
+// timeout is due within g_sleepMinUs.  Slot 0 is the harness, not the board.
+bool canSleep() {
+    for (int i = 0; i < g_numTimers; i++)
+        if (g_timers[i].running && g_timers[i].pmLock) return false;
+    uint64_t due = kernel::NEVER;
+    for (size_t i = 1; i < g_numTasks; i++)
+        if (g_tasks[i].state != SimTask::READY && g_tasks[i].state != SimTask::DELETED)
+            due = std::min(due, g_tasks[i].wakeUs);
+    return due == kernel::NEVER || due - g_nowUs >= g_sleepMinUs;
+}
+
+// Current task can no longer run: hand the CPU to the best ready task,
+// idling the clock forward when nothing is ready.
+void block() {
+    bool idle = false, slept = false;
+    for (;;) {
+        if (SimTask* next = highestReady()) {
+            if (idle && next != &g_tasks[0]) {
+                g_cpu.wakeups++;
+                if (slept) {
+                    g_cpu.sleepExits++;
+                    runDue(g_nowUs + g_sleepExitUs);    // ISRs still land meanwhile
+                    next = highestReady();
+                }
+            }
+            switchTo(next);
+            return;
+        }
+        uint64_t t = nextWakeUs();
+        if (t == kernel::NEVER) {
+            fprintf(stderr, "sim: every task is blocked forever (in '%s')\n", g_cur->name);
+            abort();
+        }
+        if (!idle) { idle = true; slept = canSleep(); }
+        uint64_t from = g_nowUs;
+        runDue(t);
+        (slept ? g_cpu.sleepUs : g_cpu.idleUs) += g_nowUs - from;
+    }
+}
+
+void preempt() {
+    if (g_isrDepth || g_numTasks == 1) return;
+    SimTask* next = highestReady();
+    if (next && next != g_cur && next->prio > g_cur->prio) switchTo(next);
+}
+
+void waitUntil(SimTask::State state, uint64_t wakeUs) {
+    g_cur->state  = state;
+    g_cur->wakeUs = wakeUs;
+    block();
+}
+
+uint64_t ticksToWake(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? kernel::NEVER : g_nowUs + (uint64_t)ticks * 1000;
+}
+
+void trampoline() {
+    g_cur->fn(g_cur->arg);
+    g_cur->state = SimTask::DELETED;
+    block();
+}
+
+} // namespace
+
+// =============================================================================
+// kernel::
+// =============================================================================
+namespace kernel {
+
+uint64_t nowUs() { return g_nowUs; }
+
+void busyFor(uint64_t us) {
+    uint64_t target = g_nowUs + us;
+    for (;;) {
+        uint64_t m = nextWakeUs();
+        if (m > target) break;
+        runDue(m);
+        preempt();
+    }
+    if (target > g_nowUs) g_nowUs = target;
+}
+
+void sleepFor(uint64_t us) {
+    if (g_numTasks == 1 || g_isrDepth) { busyFor(us); return; }
+    waitUntil(SimTask::DELAYED, g_nowUs + us);
+}
+
+bool haltUntil(bool (*woken)()) {
+    uint64_t from = g_nowUs;
+    bool     woke;
+    while (!(woke = woken()) && nextPinUs() != NEVER) runDue(nextPinUs());
+    g_cpu.sleepUs += g_nowUs - from;
+    g_cpu.sleepExits++;
+    runDue(g_nowUs + g_sleepExitUs);
+    return woke;
+}
+
+void advanceIdle(uint64_t us) { sleepFor(us); }
+
+void schedulePin(const PinEvent& e) {
+    // Keep the pending tail sorted; scripts are mostly appended in order.
+    auto it = g_pins.end();
+    while (it != g_pins.begin() + g_nextPin && (it - 1)->t > e.t) --it;
+    g_pins.insert(it, e);
+}
+
+void     clearPins()   { g_pins.clear(); g_nextPin = 0; }
+bool     pinsPending() { return g_nextPin < g_pins.size(); }
+uint64_t nextPinUs()   { return pinsPending() ? g_pins[g_nextPin].t : NEVER; }
+
+bool inIsr()    { return g_isrDepth > 0; }
+void enterIsr() { g_isrDepth++; }
+void leaveIsr() { g_isrDepth--; }
+
+bool tasksRunning() { return g_numTasks > 1; }
+
+const char* currentTask() { return g_cur == &g_tasks[0] ? nullptr : g_cur->name; }
+
+void reset() {
+    // Called from the harness context, so no task stack is live.
+    for (size_t i = 1; i < g_numTasks; i++) {
+        free(g_tasks[i].stack);
+        g_tasks[i] = SimTask();
+    }
+    g_numTasks = 1;
+    g_cur      = &g_tasks[0];
+    g_cur->state = SimTask::READY;
+    for (Timer& t : g_timers) t = Timer();
+    g_numTimers = 0;
+    g_cpu       = {};
+}
+
+sim::CpuTime cpuTime() { return g_cpu; }
+
+void setSleepModel(uint32_t exitUs, uint32_t minIdleUs) {
+    g_sleepExitUs = exitUs;
+    g_sleepMinUs  = minIdleUs;
+}
+
+int timerCreate(void (*isr)(void), bool pmLock) {
+    if (g_numTimers >= 4) abort();
+    g_timers[g_numTimers].isr    = isr;
+    g_timers[g_numTimers].pmLock = pmLock;
+    return g_numTimers++;
+}
+
+void timerArm(int id, uint64_t periodUs, bool autoreload) {
+    Timer& t   = g_timers[id];
+    t.periodUs = periodUs ? periodUs : 1;
+    t.reload   = autoreload;
+    t.nextUs   = g_nowUs + t.periodUs;
+    t.running  = true;
+}
+
+void timerRun(int id, bool run) {
+    Timer& t = g_timers[id];
+    if (run && !t.running) t.nextUs = g_nowUs + t.periodUs;
+    t.running = run;
+}
+
+} // namespace kernel
+
+// =============================================================================
+// FreeRTOS API
+// =============================================================================
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t,
+                       void* arg, UBaseType_t prio, TaskHandle_t* handle) {
+    if (g_numTasks >= MAX_TASKS) return pdFAIL;
+    SimTask& t = g_tasks[g_numTasks++];
+    t.name  = name;
+    t.prio  = (int)prio;
+    t.fn    = fn;
+    t.arg   = arg;
+    t.stack = malloc(STACK_BYTES);
+    getcontext(&t.ctx);
+    t.ctx.uc_stack.ss_sp   = t.stack;
+    t.ctx.uc_stack.ss_size = STACK_BYTES;
+    t.ctx.uc_link          = nullptr;
+    makecontext(&t.ctx, trampoline, 0);
+    if (handle) *handle = &t;
+    preempt();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task) task = g_cur;
+    if (task == &g_tasks[0]) return;        // the harness context never goes away
+    task->state = SimTask::DELETED;
+    if (task == g_cur) block();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    kernel::sleepFor((uint64_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(g_nowUs / 1000); }
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    if (g_cur->notify == 0 && ticks != 0) waitUntil(SimTask::WAIT_NOTIFY, ticksToWake(ticks));
+    uint32_t v = g_cur->notify;
+    if (v) g_cur->notify = clearOnExit ? 0 : v - 1;
+    return v;
+}
+
+static void give(TaskHandle_t t) {
+    t->notify++;
+    if (t->state == SimTask::WAIT_NOTIFY) { t->state = SimTask::READY; t->wakeUs = kernel::NEVER; }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t) {
+    give(t);
+    preempt();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t* woken) {
+    give(t);
+    if (woken && t->prio > g_cur->prio) *woken = pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    SimQueue* q = new SimQueue;
+    q->buf      = (uint8_t*)calloc(length, itemSize);
+    q->itemSize = itemSize;
+    q->length   = length;
+    return q;
+}
+
+static bool push(QueueHandle_t q, const void* item) {
+    if (q->count == q->length) return false;
+    memcpy(q->buf + ((q->head + q->count) % q->length) * q->itemSize, item, q->itemSize);
+    q->count++;
+    for (size_t i = 0; i < g_numTasks; i++) {
+        SimTask& t = g_tasks[i];
+        if (t.state == SimTask::WAIT_QUEUE) { t.state = SimTask::READY; t.wakeUs = kernel::NEVER; }
+    }
+    return true;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+    if (!push(q, item)) return errQUEUE_FULL;
+    preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) {
+    if (!push(q, item)) return errQUEUE_FULL;
+    if (woken) *woken = pdTRUE;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks) {
+    while (q->count == 0) {
+        if (ticks == 0) return errQUEUE_EMPTY;
+        uint64_t wake = ticksToWake(ticks);
+        waitUntil(SimTask::WAIT_QUEUE, wake);
+        if (q->count == 0 && g_nowUs >= wake) return errQUEUE_EMPTY;
+    }
+    memcpy(item, q->buf + q->head * q->itemSize, q->itemSize);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return (UBaseType_t)q->count; }
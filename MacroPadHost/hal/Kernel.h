@@ -0,0 +1,68 @@
+// =============================================================================
+// Kernel.h — Internal: virtual clock and task scheduler of the host build
+// Shared by the HAL translation units only; the harness uses Sim.h.
+//
+// Until the firmware creates its first task, everything runs on the harness
+// thread and time only moves in delay()/delayMicroseconds().  Once tasks exist
+// each one gets its own ucontext stack and a strict-priority scheduler switches
+// between them at HAL calls:
+//   · busyFor()  — CPU or bus time (delayMicroseconds, UART bytes, notify).
+//                  Higher-priority tasks readied meanwhile preempt the caller.
+//   · sleepFor() — delay()/vTaskDelay(): the caller blocks, others run.
+// ISRs (GPIO edges, hardware timers) run on whatever stack is current.
+// =============================================================================
+#ifndef HOST_KERNEL_H
+#define HOST_KERNEL_H
+
+#include "Sim.h"
+#include <cstdint>
+
+// Scripted pin change (see sim::scheduleLevel / scheduleSwitch)
+struct PinEvent {
+    uint64_t t;
+    uint8_t  kind;               // 0 = level, 1 = switch
+    uint8_t  a;
+    uint8_t  b;
+    uint8_t  v;
+};
+
+void gpioApply(const PinEvent& e);           // Arduino.cpp
+void bleReset();                             // NimBLEDevice.cpp: forget the link and its timer
+
+namespace kernel {
+
+static const uint64_t NEVER = UINT64_MAX;
+
+uint64_t nowUs();
+void     busyFor(uint64_t us);
+void     sleepFor(uint64_t us);
+bool     haltUntil(bool (*woken)());         // light sleep: ISRs run, no task does, until
+                                             // woken() (true) or the pin script runs out
+void     advanceIdle(uint64_t us);           // harness: let the board run
+
+void     schedulePin(const PinEvent& e);
+void     clearPins();
+bool     pinsPending();
+uint64_t nextPinUs();
+
+bool     inIsr();
+void     enterIsr();
+void     leaveIsr();
+
+bool     tasksRunning();
+const char* currentTask();                   // nullptr on the harness context
+void     reset();                            // drop every task and timer (harness only)
+
+// Idle accounting (sim::CpuTime); the sleep model comes from sim::Costs
+sim::CpuTime cpuTime();
+void         setSleepModel(uint32_t exitUs, uint32_t minIdleUs);
+
+// Periodic/one-shot hardware timers.  A pmLock timer keeps the CPU out of
+// light sleep while it runs, like a GPTimer on the APB clock.
+int      timerCreate(void (*isr)(void), bool pmLock = false);
+void     timerArm(int id, uint64_t periodUs, bool autoreload);
+void     timerRun(int id, bool run);
+
+} // namespace kernel
+
+#endif // HOST_KERNEL_H
@@ -0,0 +1,351 @@
+// =============================================================================
+// NimBLEDevice.cpp — Host-side NimBLE stand-in
+// =============================================================================
+#include <NimBLEDevice.h>
+#include "Kernel.h"
+#include "Sim.h"
+
+namespace {
+
+const size_t MAX_CHARS   = 32;
+const size_t MAX_NOTIFY  = 1u << 16;
+const size_t MAX_TX_BUFS = 64;
+
+NimBLECharacteristic g_chars[MAX_CHARS];
+size_t               g_numChars = 0;
+NimBLEService        g_services[8];
+size_t               g_numServices = 0;
+NimBLEServer         g_server;
+NimBLEAdvertising    g_adv;
+
+sim::Notify    g_notify[MAX_NOTIFY];
+size_t         g_notifyLen = 0;
+uint32_t       g_failEvery = 0;
+uint32_t       g_attempts  = 0;
+uint32_t       g_refused   = 0;
+uint32_t       g_txBufs    = sim::TX_BUFS;
+uint32_t       g_lossPct   = 0;
+uint32_t       g_lossSeed  = 1;
+NimBLEConnInfo g_conn;
+
+// ── Link layer model ─────────────────────────────────────────────────────────
+struct Link {
+    bool     up          = false;
+    uint64_t anchorUs    = 0;                   // a connection event on the current timing
+    uint8_t  phy         = BLE_GAP_LE_PHY_1M;
+    uint16_t dataLen     = 27;                  // LL payload octets
+    uint64_t radioFreeUs = 0;                   // previous notify acknowledged
+    uint64_t bufUntilUs[MAX_TX_BUFS] = {};      // each TX buffer held until its ack
+};
+
+struct ParamsUpdate {
+    bool     pending = false;
+    uint64_t atUs    = 0;                       // the instant: first event on the new timing
+    uint16_t interval, latency, timeout;
+};
+
+struct PhyUpdate {
+    bool     pending = false;
+    uint64_t atUs    = 0;
+    uint8_t  phy;
+};
+
+sim::BleCentral g_central;
+Link            g_link;
+ParamsUpdate    g_params;
+PhyUpdate       g_phy;
+int             g_linkTimer = -1;
+int             g_advTimer  = -1;
+bool            g_bonded    = false;
+const uint64_t  BOND_ADDR   = 0xC0FFEE123456ull;    // the bonded central
+
+uint64_t intervalUs() { return g_conn._interval * 1250ull; }
+
+// First connection event at or after t
+uint64_t nextEventUs(uint64_t t) {
+    if (g_params.pending && t >= g_params.atUs) return t;    // timer is about to move the anchor
+    uint64_t iv = intervalUs();
+    uint64_t ev = t <= g_link.anchorUs ? g_link.anchorUs
+                                       : g_link.anchorUs + (t - g_link.anchorUs + iv - 1) / iv * iv;
+    if (g_params.pending && ev > g_params.atUs) ev = g_params.atUs;
+    return ev;
+}
+
+// Whether the next LL PDU is lost to interference (sim::bleNoise)
+bool lost() {
+    if (!g_lossPct) return false;
+    g_lossSeed = g_lossSeed * 1664525u + 1013904223u;
+    return (g_lossSeed >> 8) % 100 < g_lossPct;
+}
+
+// One ATT notification as LL data PDUs from `at`, each followed by the
+// central's empty acknowledgement: preamble, access address, header, MIC and
+// CRC on both.  A lost PDU goes unacknowledged, which closes the connection
+// event; it is sent again at the next one.  Returns when the last is acked.
+uint64_t transmit(uint64_t at, uint16_t attLen) {
+    uint32_t byteNs   = g_link.phy == BLE_GAP_LE_PHY_2M ? 4000 : 8000;
+    uint32_t overhead = (g_link.phy == BLE_GAP_LE_PHY_2M ? 2 : 1) + 4 + 2 + 4 + 3;
+    uint32_t left     = attLen + 3 + 4;         // ATT opcode + handle, L2CAP header
+    while (left) {
+        uint32_t n = std::min<uint32_t>(left, g_link.dataLen);
+        while (lost()) at = nextEventUs(at + 1);
+        left -= n;
+        at += (n + overhead) * byteNs / 1000 + 150 + overhead * byteNs / 1000 + 150;
+    }
+    return at;
+}
+
+// A TX buffer whose notify has been acknowledged, or nullptr
+uint64_t* freeBuffer(uint64_t now) {
+    for (uint32_t i = 0; i < g_txBufs; i++)
+        if (g_link.bufUntilUs[i] <= now) return &g_link.bufUntilUs[i];
+    return nullptr;
+}
+
+void armLinkTimer() {
+    uint64_t at = kernel::NEVER;
+    if (g_params.pending) at = std::min(at, g_params.atUs);
+    if (g_phy.pending)    at = std::min(at, g_phy.atUs);
+    if (at == kernel::NEVER) {
+        if (g_linkTimer >= 0) kernel::timerRun(g_linkTimer, false);
+        return;
+    }
+    uint64_t now = kernel::nowUs();
+    kernel::timerArm(g_linkTimer, at > now ? at - now : 0, false);
+}
+
+// Timer ISR at an update instant; the real stack calls back from its host task
+void linkInstant() {
+    uint64_t               now = kernel::nowUs();
+    NimBLEServerCallbacks* cb  = g_server.callbacks();
+    if (g_params.pending && g_params.atUs <= now) {
+        g_params.pending = false;
+        g_conn._interval = g_params.interval;
+        g_conn._latency  = g_params.latency;
+        g_conn._timeout  = g_params.timeout;
+        g_link.anchorUs  = g_params.atUs;
+        if (cb) cb->onConnParamsUpdate(g_conn);
+    }
+    if (g_phy.pending && g_phy.atUs <= now) {
+        g_phy.pending = false;
+        g_link.phy    = g_phy.phy;
+        if (cb) cb->onPhyUpdate(g_conn, g_link.phy, g_link.phy);
+    }
+    armLinkTimer();
+}
+
+// A procedure started now completes UPDATE_EVENTS connection events later
+uint64_t instantUs() {
+    return nextEventUs(kernel::nowUs()) + sim::UPDATE_EVENTS * intervalUs();
+}
+
+void advTimeout() { g_adv.expire(); }
+
+} // namespace
+
+void bleReset() {
+    g_link      = Link();
+    g_txBufs    = sim::TX_BUFS;
+    g_lossPct   = 0;
+    g_params    = ParamsUpdate();
+    g_phy       = PhyUpdate();
+    g_linkTimer = -1;                           // kernel::reset() dropped it
+    g_advTimer  = -1;
+    g_adv.reset();
+}
+
+void NimBLECharacteristic::setValue(const uint8_t* data, size_t len) {
+    _len = std::min(len, MAX_VALUE);
+    memcpy(_value, data, _len);
+}
+
+std::string NimBLECharacteristic::getValue() const {
+    return std::string((const char*)_value, _len);
+}
+
+bool NimBLECharacteristic::notify() {
+    // A refused notify costs nothing and never reaches the client: every Nth
+    // on request, or any while all TX buffers wait for acknowledgements
+    uint64_t  now = sim::nowUs();
+    uint64_t* buf = g_link.up ? freeBuffer(now) : nullptr;
+    if ((g_failEvery && ++g_attempts % g_failEvery == 0) || (g_link.up && !buf)) {
+        g_refused++;
+        return false;
+    }
+    if (g_notifyLen < MAX_NOTIFY) {
+        sim::Notify& n = g_notify[g_notifyLen++];
+        n.tUs = now;
+        n.chr = this;
+        n.len = (uint16_t)std::min({ _len, sizeof(n.data), (size_t)(g_conn._mtu - 3) });
+        memcpy(n.data, _value, n.len);
+        n.hostUs = n.tUs;
+        if (g_link.up) {
+            uint64_t start = std::max(nextEventUs(n.tUs), g_link.radioFreeUs);
+            n.hostUs = g_link.radioFreeUs = *buf = transmit(start, n.len);
+        }
+    }
+    if (sim::costs().notifyUs) kernel::busyFor(sim::costs().notifyUs);
+    return true;
+}
+
+NimBLECharacteristic* NimBLEService::createCharacteristic(const char* uuid, uint16_t props) {
+    if (g_numChars >= MAX_CHARS) abort();
+    NimBLECharacteristic* c = &g_chars[g_numChars++];
+    c->_uuid  = uuid;
+    c->_props = props;
+    return c;
+}
+
+bool NimBLEServer::updateConnParams(uint16_t handle, uint16_t minInterval, uint16_t maxInterval,
+                                    uint16_t latency, uint16_t timeout) const {
+    if (!g_link.up || handle != g_conn._handle) return false;
+    if (!g_central.acceptParams) return true;            // sent; the central never answers
+
+    uint16_t interval = std::max(minInterval, g_central.minInterval);
+    if (interval > maxInterval) return true;             // central rejects the range
+    g_params = { true, instantUs(), interval, latency, timeout };
+    armLinkTimer();
+    return true;
+}
+
+bool NimBLEServer::updatePhy(uint16_t handle, uint8_t txPhyMask, uint8_t rxPhyMask, uint16_t) {
+    if (!g_link.up || handle != g_conn._handle) return false;
+    bool two = g_central.phy2M && (txPhyMask & rxPhyMask & BLE_GAP_LE_PHY_2M_MASK);
+    g_phy = { true, instantUs(), (uint8_t)(two ? BLE_GAP_LE_PHY_2M : BLE_GAP_LE_PHY_1M) };
+    armLinkTimer();
+    return true;
+}
+
+bool NimBLEServer::getPhy(uint16_t handle, uint8_t* txPhy, uint8_t* rxPhy) {
+    if (!g_link.up || handle != g_conn._handle) return false;
+    *txPhy = *rxPhy = g_link.phy;
+    return true;
+}
+
+// The length update is a single LL exchange; treat it as immediate
+bool NimBLEServer::setDataLen(uint16_t handle, uint16_t txOctets) const {
+    if (!g_link.up || handle != g_conn._handle) return false;
+    g_link.dataLen = std::max<uint16_t>(27, std::min(txOctets, g_central.maxDataLen));
+    return true;
+}
+
+NimBLEService* NimBLEServer::createService(const char*) {
+    if (g_numServices >= 8) abort();
+    return &g_services[g_numServices++];
+}
+
+void               NimBLEDevice::init(const char*)                {}
+void               NimBLEDevice::setSecurityAuth(bool, bool, bool) {}
+void               NimBLEDevice::setSecurityIOCap(uint8_t)        {}
+void               NimBLEDevice::setPower(int)                    {}
+NimBLEServer*      NimBLEDevice::createServer()                   { return &g_server; }
+NimBLEAdvertising* NimBLEDevice::getAdvertising()                 { return &g_adv; }
+int                NimBLEDevice::getNumBonds()                    { return g_bonded ? 1 : 0; }
+NimBLEAddress      NimBLEDevice::getBondedAddress(int index) {
+    return NimBLEAddress(g_bonded && index == 0 ? BOND_ADDR : 0);
+}
+
+// ── Advertising ──────────────────────────────────────────────────────────────
+void NimBLEAdvertising::reset() {
+    stop();
+    *this = NimBLEAdvertising();
+}
+
+bool NimBLEAdvertising::start(uint32_t duration, const NimBLEAddress* dirAddr) {
+    bool directed = _mode == BLE_GAP_CONN_MODE_DIR;
+    if (directed != (dirAddr && !dirAddr->isNull())) return false;
+    _active = true;
+    _peer   = directed ? dirAddr->_addr : 0;
+    if (g_advTimer < 0) g_advTimer = kernel::timerCreate(advTimeout);
+    if (duration) kernel::timerArm(g_advTimer, duration * 1000ull, false);
+    else          kernel::timerRun(g_advTimer, false);
+    return true;
+}
+
+bool NimBLEAdvertising::stop() {
+    _active = false;
+    _peer   = 0;
+    if (g_advTimer >= 0) kernel::timerRun(g_advTimer, false);
+    return true;
+}
+
+void NimBLEAdvertising::expire() {
+    if (!_active) return;
+    _active = false;
+    _peer   = 0;
+    if (_onComplete) _onComplete(this);
+}
+
+namespace sim {
+
+NimBLEServer* bleServer() { return &g_server; }
+
+void bleConnect(uint16_t mtu, const BleCentral& central) {
+    if (g_linkTimer < 0) g_linkTimer = kernel::timerCreate(linkInstant);
+    g_central        = central;
+    g_conn           = NimBLEConnInfo();
+    g_conn._interval = central.interval;
+    g_params         = ParamsUpdate();
+    g_phy            = PhyUpdate();
+    g_link           = Link();
+    g_link.up        = true;
+    g_adv.stop();                               // the stack ends advertising on connect
+    g_link.anchorUs  = kernel::nowUs();
+    armLinkTimer();
+    if (NimBLEServerCallbacks* cb = g_server.callbacks()) {
+        cb->onConnect(&g_server, g_conn);
+        if (mtu != g_conn._mtu) {
+            g_conn._mtu = mtu;
+            cb->onMTUChange(mtu, g_conn);
+        }
+    }
+}
+
+void bleDisconnect(int reason) {
+    g_link.up = false;
+    g_params  = ParamsUpdate();
+    g_phy     = PhyUpdate();
+    armLinkTimer();
+    if (NimBLEServerCallbacks* cb = g_server.callbacks()) cb->onDisconnect(&g_server, g_conn, reason);
+}
+
+void bleBond(bool bonded) { g_bonded = bonded; }
+
+const NimBLEConnInfo& bleLink()    { return g_conn; }
+uint8_t               blePhy()     { return g_link.phy; }
+uint16_t              bleDataLen() { return g_link.dataLen; }
+
+void bleSubscribe(const char* uuid, bool on) {
+    NimBLECharacteristic* c = bleFind(uuid);
+    if (c && c->callbacks()) c->callbacks()->onSubscribe(c, g_conn, on ? 1 : 0);
+}
+
+void bleWrite(const char* uuid, const uint8_t* data, size_t len) {
+    NimBLECharacteristic* c = bleFind(uuid);
+    if (!c) return;
+    c->setValue(data, len);
+    if (c->callbacks()) c->callbacks()->onWrite(c, g_conn);
+}
+
+NimBLECharacteristic* bleFind(const char* uuid) {
+    for (size_t i = 0; i < g_numChars; i++)
+        if (strcmp(g_chars[i].uuid(), uuid) == 0) return &g_chars[i];
+    return nullptr;
+}
+
+size_t        notifyCount()        { return g_notifyLen; }
+const Notify& notifyAt(size_t i)   { return g_notify[i]; }
+void          notifyClear()        { g_notifyLen = 0; }
+void          bleFailNotifies(uint32_t everyN) { g_failEvery = everyN; g_attempts = 0; }
+void          bleTxBuffers(uint32_t n)         { g_txBufs = std::min<uint32_t>(std::max<uint32_t>(n, 1), MAX_TX_BUFS); }
+void          bleNoise(uint32_t lossPct)       { g_lossPct = std::min<uint32_t>(lossPct, 90); g_lossSeed = 1; }
+uint32_t      notifyRefused()      { return g_refused; }
+
+} // namespace sim
+
+int os_msys_num_free() {
+    uint64_t now = sim::nowUs();
+    int      n   = 0;
+    for (uint32_t i = 0; i < g_txBufs; i++) n += !g_link.up || g_link.bufUntilUs[i] <= now;
+    return n;
+}
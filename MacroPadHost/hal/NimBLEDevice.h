@@ -0,0 +1,235 @@
+// =============================================================================
+// NimBLEDevice.h — Host-side stand-in for NimBLE-Arduino 2.x
+// Enough of the server API for BleService to compile and run.  Characteristic
+// values live in fixed buffers and every notify() is logged with its virtual
+// timestamp so the harness can measure press-to-notify latency.
+// =============================================================================
+#ifndef HOST_NIMBLE_DEVICE_H
+#define HOST_NIMBLE_DEVICE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <string>
+
+#define BLE_HS_IO_NO_INPUT_OUTPUT 3
+#define ESP_PWR_LVL_P9            7
+
+#define BLE_GAP_LE_PHY_1M         1
+#define BLE_GAP_LE_PHY_2M         2
+#define BLE_GAP_LE_PHY_CODED      3
+#define BLE_GAP_LE_PHY_1M_MASK    0x01
+#define BLE_GAP_LE_PHY_2M_MASK    0x02
+#define BLE_GAP_LE_PHY_CODED_MASK 0x04
+
+#define BLE_GAP_CONN_MODE_NON     0
+#define BLE_GAP_CONN_MODE_DIR     1
+#define BLE_GAP_CONN_MODE_UND     2
+
+namespace NIMBLE_PROPERTY {
+    static const uint16_t READ   = 0x0002;
+    static const uint16_t WRITE  = 0x0008;
+    static const uint16_t NOTIFY = 0x0010;
+}
+
+class NimBLEServer;
+class NimBLECharacteristic;
+
+class NimBLEAddress {
+public:
+    NimBLEAddress() = default;
+    explicit NimBLEAddress(uint64_t addr) : _addr(addr) {}
+    bool     isNull() const { return _addr == 0; }
+    uint64_t _addr = 0;
+};
+
+class NimBLEConnInfo {
+public:
+    uint16_t getConnHandle() const { return _handle; }
+    bool     isEncrypted()   const { return _encrypted; }
+    uint16_t getMTU()        const { return _mtu; }
+    uint16_t getConnInterval() const { return _interval; }
+    uint16_t getConnLatency()  const { return _latency; }
+    uint16_t getConnTimeout()  const { return _timeout; }
+
+    uint16_t _handle    = 1;
+    bool     _encrypted = true;
+    uint16_t _mtu       = 23;       // BLE default until an MTU exchange
+    uint16_t _interval  = 24;       // 1.25 ms units
+    uint16_t _latency   = 0;
+    uint16_t _timeout   = 400;      // 10 ms units
+};
+
+class NimBLEServerCallbacks {
+public:
+    virtual ~NimBLEServerCallbacks() = default;
+    virtual void onConnect(NimBLEServer*, NimBLEConnInfo&) {}
+    virtual void onDisconnect(NimBLEServer*, NimBLEConnInfo&, int) {}
+    virtual void onAuthenticationComplete(NimBLEConnInfo&) {}
+    virtual void onMTUChange(uint16_t, NimBLEConnInfo&) {}
+    virtual void onConnParamsUpdate(NimBLEConnInfo&) {}
+    virtual void onPhyUpdate(NimBLEConnInfo&, uint8_t, uint8_t) {}
+};
+
+class NimBLECharacteristicCallbacks {
+public:
+    virtual ~NimBLECharacteristicCallbacks() = default;
+    virtual void onWrite(NimBLECharacteristic*, NimBLEConnInfo&) {}
+    virtual void onRead(NimBLECharacteristic*, NimBLEConnInfo&) {}
+    virtual void onSubscribe(NimBLECharacteristic*, NimBLEConnInfo&, uint16_t) {}
+};
+
+class NimBLECharacteristic {
+public:
+    static const size_t MAX_VALUE = 512;
+
+    void        setValue(const uint8_t* data, size_t len);
+    std::string getValue() const;
+    bool        notify();
+    void        setCallbacks(NimBLECharacteristicCallbacks* cb) { _cb = cb; }
+
+    // Harness hooks
+    const char*                    uuid() const       { return _uuid; }
+    const uint8_t*                 data() const       { return _value; }
+    size_t                         length() const     { return _len; }
+    NimBLECharacteristicCallbacks* callbacks() const  { return _cb; }
+
+    const char* _uuid  = "";
+    uint16_t    _props = 0;
+
+private:
+    uint8_t _value[MAX_VALUE] = {};
+    size_t  _len = 0;
+    NimBLECharacteristicCallbacks* _cb = nullptr;
+};
+
+class NimBLEService {
+public:
+    NimBLECharacteristic* createCharacteristic(const char* uuid, uint16_t props);
+    void start() {}
+};
+
+class NimBLEServer {
+public:
+    NimBLEService* createService(const char* uuid);
+    void setCallbacks(NimBLEServerCallbacks* cb) { _cb = cb; }
+    NimBLEServerCallbacks* callbacks() const    { return _cb; }
+
+    // Link procedures: the simulated central answers them a few connection
+    // events later through onConnParamsUpdate / onPhyUpdate (see sim::BleCentral)
+    bool updateConnParams(uint16_t connHandle, uint16_t minInterval, uint16_t maxInterval,
+                          uint16_t latency, uint16_t timeout) const;
+    bool updatePhy(uint16_t connHandle, uint8_t txPhyMask, uint8_t rxPhyMask,
+                   uint16_t phyOptions = 0);
+    bool getPhy(uint16_t connHandle, uint8_t* txPhy, uint8_t* rxPhy);
+    bool setDataLen(uint16_t connHandle, uint16_t txOctets) const;
+
+private:
+    NimBLEServerCallbacks* _cb = nullptr;
+};
+
+// Advertising runs for `duration` ms (0 = until stopped or a central
+// connects), then calls the complete callback from a timer ISR; the real
+// stack calls it from its host task.  Directed advertising needs
+// BLE_GAP_CONN_MODE_DIR and the peer's address.
+class NimBLEAdvertising {
+public:
+    using advCompleteCB_t = std::function<void(NimBLEAdvertising*)>;
+
+    void reset();                          // stop; defaults, no callback
+    void addServiceUUID(const char*) {}
+    void enableScanResponse(bool) {}
+    void setPreferredParams(uint16_t, uint16_t) {}
+    void setAppearance(uint16_t) {}
+    void setMinInterval(uint16_t v)        { _min = v; }
+    void setMaxInterval(uint16_t v)        { _max = v; }
+    bool setConnectableMode(uint8_t mode)  { _mode = mode; return true; }
+    void setAdvertisingCompleteCallback(advCompleteCB_t cb) { _onComplete = cb; }
+    bool start(uint32_t duration = 0, const NimBLEAddress* dirAddr = nullptr);
+    bool stop();
+    bool isAdvertising() const { return _active; }
+
+    // Harness side
+    uint16_t minInterval() const { return _min; }     // 0.625 ms units
+    uint16_t maxInterval() const { return _max; }
+    bool     directed()    const { return _active && _peer; }
+    void     expire();                                // duration over
+
+private:
+    bool            _active = false;
+    uint8_t         _mode   = BLE_GAP_CONN_MODE_UND;
+    uint16_t        _min    = 32;                     // NimBLE's defaults: 20–30 ms
+    uint16_t        _max    = 48;
+    uint64_t        _peer   = 0;
+    advCompleteCB_t _onComplete;
+};
+
+class NimBLEDevice {
+public:
+    static void               init(const char* name);
+    static void               setSecurityAuth(bool bond, bool mitm, bool sc);
+    static void               setSecurityIOCap(uint8_t cap);
+    static void               setPower(int level);
+    static NimBLEServer*      createServer();
+    static NimBLEAdvertising* getAdvertising();
+    static int                getNumBonds();
+    static NimBLEAddress      getBondedAddress(int index);
+};
+
+// ── Harness side ─────────────────────────────────────────────────────────────
+namespace sim {
+
+struct Notify {
+    uint64_t                    tUs;           // notify() called
+    uint64_t                    hostUs;        // last packet acknowledged by the central
+    const NimBLECharacteristic* chr;
+    uint16_t                    len;
+    uint8_t                     data[244];     // ATT MTU 247 − 3
+};
+
+// The central on the other end of the link.  Notifies go out at the next
+// connection event and take air time for their LL fragments, so hostUs
+// depends on the interval, PHY and data length in effect.  Parameter and PHY
+// updates take effect UPDATE_EVENTS connection events after the request.
+struct BleCentral {
+    uint16_t interval    = 24;      // picked at connect, 1.25 ms units (30 ms)
+    uint16_t minInterval = 6;       // shortest it accepts (7.5 ms)
+    bool     acceptParams = true;   // false = ignores connection parameter requests
+    bool     phy2M       = true;
+    uint16_t maxDataLen  = 251;     // 27 = no data length extension
+};
+static const uint8_t UPDATE_EVENTS = 6;
+
+// notify() sends at most MTU − 3 bytes, like the real stack
+NimBLEServer*         bleServer();
+void                  bleConnect(uint16_t mtu = 23,   // onConnect, then onMTUChange
+                                 const BleCentral& central = BleCentral());
+void                  bleDisconnect(int reason = 0x13);
+void                  bleBond(bool bonded);           // one bonded central, or none
+const NimBLEConnInfo& bleLink();                      // parameters in effect
+uint8_t               blePhy();                       // BLE_GAP_LE_PHY_*
+uint16_t              bleDataLen();                   // LL payload octets in effect
+void                  bleSubscribe(const char* uuid, bool on);
+void                  bleWrite(const char* uuid, const uint8_t* data, size_t len);   // onWrite
+NimBLECharacteristic* bleFind(const char* uuid);
+size_t                notifyCount();
+const Notify&         notifyAt(size_t i);
+void                  notifyClear();
+// Make every Nth notify() return false, as NimBLE does when it is out of
+// mbufs; 0 turns it off.
+void                  bleFailNotifies(uint32_t everyN);
+uint32_t              notifyRefused();
+// The stack's TX buffers (NimBLE's msys mbufs): each notify holds one until
+// the central acknowledges it, and notify() is refused while none is free.
+// TX_BUFS at reset; a disconnect frees them all.
+static const uint32_t TX_BUFS = 12;
+void                  bleTxBuffers(uint32_t n);
+// Lose this share of LL PDUs to interference (0 = clean, at most 90); each
+// loss ends the connection event and the PDU waits for the next one
+void                  bleNoise(uint32_t lossPct);
+
+} // namespace sim
+
+// NimBLE's count of free msys mbufs (os/os_mbuf.h): here, free TX buffers
+int os_msys_num_free();
+
+#endif // HOST_NIMBLE_DEVICE_H
@@ -0,0 +1,77 @@
+// =============================================================================
+// NimBLEHIDDevice.cpp — Host-side NimBLE HID device stand-in
+// =============================================================================
+#include <NimBLEHIDDevice.h>
+
+namespace {
+NimBLEHIDDevice* g_hid = nullptr;
+}
+
+NimBLEHIDDevice::NimBLEHIDDevice(NimBLEServer* server) {
+    _devInfoSvc   = server->createService("180a");
+    _manufacturer = _devInfoSvc->createCharacteristic("2a29", NIMBLE_PROPERTY::READ);
+    _pnp          = _devInfoSvc->createCharacteristic("2a50", NIMBLE_PROPERTY::READ);
+
+    _hidSvc       = server->createService("1812");
+    _hidInfo      = _hidSvc->createCharacteristic("2a4a", NIMBLE_PROPERTY::READ);
+    _reportMap    = _hidSvc->createCharacteristic("2a4b", NIMBLE_PROPERTY::READ);
+    _hidControl   = _hidSvc->createCharacteristic("2a4c", NIMBLE_PROPERTY::WRITE);
+    _protocolMode = _hidSvc->createCharacteristic("2a4e",
+                        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE);
+    uint8_t report = 1;
+    _protocolMode->setValue(&report, 1);
+
+    _battSvc = server->createService("180f");
+    _battLvl = _battSvc->createCharacteristic("2a19",
+                   NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+    g_hid = this;
+}
+
+void NimBLEHIDDevice::setReportMap(uint8_t* map, uint16_t len) { _reportMap->setValue(map, len); }
+
+void NimBLEHIDDevice::setManufacturer(const std::string& name) {
+    _manufacturer->setValue((const uint8_t*)name.data(), name.size());
+}
+
+void NimBLEHIDDevice::setPnp(uint8_t sig, uint16_t vid, uint16_t pid, uint16_t version) {
+    const uint8_t v[7] = { sig, (uint8_t)vid, (uint8_t)(vid >> 8), (uint8_t)pid,
+                           (uint8_t)(pid >> 8), (uint8_t)version, (uint8_t)(version >> 8) };
+    _pnp->setValue(v, sizeof(v));
+}
+
+void NimBLEHIDDevice::setHidInfo(uint8_t country, uint8_t flags) {
+    const uint8_t v[4] = { 0x11, 0x01, country, flags };   // bcdHID 1.11
+    _hidInfo->setValue(v, sizeof(v));
+}
+
+void NimBLEHIDDevice::setBatteryLevel(uint8_t level, bool notify) {
+    _battLvl->setValue(&level, 1);
+    if (notify) _battLvl->notify();
+}
+
+NimBLECharacteristic* NimBLEHIDDevice::getInputReport(uint8_t reportId) {
+    for (uint8_t i = 0; i < MAX_REPORTS; i++) {
+        if (_input[i] && _inputId[i] == reportId) return _input[i];
+        if (!_input[i]) {
+            _input[i]   = _hidSvc->createCharacteristic("2a4d",
+                              NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+            _inputId[i] = reportId;
+            return _input[i];
+        }
+    }
+    abort();
+}
+
+NimBLECharacteristic* NimBLEHIDDevice::findInputReport(uint8_t reportId) const {
+    for (uint8_t i = 0; i < MAX_REPORTS; i++)
+        if (_input[i] && _inputId[i] == reportId) return _input[i];
+    return nullptr;
+}
+
+namespace sim {
+
+NimBLECharacteristic* bleHidInput(uint8_t reportId) {
+    return g_hid ? g_hid->findInputReport(reportId) : nullptr;
+}
+
+} // namespace sim
@@ -0,0 +1,55 @@
+// =============================================================================
+// NimBLEHIDDevice.h — Host-side stand-in for NimBLE-Arduino 2.x HID device
+// Creates the Device Information, HID and Battery services the way the
+// library does; input reports are ordinary characteristics, so their
+// notifies land in the same log as everything else.
+// =============================================================================
+#ifndef HOST_NIMBLE_HID_DEVICE_H
+#define HOST_NIMBLE_HID_DEVICE_H
+
+#include "NimBLEDevice.h"
+
+class NimBLEHIDDevice {
+public:
+    explicit NimBLEHIDDevice(NimBLEServer* server);
+
+    void setReportMap(uint8_t* map, uint16_t len);
+    void setManufacturer(const std::string& name);
+    void setPnp(uint8_t sig, uint16_t vid, uint16_t pid, uint16_t version);
+    void setHidInfo(uint8_t country, uint8_t flags);
+    void setBatteryLevel(uint8_t level, bool notify = false);
+    void startServices() {}
+
+    NimBLECharacteristic* getInputReport(uint8_t reportId);
+    NimBLECharacteristic* getBatteryLevel() { return _battLvl; }
+    NimBLEService*        getHidService()   { return _hidSvc; }
+
+    // Harness hook: the input report for an id, without creating one
+    NimBLECharacteristic* findInputReport(uint8_t reportId) const;
+
+private:
+    static const uint8_t MAX_REPORTS = 4;
+
+    NimBLEService*        _devInfoSvc;
+    NimBLEService*        _hidSvc;
+    NimBLEService*        _battSvc;
+    NimBLECharacteristic* _manufacturer;
+    NimBLECharacteristic* _pnp;
+    NimBLECharacteristic* _hidInfo;
+    NimBLECharacteristic* _reportMap;
+    NimBLECharacteristic* _hidControl;
+    NimBLECharacteristic* _protocolMode;
+    NimBLECharacteristic* _battLvl;
+    NimBLECharacteristic* _input[MAX_REPORTS] = {};
+    uint8_t               _inputId[MAX_REPORTS] = {};
+};
+
+// ── Harness side ─────────────────────────────────────────────────────────────
+namespace sim {
+
+// Input report characteristic for a report id, nullptr if never created
+NimBLECharacteristic* bleHidInput(uint8_t reportId);
+
+} // namespace sim
+
+#endif // HOST_NIMBLE_HID_DEVICE_H
@@ -0,0 +1,116 @@
+// =============================================================================
+// Sim.h — Harness control of the simulated board
+// Virtual clock, scripted pin waveforms, key-matrix wiring, serial RX/TX taps.
+// Nothing here allocates once a scenario has been scripted, so heap counters
+// taken around loop() only see what the firmware itself does.
+// =============================================================================
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <Arduino.h>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+static const uint8_t  NUM_PINS     = 64;       // ESP32-S3 has GPIO 0–48
+static const uint32_t TX_CAPACITY  = 1u << 20;
+static const uint32_t RX_CAPACITY  = 1u << 16;
+static const uint32_t STROBE_CAPACITY = 1u << 18;
+
+// ── Clock ────────────────────────────────────────────────────────────────────
+// advanceUs() runs due events and ISRs on the way.  Once the firmware has
+// created FreeRTOS tasks it also lets them run, by priority, until the target
+// time; before that it just moves the clock.
+uint64_t nowUs();
+void     advanceUs(uint64_t us);
+bool     tasksRunning();
+
+// What is running on the board right now: "ISR" inside an interrupt, else
+// the FreeRTOS task's name, or nullptr on the harness's own context (scripting,
+// setup(), decoding).  The bench's heap tracker blames allocations with it.
+const char* firmwareContext();
+
+// ── Scripted waveforms ───────────────────────────────────────────────────────
+// A level event drives an input pin that is wired to ground through a switch
+// (encoder A/B, encoder button).  A switch event closes or opens the contact
+// between a matrix row pin and a column pin.
+void scheduleLevel(uint64_t atUs, uint8_t pin, uint8_t level);
+void scheduleSwitch(uint64_t atUs, uint8_t rowPin, uint8_t colPin, bool closed);
+bool eventsPending();
+void clearSchedule();
+
+// Immediate versions (no clock movement)
+void setLevel(uint8_t pin, uint8_t level);
+void setSwitch(uint8_t rowPin, uint8_t colPin, bool closed);
+
+// ── Serial taps ──────────────────────────────────────────────────────────────
+// Host → device bytes, read back by Serial.available()/read()/readBytes().
+void     hostWrite(const uint8_t* data, size_t len);
+uint32_t rxReadCalls();                 // read() + readBytes() calls, cumulative
+
+// Device → host bytes, each stamped with the virtual time it left the wire.
+struct TxByte {
+    uint64_t tUs;
+    uint8_t  b;
+};
+size_t        txCount();
+const TxByte& txAt(size_t i);
+void          txClear();
+uint32_t      txWriteCalls();           // number of Stream::write() calls
+
+// ── Transport costs ──────────────────────────────────────────────────────────
+// Virtual time a call keeps the CPU busy.  All zero by default; scenarios that
+// model a slow UART or a congested BLE link set them.
+struct Costs {
+    uint32_t serialWriteUs = 0;         // per Stream::write() call
+    uint32_t serialByteNs  = 0;         // wire time per byte (86 805 ≈ 115200 baud)
+    uint32_t serialTxFifo  = 256;       // driver TX buffer, bytes
+    uint32_t serialReadUs  = 0;         // per read() / readBytes() call
+    uint32_t notifyUs      = 0;         // per NimBLECharacteristic::notify()
+    uint32_t analogReadUs  = 0;         // per analogRead()
+    uint32_t sleepExitUs   = 0;         // tickless light sleep → running again
+    uint32_t sleepMinUs    = 3000;      // shortest idle worth a light sleep
+};
+void         setCosts(const Costs& c);
+const Costs& costs();
+
+// ── ADC ──────────────────────────────────────────────────────────────────────
+// What analogRead() returns on a pin (2600 by default, ≈ 4.2 V behind a 1:2
+// divider), and how many conversions it has done, cumulative.
+void     setAnalog(uint8_t pin, uint16_t raw);
+uint32_t analogReads();
+
+// ── Scan strobe ──────────────────────────────────────────────────────────────
+// Records the interval between successive HIGH→LOW writes of one pin — with a
+// matrix row pin this is the input sampling period.
+void     watchStrobe(uint8_t pin);
+void     strobeClear();
+size_t   strobeCount();
+uint32_t strobeIntervalAt(size_t i);    // µs
+
+// ── CPU time ─────────────────────────────────────────────────────────────────
+// Time with no task ready is idle.  The board runs FreeRTOS tickless idle: an
+// idle stretch light-sleeps when nothing holds a power-management lock (a
+// running hw_timer_t does) and no task is due within Costs::sleepMinUs;
+// otherwise the CPU just waits for an interrupt.  Leaving a light sleep costs
+// Costs::sleepExitUs before the woken task runs.  esp_light_sleep_start()
+// counts as light sleep too.  All counts are cumulative.
+struct CpuTime {
+    uint64_t idleUs;                    // waiting for an interrupt
+    uint64_t sleepUs;                   // light sleep
+    uint32_t wakeups;                   // idle → a task running
+    uint32_t sleepExits;
+};
+CpuTime cpuTime();
+
+// ── Counters ─────────────────────────────────────────────────────────────────
+uint32_t isrCalls();
+uint32_t sleepCount();                  // esp_light_sleep_start() calls
+
+// Reset everything except the clock (which only moves forward).
+void reset();
+
+} // namespace sim
+
+#endif // HOST_SIM_H
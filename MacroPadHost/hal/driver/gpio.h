@@ -0,0 +1,27 @@
+// =============================================================================
+// driver/gpio.h — Host-side stand-in for the ESP-IDF GPIO driver
+// =============================================================================
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+#include <cstdint>
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE    = 0,
+    GPIO_INTR_POSEDGE    = 1,
+    GPIO_INTR_NEGEDGE    = 2,
+    GPIO_INTR_ANYEDGE    = 3,
+    GPIO_INTR_LOW_LEVEL  = 4,
+    GPIO_INTR_HIGH_LEVEL = 5,
+} gpio_int_type_t;
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio, gpio_int_type_t type);
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio);
+esp_err_t gpio_set_intr_type(gpio_num_t gpio, gpio_int_type_t type);
+
+#endif // HOST_DRIVER_GPIO_H
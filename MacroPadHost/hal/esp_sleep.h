@@ -0,0 +1,22 @@
+// =============================================================================
+// esp_sleep.h — Host-side stand-in for ESP-IDF light sleep
+// esp_light_sleep_start() runs the virtual clock through the scripted events
+// until a wake-enabled pin sits at its level; ISRs run on the way, tasks only
+// once it returns.
+// =============================================================================
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include "driver/gpio.h"
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_TIMER     = 4,
+    ESP_SLEEP_WAKEUP_GPIO      = 7,
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t                esp_sleep_enable_gpio_wakeup();
+esp_err_t                esp_light_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+
+#endif // HOST_ESP_SLEEP_H
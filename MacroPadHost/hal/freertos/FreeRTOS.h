@@ -0,0 +1,28 @@
+// =============================================================================
+// freertos/FreeRTOS.h — Host-side stand-in for the ESP-IDF FreeRTOS port
+// Scheduling is simulated on the virtual clock (see Kernel.h); 1 tick = 1 ms.
+// =============================================================================
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <cstdint>
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE             ((BaseType_t)0)
+#define pdTRUE              ((BaseType_t)1)
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define errQUEUE_FULL       ((BaseType_t)0)
+#define errQUEUE_EMPTY      ((BaseType_t)0)
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS  ((TickType_t)1)
+#define configTICK_RATE_HZ  1000
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+#define portYIELD_FROM_ISR(woken)  ((void)(woken))
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,18 @@
+// =============================================================================
+// freertos/queue.h — Host-side stand-in for FreeRTOS queues
+// =============================================================================
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+struct SimQueue;
+typedef SimQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t    xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks);
+BaseType_t    xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken);
+BaseType_t    xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t q);
+
+#endif // HOST_FREERTOS_QUEUE_H
@@ -0,0 +1,23 @@
+// =============================================================================
+// freertos/task.h — Host-side stand-in for FreeRTOS tasks and notifications
+// =============================================================================
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+struct SimTask;
+typedef SimTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t  xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackBytes,
+                        void* arg, UBaseType_t prio, TaskHandle_t* handle);
+void        vTaskDelete(TaskHandle_t task);
+void        vTaskDelay(TickType_t ticks);
+TickType_t  xTaskGetTickCount();
+
+uint32_t    ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t  xTaskNotifyGive(TaskHandle_t task);
+void        vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,11 @@
+// =============================================================================
+// soc/gpio_reg.h — Host-side stand-in for the ESP32-C3 / S3 GPIO register map
+// =============================================================================
+#ifndef HOST_SOC_GPIO_REG_H
+#define HOST_SOC_GPIO_REG_H
+
+#define DR_REG_GPIO_BASE  0x60004000
+#define GPIO_IN_REG       (DR_REG_GPIO_BASE + 0x3C)   // GPIO 0–31
+#define GPIO_IN1_REG      (DR_REG_GPIO_BASE + 0x40)   // GPIO 32+ (ESP32-S3)
+
+#endif // HOST_SOC_GPIO_REG_H
@@ -0,0 +1,14 @@
+// =============================================================================
+// soc/soc.h — Host-side stand-in for ESP32 register access macros
+// Only the GPIO input register is modelled; it reflects the simulated pins.
+// =============================================================================
+#ifndef HOST_SOC_SOC_H
+#define HOST_SOC_SOC_H
+
+#include <cstdint>
+
+uint32_t hostRegRead(uint32_t reg);
+
+#define REG_READ(reg) hostRegRead((uint32_t)(reg))
+
+#endif // HOST_SOC_SOC_H
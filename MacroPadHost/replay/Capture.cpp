@@ -0,0 +1,85 @@
+// =============================================================================
+// Capture.cpp — PKT_CAPTURE records on the host, and the .mpcap file that keeps them
+// =============================================================================
+#include "Capture.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace replay {
+
+static const char    MAGIC[5]     = { 'M', 'P', 'C', 'A', 'P' };
+static const uint8_t HEADER_BYTES = 10;
+
+static uint16_t recordBytes(uint16_t keys) { return (uint16_t)(5 + (keys + 7) / 8); }
+
+// The next u32 stamp after `prev`, on the 64-bit line
+static uint64_t widen(uint32_t us, const std::vector<Record>& out) {
+    if (out.empty()) return us;
+    uint64_t prev = out.back().tUs;
+    return prev + (uint32_t)(us - (uint32_t)prev);
+}
+
+static bool records(const uint8_t* p, size_t n, uint16_t keys, std::vector<Record>& out) {
+    uint16_t size = recordBytes(keys);
+    for (size_t i = 0; i < n; i++, p += size) {
+        Record r = {};
+        uint32_t t = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        r.tUs    = widen(t, out);
+        r.levels = p[4];
+        memcpy(r.keys, p + 5, size - 5);
+        out.push_back(r);
+    }
+    return true;
+}
+
+bool unpack(const uint8_t* d, uint16_t len, uint16_t keys, std::vector<Record>& out) {
+    if (len < 2 || d[1] != (uint8_t)keys || keys > MAX_KEYS) return false;
+    if (len < 2 + (size_t)d[0] * recordBytes(keys)) return false;
+    return records(d + 2, d[0], keys, out);
+}
+
+bool save(const char* path, const Header& h, const std::vector<Record>& recs) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    const uint8_t head[HEADER_BYTES] = { 'M', 'P', 'C', 'A', 'P', FILE_VERSION, h.rows, h.cols,
+                                         (uint8_t)(h.rateHz >> 8), (uint8_t)h.rateHz };
+    bool     ok   = fwrite(head, 1, sizeof(head), f) == sizeof(head);
+    uint16_t size = recordBytes(h.keys());
+    uint8_t  rec[5 + MAX_KEYS / 8];
+    for (size_t i = 0; ok && i < recs.size(); i++) {
+        uint32_t t = (uint32_t)recs[i].tUs;
+        rec[0] = (uint8_t)(t >> 24);
+        rec[1] = (uint8_t)(t >> 16);
+        rec[2] = (uint8_t)(t >> 8);
+        rec[3] = (uint8_t)t;
+        rec[4] = recs[i].levels;
+        memcpy(rec + 5, recs[i].keys, size - 5);
+        ok = fwrite(rec, 1, size, f) == size;
+    }
+    return fclose(f) == 0 && ok;
+}
+
+bool load(const char* path, Header& h, std::vector<Record>& recs) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> bytes;
+    uint8_t buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+
+    if (bytes.size() < HEADER_BYTES || memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0 ||
+        bytes[5] != FILE_VERSION)
+        return false;
+    h.rows   = bytes[6];
+    h.cols   = bytes[7];
+    h.rateHz = (uint16_t)(bytes[8] << 8 | bytes[9]);
+    if (h.keys() > MAX_KEYS) return false;
+
+    size_t body = bytes.size() - HEADER_BYTES, size = recordBytes(h.keys());
+    if (body % size) return false;                       // cut short
+    recs.clear();
+    return records(bytes.data() + HEADER_BYTES, body / size, h.keys(), recs);
+}
+
+} // namespace replay
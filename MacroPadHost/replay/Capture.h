@@ -0,0 +1,45 @@
+// =============================================================================
+// Capture.h — PKT_CAPTURE records on the host, and the .mpcap file that keeps them
+// A capture file is a small header followed by the records exactly as they
+// came off the wire (PinCapture.h):
+//   "MPCAP" [version] [rows] [cols] [capture rate Hz, u16 BE]
+//   then [t µs, u32 BE] [levels] [raw keys, ⌈rows·cols/8⌉ bytes, LSB first] …
+// Timestamps are widened to 64 bits on the way in, each against the record
+// before it, so a capture may run past the device's micros() wrap.
+// =============================================================================
+#ifndef REPLAY_CAPTURE_H
+#define REPLAY_CAPTURE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace replay {
+
+static const uint8_t  FILE_VERSION  = 1;
+static const uint16_t MAX_KEYS      = 256;
+
+struct Header {
+    uint8_t  rows   = 0;
+    uint8_t  cols   = 0;
+    uint16_t rateHz = 0;
+    uint16_t keys() const { return (uint16_t)(rows * cols); }
+};
+
+struct Record {
+    uint64_t tUs;
+    uint8_t  levels;                  // CAP_* | A, B, button (1 = HIGH)
+    uint8_t  keys[MAX_KEYS / 8];      // raw closed contacts, bit i = key index i
+
+    bool key(uint16_t i) const { return (keys[i >> 3] >> (i & 7)) & 1; }
+};
+
+// One PKT_CAPTURE payload onto `out`.  False when the payload is short or
+// its key count is not `keys`; nothing is appended then.
+bool unpack(const uint8_t* d, uint16_t len, uint16_t keys, std::vector<Record>& out);
+
+bool save(const char* path, const Header& h, const std::vector<Record>& recs);
+bool load(const char* path, Header& h, std::vector<Record>& recs);
+
+} // namespace replay
+
+#endif
@@ -0,0 +1,442 @@
+// =============================================================================
+// Replay.cpp — Offline replay of a raw pin capture through the firmware's input code
+//
+// Feeds a .mpcap file (Capture.h, saved by `macropad_bench --save-capture`
+// or by the app from PKT_CAPTURE frames) back through the unmodified
+// KeyMatrix and RotaryEncoder on the simulated board: every recorded level
+// change becomes a scripted switch or level edge at its captured time, and
+// the scan runs once a millisecond as on the device.  Each capture segment
+// (CAP_FIRST … CAP_LAST) replays on its own, from the levels it found.
+//
+// Keys replay once per debounce setting and are scored against a reference
+// read off the raw samples: a contact level held at least --hold-ms is a
+// real transition, dated at the first edge of the burst that led to it.
+// Each reference transition wants exactly one event of its kind before the
+// next one; none is a missed event, any more are false ones.  The encoder
+// replays once per sensitivity, at the configured report rate.
+//
+// Usage: macropad_replay FILE [--debounce MS[,MS…]] [--hold-ms MS] [--eager]
+//                             [--sensitivity N[,N…]]
+// =============================================================================
+#include "Capture.h"
+
+#include <Arduino.h>
+#include "Sim.h"
+#include "Config.h"
+#include "EventRing.h"
+#include "KeyMatrix.h"
+#include "Encoder.h"
+#include "PinCapture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using replay::Header;
+using replay::Record;
+
+namespace {
+
+static const uint16_t DEFAULT_DEBOUNCES[] = { 0, 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25, 30 };
+static const uint32_t SCAN_US   = 1000000 / SCAN_RATE_HZ;
+static const uint32_t WARMUP_US = 300000;              // longer than any debounce window
+
+static const uint8_t BTN_BIT = 0x01;
+static const uint8_t B_BIT   = 0x02;
+static const uint8_t A_BIT   = 0x04;
+
+struct Options {
+    const char*           path   = nullptr;
+    std::vector<uint16_t> debounces;
+    std::vector<uint16_t> sensitivities;
+    uint32_t              holdUs = 30000;
+    bool                  eager  = false;
+};
+
+struct Segment {
+    size_t first, last;                  // record indices, inclusive
+    bool   lost;                         // a record inside carries CAP_LOST
+};
+
+// ── Reference transitions off the raw samples ────────────────────────────────
+struct Transition {
+    uint64_t tUs;                        // first edge of the burst
+    bool     level;                      // new level: closed / pressed
+};
+
+struct Reference {
+    std::vector<Transition> t;
+    bool     initial;
+    uint64_t settledUntil;               // an unsettled tail starts here
+};
+
+template <class Level>
+Reference reference(const std::vector<Record>& recs, const Segment& s, uint32_t holdUs, Level level) {
+    Reference ref;
+    ref.initial = level(recs[s.first]);
+    ref.settledUntil = recs[s.last].tUs;
+
+    bool     stable = ref.initial, cur = ref.initial, inBurst = false;
+    uint64_t since  = recs[s.first].tUs, burst = 0;
+    for (size_t i = s.first + 1; i <= s.last + 1; i++) {
+        bool end = i > s.last;
+        bool l   = end ? cur : level(recs[i]);
+        if (!end && l == cur) continue;
+        uint64_t t = end ? recs[s.last].tUs : recs[i].tUs;
+
+        // The run of `cur` from `since` to `t` is over
+        if (t - since >= holdUs) {
+            if (cur != stable) ref.t.push_back({ burst, cur });
+            stable  = cur;
+            inBurst = false;
+        }
+        if (end) {
+            if (inBurst) ref.settledUntil = burst;
+            break;
+        }
+        if (!inBurst) { burst = t; inBurst = true; }
+        cur   = l;
+        since = t;
+    }
+    return ref;
+}
+
+// ── Scoring ──────────────────────────────────────────────────────────────────
+struct Seen {
+    uint64_t stampUs;                    // event capture stamp
+    uint64_t pushUs;                     // when it reached the ring
+    bool     level;
+};
+
+struct Score {
+    uint32_t events = 0, missed = 0, falses = 0;
+    std::vector<double> latMs;
+
+    void add(const Score& o) {
+        events += o.events; missed += o.missed; falses += o.falses;
+        latMs.insert(latMs.end(), o.latMs.begin(), o.latMs.end());
+    }
+};
+
+// Reference transition j owns the events stamped in [T_j, T_j+1), shifted
+// back one scan: a scan can start just before the edge it sees.
+Score score(const Reference& ref, const std::vector<Seen>& seen) {
+    Score sc;
+    std::vector<uint32_t> hits(ref.t.size()), other(ref.t.size());
+    for (const Seen& e : seen) {
+        if (e.stampUs + SCAN_US >= ref.settledUntil) continue;
+        sc.events++;
+        size_t j = ref.t.size();
+        for (size_t i = 0; i < ref.t.size() && ref.t[i].tUs <= e.stampUs + SCAN_US; i++) j = i;
+        if (j == ref.t.size()) { sc.falses++; continue; }           // before any transition
+        if (e.level != ref.t[j].level) { other[j]++; continue; }
+        if (hits[j]++ == 0) sc.latMs.push_back((double)(e.pushUs - ref.t[j].tUs) / 1000.0);
+    }
+    for (size_t j = 0; j < ref.t.size(); j++) {
+        if (!hits[j]) sc.missed++;
+        sc.falses += other[j] + (hits[j] ? hits[j] - 1 : 0);
+    }
+    return sc;
+}
+
+double pct(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(p / 100.0 * (v.size() - 1) + 0.5)];
+}
+
+// ── Replaying the pins ───────────────────────────────────────────────────────
+// Segment time t plays at base + (t − first record), on the virtual clock.
+void script(const std::vector<Record>& recs, const Segment& s, uint64_t base) {
+    const Record& r0 = recs[s.first];
+    for (uint16_t k = 0; k < NUM_KEYS; k++)
+        sim::setSwitch(ROW_PINS[k / NUM_COLS], COL_PINS[k % NUM_COLS], r0.key(k));
+    sim::setLevel(ENC_A_PIN,   (r0.levels & A_BIT)   ? HIGH : LOW);
+    sim::setLevel(ENC_B_PIN,   (r0.levels & B_BIT)   ? HIGH : LOW);
+    sim::setLevel(ENC_BTN_PIN, (r0.levels & BTN_BIT) ? HIGH : LOW);
+
+    for (size_t i = s.first + 1; i <= s.last; i++) {
+        const Record& a = recs[i - 1];
+        const Record& b = recs[i];
+        uint64_t      t = base + (b.tUs - r0.tUs);
+        for (uint16_t k = 0; k < NUM_KEYS; k++)
+            if (a.key(k) != b.key(k))
+                sim::scheduleSwitch(t, ROW_PINS[k / NUM_COLS], COL_PINS[k % NUM_COLS], b.key(k));
+        static const uint8_t BITS[3] = { A_BIT, B_BIT, BTN_BIT };
+        static const uint8_t PINS[3] = { ENC_A_PIN, ENC_B_PIN, ENC_BTN_PIN };
+        for (int p = 0; p < 3; p++)
+            if ((a.levels ^ b.levels) & BITS[p])
+                sim::scheduleLevel(t, PINS[p], (b.levels & BITS[p]) ? HIGH : LOW);
+    }
+}
+
+void drain(EventRing& ring, std::vector<InputEvent>& out) {
+    InputEvent e;
+    while (ring.pop(e)) out.push_back(e);
+}
+
+// Settle on the levels the capture found for WARMUP_US, dropping what that
+// reports, then `start` and one scan per SCAN_US from `base` to `end`
+template <class Scan, class Start>
+void runScans(uint64_t base, uint64_t end, EventRing& ring, std::vector<InputEvent>& out,
+              Scan scan, Start start) {
+    for (uint64_t t = base - WARMUP_US; t < base; t += SCAN_US) {
+        sim::advanceUs(t - sim::nowUs());
+        scan();
+        drain(ring, out);
+    }
+    out.clear();
+    start();
+    for (uint64_t t = base; t <= end; t += SCAN_US) {
+        sim::advanceUs(t - sim::nowUs());
+        scan();
+        drain(ring, out);
+    }
+}
+
+// Device stamps are micros(); put them back on the virtual clock
+uint64_t widen(uint32_t us) {
+    uint64_t now = sim::nowUs(), t = (now & ~0xFFFFFFFFull) | us;
+    return t > now ? t - (1ull << 32) : t;
+}
+
+// One segment through a fresh KeyMatrix; key events per key
+void replayKeys(const std::vector<Record>& recs, const Segment& s, uint16_t debounce,
+                bool eager, std::vector<std::vector<Seen>>& seen) {
+    sim::reset();
+    uint64_t base = sim::nowUs() + WARMUP_US;
+    script(recs, s, base);
+
+    static EventRing ring;
+    ring.begin();
+    KeyMatrix km;
+    km.setAdaptiveDebounce(false);          // one fixed window per row of the table
+    km.setDebounceMs(debounce);
+    km.setEagerPress(eager);
+    km.begin();
+    km.setEventRing(&ring);
+
+    std::vector<InputEvent> evts;
+    uint64_t end = base + (recs[s.last].tUs - recs[s.first].tUs) + (debounce + 2) * 1000ull;
+    runScans(base, end, ring, evts, [&km] { km.scan(); }, [] {});
+
+    seen.assign(NUM_KEYS, {});
+    for (const InputEvent& e : evts) {
+        if (e.id >= NUM_KEYS) continue;
+        uint64_t stamp = widen(e.tUs);
+        seen[e.id].push_back({ stamp - base + recs[s.first].tUs,
+                               stamp + e.queuedUs - base + recs[s.first].tUs,
+                               e.type == EVT_KEY_PRESS });
+    }
+}
+
+struct EncoderResult {
+    int32_t  refPos    = 0;              // net quadrature count off the samples
+    uint32_t refIllegal = 0;             // both channels changed between samples
+    int32_t  steps     = 0;              // net reported steps
+    uint32_t rotates   = 0;
+    uint32_t reversals = 0;              // one event against the spin on both sides
+    std::vector<Seen> button;
+};
+
+void replayEncoder(const std::vector<Record>& recs, const Segment& s, uint8_t sensitivity,
+                   EncoderResult& out) {
+    static const int8_t TABLE[16] = { 0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0 };
+    for (size_t i = s.first + 1; i <= s.last; i++) {
+        uint8_t a = (recs[i - 1].levels >> 1) & 3, b = (recs[i].levels >> 1) & 3;
+        if (a == b) continue;
+        if ((a ^ b) == 3) out.refIllegal++;
+        out.refPos += TABLE[a << 2 | b];
+    }
+
+    sim::reset();
+    uint64_t base = sim::nowUs() + WARMUP_US;
+    script(recs, s, base);
+
+    static EventRing ring;
+    ring.begin();
+    // The quadrature count is static across instances: warm up reporting
+    // every count, so no remainder from an earlier replay carries over
+    RotaryEncoder enc;
+    enc.begin();
+    enc.setSensitivity(1);
+    enc.setEventRing(&ring);
+
+    std::vector<InputEvent> evts;
+    uint64_t end = base + (recs[s.last].tUs - recs[s.first].tUs) + (DEFAULT_DEBOUNCE_MS + 2) * 1000ull;
+    runScans(base, end, ring, evts, [&enc] { enc.update(); },
+             [&enc, sensitivity] { enc.setSensitivity(sensitivity); });
+
+    std::vector<int8_t> dirs;
+    for (const InputEvent& e : evts) {
+        uint64_t stamp = widen(e.tUs);
+        if (e.type == EVT_ENCODER_ROTATE) {
+            int8_t dir = e.value == DIR_CW ? 1 : -1;
+            out.steps += dir * e.steps;
+            out.rotates++;
+            dirs.push_back(dir);
+        } else {
+            out.button.push_back({ stamp - base + recs[s.first].tUs,
+                                   stamp + e.queuedUs - base + recs[s.first].tUs,
+                                   e.type == EVT_ENCODER_BTN_PRESS });
+        }
+    }
+    for (size_t i = 1; i + 1 < dirs.size(); i++)
+        if (dirs[i] != dirs[i - 1] && dirs[i] != dirs[i + 1]) out.reversals++;
+}
+
+// ── Input ────────────────────────────────────────────────────────────────────
+std::vector<Segment> segments(const std::vector<Record>& recs) {
+    std::vector<Segment> segs;
+    bool closed = true;
+    for (size_t i = 0; i < recs.size(); i++) {
+        uint8_t f = recs[i].levels;
+        if (closed || (f & CAP_FIRST)) segs.push_back({ i, i, false });
+        segs.back().last  = i;
+        segs.back().lost |= (f & CAP_LOST) != 0;
+        closed = (f & CAP_LAST) != 0;
+    }
+    return segs;
+}
+
+bool parseList(char* p, std::vector<uint16_t>& out) {
+    while (*p) {
+        out.push_back((uint16_t)strtoul(p, &p, 10));
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return true;
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--eager") {
+            o.eager = true;
+        } else if (a == "--hold-ms" && i + 1 < argc) {
+            o.holdUs = (uint32_t)atoi(argv[++i]) * 1000u;
+        } else if (a == "--debounce" && i + 1 < argc) {
+            if (!parseList(argv[++i], o.debounces)) return false;
+        } else if (a == "--sensitivity" && i + 1 < argc) {
+            if (!parseList(argv[++i], o.sensitivities)) return false;
+        } else if (a[0] != '-' && !o.path) {
+            o.path = argv[i];
+        } else {
+            return false;
+        }
+    }
+    if (o.debounces.empty())
+        o.debounces.assign(std::begin(DEFAULT_DEBOUNCES), std::end(DEFAULT_DEBOUNCES));
+    if (o.sensitivities.empty()) o.sensitivities.push_back(DEFAULT_ENCODER_SENSITIVITY);
+    return o.path != nullptr;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parseArgs(argc, argv, o)) {
+        fprintf(stderr, "usage: %s FILE [--debounce MS[,MS…]] [--hold-ms MS] [--eager] "
+                        "[--sensitivity N[,N…]]\n", argv[0]);
+        return 2;
+    }
+    Header              h;
+    std::vector<Record> recs;
+    if (!replay::load(o.path, h, recs)) {
+        fprintf(stderr, "%s: not a readable capture file\n", o.path);
+        return 2;
+    }
+    if (h.rows != NUM_ROWS || h.cols != NUM_COLS) {
+        fprintf(stderr, "%s: captured on a %ux%u matrix, this build is %ux%u\n",
+                o.path, h.rows, h.cols, NUM_ROWS, NUM_COLS);
+        return 2;
+    }
+    std::vector<Segment> segs = segments(recs);
+    if (segs.empty()) {
+        fprintf(stderr, "%s: no records\n", o.path);
+        return 2;
+    }
+
+    uint64_t span = 0;
+    for (const Segment& s : segs) {
+        span += recs[s.last].tUs - recs[s.first].tUs;
+        if (s.lost)
+            printf("warning: segment at record %zu lost records on the device; its "
+                   "reference may be wrong around the gap\n", s.first);
+    }
+    printf("%s — %ux%u matrix, %u Hz, %zu records in %zu segment(s), %.2f s\n",
+           o.path, h.rows, h.cols, h.rateHz, recs.size(), segs.size(), span / 1e6);
+
+    // ── Keys, per debounce setting ──
+    std::vector<Reference> refs;                         // segment-major, NUM_KEYS each
+    uint32_t transitions = 0, keysUsed = 0;
+    std::vector<bool> used(NUM_KEYS);
+    for (const Segment& s : segs)
+        for (uint16_t k = 0; k < NUM_KEYS; k++) {
+            refs.push_back(reference(recs, s, o.holdUs, [k](const Record& r) { return r.key(k); }));
+            transitions += (uint32_t)refs.back().t.size();
+            if (!refs.back().t.empty()) used[k] = true;
+        }
+    for (bool u : used) keysUsed += u;
+    printf("reference: a level held ≥ %u ms; %u key transitions on %u key(s)%s\n\n",
+           o.holdUs / 1000, transitions, keysUsed, o.eager ? "; eager presses" : "");
+
+    printf("  debounce  events  missed   false   latency ms p50     p99     max\n");
+    int              safe = -1;
+    std::vector<int> safeKey(NUM_KEYS, -1);
+    for (uint16_t d : o.debounces) {
+        Score total;
+        std::vector<Score> perKey(NUM_KEYS);
+        for (size_t si = 0; si < segs.size(); si++) {
+            std::vector<std::vector<Seen>> seen;
+            replayKeys(recs, segs[si], d, o.eager, seen);
+            for (uint16_t k = 0; k < NUM_KEYS; k++)
+                perKey[k].add(score(refs[si * NUM_KEYS + k], seen[k]));
+        }
+        for (uint16_t k = 0; k < NUM_KEYS; k++) {
+            total.add(perKey[k]);
+            if (safeKey[k] < 0 && used[k] && !perKey[k].missed && !perKey[k].falses) safeKey[k] = d;
+        }
+        if (safe < 0 && !total.missed && !total.falses) safe = d;
+        printf("  %5u ms  %6u  %6u  %6u        %7.2f %7.2f %7.2f\n", d, total.events,
+               total.missed, total.falses, pct(total.latMs, 50), pct(total.latMs, 99),
+               total.latMs.empty() ? 0.0 : *std::max_element(total.latMs.begin(), total.latMs.end()));
+    }
+
+    if (safe < 0) printf("\nno setting tried is clean on every key\n");
+    else          printf("\nlowest clean debounce: %d ms\n", safe);
+    printf("per key:");
+    for (uint16_t k = 0; k < NUM_KEYS; k++) {
+        if (!used[k]) continue;
+        if (safeKey[k] < 0) printf("  k%u –", k);
+        else                printf("  k%u %d", k, safeKey[k]);
+    }
+    printf("\n");
+
+    // ── Encoder, per sensitivity; the button at its fixed debounce ──
+    printf("\n");
+    for (size_t n = 0; n < o.sensitivities.size(); n++) {
+        uint8_t       sens = (uint8_t)std::max<uint16_t>(1, o.sensitivities[n]);
+        EncoderResult enc;
+        Score         btn;
+        for (const Segment& s : segs) {
+            replayEncoder(recs, s, sens, enc);
+            Reference ref = reference(recs, s, o.holdUs,
+                                      [](const Record& r) { return !(r.levels & BTN_BIT); });
+            btn.add(score(ref, enc.button));
+            enc.button.clear();
+        }
+        printf("encoder at sensitivity %u: %u rotate events, %d net steps (%d from the samples), "
+               "%u isolated reversal(s), %u skipped quadrature state(s)\n",
+               sens, enc.rotates, enc.steps, enc.refPos / sens, enc.reversals, enc.refIllegal);
+        if (n == 0)
+            printf("button: %u events, %u missed, %u false at %u ms; latency ms p50 %.2f  max %.2f\n",
+                   btn.events, btn.missed, btn.falses, DEFAULT_DEBOUNCE_MS, pct(btn.latMs, 50),
+                   btn.latMs.empty() ? 0.0 : *std::max_element(btn.latMs.begin(), btn.latMs.end()));
+    }
+    return 0;
+}
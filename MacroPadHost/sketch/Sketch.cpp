@@ -0,0 +1,6 @@
+// =============================================================================
+// Sketch.cpp — Builds MacroPadSketch.ino as an ordinary translation unit
+// setup(), loop() and the global instances are reached from the harness via
+// extern declarations (see bench/Harness.h).
+// =============================================================================
+#include "MacroPadSketch.ino"
@@ -0,0 +1,101 @@
+// =============================================================================
+// ActionEngine.cpp — Resolves input events through the key map on the device
+// =============================================================================
+#include "ActionEngine.h"
+#include "Trace.h"
+
+uint8_t ActionEngine::load(const uint8_t* image, uint16_t len) {
+    uint8_t status = _map.load(image, len);
+    if (status == KEYMAP_OK) setLayers(1);
+    return status;
+}
+
+uint8_t ActionEngine::topLayer() const {
+    uint8_t top = 0;
+    for (uint8_t m = _layersOn >> 1; m; m >>= 1) top++;
+    return top;
+}
+
+// Layers the map does not have stay off; layer 0 is always on
+void ActionEngine::setLayers(uint8_t mask) {
+    mask = (uint8_t)((mask | 1) & ((1u << _map.layers()) - 1));
+    if (mask == _layersOn) return;
+    _layersOn = mask;
+    TRACE(TR_LAYER, mask, topLayer(), 0);
+}
+
+// At most KEYMAP_LAYERS probes, from the top active layer down
+ActionEngine::Down ActionEngine::resolve(uint8_t key) const {
+    for (uint8_t l = topLayer() + 1; l-- > 0;) {
+        if (!(_layersOn & 1 << l)) continue;
+        const KeyAction& a = _map.at(l, key);
+        if (a.type != MAP_TRANSPARENT) return { a, l };
+    }
+    return { { MAP_NONE, 0, 0 }, 0 };
+}
+
+uint8_t ActionEngine::press(uint8_t slot, const Down& d, HidReport* out) {
+    uint8_t hidSlot = slot == BTN ? HidReports::ENC_SLOT : slot;
+    switch (d.a.type) {
+    case MAP_LAYER_HOLD:
+        if (d.a.code < KEYMAP_LAYERS) setLayers(_layersOn | 1 << d.a.code);
+        return 0;
+    case MAP_LAYER_TOGGLE:
+        if (d.a.code < KEYMAP_LAYERS) setLayers(_layersOn ^ 1 << d.a.code);
+        return 0;
+    case MAP_SEQUENCE: {
+        if (!_hidOn) return 0;
+        const SeqStep* s;
+        uint8_t        steps = _map.sequence(d.a.code, &s), n = 0;
+        for (uint8_t i = 0; i < steps; i++)
+            n += _hid.taps({ MAP_SHORTCUT, s[i].code, s[i].mods }, 1, out + n);
+        return n;
+    }
+    default:
+        return _hidOn ? _hid.press(hidSlot, d.a, out) : 0;
+    }
+}
+
+uint8_t ActionEngine::release(uint8_t slot, HidReport* out) {
+    uint8_t hidSlot = slot == BTN ? HidReports::ENC_SLOT : slot;
+    Down    d       = _down[slot];
+    _down[slot] = {};
+    if (d.a.type == MAP_LAYER_HOLD) {
+        if (d.a.code < KEYMAP_LAYERS) setLayers(_layersOn & ~(1 << d.a.code));
+        return 0;
+    }
+    return _hidOn ? _hid.release(hidSlot, out) : 0;
+}
+
+uint8_t ActionEngine::onEvent(InputEvent& e, HidReport* out) {
+    uint8_t n = _hidOn ? 0 : _hid.releaseAll(out);
+
+    switch (e.type) {
+    case EVT_KEY_PRESS:
+        if (e.id >= NUM_KEYS) return n;
+        _down[e.id]      = resolve(e.id);
+        e.layer          = _down[e.id].layer;
+        _lastLayer[e.id] = e.layer;
+        return n + press(e.id, _down[e.id], out + n);
+    case EVT_KEY_RELEASE:
+        if (e.id >= NUM_KEYS) return n;
+        e.layer = _down[e.id].layer;
+        return n + release(e.id, out + n);
+    case EVT_ENCODER_BTN_PRESS:
+        _down[BTN] = { _enc.button, 0 };
+        return n + press(BTN, _down[BTN], out + n);
+    case EVT_ENCODER_BTN_RELEASE:
+        return n + release(BTN, out + n);
+    case EVT_ENCODER_ROTATE:
+        return _hidOn ? _hid.rotate(e, _enc, out) : n;
+    case EVT_KEY_TAP:
+    case EVT_KEY_HOLD:
+    case EVT_KEY_DOUBLE_TAP:
+        // Gestures act on the host; they carry the layer of the latest press,
+        // which a tap's release has already cleared from _down
+        if (e.id < NUM_KEYS) e.layer = _lastLayer[e.id];
+        return n;
+    default:
+        return n;
+    }
+}
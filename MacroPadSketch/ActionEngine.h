@@ -0,0 +1,64 @@
+// =============================================================================
+// ActionEngine.h — Resolves input events through the key map on the device
+// Each key press looks its action up in the highest active layer that does
+// not mark it MAP_TRANSPARENT and remembers it until release, so a layer
+// change or a new map while the key is down still releases what it pressed.
+// Layer keys change the active layers; sequence keys tap their steps; the
+// rest become HID reports (HidReports) while HID mode is on.  Every key event
+// leaves stamped with the layer its action came from, so the app resolves
+// what stays on its side (text, launch) against the same map.
+// Runs on the transport task.  Fixed tables, no heap.
+// =============================================================================
+#ifndef ACTION_ENGINE_H
+#define ACTION_ENGINE_H
+
+#include "Config.h"
+#include "EventRing.h"
+#include "HidReports.h"
+#include "Keymap.h"
+
+class ActionEngine {
+public:
+    // A decoded image replaces the map and drops layer state; keys held
+    // across the swap still release what they pressed
+    uint8_t load(const uint8_t* image, uint16_t len);
+
+    // CMD_SET_KEY_MAP / CMD_SET_ENCODER_MODE: layer 0 entries, set one by one
+    void setKey(uint8_t key, const KeyAction& a) { _map.set(0, key, a); }
+    void setEncoder(const EncoderMap& m)         { _enc = m; }
+    void setHidMode(bool on)                     { _hidOn = on && HID_ENABLED; }
+    bool hidMode() const                         { return _hidOn; }
+
+    // Resolve one event: sets e.layer and returns the HID reports it causes,
+    // in order (≤ HID_REPORTS_MAX).  With HID mode off the first event
+    // releases whatever reports still hold down.
+    uint8_t onEvent(InputEvent& e, HidReport* out);
+
+    uint8_t layerMask() const { return _layersOn; }      // bit 0 always set
+    uint8_t topLayer()  const;
+    uint8_t layers()    const { return _map.layers(); }
+    uint8_t sequences() const { return _map.sequences(); }
+
+private:
+    static const uint8_t BTN = NUM_KEYS;                 // _down slot of the encoder button
+
+    struct Down {
+        KeyAction a;
+        uint8_t   layer;
+    };
+
+    Down    resolve(uint8_t key) const;
+    uint8_t press(uint8_t slot, const Down& d, HidReport* out);
+    uint8_t release(uint8_t slot, HidReport* out);
+    void    setLayers(uint8_t mask);
+
+    Keymap        _map;
+    HidReports    _hid;
+    EncoderMap    _enc            = {};
+    Down          _down[NUM_KEYS + 1] = {};
+    uint8_t       _lastLayer[NUM_KEYS] = {};          // of the latest press; kept past its release
+    uint8_t       _layersOn       = 1;
+    volatile bool _hidOn          = DEFAULT_HID_MODE;
+};
+
+#endif
@@ -3,40 +3,73 @@
 // =============================================================================
 #include "Battery.h"
 
+// Single-cell LiPo at light load: [mV, tenths of a percent], rising.  Nearly
+// half the charge sits within 0.1 V of 3.8 V, which is why the filtered
+// voltage, not a single reading, is what gets looked up.
+static const uint16_t CURVE[][2] = {
+    { BATTERY_EMPTY_MV,    0 }, { 3450,  20 }, { 3610,  50 }, { 3690, 100 },
+    { 3710,  150 }, { 3730, 200 }, { 3750, 250 }, { 3770, 300 }, { 3790, 350 },
+    { 3800,  400 }, { 3820, 450 }, { 3840, 500 }, { 3850, 550 }, { 3870, 600 },
+    { 3910,  650 }, { 3950, 700 }, { 3980, 750 }, { 4020, 800 }, { 4080, 850 },
+    { 4110,  900 }, { 4150, 950 }, { BATTERY_FULL_MV, 1000 },
+};
+static const uint8_t CURVE_POINTS = sizeof(CURVE) / sizeof(CURVE[0]);
+static_assert(BATTERY_EMPTY_MV < 3450 && BATTERY_FULL_MV > 4150,
+              "the discharge curve must rise from BATTERY_EMPTY_MV to BATTERY_FULL_MV");
+
+uint16_t BatteryMonitor::chargeTenths(uint16_t mv) {
+    if (mv <= CURVE[0][0])                return 0;
+    if (mv >= CURVE[CURVE_POINTS - 1][0]) return 1000;
+    uint8_t i = 1;
+    while (mv > CURVE[i][0]) i++;
+    uint32_t dv = CURVE[i][0] - CURVE[i - 1][0];
+    uint32_t dc = CURVE[i][1] - CURVE[i - 1][1];
+    return (uint16_t)(CURVE[i - 1][1] + (mv - CURVE[i - 1][0]) * dc / dv);
+}
+
 void BatteryMonitor::begin() {
 #if BATTERY_ENABLED
     analogReadResolution(12);
     // 0-3.3 V range on ESP32-C3 with 11 dB attenuation
     analogSetAttenuation(ADC_11db);
-    update();
+    // Seed the filter before the tasks start, so the first report is not one reading
+    uint32_t sum = 0;
+    for (int i = 0; i < BATTERY_SEED_SAMPLES; i++) sum += analogRead(BATTERY_ADC_PIN);
+    sample((uint16_t)(sum / BATTERY_SEED_SAMPLES));
+    _lastSample = millis();
 #endif
 }
 
-void BatteryMonitor::update() {
+// Called every HOUSEKEEPING_PERIOD_MS; at most one conversion per call, so
+// the CPU is never held longer than one analogRead()
+bool BatteryMonitor::update() {
 #if BATTERY_ENABLED
     unsigned long now = millis();
-    if (_lastRead != 0 && (now - _lastRead) < BATTERY_READ_INTERVAL_MS) return;
-    _lastRead = now;
-
-    // Average 16 samples
-    uint32_t sum = 0;
-    for (int i = 0; i < 16; i++) sum += analogRead(BATTERY_ADC_PIN);
-    uint16_t raw = sum / 16;
-
-    _mv = (uint16_t)((raw / 4095.0f) * 3300.0f * BATTERY_DIVIDER);
-
-    if      (_mv >= BATTERY_FULL_MV)  _pct = 100;
-    else if (_mv <= BATTERY_EMPTY_MV) _pct = 0;
-    else _pct = (uint8_t)(((float)(_mv - BATTERY_EMPTY_MV) /
-                            (float)(BATTERY_FULL_MV - BATTERY_EMPTY_MV)) * 100.0f);
-
-    if (_cb) _cb(_pct, _mv);
+    if (now - _lastSample < BATTERY_SAMPLE_MS) return false;
+    _lastSample = now;
+    return sample(analogRead(BATTERY_ADC_PIN));
 #else
-    _pct = 100;
-    _mv  = BATTERY_FULL_MV;
+    return false;
 #endif
 }
 
-void     BatteryMonitor::setCallback(Callback cb) { _cb = cb; }
-uint8_t  BatteryMonitor::getPercentage() const     { return _pct; }
-uint16_t BatteryMonitor::getVoltageMv()  const     { return _mv; }
+bool BatteryMonitor::sample(uint16_t raw) {
+    uint32_t mv = (uint32_t)raw * (uint32_t)(3300 * BATTERY_DIVIDER) / 4095;
+    if (_filtered == 0) _filtered = mv << BATTERY_EMA_SHIFT;
+    else                _filtered = _filtered - (_filtered >> BATTERY_EMA_SHIFT) + mv;
+    _mv = (uint16_t)((_filtered + (1u << (BATTERY_EMA_SHIFT - 1))) >> BATTERY_EMA_SHIFT);
+
+    // Re-read the curve only once the voltage has really moved; a radio burst
+    // or ADC noise that the filter let through stays inside the band
+    bool first = _reportedMv == 0;
+    int  moved = (int)_mv - (int)_reportedMv;
+    if (!first && moved < BATTERY_HYST_MV && moved > -BATTERY_HYST_MV) return false;
+    _reportedMv = _mv;
+    uint8_t pct = (uint8_t)((chargeTenths(_mv) + 5) / 10);
+    if (pct == _pct && !first) return false;
+    _pct = pct;
+    return true;
+}
+
+uint8_t  BatteryMonitor::getPercentage() const { return _pct; }
+uint16_t BatteryMonitor::getVoltageMv()  const { return _mv; }
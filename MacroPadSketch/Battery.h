@@ -1,27 +1,31 @@
 // =============================================================================
 // Battery.h — Optional battery-voltage monitor via ADC
+// One conversion per update() at most, filtered and mapped through a LiPo
+// discharge curve.  update() is true only when the percentage changed, and
+// the caller reports it; nothing is called back.
 // =============================================================================
 #ifndef BATTERY_H
 #define BATTERY_H
 
 #include "Config.h"
-#include <functional>
 
 class BatteryMonitor {
 public:
-    using Callback = std::function<void(uint8_t pct, uint16_t mv)>;
-
     void     begin();
-    void     update();
-    void     setCallback(Callback cb);
+    bool     update();                   // housekeeping: a conversion every BATTERY_SAMPLE_MS
+    bool     sample(uint16_t raw);       // one 12-bit reading through the filter and curve
     uint8_t  getPercentage() const;
     uint16_t getVoltageMv()  const;
 
+    // State of charge for a resting cell voltage, in tenths of a percent
+    static uint16_t chargeTenths(uint16_t mv);
+
 private:
-    uint8_t       _pct       = 100;
-    uint16_t      _mv        = BATTERY_FULL_MV;
-    unsigned long _lastRead  = 0;
-    Callback      _cb        = nullptr;
+    uint8_t       _pct        = 100;
+    uint16_t      _mv         = BATTERY_FULL_MV;
+    uint16_t      _reportedMv = 0;       // filtered voltage _pct was read at
+    uint32_t      _filtered   = 0;       // mV << BATTERY_EMA_SHIFT; 0 = no reading yet
+    unsigned long _lastSample = 0;
 };
 
 #endif
@@ -2,6 +2,8 @@
 // BleService.cpp — Full NimBLE service implementation
 // =============================================================================
 #include "BleService.h"
+#include "Log.h"
+#include "Trace.h"
 
 void BleService::begin(const char* deviceName) {
     NimBLEDevice::init(deviceName);
@@ -37,8 +39,43 @@ void BleService::begin(const char* deviceName) {
                    NIMBLE_PROPERTY::WRITE);
     _cCmd->setCallbacks(this);
 
+    _cBatch = _svc->createCharacteristic(EVENT_BATCH_CHAR_UUID,
+                   NIMBLE_PROPERTY::NOTIFY);
+    _cBatch->setCallbacks(this);
+
+    _cState = _svc->createCharacteristic(STATE_CHAR_UUID,
+                   NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+
+    _cStats = _svc->createCharacteristic(STATS_CHAR_UUID,
+                   NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+
+    _cLink = _svc->createCharacteristic(LINK_CHAR_UUID,
+                   NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+
+    _cTime = _svc->createCharacteristic(TIME_CHAR_UUID,
+                   NIMBLE_PROPERTY::NOTIFY);
+
+    _cTimes = _svc->createCharacteristic(EVENT_TIMES_CHAR_UUID,
+                   NIMBLE_PROPERTY::NOTIFY);
+
     _svc->start();
 
+#if HID_ENABLED
+    // ── HID over GATT: keyboard, consumer control, mouse ─────────────────────
+    // The HID device brings its own Device Information and Battery services
+    _hidDev = new NimBLEHIDDevice(_server);
+    _hidDev->setManufacturer("MacroPad");
+    _hidDev->setPnp(0x02, HID_VENDOR_ID, HID_PRODUCT_ID,
+                    FW_VERSION_MAJOR << 8 | FW_VERSION_MINOR);
+    _hidDev->setHidInfo(0x00, 0x01);      // not localized, remote wake
+    _hidDev->setReportMap((uint8_t*)HID_REPORT_MAP, HID_REPORT_MAP_BYTES);
+    _cHidKeys  = _hidDev->getInputReport(HID_REPORT_KEYBOARD);
+    _cHidMedia = _hidDev->getInputReport(HID_REPORT_CONSUMER);
+    _cHidMouse = _hidDev->getInputReport(HID_REPORT_MOUSE);
+    _cBattLvl  = _hidDev->getBatteryLevel();
+    _hidDev->setBatteryLevel(100);
+    _hidDev->startServices();
+#else
     // ── Standard Battery Service (so the OS shows battery level) ─────────────
     _battSvc  = _server->createService(BATTERY_SVC_UUID);
     _cBattLvl = _battSvc->createCharacteristic(BATTERY_LVL_CHAR_UUID,
@@ -46,87 +83,304 @@ void BleService::begin(const char* deviceName) {
     uint8_t full = 100;
     _cBattLvl->setValue(&full, 1);
     _battSvc->start();
+#endif
 
+    _tx.begin();
+    _link.begin(_server);
     updateDeviceInfo();
     startAdvertising();
-    Serial.println("BLE: service started, advertising…");
+    LOG_I("BLE: service started, advertising…\n");
 }
 
 // ── Advertising ──────────────────────────────────────────────────────────────
 void BleService::startAdvertising() {
+    advertise(NimBLEDevice::getNumBonds() ? ADV_DIRECTED : ADV_FAST);
+}
+
+void BleService::stopAdvertising() {
+    _advPhase = ADV_OFF;
+    NimBLEDevice::getAdvertising()->stop();
+}
+
+// Directed advertising carries no data: the bonded host is already looking
+// for this address and connects on the first packet it hears
+void BleService::advertise(uint8_t phase) {
     NimBLEAdvertising* adv = NimBLEDevice::getAdvertising();
     adv->reset();                        // clear stale data from previous cycles
-    adv->addServiceUUID(SERVICE_UUID);
-    adv->enableScanResponse(true);
-    adv->setPreferredParams(0x06, 0x12);
-    adv->start();
-    Serial.println("BLE: advertising started");
+    adv->setAdvertisingCompleteCallback([this](NimBLEAdvertising*) { onAdvertisingComplete(); });
+    bool fast = phase != ADV_SLOW;
+    adv->setMinInterval(fast ? ADV_FAST_INTERVAL_MIN : ADV_SLOW_INTERVAL_MIN);
+    adv->setMaxInterval(fast ? ADV_FAST_INTERVAL_MAX : ADV_SLOW_INTERVAL_MAX);
+    _advPhase = phase;
+
+    bool started;
+    if (phase == ADV_DIRECTED) {
+        NimBLEAddress peer = NimBLEDevice::getBondedAddress(0);
+        adv->setConnectableMode(BLE_GAP_CONN_MODE_DIR);
+        started = adv->start(ADV_DIRECTED_MS, &peer);
+    } else {
+        adv->addServiceUUID(SERVICE_UUID);
+#if HID_ENABLED
+        adv->addServiceUUID("1812");
+        adv->setAppearance(HID_APPEARANCE);
+#endif
+        adv->enableScanResponse(true);
+        adv->setPreferredParams(0x06, 0x12);
+        started = adv->start(fast ? ADV_FAST_MS : 0);
+    }
+    if (!started) {
+        _advPhase = ADV_OFF;
+        if (phase == ADV_DIRECTED) advertise(ADV_FAST);   // bond without a usable address
+        return;
+    }
+    uint16_t minIv = fast ? ADV_FAST_INTERVAL_MIN : ADV_SLOW_INTERVAL_MIN;
+    TRACE(TR_ADVERTISE, phase, minIv >> 8, minIv);
+    LOG_I("BLE: advertising started (%s)\n",
+          phase == ADV_DIRECTED ? "directed" : fast ? "fast" : "slow");
+}
+
+// A timed phase ran out without a connection: on to the next one
+void BleService::onAdvertisingComplete() {
+    if (_connected) return;
+    if      (_advPhase == ADV_DIRECTED) advertise(ADV_FAST);
+    else if (_advPhase == ADV_FAST)     advertise(ADV_SLOW);
 }
-void BleService::stopAdvertising() { NimBLEDevice::getAdvertising()->stop(); }
 
 // ── Callbacks ────────────────────────────────────────────────────────────────
 void BleService::setCommandCallback(CommandCb cb) { _cmdCb = cb; }
 void BleService::setConfigCallback(ConfigCb cb)   { _cfgCb = cb; }
 
 // ── Connection ───────────────────────────────────────────────────────────────
+// The connection callbacks run on the NimBLE host task: they leave the event
+// batch and the notify queue to the transport task (syncLink())
 void BleService::onConnect(NimBLEServer*, NimBLEConnInfo& connInfo) {
+    _mtu       = connInfo.getMTU();
+    _reset     = true;
     _connected = true;
-    Serial.println("BLE: client connected");
+    _batching  = false;
+    _timesOn   = false;
+    _link.onConnect(connInfo);
+    TRACE(TR_BLE_CONNECT, 0, connInfo.getMTU() >> 8, connInfo.getMTU());
+    LOG_I("BLE: client connected\n");
     stopAdvertising();
 }
-void BleService::onDisconnect(NimBLEServer*, NimBLEConnInfo& connInfo, int reason) {
+void BleService::onDisconnect(NimBLEServer*, NimBLEConnInfo&, int reason) {
+    _reset     = true;
     _connected = false;
-    Serial.printf("BLE: client disconnected (reason=%d)\n", reason);
+    _batching  = false;
+    _timesOn   = false;
+    _link.onDisconnect();
+    TRACE(TR_BLE_DISCONNECT, 0, reason >> 8, reason);
+    LOG_I("BLE: client disconnected (reason=%d)\n", reason);
     startAdvertising();
 }
 
+// MTU exchange happens once, right after connecting, so a batch never
+// straddles a shrinking limit.
+void BleService::onMTUChange(uint16_t mtu, NimBLEConnInfo&) {
+    _mtu = mtu;
+    _link.onMtu(mtu);
+    TRACE(TR_BLE_MTU, 0, mtu >> 8, mtu);
+}
+
+// The central's answers to LinkPolicy's requests
+void BleService::onConnParamsUpdate(NimBLEConnInfo& connInfo) { _link.onParams(connInfo); }
+void BleService::onPhyUpdate(NimBLEConnInfo&, uint8_t txPhy, uint8_t rxPhy) {
+    _link.onPhy(txPhy, rxPhy);
+}
+
 void BleService::onAuthenticationComplete(NimBLEConnInfo& connInfo) {
     if (connInfo.isEncrypted())
-        Serial.println("BLE: encrypted link established");
+        LOG_I("BLE: encrypted link established\n");
     else
-        Serial.println("BLE: WARNING – link NOT encrypted");
+        LOG_W("BLE: WARNING – link NOT encrypted\n");
 }
 
 // ── Characteristic writes (from app) ─────────────────────────────────────────
-void BleService::onWrite(NimBLECharacteristic* pChar, NimBLEConnInfo& connInfo) {
-    std::string val = pChar->getValue();
+void BleService::onWrite(NimBLECharacteristic* pChar, NimBLEConnInfo&) {
+    uint32_t    rxUs = micros();
+    std::string val  = pChar->getValue();
     if (val.empty()) return;
     const uint8_t* d = (const uint8_t*)val.data();
     size_t         n = val.length();
 
-    if (pChar == _cCmd && _cmdCb) {
-        _cmdCb(d[0], d + 1, n - 1);
+    if (pChar == _cCmd) {
+        linkCommand(rxUs, d, n);
+        if (_cmdCb) _cmdCb(d[0], d + 1, n - 1);
     } else if (pChar == _cConfig && n >= 2 && _cfgCb) {
         _cfgCb(d[0], d + 1, n - 1);
     }
 }
-void BleService::onRead(NimBLECharacteristic*, NimBLEConnInfo& connInfo) { /* values are set elsewhere */ }
+void BleService::onRead(NimBLECharacteristic*, NimBLEConnInfo&) { /* values are set elsewhere */ }
+
+// Commands this link answers itself, from the NimBLE host task: the clock
+// sync reply goes out on the link the request came in on, stamped on the
+// write callback's entry and just before the notify
+void BleService::linkCommand(uint32_t rxUs, const uint8_t* d, size_t n) {
+    switch (d[0]) {
+    case CMD_TIME_SYNC:
+        if (n >= 5 && _connected) {
+            TimeSync t = { (uint32_t)d[1] << 24 | (uint32_t)d[2] << 16 |
+                           (uint32_t)d[3] << 8  | d[4],
+                           rxUs, 0 };
+            uint8_t  buf[TIME_SYNC_BYTES];
+            t.txUs = micros();
+            _cTime->setValue(buf, t.build(buf));
+            notify(_cTime);
+        }
+        break;
+    case CMD_SET_LATENCY_TRACE:
+        if (n >= 2) _timesOn = d[1] != 0;
+        break;
+    }
+}
+
+void BleService::onSubscribe(NimBLECharacteristic* pChar, NimBLEConnInfo&, uint16_t subValue) {
+    if (pChar == _cBatch) {
+        _batching = (subValue & 0x0001) != 0;
+        TRACE(TR_BLE_SUBSCRIBE, 1, _batching, 0);
+    }
+}
 
 // ── Outgoing data ────────────────────────────────────────────────────────────
-void BleService::sendKeyEvent(uint8_t evt, uint8_t idx) {
+// Time sync replies and event times go out now or not at all: a retry would
+// carry a stale stamp.  Everything else goes through _tx.
+void BleService::notify(NimBLECharacteristic* c) {
+    if (!c->notify()) _notifyFailed = _notifyFailed + 1;
+}
+
+uint8_t BleService::send(NimBLECharacteristic* c, const uint8_t* data, uint16_t len, uint8_t kind) {
+    syncLink();
+    return _tx.send(c, data, len, kind);
+}
+
+// Transport task, before it touches _tx or _batch: nothing waiting for the
+// previous link goes out on the next one, and batches follow the MTU
+void BleService::syncLink() {
+    if (_reset) {
+        _reset = false;
+        _tx.clear();
+        _batch.clear();
+    }
+    if (_mtu != _batchMtu) {
+        _batchMtu = _mtu;
+        _batch.setLimit(_batchMtu - 3);
+    }
+}
+
+bool BleService::sendKeyEvent(uint8_t evt, uint8_t idx, uint8_t layer, uint8_t seq) {
+    if (!_connected) return false;
+    uint8_t pkt[4] = {evt, idx, layer, seq};
+    return send(_cKeyEvt, pkt, 4, TX_EVENT) == TX_SENT;
+}
+
+bool BleService::sendEncoderEvent(uint8_t evt, uint8_t dir, uint8_t steps, uint8_t seq,
+                                  uint16_t speed) {
+    if (!_connected) return false;
+    uint8_t pkt[6] = {evt, dir, steps, seq, (uint8_t)(speed >> 8), (uint8_t)speed};
+    uint8_t kind   = evt == EVT_ENCODER_ROTATE ? TX_ROTATION : TX_EVENT;   // a button is a key
+    return send(_cEncEvt, pkt, 6, kind) == TX_SENT;
+}
+
+void BleService::queueEvent(const InputEvent& e) {
+    if (!_connected) { _notifySkipped = _notifySkipped + 1; return; }
+    _link.noteInput(millis());
+
+    if (!_batching) {
+        bool     key  = isKeyEvent(e.type);
+        uint32_t sent = micros();
+        bool     now  = key ? sendKeyEvent(e.type, e.id, e.layer, e.seq)
+                            : sendEncoderEvent(e.type, e.value, e.steps, e.seq, e.speed);
+        if (now && _timesOn) {
+            uint8_t buf[EventBatch::TIMES_HEADER_BYTES + EventBatch::TIMES_RECORD_BYTES];
+            _cTimes->setValue(buf, EventBatch::buildTimes(&e, 1, sent, buf));
+            notify(_cTimes);
+        }
+        return;
+    }
+    syncLink();
+    if (!_batch.add(e)) {
+        sendBatch();
+        _batch.add(e);
+    }
+}
+
+// Straight out, ahead of any batch: these are what the OS acts on.  Mouse
+// reports come from encoder turns and merge while they wait.
+void BleService::sendHid(const HidReport* r, uint8_t n) {
     if (!_connected) return;
-    uint8_t pkt[4] = {evt, idx, 0, 0};
-    _cKeyEvt->setValue(pkt, 4);
-    _cKeyEvt->notify();
+    for (uint8_t i = 0; i < n; i++) {
+        NimBLECharacteristic* c = r[i].id == HID_REPORT_KEYBOARD ? _cHidKeys
+                                : r[i].id == HID_REPORT_CONSUMER ? _cHidMedia
+                                                                 : _cHidMouse;
+        if (!c) return;
+        send(c, r[i].data, r[i].len, c == _cHidMouse ? TX_MOUSE : TX_EVENT);
+    }
+}
+
+void BleService::flushEvents() {
+    syncLink();
+    if (_batch.empty() || _tx.waiting()) return;
+    sendBatch();
+}
+
+void BleService::sendBatch() {
+    uint8_t  buf[EVENT_BATCH_MAX_BYTES];
+    uint16_t n    = _batch.build(buf);
+    uint32_t sent = micros();
+    uint8_t  st   = send(_cBatch, buf, n, _batch.onlyRotations() ? TX_ROTATION : TX_EVENT);
+    if (st == TX_SENT && _timesOn) {     // right behind the notify they describe
+        _cTimes->setValue(buf, _batch.buildTimes(sent, buf));
+        notify(_cTimes);
+    }
+    _batch.clear();
 }
 
-void BleService::sendEncoderEvent(uint8_t evt, uint8_t dir, uint8_t steps) {
+void BleService::pumpNotifies() {
     if (!_connected) return;
-    uint8_t pkt[4] = {evt, dir, steps, 0};
-    _cEncEvt->setValue(pkt, 4);
-    _cEncEvt->notify();
+    syncLink();
+    _tx.pump();
+    flushEvents();
+}
+
+// Always readable; notified to a connected client
+void BleService::sendSnapshot(const InputSnapshot& s) {
+    uint8_t  buf[SNAPSHOT_MAX_BYTES];
+    uint16_t n = s.build(buf);
+    _cState->setValue(buf, n);
+    if (_connected) send(_cState, buf, n, TX_STATE);
+}
+
+// Always readable; a client whose MTU is under STATS_MAX_BYTES + 3 gets a
+// truncated notify and reads the characteristic for the rest
+void BleService::sendStats(const DeviceStats& s) {
+    uint8_t buf[STATS_MAX_BYTES];
+    uint8_t n = s.build(buf);
+    _cStats->setValue(buf, n);
+    if (_connected) send(_cStats, buf, n, TX_STATE);
+}
+
+// Always readable; notified to a connected client whenever it changes
+void BleService::sendLink(const LinkParams& p) {
+    uint8_t buf[LINK_PARAMS_BYTES];
+    uint8_t n = p.build(buf);
+    _cLink->setValue(buf, n);
+    if (_connected) send(_cLink, buf, n, TX_STATE);
 }
 
 void BleService::updateBatteryLevel(uint8_t pct) {
     _cBatt->setValue(&pct, 1);
     _cBattLvl->setValue(&pct, 1);
-    if (_connected) { _cBatt->notify(); _cBattLvl->notify(); }
+    if (_connected) {
+        send(_cBatt, &pct, 1, TX_STATE);
+        send(_cBattLvl, &pct, 1, TX_STATE);
+    }
 }
 
 void BleService::sendConfigData(const uint8_t* data, size_t len) {
     if (!_connected) return;
     _cConfig->setValue(data, len);
-    _cConfig->notify();
+    send(_cConfig, data, (uint16_t)len, TX_EVENT);
 }
 
 void BleService::updateDeviceInfo() {
@@ -135,7 +389,7 @@ void BleService::updateDeviceInfo() {
         NUM_ROWS, NUM_COLS,
         1,  // hasEncoder
         BATTERY_ENABLED ? (uint8_t)1 : (uint8_t)0,
-        0   // reserved
+        NUM_KEYS    // key indexes 0 … NUM_KEYS−1, row-major
     };
     _cDevInfo->setValue(info, 8);
 }
@@ -6,37 +6,91 @@
 #define BLE_SERVICE_H
 
 #include "Config.h"
+#include "EventBatch.h"
+#include "Stats.h"
+#include "LinkPolicy.h"
+#include "HidReports.h"
+#include "TimeSync.h"
+#include "NotifyQueue.h"
 #include <NimBLEDevice.h>
-#include <functional>
+#if HID_ENABLED
+#include <NimBLEHIDDevice.h>
+#endif
+
+#define ADV_OFF       0
+#define ADV_DIRECTED  1         // at the bonded host
+#define ADV_FAST      2
+#define ADV_SLOW      3
 
 class BleService : public NimBLEServerCallbacks,
                    public NimBLECharacteristicCallbacks {
 public:
-    using CommandCb = std::function<void(uint8_t cmd, const uint8_t* data, size_t len)>;
-    using ConfigCb  = std::function<void(uint8_t type, const uint8_t* data, size_t len)>;
+    typedef void (*CommandCb)(uint8_t cmd, const uint8_t* data, size_t len);
+    typedef void (*ConfigCb)(uint8_t type, const uint8_t* data, size_t len);
 
     void begin(const char* deviceName);
     void setCommandCallback(CommandCb cb);
     void setConfigCallback(ConfigCb cb);
 
-    void sendKeyEvent(uint8_t eventType, uint8_t keyIndex);
-    void sendEncoderEvent(uint8_t eventType, uint8_t direction, uint8_t steps);
+    // Notify now or queue (NotifyQueue); true when it went out now
+    bool sendKeyEvent(uint8_t eventType, uint8_t keyIndex, uint8_t layer, uint8_t seq);
+    bool sendEncoderEvent(uint8_t eventType, uint8_t direction, uint8_t steps, uint8_t seq,
+                          uint16_t speed);
+    void sendSnapshot(const InputSnapshot& s);
+    void sendStats(const DeviceStats& s);
+    void sendLink(const LinkParams& p);
     void updateBatteryLevel(uint8_t pct);
     void sendConfigData(const uint8_t* data, size_t len);
     void updateDeviceInfo();
 
-    bool isConnected() const;
-    void startAdvertising();
-    void stopAdvertising();
+    // Input events: batched on the Event Batch characteristic until
+    // flushEvents() when the client subscribed to it, otherwise one notify each.
+    // While notifies wait for TX buffers the open batch stays open.
+    void queueEvent(const InputEvent& e);
+    void flushEvents();
+    // Transport task, every pass: retry waiting notifies, then the held batch
+    void pumpNotifies();
+    bool congested() const   { return _connected && _tx.congested(); }
+    uint8_t txWaiting() const { return _tx.waiting(); }
+    // HID input reports (ActionEngine), straight out ahead of any batch
+    void sendHid(const HidReport* r, uint8_t n);
+
+    // CMD_SET_LATENCY_TRACE over BLE: Event Times notifies after each event
+    // notify, until the client disconnects
+    bool     latencyTrace()  const { return _timesOn; }
+
+    uint32_t notifyFailed()  const { return _notifyFailed + _tx.refused(); }   // notify() returned false
+    uint32_t notifySkipped() const { return _notifySkipped; }   // events with no client
+    uint32_t txRetried()     const { return _tx.retried(); }    // refused, then sent on a retry
+    uint32_t txDropped()     const { return _tx.dropped(); }
+    uint32_t txCoalesced()   const { return _tx.coalesced(); }
+
+    // Connection profile (LinkPolicy); updateLink() belongs to the transport
+    // task and is true when the negotiated parameters changed
+    void       setLinkMode(uint8_t mode) { _link.setMode(mode); }
+    bool       updateLink()              { return _link.update(millis()); }
+    LinkParams linkParams() const        { return _link.params(); }
+
+    bool    isConnected() const;
+    // Directed at the bonded host, then fast, then slow (Config.h); a
+    // connection or stopAdvertising() ends the chain
+    void    startAdvertising();
+    void    stopAdvertising();
+    uint8_t advPhase() const { return _advPhase; }   // ADV_*
 
     // NimBLEServerCallbacks (v2.x signatures)
     void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override;
     void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override;
     void onAuthenticationComplete(NimBLEConnInfo& connInfo) override;
+    void onMTUChange(uint16_t mtu, NimBLEConnInfo& connInfo) override;
+    void onConnParamsUpdate(NimBLEConnInfo& connInfo) override;
+    void onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy) override;
 
     // NimBLECharacteristicCallbacks (v2.x signatures)
     void onWrite(NimBLECharacteristic* pChar, NimBLEConnInfo& connInfo) override;
     void onRead(NimBLECharacteristic* pChar, NimBLEConnInfo& connInfo) override;
+    void onSubscribe(NimBLECharacteristic* pChar, NimBLEConnInfo& connInfo,
+                     uint16_t subValue) override;
 
 private:
     NimBLEServer*         _server   = nullptr;
@@ -47,12 +101,47 @@ private:
     NimBLECharacteristic* _cBatt    = nullptr;
     NimBLECharacteristic* _cConfig  = nullptr;
     NimBLECharacteristic* _cCmd     = nullptr;
+    NimBLECharacteristic* _cBatch   = nullptr;
+    NimBLECharacteristic* _cState   = nullptr;
+    NimBLECharacteristic* _cStats   = nullptr;
+    NimBLECharacteristic* _cLink    = nullptr;
+    NimBLECharacteristic* _cTime    = nullptr;
+    NimBLECharacteristic* _cTimes   = nullptr;
     NimBLEService*        _battSvc  = nullptr;
     NimBLECharacteristic* _cBattLvl = nullptr;
+#if HID_ENABLED
+    NimBLEHIDDevice*      _hidDev   = nullptr;
+#endif
+    NimBLECharacteristic* _cHidKeys  = nullptr;
+    NimBLECharacteristic* _cHidMedia = nullptr;
+    NimBLECharacteristic* _cHidMouse = nullptr;
+
+    bool       _connected = false;
+    bool       _batching  = false;      // client subscribed to _cBatch
+    volatile bool _timesOn = false;     // latency trace on _cTimes
+    EventBatch _batch;
+    LinkPolicy _link;
+    CommandCb  _cmdCb     = nullptr;
+    ConfigCb   _cfgCb     = nullptr;
+    NotifyQueue _tx;                    // event, HID and state notifies
+
+    // Set by the host task's connection callbacks, applied by syncLink()
+    volatile bool     _reset    = false;   // (dis)connected: drop the batch and the queue
+    volatile uint16_t _mtu      = 0;
+    uint16_t          _batchMtu = 0;       // the MTU _batch's limit follows
+
+    volatile uint32_t _notifyFailed  = 0;
+    volatile uint32_t _notifySkipped = 0;
+
+    volatile uint8_t _advPhase = ADV_OFF;
 
-    bool      _connected = false;
-    CommandCb _cmdCb     = nullptr;
-    ConfigCb  _cfgCb     = nullptr;
+    void notify(NimBLECharacteristic* c);   // notify() now and count refusals; no retry
+    uint8_t send(NimBLECharacteristic* c, const uint8_t* data, uint16_t len, uint8_t kind);
+    void syncLink();
+    void sendBatch();
+    void linkCommand(uint32_t rxUs, const uint8_t* data, size_t len);
+    void advertise(uint8_t phase);
+    void onAdvertisingComplete();
 };
 
 #endif
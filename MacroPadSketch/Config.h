@@ -1,6 +1,6 @@
 // =============================================================================
 // Config.h — MacroPad Firmware Configuration
-// Hardware: ESP32-C3 · 2×5 Key Matrix · Rotary Encoder · BLE
+// Hardware: ESP32-C3 / S3 · 2×5, 4×6 or 6×16 Key Matrix · Rotary Encoder · BLE
 // =============================================================================
 #ifndef CONFIG_H
 #define CONFIG_H
@@ -8,34 +8,261 @@
 #include <Arduino.h>
 
 // ─── Pin Configuration ───────────────────────────────────────────────────────
-#define NUM_ROWS 2
-#define NUM_COLS 5
-#define NUM_KEYS (NUM_ROWS * NUM_COLS)
+// The matrix is wired as two compile-time pin lists; KeyMatrix is generated
+// from them, so every layout gets an unrolled scan with constant pins.
+// Build for another board with -DMACROPAD_BOARD=BOARD_4X6 (or BOARD_6X16).
+// Column pins must all be below 32: each row is one GPIO_IN_REG read.
+#define BOARD_2X5   1       // ESP32-C3, the original pad
+#define BOARD_4X6   2       // ESP32-C3
+#define BOARD_6X16  3       // ESP32-S3
 
-static const uint8_t ROW_PINS[NUM_ROWS] = {21, 20};
-static const uint8_t COL_PINS[NUM_COLS] = {0, 1, 2, 3, 4};
+#ifndef MACROPAD_BOARD
+#define MACROPAD_BOARD BOARD_2X5
+#endif
 
+#if MACROPAD_BOARD == BOARD_2X5
+#define MATRIX_ROW_PINS 21, 20
+#define MATRIX_COL_PINS 0, 1, 2, 3, 4
 #define ENC_A_PIN   5
 #define ENC_B_PIN   6
 #define ENC_BTN_PIN 7       // Encoder push-button — adjust to your wiring
+#elif MACROPAD_BOARD == BOARD_4X6
+#define MATRIX_ROW_PINS 21, 20, 10, 9
+#define MATRIX_COL_PINS 0, 1, 2, 3, 4, 8
+#define ENC_A_PIN   5
+#define ENC_B_PIN   6
+#define ENC_BTN_PIN 7
+#elif MACROPAD_BOARD == BOARD_6X16
+#define MATRIX_ROW_PINS 17, 18, 21, 38, 39, 40
+#define MATRIX_COL_PINS 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+#define ENC_A_PIN   41
+#define ENC_B_PIN   42
+#define ENC_BTN_PIN 47
+#else
+#error "Unknown MACROPAD_BOARD"
+#endif
+
+template <uint8_t... Pins>
+struct PinList {
+    static constexpr uint8_t count = sizeof...(Pins);
+    static constexpr uint8_t pins[count] = { Pins... };
+};
+using RowPins = PinList<MATRIX_ROW_PINS>;
+using ColPins = PinList<MATRIX_COL_PINS>;
+
+static constexpr uint8_t NUM_ROWS = RowPins::count;
+static constexpr uint8_t NUM_COLS = ColPins::count;
+static_assert(NUM_ROWS * NUM_COLS <= 255, "key indexes travel as one byte");
+static constexpr uint8_t NUM_KEYS = NUM_ROWS * NUM_COLS;
+
+// Runtime copies for code off the scan path (sleep wake-up, host harness)
+static const uint8_t ROW_PINS[NUM_ROWS] = { MATRIX_ROW_PINS };
+static const uint8_t COL_PINS[NUM_COLS] = { MATRIX_COL_PINS };
 
 // ─── Battery Monitoring (optional) ───────────────────────────────────────────
 // Set BATTERY_ENABLED to true and wire a voltage divider to an ADC-capable pin.
 // On ESP32-C3 only GPIO 0-4 have ADC1 channels; pick one not used by the matrix
 // or time-multiplex with caution.
+// One conversion per housekeeping pass at most, every BATTERY_SAMPLE_MS, into
+// an EMA of weight 1 / 2^BATTERY_EMA_SHIFT (about 2 min at these values).  The
+// filtered voltage goes through a single-cell LiPo discharge curve; the
+// percentage is only re-read once the voltage has moved BATTERY_HYST_MV.
+#ifndef BATTERY_ENABLED
 #define BATTERY_ENABLED           false
+#endif
 #define BATTERY_ADC_PIN           3
 #define BATTERY_FULL_MV           4200
 #define BATTERY_EMPTY_MV          3000
 #define BATTERY_DIVIDER           2.0f
-#define BATTERY_READ_INTERVAL_MS  30000
+#define BATTERY_SAMPLE_MS         2000
+#define BATTERY_SEED_SAMPLES      8      // at begin(), before the tasks start
+#define BATTERY_EMA_SHIFT         6
+#define BATTERY_HYST_MV           10
 
 // ─── Default Settings ────────────────────────────────────────────────────────
 #define DEFAULT_DEVICE_NAME         "MacroPad"
-#define DEFAULT_DEBOUNCE_MS         20
+#define DEFAULT_DEBOUNCE_MS         20       // the ceiling, when adaptive
+#define DEFAULT_DEBOUNCE_ADAPTIVE   true     // per-key windows learned from each switch's bounce
+#define DEFAULT_EAGER_PRESS         false    // true = press on first edge, debounce release only
 #define DEFAULT_ENCODER_SENSITIVITY 2
 #define DEFAULT_SLEEP_TIMEOUT_MS    300000   // 5 min
 
+// ─── Adaptive Debounce ───────────────────────────────────────────────────────
+// Every key starts at the configured window, the ceiling, and times its own
+// bursts: first edge to last, for each change of level.  Once it has
+// DEBOUNCE_LEARN_BURSTS of them it debounces with its longest burst × 1.5,
+// plus one scan and DEBOUNCE_MARGIN_MS, never below DEBOUNCE_MIN_MS.  An edge
+// less than DEBOUNCE_CHATTER_MS after a learned window closed means a bounce
+// got through: the key is flagged, goes back to the ceiling and relearns.
+// A key whose bursts need the ceiling is flagged as well.
+#define DEBOUNCE_LEARN_BURSTS       8
+#define DEBOUNCE_MIN_MS             3
+#define DEBOUNCE_MARGIN_MS          2
+#define DEBOUNCE_CHATTER_MS         15
+
+// ─── Task Layout (FreeRTOS) ──────────────────────────────────────────────────
+// Input sampling runs in its own high-priority task, woken by a hardware timer,
+// so a slow printf, a blocking BLE notify or a battery read cannot stretch the
+// scan period.  Events reach the transport task through a lock-free ring.
+#define SCAN_RATE_HZ                1000
+#define SCAN_TIMER_HZ               1000000  // 1 µs timer resolution
+
+#define INPUT_TASK_PRIORITY         5
+#define TRANSPORT_TASK_PRIORITY     3
+#define HOUSEKEEPING_TASK_PRIORITY  1
+
+#define INPUT_TASK_STACK            3072
+#define TRANSPORT_TASK_STACK        4096
+#define HOUSEKEEPING_TASK_STACK     3072
+
+#define EVENT_RING_SIZE             64       // power of two; full ring drops + counts
+#define TRANSPORT_POLL_MS           1        // serial RX poll while the queue is idle
+#define HOUSEKEEPING_PERIOD_MS      100
+
+// ─── Scan Governor ───────────────────────────────────────────────────────────
+// Full SCAN_RATE_HZ while keys or the encoder are in use.  GOV_IDLE_AFTER_MS
+// after the last input the input task scans every GOV_IDLE_PERIOD_MS, after
+// GOV_DEEP_AFTER_MS every GOV_DEEP_PERIOD_MS.  Below full rate the scan timer
+// is off and the task waits on a timeout, so tickless idle can light-sleep
+// the chip between scans; the rows stay LOW and the first column or encoder
+// edge brings full rate straight back (ScanGovernor.h).  Tickless idle needs
+// CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE in the sdkconfig.
+#define GOV_IDLE_AFTER_MS           250
+#define GOV_IDLE_PERIOD_MS          10       // 100 Hz
+#define GOV_DEEP_AFTER_MS           5000
+#define GOV_DEEP_PERIOD_MS          50       // 20 Hz
+#define GOV_IDLE_POLL_MS            20       // serial RX poll below full rate, no USB host
+#define GOV_PM_MAX_MHZ              160
+#define GOV_PM_MIN_MHZ              40       // between tasks when light sleep is not possible
+#define DEFAULT_GOV_MODE            GOV_MODE_AUTO
+
+// ─── Encoder Reports ─────────────────────────────────────────────────────────
+// The encoder ISRs stamp every quadrature transition.  The input task turns
+// them into at most ENCODER_REPORT_HZ rotate events per second, each with the
+// steps accumulated since the previous one and the speed measured from the
+// edge stamps, so a fast spin neither floods the links nor loses steps.
+#define ENCODER_REPORT_HZ           100      // 0 = report on every scan
+#define ENCODER_EDGE_LOG            16       // stamped transitions kept; power of two
+#define ENCODER_IDLE_MS             200      // one edge after a longer pause has no speed yet
+
+// ─── Event Batching ──────────────────────────────────────────────────────────
+// Apps that opt in (serial handshake flag / Event Batch subscription) get
+// every event collected within the window in one frame instead of one each.
+#define EVENT_BATCH_WINDOW_MS       1        // collect after the first event; 0 = backlog only
+#define EVENT_BATCH_MAX_BYTES       240      // payload cap; BLE is further capped at MTU − 3
+
+// ─── Sequence Numbers & Snapshots ────────────────────────────────────────────
+// Every event carries an 8-bit sequence number.  A host that sees a gap asks
+// for a snapshot of the pressed keys; while anything is held the device also
+// pushes one every SNAPSHOT_PERIOD_MS, plus one when the last key lets go.
+#define SNAPSHOT_PERIOD_MS          250
+
+// ─── BLE Link Profiles ───────────────────────────────────────────────────────
+// After connecting, LinkPolicy asks for 2M PHY, data length extension and the
+// connection parameters of a profile.  "performance" keeps the interval short
+// so a notify waits a few ms for its connection event; "battery" lengthens it
+// and lets the radio skip idle events.  LINK_AUTO picks performance while
+// input is arriving and battery after LINK_IDLE_MS without any;
+// CMD_SET_LINK_PROFILE pins either one.  Intervals are 1.25 ms units,
+// timeouts 10 ms units.
+#define LINK_PERF_INTERVAL_MIN      6        // 7.5 ms
+#define LINK_PERF_INTERVAL_MAX      12       // 15 ms
+#define LINK_PERF_LATENCY           0
+#define LINK_PERF_TIMEOUT           200      // 2 s
+#define LINK_BATT_INTERVAL_MIN      48       // 60 ms
+#define LINK_BATT_INTERVAL_MAX      80       // 100 ms
+#define LINK_BATT_LATENCY           4        // idle: radio up every 5th event
+#define LINK_BATT_TIMEOUT           600      // 6 s, > 2 × (1 + latency) × interval
+#define LINK_DATA_LEN               251      // LL payload octets; 27 = no DLE
+#define LINK_IDLE_MS                10000    // auto: battery profile after this long idle
+#define LINK_RETRY_MS               5000     // re-ask if the central did not settle in range
+#define DEFAULT_LINK_MODE           LINK_AUTO
+
+// ─── BLE Transmit Queue ──────────────────────────────────────────────────────
+// A notify the stack refuses (every TX buffer waiting for the central's ack)
+// waits in BleService's NotifyQueue and is retried on every transport pass.
+// While anything waits, or no more than BLE_TX_RESERVE buffers are free, the
+// encoder reports at most ENCODER_CONGESTED_HZ (more steps per event) and an
+// open event batch keeps collecting instead of adding another notify.
+#define BLE_TX_QUEUE                16       // waiting notifies
+#define BLE_TX_RESERVE              2        // TX buffers left that count as congested
+#define ENCODER_CONGESTED_HZ        10
+
+// ─── Light Sleep & Advertising ───────────────────────────────────────────────
+// After sleepTimeoutMs with no input and no USB host the input task light-
+// sleeps the chip with every row LOW, so a key press, an encoder detent or
+// the button wakes it.  It scans the moment it is back: the waking key goes
+// out as a press at once, stamped with the wake time, and the peripherals
+// carry on where they were instead of being set up again.  Advertising then
+// starts directed at the bonded host for ADV_DIRECTED_MS, so it reconnects
+// without a scan, then runs undirected at the fast interval for ADV_FAST_MS
+// and at the slow one after that.  The same chain runs at boot and after a
+// disconnect; without a bond it starts fast.  Intervals are 0.625 ms units.
+#define ADV_DIRECTED_MS             1280
+#define ADV_FAST_MS                 30000
+#define ADV_FAST_INTERVAL_MIN       32       // 20 ms
+#define ADV_FAST_INTERVAL_MAX       48       // 30 ms
+#define ADV_SLOW_INTERVAL_MIN       244      // 152.5 ms
+#define ADV_SLOW_INTERVAL_MAX       338      // 211.25 ms
+
+#define WAKE_KEY                    0x01     // TR_WAKE sources: a column was LOW
+#define WAKE_ENCODER                0x02     //   a quadrature channel moved
+#define WAKE_BUTTON                 0x04     //   the encoder button changed
+
+// ─── HID over GATT ───────────────────────────────────────────────────────────
+// With HID_ENABLED the device also exposes the standard HID service with a
+// keyboard, a consumer-control and a mouse input report (HidReports.h), so
+// the OS takes mapped keys straight from the radio.  The app pushes what each
+// key and the encoder do (CMD_SET_KEY_MAP, CMD_SET_ENCODER_MODE) into RAM and
+// turns the reports on with CMD_SET_HID_MODE.  Text macros, recorded macros
+// and app launches stay with the app.
+#ifndef HID_ENABLED
+#define HID_ENABLED                 1
+#endif
+#define DEFAULT_HID_MODE            0        // reports off until the app asks
+#define HID_MAX_HELD                16       // mapped keys held at once
+#define HID_MAX_TAPS                8        // encoder steps per event turned into taps
+#define HID_VENDOR_ID               0x303A   // Espressif
+#define HID_PRODUCT_ID              0x4D50
+#define HID_APPEARANCE              0x03C1   // keyboard
+
+// ─── Key Map & Action Engine ─────────────────────────────────────────────────
+// The app uploads a binary key map into RAM at connect time (Keymap.h) with
+// CFG_KEYMAP_* writes on the Config characteristic or PKT_CONFIG_DATA.
+// ActionEngine resolves every key through its layers on the transport task:
+// layer keys and sequences act on the device, the rest become HID reports,
+// and each key event carries the layer it resolved on.  Config writes and key
+// map commands over BLE arrive on the NimBLE host task and wait in a queue of
+// BLE_WRITE_QUEUE for the transport to apply them.
+#define KEYMAP_LAYERS               4        // ≤ 8
+#define BLE_WRITE_QUEUE             8        // BLE writes waiting for the transport
+#define KEYMAP_SEQUENCES            16
+#define KEYMAP_SEQ_BYTES            256      // all sequence steps, 2 bytes each
+
+// ─── Gestures ────────────────────────────────────────────────────────────────
+// Tap, hold and double-tap resolved on the device from each key's debounced
+// edges and their capture stamps (Gestures.h).  Every key is off until
+// CMD_SET_GESTURE gives it thresholds; a command with the key alone takes these.
+#define GESTURE_HOLD_MS             200      // held this long: a hold
+#define GESTURE_DOUBLE_TAP_MS       250      // pressed again within this of a release: a double tap
+
+// ─── Pin Capture ─────────────────────────────────────────────────────────────
+// CMD_SET_CAPTURE runs the scan timer at CAPTURE_RATE_HZ.  Every tick reads
+// the raw matrix and the encoder pins, and each sample that differs from
+// the one before goes into a RAM ring (PinCapture.h), streamed out as
+// PKT_CAPTURE frames.  A scan pass still runs every SCAN_RATE_HZ.  Each
+// sample strobes every row, so NUM_ROWS × 10 µs of settling bounds the rate.
+#define CAPTURE_RATE_HZ             8000
+#define CAPTURE_RING_SIZE           1024     // change records, power of two
+
+// ─── Logging & Trace ─────────────────────────────────────────────────────────
+// Text logs compile in by level (Log.h) and default to the core's "Core Debug
+// Level".  Per-event diagnostics go to a binary RAM ring fetched with
+// CMD_GET_TRACE, so the serial stream carries only protocol frames.
+// #define LOG_LEVEL                LOG_LEVEL_INFO
+#define TRACE_ENABLED               1
+#define TRACE_RING_SIZE             128      // records, power of two; 8 bytes each
+
 // ─── BLE UUIDs ───────────────────────────────────────────────────────────────
 #define SERVICE_UUID              "e5e60001-b594-4841-8a6c-5b0d12e7e4a8"
 #define KEY_EVENT_CHAR_UUID       "e5e60002-b594-4841-8a6c-5b0d12e7e4a8"
@@ -44,6 +271,12 @@ static const uint8_t COL_PINS[NUM_COLS] = {0, 1, 2, 3, 4};
 #define BATTERY_CHAR_UUID         "e5e60005-b594-4841-8a6c-5b0d12e7e4a8"
 #define CONFIG_CHAR_UUID          "e5e60006-b594-4841-8a6c-5b0d12e7e4a8"
 #define COMMAND_CHAR_UUID         "e5e60007-b594-4841-8a6c-5b0d12e7e4a8"
+#define EVENT_BATCH_CHAR_UUID     "e5e60008-b594-4841-8a6c-5b0d12e7e4a8"
+#define STATE_CHAR_UUID           "e5e60009-b594-4841-8a6c-5b0d12e7e4a8"
+#define STATS_CHAR_UUID           "e5e6000a-b594-4841-8a6c-5b0d12e7e4a8"
+#define LINK_CHAR_UUID            "e5e6000b-b594-4841-8a6c-5b0d12e7e4a8"
+#define TIME_CHAR_UUID            "e5e6000c-b594-4841-8a6c-5b0d12e7e4a8"
+#define EVENT_TIMES_CHAR_UUID     "e5e6000d-b594-4841-8a6c-5b0d12e7e4a8"
 
 // Standard Battery Service (OS-level battery indicator)
 #define BATTERY_SVC_UUID          "180f"
@@ -52,6 +285,9 @@ static const uint8_t COL_PINS[NUM_COLS] = {0, 1, 2, 3, 4};
 // ─── Protocol — Event Types ──────────────────────────────────────────────────
 #define EVT_KEY_PRESS             0x01
 #define EVT_KEY_RELEASE           0x02
+#define EVT_KEY_TAP               0x03   // gestures (Gestures.h), stamped at the first press:
+#define EVT_KEY_HOLD              0x04   //   released before the hold threshold, held past
+#define EVT_KEY_DOUBLE_TAP        0x05   //   it, pressed again within the double-tap window
 #define EVT_ENCODER_ROTATE        0x10
 #define EVT_ENCODER_BTN_PRESS     0x11
 #define EVT_ENCODER_BTN_RELEASE   0x12
@@ -62,17 +298,84 @@ static const uint8_t COL_PINS[NUM_COLS] = {0, 1, 2, 3, 4};
 
 // ─── Protocol — Commands (app → device) ──────────────────────────────────────
 // The ESP stores NOTHING.  It is a dumb I/O board.
-// All configuration lives on the PC.  Only two commands remain:
+// All configuration lives on the PC; whatever the app pushes is RAM-only:
 #define CMD_IDENTIFY              0x07   // device replies with device-info
-#define CMD_SET_DEBOUNCE_LIVE     0x03   // RAM-only, lost on reboot
+#define CMD_SET_DEBOUNCE_LIVE     0x03   // [ms u16 BE] fixed for every key, or [ms u16 BE] [1]
+                                         // adaptive below ms; RAM-only, lost on reboot
+#define CMD_GET_SNAPSHOT          0x0B   // device replies with a state snapshot
+#define CMD_GET_TRACE             0x0C   // [since u32 BE]; replies with PKT_TRACE frames
+#define CMD_GET_STATS             0x0D   // device replies with performance counters
+#define CMD_SET_ENCODER_RATE_LIVE 0x0E   // uint16 BE report rate in Hz, 0 = every scan; RAM-only
+#define CMD_SET_LINK_PROFILE      0x0F   // LINK_AUTO / LINK_PERFORMANCE / LINK_BATTERY; RAM-only
+#define CMD_GET_LINK              0x10   // device replies with the negotiated link parameters
+#define CMD_SET_KEY_MAP           0x08   // [key] [type] [code] [mods] [macro len] [macro]; RAM-only
+#define CMD_SET_ENCODER_MODE      0x09   // [mode] [cw key] [cw mods] [ccw key] [ccw mods]
+                                         // [button type] [button key] [button mods]; RAM-only
+#define CMD_SET_HID_MODE          0x11   // 1 = send HID reports, 0 = off; RAM-only
+#define CMD_SET_SCAN_GOVERNOR     0x12   // GOV_MODE_*; RAM-only
+#define CMD_TIME_SYNC             0x13   // [host µs u32 BE]; that link replies at once (TimeSync.h)
+#define CMD_SET_LATENCY_TRACE     0x14   // 1 = event times after each event frame on that link
+#define CMD_SET_CAPTURE           0x15   // 1 = raw pin capture, streamed as PKT_CAPTURE (serial)
+#define CMD_GET_DEBOUNCE          0x16   // device replies with CFG_DEBOUNCE_PROFILE
+#define CMD_SET_GESTURE           0x17   // [key] [hold ms u16 BE] [double-tap ms u16 BE], or [key]
+                                         // for the defaults; key 0xFF = every key, 0 / 0 = off
+
+// ─── Protocol — Config writes (app → device) ─────────────────────────────────
+// Config characteristic / PKT_CONFIG_DATA payload: [type] [data …]
+#define CFG_KEYMAP_BEGIN          0x01   // [image bytes u16 BE]
+#define CFG_KEYMAP_DATA           0x02   // [offset u16 BE] [image bytes …]
+#define CFG_KEYMAP_COMMIT         0x03   // [CRC-16/CCITT-FALSE of the image u16 BE]
+#define CFG_KEYMAP_STATUS         0x04   // device → app: [status] [layers] [sequences] [CRC u16 BE]
+#define CFG_DEBOUNCE_PROFILE      0x05   // device → app: [adaptive] [ceiling ms] [keys]
+                                         // keys × [window ms] [longest burst ms]
+                                         // [chattering mask, LSB first]
+
+// CFG_KEYMAP_STATUS codes
+#define KEYMAP_OK                 0x00
+#define KEYMAP_ERR_SIZE           0x01   // larger than KEYMAP_IMAGE_MAX, or data past the end
+#define KEYMAP_ERR_CRC            0x02
+#define KEYMAP_ERR_FORMAT         0x03   // version, counts or lengths do not add up
+#define KEYMAP_ERR_ORDER          0x04   // commit without a begin
+
+// Link modes (CMD_SET_LINK_PROFILE) and profiles
+#define LINK_AUTO                 0x00
+#define LINK_PERFORMANCE          0x01
+#define LINK_BATTERY              0x02
+
+// Scan governor modes (CMD_SET_SCAN_GOVERNOR)
+#define GOV_MODE_FIXED            0x00   // full rate, always
+#define GOV_MODE_AUTO             0x01   // step down when idle, full rate on the first edge
+#define GOV_MODE_POLL             0x02   // step down when idle, no edge wake: a tap
+                                         // shorter than the idle period goes unseen
+
+// Key map types (CMD_SET_KEY_MAP), as the app defines them
+#define MAP_NONE                  0x00
+#define MAP_SINGLE_KEY            0x01   // HID keyboard usage
+#define MAP_MEDIA_KEY             0x02   // app media code, sent as a consumer usage
+#define MAP_MODIFIER_COMBO        0x03   // modifiers + usage, or a recorded macro (app)
+#define MAP_TEXT_MACRO            0x04   // app only
+#define MAP_SHORTCUT              0x05   // modifiers + usage
+#define MAP_LAUNCH_APP            0x06   // app only
+#define MAP_LAYER_HOLD            0x07   // code = layer, on while held        (key map upload)
+#define MAP_LAYER_TOGGLE          0x08   // code = layer, flips on each press
+#define MAP_SEQUENCE              0x09   // code = sequence, its steps tapped in order
+#define MAP_TRANSPARENT           0x0A   // use the next active layer below
+
+// Encoder modes (CMD_SET_ENCODER_MODE)
+#define ENC_MODE_NONE             0x00
+#define ENC_MODE_VOLUME           0x01
+#define ENC_MODE_SCROLL           0x02
+#define ENC_MODE_ZOOM             0x03
+#define ENC_MODE_BRIGHTNESS       0x04
+#define ENC_MODE_CUSTOM           0x05
 
 // ─── Firmware Version ─────────────────────────────────────────────────────────
 #define FW_VERSION_MAJOR          1
 #define FW_VERSION_MINOR          0
 #define FW_VERSION_PATCH          0
 
-// ─── No data structures on ESP ───────────────────────────────────────────────
-// All key mappings, profiles, encoder config live on the PC.
-// The ESP only sends raw hardware events (key press/release, encoder rotate).
+// ─── No data structures in flash ─────────────────────────────────────────────
+// All key mappings, profiles, encoder config live on the PC.  What the app
+// pushes (key map, encoder modes) is held in RAM and gone on reboot.
 
 #endif // CONFIG_H
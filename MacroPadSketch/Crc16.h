@@ -0,0 +1,21 @@
+// =============================================================================
+// Crc16.h — CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), table driven
+// Catches every 1- and 2-bit error and every burst up to 16 bits in a frame,
+// which the one-byte XOR checksum does not.
+// =============================================================================
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <Arduino.h>
+
+#define CRC16_INIT 0xFFFF
+
+extern const uint16_t CRC16_TABLE[256];
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t b) {
+    return (uint16_t)((crc << 8) ^ CRC16_TABLE[(uint8_t)((crc >> 8) ^ b)]);
+}
+
+uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = CRC16_INIT);
+
+#endif
@@ -2,9 +2,16 @@
 // Encoder.cpp — Rotary encoder with quadrature decoding (interrupts) + button
 // =============================================================================
 #include "Encoder.h"
+#include <driver/gpio.h>
 
-volatile int32_t RotaryEncoder::_isrPos   = 0;
-volatile uint8_t RotaryEncoder::_lastState = 0;
+volatile int32_t  RotaryEncoder::_isrPos    = 0;
+volatile uint8_t  RotaryEncoder::_lastState = 0;
+volatile uint32_t RotaryEncoder::_isrHits   = 0;
+volatile uint32_t RotaryEncoder::_edgeUs[ENCODER_EDGE_LOG]  = {};
+volatile int32_t  RotaryEncoder::_edgePos[ENCODER_EDGE_LOG] = {};
+void (* volatile  RotaryEncoder::_wakeHook)() = nullptr;
+
+static const uint32_t EDGE_MASK = ENCODER_EDGE_LOG - 1;
 
 // Gray-code transition table: maps (prev_state<<2 | curr_state) → direction
 static const int8_t ENC_TABLE[16] = {
@@ -14,18 +21,18 @@ static const int8_t ENC_TABLE[16] = {
      0,  1, -1,  0
 };
 
-void IRAM_ATTR RotaryEncoder::isrA() {
-    uint8_t s   = (digitalRead(ENC_A_PIN) << 1) | digitalRead(ENC_B_PIN);
-    uint8_t idx = (_lastState << 2) | s;
-    _isrPos    += ENC_TABLE[idx & 0x0F];
-    _lastState  = s;
-}
-
-void IRAM_ATTR RotaryEncoder::isrB() {
-    uint8_t s   = (digitalRead(ENC_A_PIN) << 1) | digitalRead(ENC_B_PIN);
-    uint8_t idx = (_lastState << 2) | s;
-    _isrPos    += ENC_TABLE[idx & 0x0F];
-    _lastState  = s;
+// Both channels share one handler: decode, then log the edge under the
+// current count and bump the count last, which publishes the entry.
+void IRAM_ATTR RotaryEncoder::onEdge() {
+    uint8_t  s   = (digitalRead(ENC_A_PIN) << 1) | digitalRead(ENC_B_PIN);
+    uint8_t  idx = (_lastState << 2) | s;
+    uint32_t n   = _isrHits;
+    _isrPos     += ENC_TABLE[idx & 0x0F];
+    _lastState   = s;
+    _edgeUs[n & EDGE_MASK]  = micros();
+    _edgePos[n & EDGE_MASK] = _isrPos;
+    _isrHits     = n + 1;
+    if (void (*hook)() = _wakeHook) hook();
 }
 
 void RotaryEncoder::begin() {
@@ -34,37 +41,112 @@ void RotaryEncoder::begin() {
     pinMode(ENC_BTN_PIN, INPUT_PULLUP);
 
     _lastState = (digitalRead(ENC_A_PIN) << 1) | digitalRead(ENC_B_PIN);
+    _reportUs  = micros() - _periodUs;           // first detent goes out at once
 
-    attachInterrupt(digitalPinToInterrupt(ENC_A_PIN), isrA, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(ENC_B_PIN), isrB, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(ENC_A_PIN), onEdge, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(ENC_B_PIN), onEdge, CHANGE);
+}
+
+// The light-sleep wake levels took the channels' edge interrupts.  Decode the
+// transition made while asleep — it may be what woke the chip — then turn the
+// interrupts back on; the count, the log and the report state carry on.
+void RotaryEncoder::resume() {
+    uint8_t s = (digitalRead(ENC_A_PIN) << 1) | digitalRead(ENC_B_PIN);
+    if (s != _lastState) onEdge();
+    gpio_set_intr_type((gpio_num_t)ENC_A_PIN, GPIO_INTR_ANYEDGE);
+    gpio_set_intr_type((gpio_num_t)ENC_B_PIN, GPIO_INTR_ANYEDGE);
+}
+
+void RotaryEncoder::setWakeHook(void (*hook)()) {
+    if (hook == _wakeHook) return;
+    _wakeHook = hook;
+    if (hook) attachInterrupt(digitalPinToInterrupt(ENC_BTN_PIN), hook, FALLING);
+    else      detachInterrupt(digitalPinToInterrupt(ENC_BTN_PIN));
 }
 
 void RotaryEncoder::update() {
     // ── Rotation ──
-    int32_t pos  = _isrPos;
-    int32_t diff = pos - _reportedPos;
+    // At most one report per _periodUs.  While the ring is more than half
+    // full the count keeps accumulating in _isrPos, so a fast spin over a
+    // congested link coalesces into fewer, larger steps instead of crowding
+    // key events out of the ring.
+    uint32_t nowUs = micros();
+    int32_t  diff  = _isrPos - _reportedPos;
+    bool     room  = !_ring || _ring->count() < _ring->capacity() / 2;
+    bool     due   = nowUs - _reportUs >= _periodUs;
+
+    if (abs(diff) >= _sensitivity && room && due) {
+        // One consistent read of the count, position and the stamps around
+        // the new edges: an unchanged _isrHits means no edge landed meanwhile.
+        // `span` new edges, measured from the last edge the previous report
+        // covered, within what the log still holds.
+        uint32_t hits, span, lastUs, firstUs, anchorUs;
+        int32_t  pos, firstPos, anchorPos;
+        do {
+            hits      = _isrHits;
+            span      = min(hits - _reportedHits, min(hits - 1, EDGE_MASK));
+            pos       = _isrPos;
+            lastUs    = _edgeUs[(hits - 1) & EDGE_MASK];
+            firstUs   = _edgeUs[(hits - span) & EDGE_MASK];
+            firstPos  = _edgePos[(hits - span) & EDGE_MASK];
+            anchorUs  = _edgeUs[(hits - 1 - span) & EDGE_MASK];
+            anchorPos = _edgePos[(hits - 1 - span) & EDGE_MASK];
+        } while (hits != _isrHits);
+
+        // The gap before the first new edge counts only if it looks like
+        // part of the same motion: at most twice the new edges' spacing, or
+        // under ENCODER_IDLE_MS when there is a single new edge.
+        if (span) {
+            uint32_t gap   = firstUs - anchorUs;
+            bool     fresh = span > 1 ? gap > 2 * ((lastUs - firstUs) / (span - 1))
+                                      : gap >= ENCODER_IDLE_MS * 1000UL;
+            if (fresh) {
+                anchorUs  = firstUs;
+                anchorPos = firstPos;
+            }
+            uint32_t dt = lastUs - anchorUs;
+            uint64_t v  = dt ? (uint64_t)abs(pos - anchorPos) * 10000000ull / ((uint64_t)dt * _sensitivity) : 0;
+            _speed = (uint16_t)min(v, (uint64_t)0xFFFF);
+        }
 
-    if (abs(diff) >= _sensitivity) {
+        diff = pos - _reportedPos;
         int8_t  dir   = (diff > 0) ? 1 : -1;
-        uint8_t steps = abs(diff) / _sensitivity;
+        uint8_t steps = (uint8_t)min(abs(diff) / _sensitivity, (int32_t)255);
         _reportedPos += dir * steps * _sensitivity;
-        if (_rotateCb) _rotateCb(dir, steps);
+        _reportedHits = hits;
+        // Keep the cadence unless we fell a whole period behind
+        _reportUs = (nowUs - _reportUs < 2 * _periodUs) ? _reportUs + _periodUs : nowUs;
+
+        if (_ring) {
+            InputEvent e = { lastUs, EVT_ENCODER_ROTATE, 0,
+                             (uint8_t)(dir > 0 ? DIR_CW : DIR_CCW), steps, 0, _speed };
+            _ring->push(e);
+        }
     }
 
     // ── Button (debounced) ──
     unsigned long now = millis();
     bool raw = (digitalRead(ENC_BTN_PIN) == LOW);
 
-    if (raw != _btnRaw) { _btnRaw = raw; _btnLastChg = now; }
+    if (raw != _btnRaw) {
+        bool settled = (_btnRaw == _btnStable) && (now - _btnLastChg) >= DEFAULT_DEBOUNCE_MS;
+        if (settled) _btnEdgeUs = micros();
+        _btnRaw = raw; _btnLastChg = now;
+    }
 
     if (_btnRaw != _btnStable && (now - _btnLastChg) >= DEFAULT_DEBOUNCE_MS) {
         _btnStable = _btnRaw;
-        if (_buttonCb) _buttonCb(_btnStable);
+        if (_ring) {
+            InputEvent e = { _btnEdgeUs,
+                             (uint8_t)(_btnStable ? EVT_ENCODER_BTN_PRESS : EVT_ENCODER_BTN_RELEASE),
+                             0, (uint8_t)_btnStable, 0 };
+            _ring->push(e);
+        }
     }
 }
 
 void RotaryEncoder::setSensitivity(uint8_t s) { _sensitivity = max((uint8_t)1, s); }
-void RotaryEncoder::setRotateCallback(RotateCallback cb) { _rotateCb = cb; }
-void RotaryEncoder::setButtonCallback(ButtonCallback cb) { _buttonCb = cb; }
+void RotaryEncoder::setReportRate(uint16_t hz) { _periodUs = hz ? 1000000UL / hz : 0; }
+void RotaryEncoder::setEventRing(EventRing* r) { _ring = r; }
 bool RotaryEncoder::isButtonPressed() const { return _btnStable; }
 int32_t RotaryEncoder::getPosition()  const { return _isrPos; }
@@ -1,38 +1,55 @@
 // =============================================================================
 // Encoder.h — Rotary encoder with quadrature decoding (interrupts) + button
+// The ISRs keep the position and a log of the last ENCODER_EDGE_LOG
+// transitions with their micros() stamps.  update() reports rotation at most
+// once per report period: the steps accumulated since the previous report,
+// stamped with the newest edge, and the speed over the edges in between.
 // =============================================================================
 #ifndef ENCODER_H
 #define ENCODER_H
 
 #include "Config.h"
-#include <functional>
+#include "EventRing.h"
+
+static_assert((ENCODER_EDGE_LOG & (ENCODER_EDGE_LOG - 1)) == 0,
+              "ENCODER_EDGE_LOG must be a power of two");
 
 class RotaryEncoder {
 public:
-    using RotateCallback = std::function<void(int8_t direction, uint8_t steps)>;
-    using ButtonCallback = std::function<void(bool pressed)>;
-
     void    begin();
+    void    resume();                       // after a light sleep, instead of begin()
     void    update();                       // call every loop()
     void    setSensitivity(uint8_t steps);
-    void    setRotateCallback(RotateCallback cb);
-    void    setButtonCallback(ButtonCallback cb);
+    void    setReportRate(uint16_t hz);     // rotate events per second, 0 = every update()
+    void    setEventRing(EventRing* ring);  // push timestamped rotate/button records
     bool    isButtonPressed() const;
     int32_t getPosition() const;
+    uint32_t isrHits()    const { return _isrHits; }   // quadrature edges since boot
+
+    // While set, every quadrature edge and a button press also call `hook`
+    // (ScanGovernor edge wake); nullptr detaches it.  ISR context.
+    void    setWakeHook(void (*hook)());
 
 private:
-    static void IRAM_ATTR isrA();
-    static void IRAM_ATTR isrB();
-    static volatile int32_t _isrPos;
-    static volatile uint8_t _lastState;
+    static void IRAM_ATTR onEdge();
+    static volatile int32_t  _isrPos;
+    static volatile uint8_t  _lastState;
+    static volatile uint32_t _isrHits;      // edges since boot; also indexes the log
+    static volatile uint32_t _edgeUs[ENCODER_EDGE_LOG];    // micros() of each edge
+    static volatile int32_t  _edgePos[ENCODER_EDGE_LOG];   // _isrPos after it
+    static void (* volatile  _wakeHook)();
 
     int32_t       _reportedPos  = 0;
+    uint32_t      _reportedHits = 0;        // _isrHits at the last report
+    uint32_t      _reportUs     = 0;        // report slot start, micros()
+    uint16_t      _speed        = 0;        // last measured, steps/s × 10
+    uint32_t      _periodUs     = ENCODER_REPORT_HZ ? 1000000 / ENCODER_REPORT_HZ : 0;
     uint8_t       _sensitivity  = DEFAULT_ENCODER_SENSITIVITY;
     bool          _btnStable    = false;
     bool          _btnRaw       = false;
     unsigned long _btnLastChg   = 0;
-    RotateCallback _rotateCb    = nullptr;
-    ButtonCallback _buttonCb    = nullptr;
+    uint32_t      _btnEdgeUs    = 0;
+    EventRing*    _ring         = nullptr;
 };
 
 #endif
@@ -0,0 +1,80 @@
+// =============================================================================
+// EventBatch.cpp — Packs several input events into one notify / serial frame
+// =============================================================================
+#include "EventBatch.h"
+
+void EventBatch::setLimit(uint16_t maxBytes) {
+    uint16_t n = maxBytes > HEADER_BYTES ? (maxBytes - HEADER_BYTES) / RECORD_BYTES : 0;
+    _cap = (uint8_t)max((uint16_t)1, min(n, (uint16_t)MAX_EVENTS));
+}
+
+bool EventBatch::add(const InputEvent& e) {
+    if (_count == 0) {
+        _minUs = _maxUs = e.tUs;
+    } else {
+        if (_count >= _cap) return false;
+        if (e.seq != (uint8_t)(_ev[0].seq + _count)) return false;
+        // Capture times are not monotonic in ring order (a debounced key is
+        // stamped at its first edge), so track the span both ways.
+        uint32_t lo = (int32_t)(e.tUs - _minUs) < 0 ? e.tUs : _minUs;
+        uint32_t hi = (int32_t)(e.tUs - _maxUs) > 0 ? e.tUs : _maxUs;
+        if (hi - lo > 0xFFFF) return false;
+        _minUs = lo;
+        _maxUs = hi;
+    }
+    _ev[_count++] = e;
+    return true;
+}
+
+bool EventBatch::onlyRotations() const {
+    for (uint8_t i = 0; i < _count; i++)
+        if (_ev[i].type != EVT_ENCODER_ROTATE) return false;
+    return true;
+}
+
+uint16_t EventBatch::build(uint8_t* out) const {
+    out[0] = _count;
+    out[1] = _ev[0].seq;
+    out[2] = (uint8_t)(_minUs >> 24);
+    out[3] = (uint8_t)(_minUs >> 16);
+    out[4] = (uint8_t)(_minUs >> 8);
+    out[5] = (uint8_t)_minUs;
+
+    uint8_t* p = out + HEADER_BYTES;
+    for (uint8_t i = 0; i < _count; i++) {
+        const InputEvent& e = _ev[i];
+        uint16_t dt = (uint16_t)(e.tUs - _minUs);
+        bool     key = isKeyEvent(e.type);
+        p[0] = (uint8_t)(dt >> 8);
+        p[1] = (uint8_t)dt;
+        p[2] = e.type;
+        p[3] = key ? e.id : e.value;
+        p[4] = key ? e.layer : e.steps;
+        p[5] = (uint8_t)(e.speed >> 8);
+        p[6] = (uint8_t)e.speed;
+        p += RECORD_BYTES;
+    }
+    return (uint16_t)(p - out);
+}
+
+uint16_t EventBatch::buildTimes(const InputEvent* ev, uint8_t n, uint32_t sentUs, uint8_t* out) {
+    out[0] = n;
+    out[1] = (uint8_t)(sentUs >> 24);
+    out[2] = (uint8_t)(sentUs >> 16);
+    out[3] = (uint8_t)(sentUs >> 8);
+    out[4] = (uint8_t)sentUs;
+
+    uint8_t* p = out + TIMES_HEADER_BYTES;
+    for (uint8_t i = 0; i < n; i++) {
+        const InputEvent& e = ev[i];
+        p[0] = e.seq;
+        p[1] = (uint8_t)(e.tUs >> 24);
+        p[2] = (uint8_t)(e.tUs >> 16);
+        p[3] = (uint8_t)(e.tUs >> 8);
+        p[4] = (uint8_t)e.tUs;
+        p[5] = (uint8_t)(e.queuedUs >> 8);
+        p[6] = (uint8_t)e.queuedUs;
+        p += TIMES_RECORD_BYTES;
+    }
+    return (uint16_t)(p - out);
+}
@@ -0,0 +1,53 @@
+// =============================================================================
+// EventBatch.h — Packs several input events into one notify / serial frame
+// Wire layout (PKT_EVENT_BATCH payload and the Event Batch characteristic):
+//   [count] [seq0] [t0 µs, uint32 BE]  then per event, in capture-ring order:
+//   [dt µs, uint16 BE] [type] [a] [b] [speed, uint16 BE]
+// Records carry consecutive sequence numbers starting at seq0; a gap in the
+// ring's numbering closes the batch.  t0 is the earliest capture time in the
+// batch and dt is each event's offset from it.  a/b are the first bytes of
+// the legacy event packets: key index / direction / button state, and key
+// map layer / rotation steps.  speed is the encoder's measured rate in
+// steps/s × 10 for rotation records and 0 for the rest.
+//
+// Latency trace (PKT_EVENT_TIMES payload and the Event Times characteristic),
+// sent right after each event frame while the link's trace mode is on
+// (CMD_SET_LATENCY_TRACE):
+//   [count] [sent µs, uint32 BE]  then per event, in the frame's order:
+//   [seq] [capture µs, uint32 BE] [queued, µs after capture, uint16 BE]
+// All device micros(): capture is the first edge, queued is when the event
+// entered the ring (debounce done), sent is when the frame went to the link.
+// =============================================================================
+#ifndef EVENT_BATCH_H
+#define EVENT_BATCH_H
+
+#include "Config.h"
+#include "EventRing.h"
+
+class EventBatch {
+public:
+    static const uint8_t HEADER_BYTES = 6;
+    static const uint8_t RECORD_BYTES = 7;
+    static const uint8_t MAX_EVENTS   = (EVENT_BATCH_MAX_BYTES - HEADER_BYTES) / RECORD_BYTES;
+    static const uint8_t TIMES_HEADER_BYTES = 5;
+    static const uint8_t TIMES_RECORD_BYTES = 7;   // never longer than the batch itself
+
+    void     setLimit(uint16_t maxBytes);    // payload cap, e.g. ATT MTU − 3
+    bool     add(const InputEvent& e);       // false: full, seq gap, or spread > 65535 µs
+    uint16_t build(uint8_t* out) const;      // serialise; returns payload bytes
+    uint16_t buildTimes(uint32_t sentUs, uint8_t* out) const { return buildTimes(_ev, _count, sentUs, out); }
+    static uint16_t buildTimes(const InputEvent* ev, uint8_t n, uint32_t sentUs, uint8_t* out);
+    void     clear()       { _count = 0; }
+    bool     empty() const { return _count == 0; }
+    uint8_t  count() const { return _count; }
+    bool     onlyRotations() const;          // nothing but EVT_ENCODER_ROTATE records
+
+private:
+    InputEvent _ev[MAX_EVENTS];
+    uint8_t    _count = 0;
+    uint8_t    _cap   = MAX_EVENTS;
+    uint32_t   _minUs = 0;
+    uint32_t   _maxUs = 0;
+};
+
+#endif
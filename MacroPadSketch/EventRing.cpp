@@ -0,0 +1,38 @@
+// =============================================================================
+// EventRing.cpp — Lock-free single-producer / single-consumer input event ring
+// =============================================================================
+#include "EventRing.h"
+
+void EventRing::begin() {
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _seq       = 0;
+    _dropped   = 0;
+    _highWater = 0;
+}
+
+// Events at or before `seq` are already reflected (or were lost, which is
+// why the snapshot exists), so only newer ones move the state.
+void InputSnapshot::apply(const InputEvent& e) {
+    if ((int8_t)(e.seq - seq) <= 0) return;
+    seq = e.seq;
+    switch (e.type) {
+    case EVT_KEY_PRESS:           maskSet(pressed, e.id);   break;
+    case EVT_KEY_RELEASE:         maskClear(pressed, e.id); break;
+    case EVT_ENCODER_BTN_PRESS:   encBtn = 1;               break;
+    case EVT_ENCODER_BTN_RELEASE: encBtn = 0;               break;
+    }
+}
+
+uint8_t InputSnapshot::build(uint8_t* out) const {
+    out[0] = seq;
+    out[1] = encBtn;
+    out[2] = NUM_KEYS;
+    for (uint8_t i = 0; i < (NUM_KEYS + 7) / 8; i++) out[3 + i] = maskByte(pressed, i);
+    return SNAPSHOT_MAX_BYTES;
+}
+
+uint16_t EventRing::count() const {
+    return (uint16_t)(_head.load(std::memory_order_acquire) -
+                      _tail.load(std::memory_order_acquire));
+}
@@ -0,0 +1,112 @@
+// =============================================================================
+// EventRing.h — Lock-free single-producer / single-consumer input event ring
+// The input task (KeyMatrix, RotaryEncoder) pushes, the transport task pops.
+// Each record keeps the micros() time its first edge was captured, so a slow
+// link delays delivery but never shifts the timestamp.  A full ring drops the
+// new record and counts it instead of blocking the producer.
+// Every push, dropped or not, takes the next 8-bit sequence number, so a host
+// sees a gap for an event lost anywhere between capture and the wire.  Push
+// also notes how long after its capture the record got here (the debounce
+// part of its latency, see the latency trace in EventBatch.h).
+// =============================================================================
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include "Config.h"
+#include "KeyMask.h"
+#include <atomic>
+
+using KeyMask = KeyMaskFor<NUM_KEYS>;     // same type as KeyMatrix::Mask
+
+static_assert((EVENT_RING_SIZE & (EVENT_RING_SIZE - 1)) == 0,
+              "EVENT_RING_SIZE must be a power of two");
+
+struct InputEvent {
+    uint32_t tUs;      // capture time, micros()
+    uint8_t  type;     // EVT_*
+    uint8_t  id;       // key index; 0 for the encoder
+    uint8_t  value;    // DIR_* for rotation, 1/0 for the encoder button
+    uint8_t  steps;    // rotation steps, 0 otherwise
+    uint8_t  seq;      // set by EventRing::push
+    uint16_t speed;    // rotation: steps/s × 10 from the ISR edge stamps, 0 otherwise
+    uint8_t  layer;    // keys: the key map layer the action came from (ActionEngine)
+    uint16_t queuedUs; // set by EventRing::push: µs from capture to the ring, saturating
+};
+
+// Press, release and the gestures: sent as key events, `id` on the wire
+inline bool isKeyEvent(uint8_t type) {
+    return type >= EVT_KEY_PRESS && type <= EVT_KEY_DOUBLE_TAP;
+}
+
+// Debounced input state as of event `seq`, for a host that saw a gap.
+// Wire layout (PKT_SNAPSHOT payload and the State characteristic):
+//   [seq] [encoder button] [key count] [pressed mask, 1 bit per key, LSB first]
+#define SNAPSHOT_MAX_BYTES  (3 + (NUM_KEYS + 7) / 8)
+
+struct InputSnapshot {
+    uint8_t  seq;       // last sequence number the state includes
+    uint8_t  encBtn;    // 1 = encoder button held
+    KeyMask  pressed;   // bit i = key index i
+
+    void    apply(const InputEvent& e);    // roll forward over a later event
+    uint8_t build(uint8_t* out) const;     // returns payload bytes
+};
+
+class EventRing {
+public:
+    void     begin();                       // empty the ring, zero the counters
+
+    bool     push(const InputEvent& e);     // producer only; false = dropped
+    uint8_t  lastSeq()   const { return (uint8_t)(_seq - 1); }   // producer only
+    bool     pop(InputEvent& e);            // consumer only; false = empty
+
+    uint16_t count()     const;
+    uint16_t capacity()  const { return EVENT_RING_SIZE; }
+    uint32_t dropped()   const { return _dropped; }
+    uint16_t highWater() const { return _highWater; }
+
+private:
+    // Free-running indices: head is written by the producer only, tail by
+    // the consumer only.  head - tail is the fill level.
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+
+    uint8_t           _seq       = 0;      // next sequence number
+    volatile uint32_t _dropped   = 0;
+    volatile uint16_t _highWater = 0;
+
+    InputEvent _buf[EVENT_RING_SIZE];
+};
+
+// push() and pop() sit on every event's path, so they are defined here to be
+// inlined into the scan, the encoder and the transport drain
+inline bool EventRing::push(const InputEvent& e) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t used = head - _tail.load(std::memory_order_acquire);
+    uint8_t  seq  = _seq++;
+
+    if (used >= EVENT_RING_SIZE) {
+        _dropped = _dropped + 1;
+        return false;
+    }
+
+    InputEvent& slot = _buf[head & (EVENT_RING_SIZE - 1)];
+    slot          = e;
+    slot.seq      = seq;
+    slot.queuedUs = (uint16_t)min((uint32_t)(micros() - e.tUs), (uint32_t)0xFFFF);
+    _head.store(head + 1, std::memory_order_release);   // publish the record
+
+    if (used + 1 > _highWater) _highWater = (uint16_t)(used + 1);
+    return true;
+}
+
+inline bool EventRing::pop(InputEvent& e) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) return false;
+
+    e = _buf[tail & (EVENT_RING_SIZE - 1)];
+    _tail.store(tail + 1, std::memory_order_release);   // hand the slot back
+    return true;
+}
+
+#endif
@@ -0,0 +1,98 @@
+// =============================================================================
+// Gestures.cpp — Tap, hold and double-tap resolved on the device
+// =============================================================================
+#include "Gestures.h"
+
+// Rows are states, columns inputs.  A key goes DOWN on its first press and
+// HELD once the hold threshold passes; a release before that leaves it UP,
+// waiting out the double-tap window for a second press (DOWN2).  Holding the
+// second press past the hold threshold is a tap, then a hold.
+const GestureEngine::Step GestureEngine::TABLE[STATES][INPUTS] = {
+    //            press           release                        hold passed                window passed
+    /* IDLE  */ { { DOWN,  0 },   { IDLE, 0 },                   { IDLE, 0 },               { IDLE, 0 }           },
+    /* DOWN  */ { { DOWN,  0 },   { UP,   0 },                   { HELD, EVT_KEY_HOLD },    { DOWN, 0 }           },
+    /* UP    */ { { DOWN2, 0 },   { UP,   0 },                   { UP,   0 },               { IDLE, EVT_KEY_TAP } },
+    /* DOWN2 */ { { DOWN2, 0 },   { IDLE, EVT_KEY_DOUBLE_TAP },  { DOWN, EVT_KEY_TAP },     { DOWN2, 0 }          },
+    /* HELD  */ { { HELD,  0 },   { IDLE, 0 },                   { HELD, 0 },               { HELD, 0 }           },
+};
+
+void GestureEngine::begin() {
+    for (uint8_t k = 0; k < NUM_KEYS; k++) {
+        _state[k]  = IDLE;
+        _holdMs[k] = _doubleMs[k] = 0;
+    }
+    _enabled  = KeyMask{};
+    _pending  = KeyMask{};
+    _resolved = 0;
+}
+
+void GestureEngine::setEventRing(EventRing* r) { _ring = r; }
+
+void GestureEngine::setKey(uint8_t key, uint16_t holdMs, uint16_t doubleTapMs) {
+    if (key >= NUM_KEYS) return;
+    if (holdMs == _holdMs[key] && doubleTapMs == _doubleMs[key]) return;
+    _holdMs[key]   = holdMs;
+    _doubleMs[key] = doubleTapMs;
+    _state[key]    = IDLE;
+    maskClear(_pending, key);
+    if (holdMs || doubleTapMs) maskSet(_enabled, key);
+    else                       maskClear(_enabled, key);
+}
+
+void GestureEngine::update(const KeyMask& pressed, const KeyMask& settling,
+                           const uint32_t* edgeUs, uint32_t nowUs) {
+    // Decide each edge at its own stamp: any threshold it came after first,
+    // then the edge, then a zero double-tap window it closes at once
+    KeyMask changed = (pressed ^ _pressed) & _enabled;
+    _pressed = pressed;
+    for (KeyMask m = changed; m; maskDropLowest(m)) {
+        uint8_t k = maskLowest(m);
+        expire(k, edgeUs[k]);
+        step(k, maskTest(pressed, k) ? IN_PRESS : IN_RELEASE, edgeUs[k]);
+        expire(k, edgeUs[k]);
+    }
+
+    // A settling key may yet turn out to have changed before its threshold
+    for (KeyMask m = _pending & (KeyMask)~settling; m; maskDropLowest(m))
+        expire(maskLowest(m), nowUs);
+}
+
+bool GestureEngine::due(uint8_t key, uint32_t tUs, uint8_t& input) const {
+    uint32_t since = tUs - _markUs[key];
+    switch (_state[key]) {
+    case DOWN:
+    case DOWN2:
+        input = IN_HOLD;
+        return _holdMs[key] && (int32_t)(since - _holdMs[key] * 1000u) >= 0;
+    case UP:
+        input = IN_WINDOW;
+        return (int32_t)(since - _doubleMs[key] * 1000u) >= 0;
+    default:
+        return false;
+    }
+}
+
+void GestureEngine::expire(uint8_t key, uint32_t tUs) {
+    uint8_t input;
+    while (due(key, tUs, input)) step(key, input, tUs);
+}
+
+void GestureEngine::step(uint8_t key, uint8_t input, uint32_t tUs) {
+    uint8_t     from = _state[key];
+    const Step& s    = TABLE[from][input];
+
+    if (s.gesture) {
+        if (_ring) {
+            InputEvent e = { _startUs[key], s.gesture, key, 0, 0 };
+            _ring->push(e);
+        }
+        _resolved++;
+    }
+    if (input == IN_PRESS || input == IN_RELEASE) _markUs[key] = tUs;
+    if (from == IDLE && s.next == DOWN) _startUs[key] = tUs;
+    if (from == DOWN2 && s.next == DOWN) _startUs[key] = _markUs[key];   // tap, then a new press
+
+    _state[key] = s.next;
+    if (s.next == DOWN || s.next == UP || s.next == DOWN2) maskSet(_pending, key);
+    else                                                  maskClear(_pending, key);
+}
@@ -0,0 +1,74 @@
+// =============================================================================
+// Gestures.h — Tap, hold and double-tap resolved on the device
+// Runs on KeyMatrix's debounced state, once per scan, and decides each
+// gesture from the capture stamps of the key's first edges, never from when
+// an event reached a host, so connection-interval jitter cannot move a key
+// across a threshold.  Every key has its own hold and double-tap thresholds
+// (CMD_SET_GESTURE); a key with neither set is left alone.  Resolved gestures
+// go into the event ring as EVT_KEY_TAP / EVT_KEY_HOLD / EVT_KEY_DOUBLE_TAP,
+// stamped at the gesture's first press edge; the plain presses and releases
+// still go out, ahead of the gesture they resolve.
+//
+// Each key is a small state machine driven by a table of (state, input) →
+// (next state, gesture): the inputs are a debounced press or release and the
+// hold or double-tap threshold passing.  A threshold is only judged once the
+// key has settled, so a release still inside its debounce window is timed at
+// its own edge, not at the scan that confirms it.
+// Input task only: CMD_SET_GESTURE reaches setKey() through it (.ino).
+// =============================================================================
+#ifndef GESTURES_H
+#define GESTURES_H
+
+#include "Config.h"
+#include "EventRing.h"
+
+class GestureEngine {
+public:
+    void begin();                                   // every key off, nothing pending
+    void setEventRing(EventRing* ring);
+
+    // Thresholds for one key; hold 0 = no hold, double-tap 0 = a tap resolves
+    // at its release.  Both 0 turns the key off.  A change drops the key's
+    // gesture in progress.
+    void     setKey(uint8_t key, uint16_t holdMs, uint16_t doubleTapMs);
+    uint16_t holdMs(uint8_t key) const      { return _holdMs[key]; }
+    uint16_t doubleTapMs(uint8_t key) const { return _doubleMs[key]; }
+
+    // Once per scan, after KeyMatrix: `pressed` its debounced state,
+    // `settling` the keys with a debounce window open, `edgeUs` each key's
+    // first-edge stamp of its latest change (KeyMatrix::edgeStamps())
+    void update(const KeyMask& pressed, const KeyMask& settling,
+                const uint32_t* edgeUs, uint32_t nowUs);
+
+    // A gesture waits on a threshold: keep scanning at full rate
+    bool pending() const { return (bool)_pending; }
+
+    uint32_t resolved() const { return _resolved; }   // gestures pushed, since begin()
+
+private:
+    enum : uint8_t { IDLE, DOWN, UP, DOWN2, HELD, STATES };
+    enum : uint8_t { IN_PRESS, IN_RELEASE, IN_HOLD, IN_WINDOW, INPUTS };
+
+    struct Step {
+        uint8_t next;
+        uint8_t gesture;                            // EVT_KEY_* or 0
+    };
+    static const Step TABLE[STATES][INPUTS];
+
+    void step(uint8_t key, uint8_t input, uint32_t tUs);
+    bool due(uint8_t key, uint32_t tUs, uint8_t& input) const;
+    void expire(uint8_t key, uint32_t tUs);        // every threshold passed by tUs
+
+    uint8_t    _state[NUM_KEYS]    = {};
+    uint16_t   _holdMs[NUM_KEYS]   = {};
+    uint16_t   _doubleMs[NUM_KEYS] = {};
+    uint32_t   _startUs[NUM_KEYS]  = {};           // first press of the gesture
+    uint32_t   _markUs[NUM_KEYS]   = {};           // latest press or release
+    KeyMask    _enabled  = {};
+    KeyMask    _pending  = {};                      // not IDLE
+    KeyMask    _pressed  = {};                      // as of the last update()
+    uint32_t   _resolved = 0;
+    EventRing* _ring     = nullptr;
+};
+
+#endif
@@ -0,0 +1,174 @@
+// =============================================================================
+// HidReports.cpp — Key actions → HID keyboard, consumer-control and mouse reports
+// =============================================================================
+#include "HidReports.h"
+
+// Keyboard (id 1): 8 modifier bits, a reserved byte, 6 usages.
+// Consumer control (id 2): one 16-bit usage.
+// Mouse (id 3): 3 buttons, X, Y, wheel and AC Pan, all relative.
+const uint8_t HID_REPORT_MAP[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, HID_REPORT_KEYBOARD,
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01,
+    0x75, 0x01, 0x95, 0x08, 0x81, 0x02,                   //   modifiers
+    0x75, 0x08, 0x95, 0x01, 0x81, 0x01,                   //   reserved
+    0x05, 0x07, 0x19, 0x00, 0x2A, 0xFF, 0x00, 0x15, 0x00, 0x26, 0xFF, 0x00,
+    0x75, 0x08, 0x95, 0x06, 0x81, 0x00,                   //   usages
+    0xC0,
+
+    0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, HID_REPORT_CONSUMER,
+    0x19, 0x00, 0x2A, 0xFF, 0x03, 0x15, 0x00, 0x26, 0xFF, 0x03,
+    0x75, 0x10, 0x95, 0x01, 0x81, 0x00,
+    0xC0,
+
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, HID_REPORT_MOUSE,
+    0x09, 0x01, 0xA1, 0x00,
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01,
+    0x75, 0x01, 0x95, 0x03, 0x81, 0x02,                   //   buttons
+    0x75, 0x05, 0x95, 0x01, 0x81, 0x01,                   //   padding
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x38, 0x15, 0x81, 0x25, 0x7F,
+    0x75, 0x08, 0x95, 0x03, 0x81, 0x06,                   //   X, Y, wheel
+    0x05, 0x0C, 0x0A, 0x38, 0x02, 0x95, 0x01, 0x81, 0x06, //   AC Pan
+    0xC0, 0xC0,
+};
+const uint16_t HID_REPORT_MAP_BYTES = sizeof(HID_REPORT_MAP);
+
+static const uint8_t ROLLOVER = 0x01;     // ErrorRollOver: more than 6 usages held
+
+// The app's media codes are mostly consumer usages already; its volume and
+// mute codes come from the keyboard page's media block.
+static uint16_t consumerUsage(uint8_t code) {
+    switch (code) {
+    case 0xE8: return 0x00EA;             // volume down
+    case 0xE9: return 0x00E9;             // volume up
+    case 0xEA: return 0x00E2;             // mute
+    default:   return code;
+    }
+}
+
+static bool isMedia(const KeyAction& a) { return a.type == MAP_MEDIA_KEY; }
+
+bool HidReports::onDevice(const KeyAction& a) {
+    switch (a.type) {
+    case MAP_SINGLE_KEY:
+    case MAP_MEDIA_KEY:
+    case MAP_MODIFIER_COMBO:
+    case MAP_SHORTCUT:
+        return a.code || a.mods;
+    default:
+        return false;
+    }
+}
+
+// ── Report builders: the state of everything held ────────────────────────────
+void HidReports::keyboard(HidReport& r, uint8_t extraMods) const {
+    r.id  = HID_REPORT_KEYBOARD;
+    r.len = HID_KEYBOARD_BYTES;
+    for (uint8_t i = 0; i < HID_KEYBOARD_BYTES; i++) r.data[i] = 0;
+
+    uint8_t mods = extraMods, n = 0;
+    bool    over = false;
+    for (uint8_t i = 0; i < _numHeld; i++) {
+        const KeyAction& a = _held[i].a;
+        if (isMedia(a)) continue;
+        mods |= a.mods;
+        if (a.code >= 0xE0 && a.code <= 0xE7) { mods |= 1 << (a.code - 0xE0); continue; }
+        if (!a.code) continue;
+
+        bool dup = false;
+        for (uint8_t k = 0; k < n; k++) dup |= r.data[2 + k] == a.code;
+        if (dup) continue;
+        if (n == 6) { over = true; continue; }
+        r.data[2 + n++] = a.code;
+    }
+    if (over)
+        for (uint8_t k = 0; k < 6; k++) r.data[2 + k] = ROLLOVER;
+    r.data[0] = mods;
+}
+
+// One usage at a time: the most recently pressed media key still held
+void HidReports::consumer(HidReport& r) const {
+    uint16_t usage = 0;
+    for (uint8_t i = _numHeld; i-- > 0;)
+        if (isMedia(_held[i].a)) { usage = consumerUsage(_held[i].a.code); break; }
+    r.id      = HID_REPORT_CONSUMER;
+    r.len     = HID_CONSUMER_BYTES;
+    r.data[0] = (uint8_t)usage;
+    r.data[1] = (uint8_t)(usage >> 8);
+}
+
+void HidReports::mouse(HidReport& r, int8_t wheel) const {
+    r.id  = HID_REPORT_MOUSE;
+    r.len = HID_MOUSE_BYTES;
+    for (uint8_t i = 0; i < HID_MOUSE_BYTES; i++) r.data[i] = 0;
+    r.data[3] = (uint8_t)wheel;
+}
+
+// ── Held actions ─────────────────────────────────────────────────────────────
+uint8_t HidReports::press(uint8_t slot, const KeyAction& a, HidReport* out) {
+    if (!onDevice(a) || _numHeld == HID_MAX_HELD) return 0;
+    _held[_numHeld++] = { slot, a };
+    if (isMedia(a)) consumer(out[0]);
+    else            keyboard(out[0], 0);
+    return 1;
+}
+
+uint8_t HidReports::release(uint8_t slot, HidReport* out) {
+    for (uint8_t i = 0; i < _numHeld; i++) {
+        if (_held[i].slot != slot) continue;
+        KeyAction a = _held[i].a;
+        for (uint8_t k = i + 1; k < _numHeld; k++) _held[k - 1] = _held[k];
+        _numHeld--;
+        if (isMedia(a)) consumer(out[0]);
+        else            keyboard(out[0], 0);
+        return 1;
+    }
+    return 0;
+}
+
+// Press and release `a` n times, on top of whatever is held
+uint8_t HidReports::taps(const KeyAction& a, uint8_t n, HidReport* out) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < n && i < HID_MAX_TAPS; i++) {
+        if (!press(TAP_SLOT, a, out + count)) break;
+        count++;
+        count += release(TAP_SLOT, out + count);
+    }
+    return count;
+}
+
+uint8_t HidReports::rotate(const InputEvent& e, const EncoderMap& m, HidReport* out) {
+    bool    cw    = e.value == DIR_CW;
+    uint8_t steps = e.steps;
+    int8_t  wheel = (int8_t)(steps > 127 ? 127 : steps);
+    if (!cw) wheel = (int8_t)-wheel;
+
+    switch (m.mode) {
+    case ENC_MODE_VOLUME:
+        return taps({ MAP_MEDIA_KEY, (uint8_t)(cw ? 0xE9 : 0xE8), 0 }, steps, out);
+    case ENC_MODE_BRIGHTNESS:
+        return taps({ MAP_MEDIA_KEY, (uint8_t)(cw ? 0x6F : 0x70), 0 }, steps, out);
+    case ENC_MODE_CUSTOM:
+        return taps(cw ? m.cw : m.ccw, steps, out);
+    case ENC_MODE_SCROLL:
+        mouse(out[0], wheel);
+        return 1;
+    case ENC_MODE_ZOOM:
+        keyboard(out[0], 0x01);            // left Ctrl around the wheel
+        mouse(out[1], wheel);
+        keyboard(out[2], 0);
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+uint8_t HidReports::releaseAll(HidReport* out) {
+    if (!_numHeld) return 0;
+    bool keys = false, media = false;
+    for (uint8_t i = 0; i < _numHeld; i++) (isMedia(_held[i].a) ? media : keys) = true;
+    _numHeld = 0;
+    uint8_t n = 0;
+    if (keys)  keyboard(out[n++], 0);
+    if (media) consumer(out[n++]);
+    return n;
+}
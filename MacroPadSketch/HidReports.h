@@ -0,0 +1,79 @@
+// =============================================================================
+// HidReports.h — Key actions → HID keyboard, consumer-control and mouse reports
+// ActionEngine resolves what each key does; this class keeps what is held and
+// turns each press, release, tap or encoder turn into the HID input reports
+// that carry it, in the order they must be sent: a key press is one report,
+// an encoder detent in volume mode is a press and a release.  No NimBLE here
+// — BleService notifies the reports, and the host build drives this class
+// directly.
+// =============================================================================
+#ifndef HID_REPORTS_H
+#define HID_REPORTS_H
+
+#include "Config.h"
+#include "EventRing.h"
+
+// Report ids and payload sizes, as declared in HID_REPORT_MAP
+#define HID_REPORT_KEYBOARD   1     // [modifiers] [0] [6 × usage]
+#define HID_REPORT_CONSUMER   2     // [usage u16 LE]
+#define HID_REPORT_MOUSE      3     // [buttons] [x] [y] [wheel] [pan]
+#define HID_KEYBOARD_BYTES    8
+#define HID_CONSUMER_BYTES    2
+#define HID_MOUSE_BYTES       5
+#define HID_REPORTS_MAX       (2 * HID_MAX_TAPS)   // from one event
+
+extern const uint8_t  HID_REPORT_MAP[];
+extern const uint16_t HID_REPORT_MAP_BYTES;
+
+struct KeyAction {
+    uint8_t type;       // MAP_*
+    uint8_t code;       // HID keyboard usage, or the app's media key code
+    uint8_t mods;       // HID modifier bits, left Ctrl = 0x01 … right GUI = 0x80
+};
+
+struct EncoderMap {
+    uint8_t   mode;     // ENC_MODE_*
+    KeyAction cw;       // ENC_MODE_CUSTOM, tapped once per step
+    KeyAction ccw;
+    KeyAction button;   // pressed and released with the encoder button
+};
+
+struct HidReport {
+    uint8_t id;         // HID_REPORT_*
+    uint8_t len;
+    uint8_t data[HID_KEYBOARD_BYTES];
+};
+
+class HidReports {
+public:
+    static const uint8_t ENC_SLOT = 0xFF;     // the encoder button
+    static const uint8_t TAP_SLOT = 0xFE;     // a tap in progress
+
+    // False for actions the app still performs (text, recorded macros, launch)
+    static bool onDevice(const KeyAction& a);
+
+    // Each returns how many reports it wrote to `out`, in order.  A slot is
+    // a key index or ENC_SLOT; release() sends what the slot pressed.
+    uint8_t press(uint8_t slot, const KeyAction& a, HidReport* out);
+    uint8_t release(uint8_t slot, HidReport* out);
+    uint8_t taps(const KeyAction& a, uint8_t n, HidReport* out);   // ≤ 2 × HID_MAX_TAPS
+    uint8_t rotate(const InputEvent& e, const EncoderMap& m, HidReport* out);
+    uint8_t releaseAll(HidReport* out);
+
+private:
+    // A held slot keeps the action it was pressed with, so remapping a key
+    // while it is down still releases what was sent.
+    struct Held {
+        uint8_t   slot;
+        KeyAction a;
+    };
+
+    void keyboard(HidReport& r, uint8_t extraMods) const;
+    void consumer(HidReport& r) const;
+    void mouse(HidReport& r, int8_t wheel) const;
+
+    Held       _held[HID_MAX_HELD];
+    uint8_t    _numHeld = 0;
+};
+
+#endif
@@ -0,0 +1,103 @@
+// =============================================================================
+// KeyMask.h — One bit per key, sized for the board at compile time
+// Up to 64 keys the mask is the smallest unsigned integer that holds them;
+// past that it is an array of 32-bit words with the same operators.  The
+// mask* helpers below work on either, so KeyMatrix's vertical-counter
+// debounce and the snapshot code are written once for every layout.
+// =============================================================================
+#ifndef KEY_MASK_H
+#define KEY_MASK_H
+
+#include <stdint.h>
+#include <type_traits>
+
+template <uint16_t BITS>
+struct WideMask {
+    static const uint8_t WORDS = (BITS + 31) / 32;
+    uint32_t w[WORDS];
+
+    constexpr WideMask() : w{} {}
+
+    WideMask& operator&=(const WideMask& o) { for (uint8_t i = 0; i < WORDS; i++) w[i] &= o.w[i]; return *this; }
+    WideMask& operator|=(const WideMask& o) { for (uint8_t i = 0; i < WORDS; i++) w[i] |= o.w[i]; return *this; }
+    WideMask& operator^=(const WideMask& o) { for (uint8_t i = 0; i < WORDS; i++) w[i] ^= o.w[i]; return *this; }
+
+    WideMask operator&(const WideMask& o) const { WideMask r = *this; return r &= o; }
+    WideMask operator|(const WideMask& o) const { WideMask r = *this; return r |= o; }
+    WideMask operator^(const WideMask& o) const { WideMask r = *this; return r ^= o; }
+    WideMask operator~() const {
+        WideMask r;
+        for (uint8_t i = 0; i < WORDS; i++) r.w[i] = ~w[i];
+        return r;
+    }
+
+    bool operator==(const WideMask& o) const {
+        for (uint8_t i = 0; i < WORDS; i++) if (w[i] != o.w[i]) return false;
+        return true;
+    }
+    bool operator!=(const WideMask& o) const { return !(*this == o); }
+
+    explicit operator bool() const {
+        uint32_t any = 0;
+        for (uint8_t i = 0; i < WORDS; i++) any |= w[i];
+        return any != 0;
+    }
+};
+
+template <uint16_t N>
+using KeyMaskFor =
+    typename std::conditional<(N <= 16), uint16_t,
+    typename std::conditional<(N <= 32), uint32_t,
+    typename std::conditional<(N <= 64), uint64_t, WideMask<N>>::type>::type>::type;
+
+// Bits 0 … n−1 set; usable in constant expressions for either kind
+template <class M>
+constexpr M maskFirst(uint8_t n) {
+    if constexpr (std::is_integral<M>::value) {
+        return n >= 8 * sizeof(M) ? (M)~(M)0 : (M)((((uint64_t)1) << n) - 1);
+    } else {
+        M m;
+        for (uint8_t i = 0; i < M::WORDS; i++) {
+            uint16_t lo = 32 * i;
+            m.w[i] = n >= lo + 32 ? 0xFFFFFFFFu : n > lo ? (uint32_t)((1ull << (n - lo)) - 1) : 0;
+        }
+        return m;
+    }
+}
+
+// ── Integer masks ────────────────────────────────────────────────────────────
+template <class M> inline bool maskTest(M m, uint8_t i)    { return (m >> i) & 1; }
+template <class M> inline void maskSet(M& m, uint8_t i)    { m |=  (M)((M)1 << i); }
+template <class M> inline void maskClear(M& m, uint8_t i)  { m &= (M)~((M)1 << i); }
+template <class M> inline uint8_t maskByte(M m, uint8_t i) { return (uint8_t)(m >> (8 * i)); }
+template <class M> inline void maskDropLowest(M& m)        { m &= (M)(m - 1); }
+template <class M> inline uint8_t maskLowest(M m) {         // m ≠ 0
+    return sizeof(M) <= 4 ? (uint8_t)__builtin_ctz((uint32_t)m) : (uint8_t)__builtin_ctzll(m);
+}
+// OR `bits` in at bit `shift`; with a constant shift this is one or two ops
+template <class M> inline void maskOr(M& m, uint32_t bits, uint8_t shift) {
+    m |= (M)((M)bits << shift);
+}
+
+// ── Word-array masks ─────────────────────────────────────────────────────────
+template <uint16_t B> inline bool maskTest(const WideMask<B>& m, uint8_t i)    { return (m.w[i >> 5] >> (i & 31)) & 1; }
+template <uint16_t B> inline void maskSet(WideMask<B>& m, uint8_t i)           { m.w[i >> 5] |=  (1u << (i & 31)); }
+template <uint16_t B> inline void maskClear(WideMask<B>& m, uint8_t i)         { m.w[i >> 5] &= ~(1u << (i & 31)); }
+template <uint16_t B> inline uint8_t maskByte(const WideMask<B>& m, uint8_t i) { return (uint8_t)(m.w[i >> 2] >> (8 * (i & 3))); }
+
+template <uint16_t B> inline void maskDropLowest(WideMask<B>& m) {
+    for (uint8_t i = 0; i < WideMask<B>::WORDS; i++)
+        if (m.w[i]) { m.w[i] &= m.w[i] - 1; return; }
+}
+template <uint16_t B> inline uint8_t maskLowest(const WideMask<B>& m) {
+    for (uint8_t i = 0; i < WideMask<B>::WORDS; i++)
+        if (m.w[i]) return (uint8_t)(32 * i + __builtin_ctz(m.w[i]));
+    return 0;
+}
+template <uint16_t B> inline void maskOr(WideMask<B>& m, uint32_t bits, uint8_t shift) {
+    uint8_t word = shift >> 5, off = shift & 31;
+    m.w[word] |= bits << off;
+    if (off && word + 1 < WideMask<B>::WORDS) m.w[word + 1] |= bits >> (32 - off);
+}
+
+#endif
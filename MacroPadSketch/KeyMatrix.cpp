@@ -1,55 +1,284 @@
 // =============================================================================
-// KeyMatrix.cpp — 2×5 matrix scanning with debounce
+// KeyMatrix.cpp — Key matrix scanning with debounce
+// Member definitions for KeyMatrixT; the board in Config.h is instantiated at
+// the bottom, so other translation units only see the declarations.
 // =============================================================================
 #include "KeyMatrix.h"
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
 
-void KeyMatrix::begin() {
-    for (int r = 0; r < NUM_ROWS; r++) {
-        pinMode(ROW_PINS[r], OUTPUT);
-        digitalWrite(ROW_PINS[r], HIGH);
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::begin() {
+    for (uint8_t r = 0; r < ROWS; r++) {
+        pinMode(Rows::pins[r], OUTPUT);
+        digitalWrite(Rows::pins[r], HIGH);
     }
-    for (int c = 0; c < NUM_COLS; c++) {
-        pinMode(COL_PINS[c], INPUT_PULLUP);
+    for (uint8_t c = 0; c < COLS; c++) pinMode(Cols::pins[c], INPUT_PULLUP);
+
+    setDebounceMs(_window);
+    _quiet    = ALL_KEYS;
+    _lastTick = millis();
+}
+
+// ── Sample every key: one input-register read per row ────────────────────────
+// Rows and columns unroll at compile time; every pin, shift and mask below is
+// a constant.
+template <class Rows, class Cols>
+typename KeyMatrixT<Rows, Cols>::Mask KeyMatrixT<Rows, Cols>::readRaw() {
+    return readRows(std::make_index_sequence<ROWS>{});
+}
+
+template <class Rows, class Cols>
+template <size_t... I>
+typename KeyMatrixT<Rows, Cols>::Mask KeyMatrixT<Rows, Cols>::readRows(std::index_sequence<I...>) {
+    Mask raw = {};
+    (readRow<I>(raw), ...);
+    return raw;
+}
+
+template <class Rows, class Cols>
+template <size_t I>
+void KeyMatrixT<Rows, Cols>::readRow(Mask& raw) {
+    constexpr uint8_t pin = Rows::pins[I];
+    digitalWrite(pin, LOW);
+    delayMicroseconds(10);   // settling time
+
+    uint32_t low = ~REG_READ(GPIO_IN_REG) & COL_MASK;   // pressed = LOW
+    uint32_t bits;
+    if constexpr (COLS_DENSE) bits = low >> COL_SHIFT;
+    else                      bits = gatherCols(low, std::make_index_sequence<COLS>{});
+    maskOr(raw, bits, I * COLS);
+
+    digitalWrite(pin, HIGH);
+}
+
+template <class Rows, class Cols>
+template <size_t... I>
+uint32_t KeyMatrixT<Rows, Cols>::gatherCols(uint32_t low, std::index_sequence<I...>) {
+    return ((((low >> Cols::pins[I]) & 1u) << I) | ...);
+}
+
+// ── Age every unsettled key's counter by one millisecond per iteration ───────
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::tick(uint32_t ms) {
+    if (ms > _window) ms = _window;   // one full window saturates every counter
+
+    while (ms-- && _quiet != ALL_KEYS) {
+        Mask carry = ALL_KEYS & ~_quiet;
+        for (uint8_t b = 0; b < _planes; b++) {
+            Mask c  = _cnt[b] & carry;
+            _cnt[b] ^= carry;
+            carry   = c;
+        }
+
+        // Count equal to the key's own window, plane by plane
+        Mask done = ALL_KEYS;
+        for (uint8_t b = 0; b < _planes; b++)
+            done &= (Mask)~(_cnt[b] ^ _win[b]);
+        _quiet |= done;
     }
 }
 
-void KeyMatrix::scan() {
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::scan() { scanAt(micros(), _eager); }
+
+// The chip only wakes for a column level held through its wake-up, so what
+// the first scan finds down is a press, not a bounce, and it closed no later
+// than the wake.
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::wakeScan(uint32_t wokeUs) { scanAt(wokeUs, true); }
+
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::scanAt(uint32_t edgeUs, bool eager) {
     unsigned long now = millis();
+    Mask wasQuiet = _quiet;
+    tick(now - _lastTick);
+    _lastTick = now;
+
+    // Bursts whose window just ran out
+    for (Mask m = _quiet & (Mask)~wasQuiet; m; maskDropLowest(m)) burstEnd(maskLowest(m));
+
+    Mask raw     = readRaw();
+    Mask changed = raw ^ _raw;
+    Mask before  = _stable;
+    _raw = raw;
+
+    // First edge of a burst is the capture time; later bounces keep it
+    for (Mask m = changed & _quiet; m; maskDropLowest(m)) burstStart(maskLowest(m), edgeUs);
+    for (Mask m = changed; m; maskDropLowest(m)) {
+        uint8_t idx = maskLowest(m);
+        _lastEdgeUs[idx] = edgeUs;
+        if (_edges[idx] < 0xFF) _edges[idx]++;
+    }
+
+    // Eager: a press on a key that had settled goes out on its first edge
+    if (eager) _stable |= changed & raw & _quiet;
+
+    // Any edge restarts that key's window
+    if (changed) {
+        _quiet &= ~changed;
+        for (uint8_t b = 0; b < _planes; b++) _cnt[b] &= ~changed;
+        if (_window == 0) _quiet = ALL_KEYS;
+    }
 
-    for (int r = 0; r < NUM_ROWS; r++) {
-        digitalWrite(ROW_PINS[r], LOW);
-        delayMicroseconds(10);   // settling time
-
-        for (int c = 0; c < NUM_COLS; c++) {
-            uint8_t idx     = r * NUM_COLS + c;
-            bool    pressed = (digitalRead(COL_PINS[c]) == LOW);
-
-            if (pressed != _raw[idx]) {
-                _raw[idx]        = pressed;
-                _lastChange[idx] = now;
-            }
-
-            if (_raw[idx] != _stable[idx] &&
-                (now - _lastChange[idx]) >= _debounceMs)
-            {
-                _stable[idx] = _raw[idx];
-                if (_cb) _cb(idx, _stable[idx]);
-            }
+    // A level held for the whole window becomes the stable state
+    _stable ^= (raw ^ _stable) & _quiet;
+
+    Mask diff = _stable ^ before;
+    while (diff) {
+        uint8_t idx = maskLowest(diff);
+        maskDropLowest(diff);
+        bool pressed = maskTest(_stable, idx);
+        if (_ring) {
+            InputEvent e = { _edgeUs[idx], (uint8_t)(pressed ? EVT_KEY_PRESS : EVT_KEY_RELEASE),
+                             idx, (uint8_t)pressed, 0 };
+            _ring->push(e);
         }
-        digitalWrite(ROW_PINS[r], HIGH);
     }
 }
 
-void KeyMatrix::setDebounceMs(uint16_t ms) { _debounceMs = ms; }
-void KeyMatrix::setCallback(KeyCallback cb) { _cb = cb; }
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::setDebounceMs(uint16_t ms) {
+    const uint16_t maxWindow = (1u << COUNTER_BITS) - 1;
+    _window = (uint8_t)(ms > maxWindow ? maxWindow : ms);
+    _planes = 0;
+    while ((_window >> _planes) != 0) _planes++;
+    applyWindows();
+}
 
-bool KeyMatrix::isKeyPressed(uint8_t i) const {
-    return (i < NUM_KEYS) ? _stable[i] : false;
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::setAdaptiveDebounce(bool on) {
+    _adaptive = on;
+    applyWindows();
 }
 
-uint16_t KeyMatrix::getPressedMask() const {
-    uint16_t mask = 0;
-    for (int i = 0; i < NUM_KEYS; i++)
-        if (_stable[i]) mask |= (1 << i);
-    return mask;
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::relearnDebounce() {
+    for (uint8_t i = 0; i < KEYS; i++) _edges[i] = _bursts[i] = _bounce[i] = 0;
+    _chatter = Mask{};
+    applyWindows();
 }
+
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::applyWindows() {
+    for (uint8_t i = 0; i < KEYS; i++) setKeyWindow(i, learnedWindow(i));
+
+    // Counters may already be past a shorter window — restart them all.
+    // Settled keys stay settled, so their next edge still gets its stamp.
+    for (Mask& c : _cnt) c = Mask{};
+    if (_window == 0) _quiet = ALL_KEYS;
+}
+
+// ── Adaptive debounce ────────────────────────────────────────────────────────
+// A key's bursts are timed in whole scans, from the first edge after it
+// settled to the last edge before its window ran out.
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::burstStart(uint8_t idx, uint32_t edgeUs) {
+    // So soon after the last burst's final edge that it must be the same
+    // burst, cut in two by a window shorter than one of its gaps
+    if (_bursts[idx] && edgeUs - _lastEdgeUs[idx] < DEBOUNCE_CHATTER_MS * 1000u) {
+        uint32_t ms = (edgeUs - _edgeUs[idx] + 999) / 1000;       // both halves, at least
+        if (ms > _bounce[idx]) _bounce[idx] = (uint8_t)(ms > 0xFF ? 0xFF : ms);
+        maskSet(_chatter, idx);
+        _chatterCount++;
+        _chatterKey  = idx;
+        _bursts[idx] = 0;
+        if (_adaptive) setKeyWindow(idx, _window);
+    }
+    _edgeUs[idx] = edgeUs;
+    _edges[idx]  = 0;
+}
+
+// An odd number of edges changed the level: a press or a release, and its
+// length is the switch's bounce.  An even number was a glitch, or a tap
+// shorter than the window, and says nothing about the bounce.
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::burstEnd(uint8_t idx) {
+    if (!(_edges[idx] & 1)) return;
+    uint32_t ms = (_lastEdgeUs[idx] - _edgeUs[idx] + 999) / 1000;
+    if (ms > _bounce[idx]) _bounce[idx] = (uint8_t)(ms > 0xFF ? 0xFF : ms);
+    if (_bursts[idx] < DEBOUNCE_LEARN_BURSTS) _bursts[idx]++;
+
+    uint8_t w = learnedWindow(idx);
+    if (_bursts[idx] == DEBOUNCE_LEARN_BURSTS && neededWindow(idx) >= _window)
+        maskSet(_chatter, idx);                                   // worn: needs the ceiling
+    if (w != _keyWindow[idx]) setKeyWindow(idx, w);
+}
+
+// Longest burst × 1.5, one scan for the timing, and the margin
+template <class Rows, class Cols>
+uint16_t KeyMatrixT<Rows, Cols>::neededWindow(uint8_t idx) const {
+    uint16_t b = _bounce[idx];
+    uint16_t w = b + b / 2 + 1000 / SCAN_RATE_HZ + DEBOUNCE_MARGIN_MS;
+    return w < DEBOUNCE_MIN_MS ? DEBOUNCE_MIN_MS : w;
+}
+
+template <class Rows, class Cols>
+uint8_t KeyMatrixT<Rows, Cols>::learnedWindow(uint8_t idx) const {
+    if (!_adaptive || _bursts[idx] < DEBOUNCE_LEARN_BURSTS) return _window;
+    uint16_t w = neededWindow(idx);
+    return (uint8_t)(w < _window ? w : _window);
+}
+
+// Only while the key's counter is stopped or about to restart: a counter
+// already past a shorter window would never meet it
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::setKeyWindow(uint8_t idx, uint8_t ms) {
+    _keyWindow[idx] = ms;
+    for (uint8_t b = 0; b < COUNTER_BITS; b++) {
+        if ((ms >> b) & 1) maskSet(_win[b], idx);
+        else               maskClear(_win[b], idx);
+    }
+}
+
+// [CFG_DEBOUNCE_PROFILE] [adaptive] [ceiling ms] [keys]
+//   keys × [window ms] [longest burst ms]   [chattering mask, LSB first]
+template <class Rows, class Cols>
+uint16_t KeyMatrixT<Rows, Cols>::buildProfile(uint8_t* out) const {
+    uint16_t n = 0;
+    out[n++] = CFG_DEBOUNCE_PROFILE;
+    out[n++] = _adaptive;
+    out[n++] = _window;
+    out[n++] = KEYS;
+    for (uint8_t i = 0; i < KEYS; i++) {
+        out[n++] = _keyWindow[i];
+        out[n++] = _bounce[i];
+    }
+    for (uint8_t i = 0; i < (KEYS + 7) / 8; i++) out[n++] = maskByte(_chatter, i);
+    return n;
+}
+
+// ── Edge wake ────────────────────────────────────────────────────────────────
+// The column ISRs go on before the rows go down, so a key that closed during
+// the last scan raises one at once.
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::armWake(void (*isr)()) {
+    if (_armed) return;
+    for (uint8_t c = 0; c < COLS; c++)
+        attachInterrupt(digitalPinToInterrupt(Cols::pins[c]), isr, FALLING);
+    for (uint8_t r = 0; r < ROWS; r++) digitalWrite(Rows::pins[r], LOW);
+    _armed = true;
+}
+
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::disarmWake() {
+    if (!_armed) return;
+    for (uint8_t c = 0; c < COLS; c++) detachInterrupt(digitalPinToInterrupt(Cols::pins[c]));
+    for (uint8_t r = 0; r < ROWS; r++) digitalWrite(Rows::pins[r], HIGH);
+    _armed = false;
+}
+
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::setEagerPress(bool eager)   { _eager = eager; }
+template <class Rows, class Cols>
+void KeyMatrixT<Rows, Cols>::setEventRing(EventRing* r)  { _ring = r; }
+
+template <class Rows, class Cols>
+bool KeyMatrixT<Rows, Cols>::isKeyPressed(uint8_t i) const {
+    return (i < KEYS) ? maskTest(_stable, i) : false;
+}
+
+template <class Rows, class Cols>
+typename KeyMatrixT<Rows, Cols>::Mask KeyMatrixT<Rows, Cols>::getPressedMask() const { return _stable; }
+
+template class KeyMatrixT<RowPins, ColPins>;
@@ -1,30 +1,143 @@
 // =============================================================================
-// KeyMatrix.h — 2×5 matrix scanning with debounce
+// KeyMatrix.h — Key matrix scanning with debounce
+// Each row is sampled with one GPIO input-register read and every key is
+// debounced at once with bit-sliced (vertical) counters, so the scan cost and
+// the state size do not grow with the number of keys.
+// The matrix is a template over the row and column pin lists in Config.h:
+// pins, column masks and shifts are compile-time constants, the per-row and
+// per-column loops unroll, and the key mask is the narrowest type that holds
+// every key (KeyMask.h).  KeyMatrix.cpp instantiates the configured board.
+// Windows are per key: each key's counter is compared with its own window,
+// held as bit planes like the counters, so an adaptive window (Config.h,
+// Adaptive Debounce) costs the scan nothing over a global one.
 // =============================================================================
 #ifndef KEY_MATRIX_H
 #define KEY_MATRIX_H
 
 #include "Config.h"
-#include <functional>
+#include "EventRing.h"
+#include "KeyMask.h"
+#include <utility>
 
-class KeyMatrix
+// Compile-time facts about a pin list
+constexpr uint32_t pinMask(const uint8_t* pins, uint8_t n) {
+    uint32_t m = 0;
+    for (uint8_t i = 0; i < n; i++) m |= 1u << pins[i];
+    return m;
+}
+constexpr bool pinsBelow(const uint8_t* pins, uint8_t n, uint8_t limit) {
+    for (uint8_t i = 0; i < n; i++) if (pins[i] >= limit) return false;
+    return true;
+}
+constexpr bool pinsContiguous(const uint8_t* pins, uint8_t n) {
+    for (uint8_t i = 1; i < n; i++) if (pins[i] != pins[0] + i) return false;
+    return true;
+}
+
+template <class Rows, class Cols>
+class KeyMatrixT
 {
 public:
-    using KeyCallback = std::function<void(uint8_t keyIndex, bool pressed)>;
+    static constexpr uint8_t ROWS = Rows::count;
+    static constexpr uint8_t COLS = Cols::count;
+    static constexpr uint8_t KEYS = ROWS * COLS;
+
+    using Mask = KeyMaskFor<KEYS>;   // one bit per key, bit i = key index i
 
     void begin();
     void scan();
-    void setDebounceMs(uint16_t ms);
-    void setCallback(KeyCallback cb);
+    // First scan after a light sleep: a key found down is a press at once,
+    // stamped `wokeUs`, whatever setEagerPress() says
+    void wakeScan(uint32_t wokeUs);
+    // Raw contacts before any debounce (PinCapture): the same row strobes
+    // as a scan, nothing else
+    Mask sample() { return readRaw(); }
+    void setDebounceMs(uint16_t ms);    // every key's window; the ceiling when adaptive
+    void setAdaptiveDebounce(bool on);  // learned windows below the ceiling
+    void relearnDebounce();             // forget every key's bursts and flags
+    void setEagerPress(bool eager);     // press on first edge, debounce release
+    void setEventRing(EventRing* ring); // push timestamped press/release records
     bool isKeyPressed(uint8_t index) const;
-    uint16_t getPressedMask() const;
+    Mask getPressedMask() const;
+    bool isSettling() const { return _quiet != ALL_KEYS; }   // a debounce window is open
+    Mask settlingKeys() const { return (Mask)~_quiet & ALL_KEYS; }
+    // micros() of each key's first edge of its latest change (GestureEngine)
+    const uint32_t* edgeStamps() const { return _edgeUs; }
+
+    // Learned debounce profile (CMD_GET_DEBOUNCE).  Each field is a byte the
+    // input task writes, so another task may read them between scans.
+    static constexpr uint16_t PROFILE_BYTES = 4 + 2 * KEYS + (KEYS + 7) / 8;
+    bool     adaptiveDebounce() const    { return _adaptive; }
+    uint8_t  keyWindowMs(uint8_t i) const { return _keyWindow[i]; }
+    uint8_t  bounceMs(uint8_t i) const    { return _bounce[i]; }
+    Mask     chattering() const          { return _chatter; }
+    uint16_t chatterCount() const        { return _chatterCount; }
+    uint8_t  lastChatterKey() const      { return _chatterKey; }
+    uint16_t buildProfile(uint8_t* out) const;   // CFG_DEBOUNCE_PROFILE, PROFILE_BYTES
+
+    // Edge wake between slow scans (ScanGovernor): every row driven LOW and
+    // `isr` on each column, so a press raises it.  scan() needs disarmWake()
+    // first.
+    void armWake(void (*isr)());
+    void disarmWake();
 
 private:
-    bool _stable[NUM_KEYS] = {};
-    bool _raw[NUM_KEYS] = {};
-    unsigned long _lastChange[NUM_KEYS] = {};
-    uint16_t _debounceMs = DEFAULT_DEBOUNCE_MS;
-    KeyCallback _cb = nullptr;
+    static const uint8_t COUNTER_BITS = 8;     // debounce window ≤ 255 ms
+
+    static_assert(pinsBelow(Cols::pins, COLS, 32), "column pins must be in GPIO_IN_REG");
+
+    static constexpr uint32_t COL_MASK   = pinMask(Cols::pins, COLS);
+    static constexpr uint8_t  COL_SHIFT  = Cols::pins[0];
+    // Contiguous ascending columns need one shift instead of a gather
+    static constexpr bool     COLS_DENSE = pinsContiguous(Cols::pins, COLS);
+    static constexpr Mask     ALL_KEYS   = maskFirst<Mask>(KEYS);
+
+    Mask readRaw();
+    template <size_t... I> Mask readRows(std::index_sequence<I...>);
+    template <size_t I>    void readRow(Mask& raw);
+    template <size_t... I> static uint32_t gatherCols(uint32_t low, std::index_sequence<I...>);
+    void tick(uint32_t ms);
+    void scanAt(uint32_t edgeUs, bool eager);
+    void burstStart(uint8_t idx, uint32_t edgeUs);
+    void burstEnd(uint8_t idx);
+    void applyWindows();
+    void setKeyWindow(uint8_t idx, uint8_t ms);
+    uint16_t neededWindow(uint8_t idx) const;
+    uint8_t  learnedWindow(uint8_t idx) const;
+
+    // Vertical counters: _cnt[b] holds bit b of every key's "ms since the raw
+    // level last changed" count, _win[b] bit b of its window.  _quiet marks
+    // keys whose count reached their window; their counters stop there.
+    Mask     _stable  = {};
+    Mask     _raw     = {};
+    Mask     _quiet   = {};
+    Mask     _cnt[COUNTER_BITS] = {};
+    Mask     _win[COUNTER_BITS] = {};
+    uint8_t  _window  = DEFAULT_DEBOUNCE_MS;   // every key's, or the ceiling
+    uint8_t  _planes  = 0;
+    bool     _adaptive = DEFAULT_DEBOUNCE_ADAPTIVE;
+    bool     _eager   = DEFAULT_EAGER_PRESS;
+    bool     _armed   = false;
+    unsigned long _lastTick = 0;
+
+    // micros() of the scan that saw each key's first edge after it settled,
+    // and of the latest edge since
+    uint32_t _edgeUs[KEYS]     = {};
+    uint32_t _lastEdgeUs[KEYS] = {};
+
+    // Per-key learning: edges in the open burst, bursts timed (saturating at
+    // DEBOUNCE_LEARN_BURSTS), the longest in ms, and the window in use
+    uint8_t  _edges[KEYS]     = {};
+    uint8_t  _bursts[KEYS]    = {};
+    uint8_t  _bounce[KEYS]    = {};
+    uint8_t  _keyWindow[KEYS] = {};
+    Mask     _chatter         = {};
+    uint16_t _chatterCount    = 0;
+    uint8_t  _chatterKey      = 0;
+
+    EventRing* _ring = nullptr;
 };
 
+using KeyMatrix = KeyMatrixT<RowPins, ColPins>;
+
 #endif
@@ -0,0 +1,118 @@
+// =============================================================================
+// Keymap.cpp — RAM-resident binary key map, uploaded by the app
+// =============================================================================
+#include "Keymap.h"
+#include "Crc16.h"
+
+static const KeyAction NONE        = { MAP_NONE, 0, 0 };
+static const KeyAction TRANSPARENT = { MAP_TRANSPARENT, 0, 0 };
+
+void Keymap::clear() {
+    for (uint8_t l = 0; l < KEYMAP_LAYERS; l++)
+        for (uint8_t k = 0; k < NUM_KEYS; k++) _keys[l][k] = l ? TRANSPARENT : NONE;
+    _layers    = 1;
+    _sequences = 0;
+}
+
+void Keymap::set(uint8_t layer, uint8_t key, const KeyAction& a) {
+    if (layer < KEYMAP_LAYERS && key < NUM_KEYS) _keys[layer][key] = a;
+}
+
+uint8_t Keymap::sequence(uint8_t index, const SeqStep** steps) const {
+    if (index >= _sequences) return 0;
+    *steps = _steps + _seqAt[index];
+    return _seqLen[index];
+}
+
+// Check the whole image before touching the tables, then decode it
+uint8_t Keymap::load(const uint8_t* image, uint16_t len) {
+    if (len < KEYMAP_HEADER_BYTES) return KEYMAP_ERR_FORMAT;
+    uint8_t layers = image[1], keys = image[2], seqs = image[3];
+    if (image[0] != KEYMAP_VERSION || layers < 1 || layers > KEYMAP_LAYERS ||
+        keys > NUM_KEYS || seqs > KEYMAP_SEQUENCES)
+        return KEYMAP_ERR_FORMAT;
+
+    uint32_t       table = (uint32_t)layers * keys * 3;
+    const uint8_t* p     = image + KEYMAP_HEADER_BYTES + table;
+    const uint8_t* end   = image + len;
+    if (p > end) return KEYMAP_ERR_FORMAT;
+    uint16_t steps = 0;
+    for (uint8_t s = 0; s < seqs; s++) {
+        if (p >= end || *p > HID_MAX_TAPS) return KEYMAP_ERR_FORMAT;
+        steps += *p;
+        p     += 1 + 2 * *p;
+        if (p > end || steps > KEYMAP_SEQ_BYTES / 2) return KEYMAP_ERR_FORMAT;
+    }
+    if (p != end) return KEYMAP_ERR_FORMAT;
+
+    clear();
+    p = image + KEYMAP_HEADER_BYTES;
+    for (uint8_t l = 0; l < layers; l++)
+        for (uint8_t k = 0; k < keys; k++, p += 3) _keys[l][k] = { p[0], p[1], p[2] };
+    uint8_t at = 0;
+    for (uint8_t s = 0; s < seqs; s++) {
+        _seqAt[s]  = at;
+        _seqLen[s] = *p++;
+        for (uint8_t i = 0; i < _seqLen[s]; i++, p += 2) _steps[at++] = { p[0], p[1] };
+    }
+    _layers    = layers;
+    _sequences = seqs;
+    return KEYMAP_OK;
+}
+
+// ── Upload ───────────────────────────────────────────────────────────────────
+bool KeymapUpload::refuse(uint8_t status) {
+    _status    = status;
+    _layers    = 0;
+    _sequences = 0;
+    return true;
+}
+
+bool KeymapUpload::write(uint8_t type, const uint8_t* d, size_t n) {
+    if (_state == COMMITTED) return false;        // the reply to that commit is pending
+
+    switch (type) {
+    case CFG_KEYMAP_BEGIN:
+        if (n < 2) return false;
+        _size = (uint16_t)(d[0] << 8 | d[1]);
+        if (_size > KEYMAP_IMAGE_MAX) { _state = IDLE; return refuse(KEYMAP_ERR_SIZE); }
+        _state = RECEIVING;
+        return false;
+
+    case CFG_KEYMAP_DATA: {
+        if (_state != RECEIVING || n < 2) return false;
+        uint16_t off = (uint16_t)(d[0] << 8 | d[1]);
+        if (off + (n - 2) > _size) { _state = IDLE; return refuse(KEYMAP_ERR_SIZE); }
+        memcpy(_buf + off, d + 2, n - 2);
+        return false;
+    }
+
+    case CFG_KEYMAP_COMMIT:
+        if (_state != RECEIVING || n < 2) return refuse(KEYMAP_ERR_ORDER);
+        _crc = (uint16_t)(d[0] << 8 | d[1]);
+        if (crc16(_buf, _size) != _crc) { _state = IDLE; return refuse(KEYMAP_ERR_CRC); }
+        _state = COMMITTED;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+void KeymapUpload::finish(uint8_t status, uint8_t layers, uint8_t sequences) {
+    _status    = status;
+    _layers    = layers;
+    _sequences = sequences;
+    _state     = IDLE;
+}
+
+// [CFG_KEYMAP_STATUS] [status] [layers] [sequences] [image CRC u16 BE]
+uint8_t KeymapUpload::buildStatus(uint8_t* out) const {
+    out[0] = CFG_KEYMAP_STATUS;
+    out[1] = _status;
+    out[2] = _layers;
+    out[3] = _sequences;
+    out[4] = (uint8_t)(_crc >> 8);
+    out[5] = (uint8_t)_crc;
+    return KEYMAP_STATUS_BYTES;
+}
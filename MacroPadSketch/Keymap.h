@@ -0,0 +1,88 @@
+// =============================================================================
+// Keymap.h — RAM-resident binary key map, uploaded by the app
+// The app sends the whole map at connect time over the Config characteristic
+// or PKT_CONFIG_DATA; nothing is written to flash.  Image layout:
+//   [version] [layers] [keys] [sequences]
+//   layers × keys × [type] [code] [mods]          layer 0 first, key index order
+//   sequences × ( [steps] steps × [code] [mods] )
+// Keys the image leaves out are MAP_NONE on layer 0 and MAP_TRANSPARENT above.
+// Lookups are plain array indexing: at(layer, key) and sequence(index).
+// =============================================================================
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+#include "Config.h"
+#include "HidReports.h"
+
+#define KEYMAP_VERSION        1
+#define KEYMAP_HEADER_BYTES   4
+#define KEYMAP_IMAGE_MAX      (KEYMAP_HEADER_BYTES + KEYMAP_LAYERS * NUM_KEYS * 3 + \
+                               KEYMAP_SEQUENCES + KEYMAP_SEQ_BYTES)
+#define KEYMAP_STATUS_BYTES   6      // CFG_KEYMAP_STATUS reply, type byte included
+
+static_assert(KEYMAP_LAYERS <= 8, "layer state is a uint8_t mask");
+
+struct SeqStep {
+    uint8_t code;       // HID keyboard usage
+    uint8_t mods;
+};
+
+class Keymap {
+public:
+    Keymap() { clear(); }
+
+    void clear();                                  // one layer, every key MAP_NONE
+    // Decode an image; KEYMAP_OK, or an error with the current map untouched
+    uint8_t load(const uint8_t* image, uint16_t len);
+
+    const KeyAction& at(uint8_t layer, uint8_t key) const { return _keys[layer][key]; }
+    void set(uint8_t layer, uint8_t key, const KeyAction& a);
+
+    // Steps of sequence `index`; returns the count, 0 for an unknown index
+    uint8_t sequence(uint8_t index, const SeqStep** steps) const;
+
+    uint8_t layers()    const { return _layers; }
+    uint8_t sequences() const { return _sequences; }
+
+private:
+    KeyAction _keys[KEYMAP_LAYERS][NUM_KEYS];
+    SeqStep   _steps[KEYMAP_SEQ_BYTES / 2];
+    uint8_t   _seqAt[KEYMAP_SEQUENCES];            // first step of each sequence
+    uint8_t   _seqLen[KEYMAP_SEQUENCES];
+    uint8_t   _layers    = 1;
+    uint8_t   _sequences = 0;
+};
+
+// ── Upload ───────────────────────────────────────────────────────────────────
+// CFG_KEYMAP_BEGIN / DATA / COMMIT write an image into a staging buffer.  A
+// commit whose size and CRC-16 check out locks the buffer until the transport
+// task has loaded it, so a second upload cannot tear the first.  Transport
+// task only: BLE config writes reach write() through the sketch's queue.
+class KeymapUpload {
+public:
+    // true when a CFG_KEYMAP_STATUS reply is due (commit, or a refused write)
+    bool write(uint8_t type, const uint8_t* data, size_t len);
+
+    bool           committed() const { return _state == COMMITTED; }
+    const uint8_t* image()     const { return _buf; }
+    uint16_t       size()      const { return _size; }
+
+    // Reply with the outcome: after a commit, what loading the image gave
+    void    finish(uint8_t status, uint8_t layers, uint8_t sequences);
+    uint8_t buildStatus(uint8_t* out) const;       // KEYMAP_STATUS_BYTES
+
+private:
+    enum State : uint8_t { IDLE, RECEIVING, COMMITTED };
+
+    volatile State _state     = IDLE;
+    uint16_t       _size      = 0;
+    uint16_t       _crc       = 0;
+    uint8_t        _status    = KEYMAP_OK;
+    uint8_t        _layers    = 0;
+    uint8_t        _sequences = 0;
+    uint8_t        _buf[KEYMAP_IMAGE_MAX];
+
+    bool refuse(uint8_t status);
+};
+
+#endif
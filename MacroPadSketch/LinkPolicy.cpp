@@ -0,0 +1,136 @@
+// =============================================================================
+// LinkPolicy.cpp — BLE connection profile: interval, PHY and data length
+// =============================================================================
+#include "LinkPolicy.h"
+#include "Log.h"
+#include "Trace.h"
+#include <NimBLEDevice.h>
+
+struct LinkProfile {
+    uint16_t minInterval, maxInterval, latency, timeout;
+};
+
+static const LinkProfile PROFILES[] = {
+    {},
+    { LINK_PERF_INTERVAL_MIN, LINK_PERF_INTERVAL_MAX, LINK_PERF_LATENCY, LINK_PERF_TIMEOUT },
+    { LINK_BATT_INTERVAL_MIN, LINK_BATT_INTERVAL_MAX, LINK_BATT_LATENCY, LINK_BATT_TIMEOUT },
+};
+
+static uint8_t* putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+    return p + 2;
+}
+
+uint8_t LinkParams::build(uint8_t* out) const {
+    uint8_t* p = out;
+    *p++ = mode;
+    *p++ = profile;
+    p  = putU16(p, interval);
+    p  = putU16(p, latency);
+    p  = putU16(p, timeout);
+    *p++ = txPhy;
+    *p++ = rxPhy;
+    p  = putU16(p, dataLen);
+    p  = putU16(p, mtu);
+    return (uint8_t)(p - out);
+}
+
+void LinkPolicy::begin(NimBLEServer* server) { _server = server; }
+
+// ── NimBLE host task ─────────────────────────────────────────────────────────
+void LinkPolicy::onConnect(const NimBLEConnInfo& c) {
+    _handle    = c.getConnHandle();
+    _interval  = c.getConnInterval();
+    _latency   = c.getConnLatency();
+    _timeout   = c.getConnTimeout();
+    _mtu       = c.getMTU();
+    _txPhy     = _rxPhy = BLE_GAP_LE_PHY_1M;
+    _dataLen   = 27;
+    _fresh     = true;
+    _connected = true;
+    _changed   = true;
+}
+
+void LinkPolicy::onDisconnect() {
+    _connected = false;
+    _fresh     = false;
+    _changed   = true;
+}
+
+void LinkPolicy::onParams(const NimBLEConnInfo& c) {
+    _interval = c.getConnInterval();
+    _latency  = c.getConnLatency();
+    _timeout  = c.getConnTimeout();
+    _changed  = true;
+    TRACE(TR_LINK_PARAMS, _interval >> 8, _interval, _latency);
+}
+
+void LinkPolicy::onPhy(uint8_t txPhy, uint8_t rxPhy) {
+    _txPhy   = txPhy;
+    _rxPhy   = rxPhy;
+    _changed = true;
+    TRACE(TR_LINK_PHY, txPhy, rxPhy, 0);
+}
+
+void LinkPolicy::onMtu(uint16_t mtu) {
+    _mtu     = mtu;
+    _changed = true;
+}
+
+// ── Any task ─────────────────────────────────────────────────────────────────
+void LinkPolicy::setMode(uint8_t mode) {
+    if (mode > LINK_BATTERY) return;
+    _mode    = mode;
+    _changed = true;
+}
+
+// ── Transport task ───────────────────────────────────────────────────────────
+bool LinkPolicy::settled(uint8_t profile) const {
+    const LinkProfile& p = PROFILES[profile];
+    return _interval >= p.minInterval && _interval <= p.maxInterval && _latency == p.latency;
+}
+
+void LinkPolicy::request(uint8_t profile, uint32_t nowMs) {
+    const LinkProfile& p = PROFILES[profile];
+    _profile   = profile;
+    _requestMs = nowMs;
+    _changed   = true;
+    _server->updateConnParams(_handle, p.minInterval, p.maxInterval, p.latency, p.timeout);
+    TRACE(TR_LINK_REQUEST, profile, p.minInterval, p.maxInterval);
+    LOG_D("BLE: link profile %u requested\n", profile);
+}
+
+bool LinkPolicy::update(uint32_t nowMs) {
+    if (_connected && _fresh) {
+        // Once per connection; the connection itself counts as activity
+        _fresh       = false;
+        _profile     = 0;
+        _lastInputMs = nowMs;
+        _server->updatePhy(_handle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, 0);
+        if (_server->setDataLen(_handle, LINK_DATA_LEN)) _dataLen = LINK_DATA_LEN;
+    }
+
+    if (_connected) {
+        uint8_t want = _mode;
+        if (want == LINK_AUTO)
+            want = nowMs - _lastInputMs < LINK_IDLE_MS ? LINK_PERFORMANCE : LINK_BATTERY;
+
+        // A central may refuse or pick outside the range; ask again now and then
+        if (want != _profile || (!settled(want) && nowMs - _requestMs >= LINK_RETRY_MS))
+            request(want, nowMs);
+    }
+
+    if (!_changed) return false;
+    _changed = false;
+    return true;
+}
+
+LinkParams LinkPolicy::params() const {
+    LinkParams p = {
+        _mode, _connected ? _profile : (uint8_t)0,
+        _interval, _latency, _timeout,
+        _txPhy, _rxPhy, _dataLen, _mtu
+    };
+    return p;
+}
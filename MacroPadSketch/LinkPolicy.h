@@ -0,0 +1,87 @@
+// =============================================================================
+// LinkPolicy.h — BLE connection profile: interval, PHY and data length
+// Once a client connects, the policy asks for 2M PHY and the longest LL data
+// length, then for the connection parameters of the wanted profile (Config.h,
+// BLE Link Profiles).  What the central grants comes back through
+// BleService's onConnParamsUpdate / onPhyUpdate and is kept here, so the app
+// can read it from the Link characteristic or with CMD_GET_LINK.
+// update() runs on the transport task and makes every request; the on*()
+// hooks run on the NimBLE host task and only store what they are told.
+// =============================================================================
+#ifndef LINK_POLICY_H
+#define LINK_POLICY_H
+
+#include "Config.h"
+
+class NimBLEServer;
+class NimBLEConnInfo;
+
+// Wire layout (PKT_LINK payload and the Link characteristic), all BE:
+//   [mode] [profile, 0 = not connected] [interval u16] [latency u16]
+//   [timeout u16] [tx PHY] [rx PHY] [data length u16] [MTU u16]
+// Interval in 1.25 ms units, timeout in 10 ms units, PHY 1 = 1M / 2 = 2M.
+// The data length is what was asked for; the controllers may settle lower.
+#define LINK_PARAMS_BYTES   14
+
+struct LinkParams {
+    uint8_t  mode;         // LINK_AUTO / LINK_PERFORMANCE / LINK_BATTERY
+    uint8_t  profile;      // last profile requested
+    uint16_t interval;
+    uint16_t latency;      // connection events the device may skip when idle
+    uint16_t timeout;
+    uint8_t  txPhy;
+    uint8_t  rxPhy;
+    uint16_t dataLen;
+    uint16_t mtu;
+
+    uint8_t build(uint8_t* out) const;   // returns LINK_PARAMS_BYTES
+};
+
+class LinkPolicy {
+public:
+    void begin(NimBLEServer* server);
+
+    // NimBLE host task
+    void onConnect(const NimBLEConnInfo& c);
+    void onDisconnect();
+    void onParams(const NimBLEConnInfo& c);
+    void onPhy(uint8_t txPhy, uint8_t rxPhy);
+    void onMtu(uint16_t mtu);
+
+    // Any task
+    void setMode(uint8_t mode);
+    void noteInput(uint32_t nowMs) { _lastInputMs = nowMs; }
+
+    // Transport task: make whatever request the mode calls for.  True once
+    // after anything in params() changed.
+    bool       update(uint32_t nowMs);
+    LinkParams params() const;
+
+private:
+    void request(uint8_t profile, uint32_t nowMs);
+    bool settled(uint8_t profile) const;
+
+    NimBLEServer* _server = nullptr;
+
+    volatile bool     _connected   = false;
+    volatile bool     _fresh       = false;   // connected, not set up yet
+    volatile uint16_t _handle      = 0;
+    volatile uint8_t  _mode        = DEFAULT_LINK_MODE;
+    volatile uint32_t _lastInputMs = 0;
+    volatile bool     _changed     = false;
+
+    // Transport task only
+    uint8_t  _profile   = 0;
+    uint32_t _requestMs = 0;
+
+    // As negotiated
+    volatile uint16_t _interval = 0;
+    volatile uint16_t _latency  = 0;
+    volatile uint16_t _timeout  = 0;
+    volatile uint8_t  _txPhy    = 1;
+    volatile uint8_t  _rxPhy    = 1;
+    volatile uint16_t _dataLen  = 27;
+    volatile uint16_t _mtu      = 23;
+};
+
+#endif
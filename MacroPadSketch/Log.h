@@ -0,0 +1,53 @@
+// =============================================================================
+// Log.h — Compile-time log levels for the text console
+// LOG_E / LOG_W / LOG_I / LOG_D expand to Serial.printf at or below LOG_LEVEL
+// and to dead code above it, so a release build carries neither the calls nor
+// the format strings (but the arguments are still type-checked).  The level follows the Arduino-ESP32 "Core Debug Level"
+// menu unless Config.h sets LOG_LEVEL.  Text shares the UART with the
+// SerialBridge frames, so per-event diagnostics go to the trace ring
+// (Trace.h) instead.
+// =============================================================================
+#ifndef LOG_H
+#define LOG_H
+
+#include "Config.h"
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+#ifndef LOG_LEVEL
+#  ifdef CORE_DEBUG_LEVEL
+#    define LOG_LEVEL CORE_DEBUG_LEVEL
+#  else
+#    define LOG_LEVEL LOG_LEVEL_NONE
+#  endif
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#  define LOG_E(...) Serial.printf(__VA_ARGS__)
+#else
+#  define LOG_E(...) do { if (0) Serial.printf(__VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#  define LOG_W(...) Serial.printf(__VA_ARGS__)
+#else
+#  define LOG_W(...) do { if (0) Serial.printf(__VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#  define LOG_I(...) Serial.printf(__VA_ARGS__)
+#else
+#  define LOG_I(...) do { if (0) Serial.printf(__VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#  define LOG_D(...) Serial.printf(__VA_ARGS__)
+#else
+#  define LOG_D(...) do { if (0) Serial.printf(__VA_ARGS__); } while (0)
+#endif
+
+#endif
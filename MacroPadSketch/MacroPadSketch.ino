@@ -1,39 +1,147 @@
 // =============================================================================
 // MacroPadSketch.ino — Main firmware  (DUMB I/O — no config storage)
-// Hardware : ESP32-C3 · 2×5 matrix · rotary encoder · BLE
+// Hardware : ESP32-C3 / S3 · key matrix (Config.h) · rotary encoder · BLE
 // Library  : NimBLE-Arduino >= 1.4  (install via Library Manager)
-// Board    : ESP32C3 Dev Module  (Arduino-ESP32 core)
+// Board    : ESP32C3 Dev Module  (Arduino-ESP32 core >= 3.0, FreeRTOS tasks)
 //
 // The ESP stores NOTHING (no NVS, no EEPROM, no persistent RAM).
 // All configuration (key mappings, profiles, encoder modes) lives on the PC.
-// The ESP only sends raw hardware events: key press/release, encoder rotate,
-// encoder button, and battery level.
+// The ESP sends hardware events: key press/release, encoder rotate, encoder
+// button, and battery level, plus tap / hold / double-tap on keys given
+// gesture thresholds.  The app may upload a key map into RAM; the
+// device then resolves layers and sequences itself, stamps each key event
+// with its layer, and with HID mode on sends standard keyboard / consumer /
+// mouse reports.
 // =============================================================================
 
 #include <Arduino.h>
 #include <driver/gpio.h>
 #include <esp_sleep.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
 #include "Config.h"
+#include "Log.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "EventRing.h"
+#include "ScanGovernor.h"
 #include "KeyMatrix.h"
 #include "Encoder.h"
+#include "Gestures.h"
 #include "Battery.h"
+#include "ActionEngine.h"
+#include "Keymap.h"
+#include "PinCapture.h"
 #include "BleService.h"
 #include "SerialBridge.h"
 
 // ── Global instances ────────────────────────────────────────────────────────
 KeyMatrix      keyMatrix;
 RotaryEncoder  encoder;
+GestureEngine  gestures;                     // input task only
 BatteryMonitor battery;
 BleService     bleService;
 SerialBridge   serialBridge;
+ActionEngine   actions;                      // transport task only
+KeymapUpload   keymapUpload;                 // transport task only
 
 // Runtime-only settings (never saved, reset to defaults on reboot)
-uint16_t      debounceMs         = DEFAULT_DEBOUNCE_MS;
-uint8_t       encoderSensitivity = DEFAULT_ENCODER_SENSITIVITY;
-uint32_t      sleepTimeoutMs     = DEFAULT_SLEEP_TIMEOUT_MS;
-
-unsigned long lastActivity = 0;
-bool          sleeping     = false;
+volatile uint16_t debounceMs         = DEFAULT_DEBOUNCE_MS;   // applied by the input task
+volatile bool     debounceAdaptive   = DEFAULT_DEBOUNCE_ADAPTIVE;
+volatile bool     debounceRelearn    = false;                 // adaptive command: start over
+volatile uint16_t encoderRateHz      = ENCODER_REPORT_HZ;     // applied by the input task
+volatile uint16_t gestureHoldMs[NUM_KEYS]   = {};             // CMD_SET_GESTURE, applied by
+volatile uint16_t gestureDoubleMs[NUM_KEYS] = {};             //   the input task
+volatile bool     gesturesChanged    = false;
+volatile bool     bleCongested       = false;                 // transport task → encoder rate
+uint8_t           encoderSensitivity = DEFAULT_ENCODER_SENSITIVITY;
+uint32_t          sleepTimeoutMs     = DEFAULT_SLEEP_TIMEOUT_MS;
+
+volatile unsigned long lastActivity = 0;
+volatile bool          sleeping     = false;
+
+// ── Tasks ───────────────────────────────────────────────────────────────────
+// input        (INPUT_TASK_PRIORITY)        — woken by scanTimer at SCAN_RATE_HZ, or
+//                                             paced by the scan governor when idle;
+//                                             also runs each light sleep; samples
+//                                             pins at CAPTURE_RATE_HZ while capturing
+// transport    (TRANSPORT_TASK_PRIORITY)    — drains inputRing, BLE + serial
+// housekeeping (HOUSEKEEPING_TASK_PRIORITY) — battery, when to light-sleep
+EventRing     inputRing;                     // input task → transport task
+TaskHandle_t  inputTask         = nullptr;
+TaskHandle_t  transportTask     = nullptr;
+hw_timer_t*   scanTimer         = nullptr;
+ScanGovernor  governor;
+bool          scanTimerOn       = true;      // input task's view of scanTimer
+volatile bool scanWake          = false;     // armed edge / light-sleep wake → full rate
+uint16_t      appliedDebounceMs = DEFAULT_DEBOUNCE_MS;   // input task's copies
+bool          appliedAdaptive   = DEFAULT_DEBOUNCE_ADAPTIVE;
+uint16_t      chatterSeen       = 0;
+uint16_t      appliedEncoderHz  = ENCODER_REPORT_HZ;
+
+// Battery is a level, not an event: housekeeping leaves the latest reading
+// here as (mv << 16) | (pct << 8) | 1 and the transport task picks it up.
+volatile uint32_t batteryReport = 0;
+
+// Snapshot mailbox.  Anyone may set snapshotWanted; the input task fills
+// `snapshot` between scans, so it matches the ring's sequence numbers.  The
+// transport rolls it forward over the events it drains and sends it after
+// them, so it always describes the state as of the last event on the wire.
+volatile bool     snapshotWanted = false;
+volatile bool     snapshotReady  = false;
+InputSnapshot     snapshot       = {};
+bool              snapshotHeld   = false;      // input task: periodic pushes armed
+unsigned long     snapshotMs     = 0;
+
+// Performance counters (Stats.h).  The input task times its own wake-ups,
+// the transport times each event from capture to both links; either side of
+// a CMD_GET_STATS sets statsWanted and the transport answers.
+Histogram         scanPeriod(SCAN_PERIOD_EDGES_US);
+Histogram         eventLatency(EVENT_LATENCY_EDGES_US);
+volatile uint32_t scanWorkMaxUs = 0;
+volatile uint32_t lastScanUs    = 0;           // 0 = timer restarted, no period yet
+volatile bool     statsWanted   = false;
+
+// BLE link parameters go out when they change, or on CMD_GET_LINK
+volatile bool     linkWanted    = false;
+
+// Device info and trace dumps are serial frames: only the transport task
+// touches SerialBridge, so a command from either link leaves a request here.
+// Every CMD_IDENTIFY gets its own reply.
+std::atomic<uint16_t> identifyWanted{0};
+volatile bool         traceWanted    = false;
+volatile uint32_t     traceSince     = 0;
+
+// Key map uploads are staged in keymapUpload; the transport loads a
+// committed image between events and replies
+volatile bool     keymapWanted  = false;
+
+// BLE config writes and the commands that change ActionEngine arrive on the
+// NimBLE host task.  They wait here, in order, and the transport applies them
+// before draining the ring, as the serial link's are applied.
+struct BleWrite {
+    bool    config;                            // Config characteristic, else a command
+    uint8_t code;                              // CFG_* type or CMD_*
+    uint8_t len;
+    uint8_t data[NotifyQueue::VALUE_MAX];
+};
+QueueHandle_t     bleWrites     = nullptr;
+
+// The learned debounce profile goes out on CMD_GET_DEBOUNCE, on both links
+volatile bool     debounceWanted = false;
+
+// Light sleep: housekeeping asks, the input task sleeps and scans the moment
+// the chip is back, then hands the wake to the transport
+volatile bool     sleepWanted   = false;
+volatile bool     wakeWanted    = false;
+volatile uint32_t wakeUs        = 0;           // micros() the last light sleep ended
+
+// Raw pin capture: any task asks, the input task samples between scan passes
+// and the serial bridge streams the records
+PinCapture        pinCapture;
+volatile bool     captureWanted = false;
+uint8_t           captureTicks  = 0;           // input task: ticks since the last scan pass
 
 // ── Helpers ─────────────────────────────────────────────────────────────────
 void resetActivity() {
@@ -41,71 +149,292 @@ void resetActivity() {
     sleeping     = false;
 }
 
-// ── Callbacks: key / encoder / battery ──────────────────────────────────────
-void onKey(uint8_t idx, bool pressed) {
-    resetActivity();
-    uint8_t evt = pressed ? EVT_KEY_PRESS : EVT_KEY_RELEASE;
-    bleService.sendKeyEvent(evt, idx);
-    serialBridge.sendKeyEvent(evt, idx);
-    Serial.printf("Key %u %s\n", idx, pressed ? "DOWN" : "UP");
+// Back to full-rate scanning from another task (a governor mode change)
+void wakeInput() {
+    scanWake = true;
+    xTaskNotifyGive(inputTask);
+}
+
+// ── Housekeeping: battery ───────────────────────────────────────────────────
+
+void onBattery(uint8_t pct, uint16_t mv) {
+    batteryReport = ((uint32_t)mv << 16) | ((uint32_t)pct << 8) | 1;
+    if (transportTask) xTaskNotifyGive(transportTask);
 }
 
-void onRotate(int8_t dir, uint8_t steps) {
-    resetActivity();
-    uint8_t d = dir > 0 ? DIR_CW : DIR_CCW;
-    bleService.sendEncoderEvent(EVT_ENCODER_ROTATE, d, steps);
-    serialBridge.sendEncoderEvent(EVT_ENCODER_ROTATE, d, steps);
-    Serial.printf("Enc %s x%u\n", dir > 0 ? "CW" : "CCW", steps);
+// ── Transport side: resolve one ring record, hand it to both links ──────────
+void sendEvent(InputEvent& e) {
+    HidReport hid[HID_REPORTS_MAX];
+    uint8_t   n = actions.onEvent(e, hid);
+    bleService.sendHid(hid, n);
+    bleService.queueEvent(e);
+    serialBridge.queueEvent(e);
+
+    // Key index, signed rotation steps, or button state
+    uint8_t what = e.value;
+    if (isKeyEvent(e.type)) what = e.id;
+    else if (e.type == EVT_ENCODER_ROTATE) {
+        uint8_t steps = min(e.steps, (uint8_t)127);
+        what = e.value == DIR_CW ? steps : (uint8_t)-steps;
+    }
+    TRACE(TR_EVENT, e.type, what, e.seq);
 }
 
-void onEncButton(bool pressed) {
-    resetActivity();
-    uint8_t evt = pressed ? EVT_ENCODER_BTN_PRESS : EVT_ENCODER_BTN_RELEASE;
-    uint8_t d   = pressed ? 1 : 0;
-    bleService.sendEncoderEvent(evt, d, 0);
-    serialBridge.sendEncoderEvent(evt, d, 0);
-    Serial.printf("Enc btn %s\n", pressed ? "DOWN" : "UP");
+void sendSnapshot(const InputSnapshot& s) {
+    bleService.sendSnapshot(s);
+    serialBridge.sendSnapshot(s);
 }
 
-void onBattery(uint8_t pct, uint16_t mv) {
+void sendStats() {
+    DeviceStats s = {
+        (uint32_t)millis(),
+        scanPeriod,   scanWorkMaxUs,
+        eventLatency,
+        inputRing.dropped(), inputRing.highWater(),
+        bleService.notifyFailed(), bleService.notifySkipped(),
+        bleService.txRetried(), bleService.txDropped(), bleService.txCoalesced(),
+        serialBridge.txDeferred(), serialBridge.txDropped(),
+        serialBridge.rxBadFrames(), serialBridge.rxOversize(),
+        encoder.isrHits(),
+        ESP.getFreeHeap(), ESP.getMinFreeHeap()
+    };
+    bleService.sendStats(s);
+    serialBridge.sendStats(s);
+}
+
+void sendLink() {
+    LinkParams p = bleService.linkParams();
+    bleService.sendLink(p);
+    serialBridge.sendLink(p);
+}
+
+void sendKeymapStatus() {
+    if (keymapUpload.committed()) {
+        uint8_t status = actions.load(keymapUpload.image(), keymapUpload.size());
+        keymapUpload.finish(status, actions.layers(), actions.sequences());
+        TRACE(TR_KEYMAP, status, actions.layers(), actions.sequences());
+        LOG_I("Key map (RAM): status %u, %u layers, %u sequences\n",
+              status, actions.layers(), actions.sequences());
+    }
+    uint8_t reply[KEYMAP_STATUS_BYTES];
+    uint8_t len = keymapUpload.buildStatus(reply);
+    bleService.sendConfigData(reply, len);
+    serialBridge.sendConfigData(reply, len);
+}
+
+// Read from the input task's per-key bytes; a key may settle in between
+void sendDebounceProfile() {
+    uint8_t  reply[KeyMatrix::PROFILE_BYTES];
+    uint16_t len = keyMatrix.buildProfile(reply);
+    bleService.sendConfigData(reply, len);
+    serialBridge.sendConfigData(reply, len);
+}
+
+void sendBattery(uint32_t report) {
+    uint8_t  pct = (uint8_t)(report >> 8);
+    uint16_t mv  = (uint16_t)(report >> 16);
     bleService.updateBatteryLevel(pct);
     serialBridge.updateBatteryLevel(pct);
-    Serial.printf("Batt %u%% (%u mV)\n", pct, mv);
+    TRACE(TR_BATTERY, pct, mv >> 8, mv);
 }
 
 // ── Command handler (only volatile/transient commands) ──────────────────────
 void onCommand(uint8_t cmd, const uint8_t* d, size_t n) {
-    Serial.printf("CMD 0x%02X len=%u\n", cmd, n);
+    TRACE(TR_COMMAND, cmd, n, 0);
 
     switch (cmd) {
 
     case CMD_IDENTIFY:
         // Send device info so the app knows what board this is
-        bleService.updateDeviceInfo();
-        serialBridge.sendDeviceInfo();
+        identifyWanted++;
+        if (transportTask) xTaskNotifyGive(transportTask);
+        break;
+
+    case CMD_GET_SNAPSHOT:
+        snapshotWanted = true;
+        break;
+
+    case CMD_GET_STATS:
+        statsWanted = true;
+        if (transportTask) xTaskNotifyGive(transportTask);
+        break;
+
+    case CMD_GET_LINK:
+        linkWanted = true;
+        if (transportTask) xTaskNotifyGive(transportTask);
+        break;
+
+    case CMD_SET_LINK_PROFILE:
+        // Pin a connection profile, or LINK_AUTO - lost on reboot
+        if (n >= 1) {
+            bleService.setLinkMode(d[0]);
+            if (transportTask) xTaskNotifyGive(transportTask);
+            LOG_I("Link profile (live) = %u\n", d[0]);
+        }
+        break;
+
+    case CMD_SET_KEY_MAP:
+        // [key] [type] [code] [mods] [macro len] [macro] - the macro stays on
+        // the app, and a combo carrying a recorded macro is the app's to play
+        if (n >= 4) {
+            KeyAction a = { d[1], d[2], d[3] };
+            if (a.type == MAP_MODIFIER_COMBO && n >= 5 && d[4]) a.type = MAP_NONE;
+            actions.setKey(d[0], a);
+        }
+        break;
+
+    case CMD_SET_ENCODER_MODE:
+        // [mode] [cw key] [cw mods] [ccw key] [ccw mods] [btn type] [btn key] [btn mods]
+        if (n >= 1) {
+            EncoderMap m = {};
+            m.mode = d[0];
+            if (n >= 5) {
+                m.cw  = { MAP_SINGLE_KEY, d[1], d[2] };
+                m.ccw = { MAP_SINGLE_KEY, d[3], d[4] };
+            }
+            if (n >= 8) m.button = { d[5], d[6], d[7] };
+            actions.setEncoder(m);
+        }
+        break;
+
+    case CMD_SET_SCAN_GOVERNOR:
+        // Scan governor mode - lost on reboot.  Starts over at full rate.
+        if (n >= 1) {
+            governor.setMode(d[0]);
+            TRACE(TR_SCAN_TIER, governor.tier(), governor.mode(), 0);
+            if (governor.tier() != GOV_FULL) wakeInput();
+            LOG_I("Scan governor (live) = %u\n", governor.mode());
+        }
+        break;
+
+    case CMD_SET_HID_MODE:
+        // HID reports on or off - lost on reboot
+        if (n >= 1) {
+            actions.setHidMode(d[0] != 0);
+            TRACE(TR_HID_MODE, actions.hidMode(), 0, 0);
+            LOG_I("HID mode (live) = %u\n", actions.hidMode());
+        }
+        break;
+
+    case CMD_GET_TRACE:
+        // Serial only: the dump is several frames and BLE has no channel for it
+        traceSince  = n >= 4 ? ((uint32_t)d[0] << 24) | ((uint32_t)d[1] << 16) |
+                               ((uint32_t)d[2] << 8)  | d[3]
+                             : 0;
+        traceWanted = true;
+        if (transportTask) xTaskNotifyGive(transportTask);
         break;
 
     case CMD_SET_DEBOUNCE_LIVE:
-        // Temporary debounce change - lost on reboot
+        // Temporary debounce change - lost on reboot.  Two bytes fix every
+        // key's window (the override); a third, 1, learns again below it.
         if (n >= 2) {
-            debounceMs = (d[0] << 8) | d[1];
-            keyMatrix.setDebounceMs(debounceMs);
-            Serial.printf("Debounce (live) = %u ms\n", debounceMs);
+            debounceAdaptive = n >= 3 && d[2];
+            debounceRelearn  = debounceAdaptive;
+            debounceMs       = (d[0] << 8) | d[1];
+            TRACE(TR_DEBOUNCE, debounceAdaptive, d[0], d[1]);
+            LOG_I("Debounce (live) = %u ms%s\n", d[0] << 8 | d[1],
+                  debounceAdaptive ? ", adaptive" : "");
         }
         break;
 
+    case CMD_GET_DEBOUNCE:
+        debounceWanted = true;
+        if (transportTask) xTaskNotifyGive(transportTask);
+        break;
+
+    case CMD_TIME_SYNC:
+    case CMD_SET_LATENCY_TRACE:
+        // Answered by the link the command came in on (SerialBridge / BleService)
+        break;
+
+    case CMD_SET_CAPTURE:
+        // Raw pin capture - streamed over serial only, like the trace dump
+        if (n >= 1) {
+            captureWanted = d[0] != 0 && serialBridge.isHandshaked();
+            wakeInput();
+        }
+        break;
+
+    case CMD_SET_GESTURE:
+        // Per-key tap / hold / double-tap thresholds - lost on reboot
+        if (n >= 1) {
+            uint16_t hold = n >= 5 ? (d[1] << 8) | d[2] : GESTURE_HOLD_MS;
+            uint16_t dbl  = n >= 5 ? (d[3] << 8) | d[4] : GESTURE_DOUBLE_TAP_MS;
+            for (uint8_t k = 0; k < NUM_KEYS; k++) {
+                if (d[0] != 0xFF && d[0] != k) continue;
+                gestureHoldMs[k]   = hold;
+                gestureDoubleMs[k] = dbl;
+            }
+            gesturesChanged = true;
+            TRACE(TR_GESTURE, d[0], min(hold / 10, 255), min(dbl / 10, 255));
+            LOG_I("Gestures (live) key %u: hold %u ms, double tap %u ms\n", d[0], hold, dbl);
+        }
+        break;
+
+    case CMD_SET_ENCODER_RATE_LIVE:
+        // Encoder report rate - lost on reboot
+        if (n >= 2) {
+            encoderRateHz = (d[0] << 8) | d[1];
+            TRACE(TR_ENCODER_RATE, 0, d[0], d[1]);
+            LOG_I("Encoder rate (live) = %u Hz\n", d[0] << 8 | d[1]);
+        }
+        break;
+
+    default:
+        LOG_W("Unknown CMD 0x%02X - ignored\n", cmd);
+        break;
+    }
+}
+
+// Key map upload into RAM (Keymap.h) - nothing is stored.  Transport task.
+void onConfigWrite(uint8_t type, const uint8_t* d, size_t n) {
+    TRACE(TR_CONFIG_WRITE, type, n, 0);
+    if (keymapUpload.write(type, d, n)) {
+        keymapWanted = true;
+        if (transportTask) xTaskNotifyGive(transportTask);
+    }
+}
+
+// ── BLE writes, from the NimBLE host task ───────────────────────────────────
+void stageBleWrite(bool config, uint8_t code, const uint8_t* d, size_t n) {
+    BleWrite w;
+    if (n > sizeof(w.data)) {
+        LOG_W("BLE write 0x%02X too long - ignored\n", code);
+        return;
+    }
+    w.config = config;
+    w.code   = code;
+    w.len    = (uint8_t)n;
+    memcpy(w.data, d, n);
+    if (xQueueSend(bleWrites, &w, 0) != pdPASS) {
+        LOG_W("BLE write 0x%02X dropped, queue full\n", code);
+        return;
+    }
+    if (transportTask) xTaskNotifyGive(transportTask);
+}
+
+void onBleCommand(uint8_t cmd, const uint8_t* d, size_t n) {
+    switch (cmd) {
+    case CMD_SET_KEY_MAP:
+    case CMD_SET_ENCODER_MODE:
+    case CMD_SET_HID_MODE:
+        stageBleWrite(false, cmd, d, n);        // ActionEngine is the transport's
+        break;
     default:
-        Serial.printf("Unknown CMD 0x%02X - ignored\n", cmd);
+        onCommand(cmd, d, n);
         break;
     }
 }
 
-void onConfigWrite(uint8_t type, const uint8_t*, size_t) {
-    // No config storage - ignore config writes from app
-    Serial.printf("CFG write type 0x%02X - ignored (no storage)\n", type);
+void onBleConfigWrite(uint8_t type, const uint8_t* d, size_t n) {
+    stageBleWrite(true, type, d, n);
 }
 
 // ── Sleep ───────────────────────────────────────────────────────────────────
+// Rows LOW so a press pulls its column LOW.  Each encoder pin wakes on leaving
+// the level it rests at, so a detent parked with a channel LOW neither wakes
+// the chip at once nor keeps it from waking.
 void configureSleepWakeup() {
     for (int r = 0; r < NUM_ROWS; r++) {
         digitalWrite(ROW_PINS[r], LOW);
@@ -113,12 +442,15 @@ void configureSleepWakeup() {
     for (int c = 0; c < NUM_COLS; c++) {
         gpio_wakeup_enable((gpio_num_t)COL_PINS[c], GPIO_INTR_LOW_LEVEL);
     }
-    gpio_wakeup_enable((gpio_num_t)ENC_A_PIN,   GPIO_INTR_LOW_LEVEL);
-    gpio_wakeup_enable((gpio_num_t)ENC_B_PIN,   GPIO_INTR_LOW_LEVEL);
-    gpio_wakeup_enable((gpio_num_t)ENC_BTN_PIN, GPIO_INTR_LOW_LEVEL);
+    for (uint8_t pin : { ENC_A_PIN, ENC_B_PIN, ENC_BTN_PIN }) {
+        gpio_wakeup_enable((gpio_num_t)pin,
+                           digitalRead(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    }
     esp_sleep_enable_gpio_wakeup();
 }
 
+// Nothing is set up again: the encoder keeps its count and only takes its
+// edge interrupts back, the serial bridge keeps its state
 void restoreAfterWake() {
     for (int r = 0; r < NUM_ROWS; r++) {
         digitalWrite(ROW_PINS[r], HIGH);
@@ -129,38 +461,305 @@ void restoreAfterWake() {
     gpio_wakeup_disable((gpio_num_t)ENC_A_PIN);
     gpio_wakeup_disable((gpio_num_t)ENC_B_PIN);
     gpio_wakeup_disable((gpio_num_t)ENC_BTN_PIN);
+    encoder.resume();
+}
 
-    encoder.begin();
-    encoder.setSensitivity(encoderSensitivity);
-    bleService.startAdvertising();
+// A, B and the button as bits 2, 1, 0
+uint8_t encoderLevels() {
+    return (digitalRead(ENC_A_PIN) << 2) | (digitalRead(ENC_B_PIN) << 1) | digitalRead(ENC_BTN_PIN);
+}
+
+// Input task, on housekeeping's request.  What woke the chip is read before
+// the rows go back HIGH, while the column that did it is still LOW; the
+// caller's scan follows at once and turns it into the press.
+void lightSleep() {
+    keyMatrix.disarmWake();
+    encoder.setWakeHook(nullptr);
+    if (scanTimerOn) {
+        scanTimerOn = false;
+        timerStop(scanTimer);
+    }
+
+    uint8_t enc = encoderLevels();
+    TRACE(TR_SLEEP, 0, 0, 0);
+    configureSleepWakeup();
+    esp_light_sleep_start();
+    wakeUs = micros();
+
+    // ── Woke up ────────────────────────────────────────────────────────
+    uint8_t src = 0;
+    for (int c = 0; c < NUM_COLS; c++) {
+        if (!digitalRead(COL_PINS[c])) src |= WAKE_KEY;
+    }
+    enc ^= encoderLevels();
+    if (enc & 0x06) src |= WAKE_ENCODER;
+    if (enc & 0x01) src |= WAKE_BUTTON;
+    restoreAfterWake();
+    TRACE(TR_WAKE, esp_sleep_get_wakeup_cause(), src, 0);
+    scanWake = true;
 }
 
+// Housekeeping only decides; the input task does the sleeping
 void checkSleep() {
     if (sleepTimeoutMs == 0 || sleeping) return;
     if (serialBridge.isHandshaked()) { resetActivity(); return; }
     if ((millis() - lastActivity) >= sleepTimeoutMs) {
-        Serial.println("Entering light sleep...");
+        LOG_I("Entering light sleep...\n");
         Serial.flush();
         sleeping = true;
 
         bleService.stopAdvertising();
-        configureSleepWakeup();
-        esp_light_sleep_start();
+        sleepWanted = true;
+        xTaskNotifyGive(inputTask);
+    }
+}
 
-        // ── Woke up ────────────────────────────────────────────────────
-        Serial.println("Woke up!");
-        restoreAfterWake();
+// ── Task bodies ─────────────────────────────────────────────────────────────
+void IRAM_ATTR onScanTimer() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(inputTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
 
-        serialBridge.begin(Serial);
-        serialBridge.setCommandCallback(onCommand);
-        serialBridge.setConfigCallback(onConfigWrite);
+// Armed column / encoder edge while the governor is below full rate
+void IRAM_ATTR onWakeEdge() {
+    scanWake = true;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(inputTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
 
-        delay(50);
-        keyMatrix.scan();
+// Input task: scanTimer runs at full rate only.  Below it the timer is off —
+// a running timer holds the APB clock and keeps the chip out of light sleep.
+void applyScanTier() {
+    bool on = governor.tier() == GOV_FULL;
+    if (on == scanTimerOn) return;
+    scanTimerOn = on;
+    if (on) timerStart(scanTimer);
+    else    timerStop(scanTimer);
+}
+
+// Input task: while capturing, the scan timer ticks at CAPTURE_RATE_HZ and
+// every tick takes a raw sample; the scan pass runs on every
+// CAPTURE_RATE_HZ / SCAN_RATE_HZ-th
+void applyCapture() {
+    bool on = captureWanted;
+    if (on) pinCapture.start(micros(), keyMatrix.sample(), encoderLevels());
+    else    pinCapture.stop(micros());
+    captureTicks = 0;
+    timerAlarm(scanTimer, SCAN_TIMER_HZ / (on ? CAPTURE_RATE_HZ : SCAN_RATE_HZ), true, 0);
+    TRACE(TR_CAPTURE, on, pinCapture.lost() >> 8, pinCapture.lost());
+    LOG_I("Pin capture %s (%lu records lost)\n", on ? "on" : "off",
+          (unsigned long)pinCapture.lost());
+}
+
+// Fill the snapshot mailbox on request, every SNAPSHOT_PERIOD_MS while
+// anything is held, and once more when everything is released.
+bool takeSnapshot() {
+    bool          held = keyMatrix.getPressedMask() || encoder.isButtonPressed();
+    unsigned long now  = millis();
+    if (held && !snapshotHeld) { snapshotHeld = true; snapshotMs = now; }
+
+    bool due = snapshotWanted ||
+               (snapshotHeld && (!held || now - snapshotMs >= SNAPSHOT_PERIOD_MS));
+    if (!due || snapshotReady) return false;
+
+    snapshot.seq     = inputRing.lastSeq();
+    snapshot.encBtn  = encoder.isButtonPressed();
+    snapshot.pressed = keyMatrix.getPressedMask();
+    snapshotWanted = false;
+    snapshotHeld   = held;
+    snapshotMs     = now;
+    snapshotReady  = true;
+    return true;
+}
+
+void inputTaskFn(void*) {
+    uint32_t encHits = encoder.isrHits();
+    for (;;) {
+        uint16_t period = governor.periodMs();
+        ulTaskNotifyTake(pdTRUE, period ? pdMS_TO_TICKS(period) : portMAX_DELAY);
+        bool woke = sleepWanted;
+        if (woke) {
+            sleepWanted = false;
+            lightSleep();
+        }
+        if (pinCapture.on() && !woke && !scanWake) {
+            pinCapture.sample(micros(), keyMatrix.sample(), encoderLevels());
+            if (++captureTicks < CAPTURE_RATE_HZ / SCAN_RATE_HZ) continue;
+            captureTicks = 0;
+        }
+        uint32_t start = micros();
+        // Only timer-paced scans count towards the scan period
+        bool paced = !period && !scanWake;
+        if (paced && lastScanUs) scanPeriod.record(start - lastScanUs);
+        lastScanUs = paced ? start : 0;
+
+        keyMatrix.disarmWake();
+        encoder.setWakeHook(nullptr);
+        if (scanWake) {
+            scanWake = false;
+            governor.wake(millis());
+            applyScanTier();
+        }
+
+        if (debounceMs != appliedDebounceMs || debounceAdaptive != appliedAdaptive) {
+            appliedDebounceMs = debounceMs;
+            appliedAdaptive   = debounceAdaptive;
+            keyMatrix.setAdaptiveDebounce(appliedAdaptive);
+            keyMatrix.setDebounceMs(appliedDebounceMs);
+        }
+        if (debounceRelearn) {
+            debounceRelearn = false;
+            keyMatrix.relearnDebounce();
+        }
+        // Notifies waiting for BLE TX buffers: fewer rotate events, more steps each
+        uint16_t encoderHz = encoderRateHz;
+        if (bleCongested && (encoderHz == 0 || encoderHz > ENCODER_CONGESTED_HZ))
+            encoderHz = ENCODER_CONGESTED_HZ;
+        if (encoderHz != appliedEncoderHz) {
+            appliedEncoderHz = encoderHz;
+            encoder.setReportRate(appliedEncoderHz);
+        }
+        if (gesturesChanged) {
+            gesturesChanged = false;
+            for (uint8_t k = 0; k < NUM_KEYS; k++)
+                gestures.setKey(k, gestureHoldMs[k], gestureDoubleMs[k]);
+        }
+        if (captureWanted != pinCapture.on()) applyCapture();
+        uint16_t queued = inputRing.count();
+        if (woke) keyMatrix.wakeScan(wakeUs);
+        else      keyMatrix.scan();
         encoder.update();
+        gestures.update(keyMatrix.getPressedMask(), keyMatrix.settlingKeys(),
+                        keyMatrix.edgeStamps(), micros());
+        if (keyMatrix.chatterCount() != chatterSeen) {
+            chatterSeen = keyMatrix.chatterCount();
+            uint8_t k   = keyMatrix.lastChatterKey();
+            TRACE(TR_CHATTER, k, keyMatrix.bounceMs(k), keyMatrix.keyWindowMs(k));
+            LOG_W("Key %u chatters: %u ms bursts\n", k, keyMatrix.bounceMs(k));
+        }
+        bool snap = takeSnapshot();
+        if (woke) wakeWanted = true;
+        if (woke || snap || inputRing.count() != queued) xTaskNotifyGive(transportTask);
+
+        bool active = inputRing.count() != queued || encoder.isrHits() != encHits ||
+                      keyMatrix.getPressedMask() || keyMatrix.isSettling() ||
+                      encoder.isButtonPressed() || pinCapture.on() || gestures.pending();
+        encHits = encoder.isrHits();
+        if (governor.update(millis(), active)) applyScanTier();
+        if (governor.edgeWake()) {
+            encoder.setWakeHook(onWakeEdge);
+            keyMatrix.armWake(onWakeEdge);
+        }
 
-        Serial.println("BLE advertising restarted, ready");
-        resetActivity();
+        uint32_t work = micros() - start;
+        if (work > scanWorkMaxUs) scanWorkMaxUs = work;
+    }
+}
+
+void transportTaskFn(void*) {
+    InputEvent e;
+    uint32_t   capturedUs[EVENT_RING_SIZE];   // this pass's events, for eventLatency
+    for (;;) {
+        // Woken by new ring records, snapshots or battery readings; polls serial RX
+        // (and retries waiting BLE notifies) every TRANSPORT_POLL_MS regardless, or
+        // every GOV_IDLE_POLL_MS while the scan governor is idle, no USB host is
+        // attached and no notify waits.
+        bool     fast   = governor.tier() == GOV_FULL || serialBridge.isHandshaked() ||
+                          bleService.txWaiting();
+        uint16_t pollMs = fast ? TRANSPORT_POLL_MS : GOV_IDLE_POLL_MS;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(pollMs));
+        bool woke = wakeWanted;
+        if (woke) {
+            wakeWanted = false;
+            resetActivity();
+            if (!bleService.isConnected()) bleService.startAdvertising();
+            LOG_I("Woke up\n");
+        }
+        BleWrite w;
+        while (xQueueReceive(bleWrites, &w, 0) == pdPASS) {
+            if (w.config) onConfigWrite(w.code, w.data, w.len);
+            else          onCommand(w.code, w.data, w.len);
+        }
+        InputSnapshot snap;
+        bool          snapDue = snapshotReady;
+        if (snapDue) {
+            snap          = snapshot;
+            snapshotReady = false;
+        }
+        if (inputRing.count()) {
+            // Keep collecting for EVENT_BATCH_WINDOW_MS, then one frame per link
+            TickType_t opened = xTaskGetTickCount();
+            uint16_t   n      = 0;
+            for (;;) {
+                while (inputRing.pop(e)) {
+                    resetActivity();
+                    sendEvent(e);
+                    if (snapDue) snap.apply(e);
+                    if (n < EVENT_RING_SIZE) capturedUs[n++] = e.tUs;
+                    else                     eventLatency.record(micros() - e.tUs);
+                }
+                if (xTaskGetTickCount() - opened >= pdMS_TO_TICKS(EVENT_BATCH_WINDOW_MS)) break;
+                ulTaskNotifyTake(pdTRUE, 1);
+            }
+            bleService.flushEvents();
+            serialBridge.flushEvents();
+            uint32_t sent = micros();
+            for (uint16_t i = 0; i < n; i++) eventLatency.record(sent - capturedUs[i]);
+            if (woke) {
+                // The wake scan's events: end of the sleep → both links
+                uint32_t us = min(sent - wakeUs, (uint32_t)0xFFFF);
+                TRACE(TR_WAKE_EVENT, 0, us >> 8, us);
+                LOG_I("Wake → first event: %lu us\n", (unsigned long)(sent - wakeUs));
+            }
+        } else if (serialBridge.hasPendingEvents()) {
+            // Last batch hit back-pressure; retry once the UART has drained
+            serialBridge.flushEvents();
+        }
+        bleService.pumpNotifies();
+        if (bleService.congested() != bleCongested) {
+            bleCongested = !bleCongested;
+            TRACE(TR_BLE_CONGESTION, bleCongested, bleService.txWaiting(), os_msys_num_free());
+        }
+        if (snapDue) sendSnapshot(snap);
+        if (statsWanted) {
+            statsWanted = false;
+            sendStats();
+        }
+        if (bleService.updateLink() || linkWanted) {
+            linkWanted = false;
+            sendLink();
+        }
+        if (keymapWanted) {
+            keymapWanted = false;
+            sendKeymapStatus();
+        }
+        if (debounceWanted) {
+            debounceWanted = false;
+            sendDebounceProfile();
+        }
+        if (uint16_t asked = identifyWanted.exchange(0)) {
+            bleService.updateDeviceInfo();
+            while (asked--) serialBridge.sendDeviceInfo();
+        }
+        if (traceWanted) {
+            traceWanted = false;
+            serialBridge.sendTrace(traceSince);
+        }
+        if (uint32_t report = batteryReport) {
+            batteryReport = 0;
+            sendBattery(report);
+        }
+        serialBridge.update();
+    }
+}
+
+void housekeepingTaskFn(void*) {
+    for (;;) {
+        if (battery.update()) onBattery(battery.getPercentage(), battery.getVoltageMv());
+        checkSleep();
+        vTaskDelay(pdMS_TO_TICKS(HOUSEKEEPING_PERIOD_MS));
     }
 }
 
@@ -170,42 +769,62 @@ void checkSleep() {
 void setup() {
     Serial.begin(115200);
     delay(500);
-    Serial.println("\n====== MacroPad (dumb I/O mode) ======");
-    Serial.printf("FW: %u.%u.%u  Layout: %ux%u\n",
+    LOG_I("\n====== MacroPad (dumb I/O mode) ======\n");
+    LOG_I("FW: %u.%u.%u  Layout: %ux%u\n",
         FW_VERSION_MAJOR, FW_VERSION_MINOR, FW_VERSION_PATCH,
         NUM_ROWS, NUM_COLS);
-    Serial.println("No config stored on device - PC handles everything.");
+    LOG_I("No config stored on device - PC handles everything.\n");
+
+    inputRing.begin();
 
     keyMatrix.begin();
+    keyMatrix.setAdaptiveDebounce(debounceAdaptive);
     keyMatrix.setDebounceMs(debounceMs);
-    keyMatrix.setCallback(onKey);
+    keyMatrix.setEventRing(&inputRing);
 
     encoder.begin();
     encoder.setSensitivity(encoderSensitivity);
-    encoder.setRotateCallback(onRotate);
-    encoder.setButtonCallback(onEncButton);
+    encoder.setEventRing(&inputRing);
+
+    gestures.begin();
+    gestures.setEventRing(&inputRing);
 
     battery.begin();
-    battery.setCallback(onBattery);
 
+    bleWrites = xQueueCreate(BLE_WRITE_QUEUE, sizeof(BleWrite));
     bleService.begin(DEFAULT_DEVICE_NAME);
-    bleService.setCommandCallback(onCommand);
-    bleService.setConfigCallback(onConfigWrite);
+    bleService.setCommandCallback(onBleCommand);
+    bleService.setConfigCallback(onBleConfigWrite);
     bleService.updateBatteryLevel(battery.getPercentage());
 
     serialBridge.begin(Serial);
     serialBridge.setCommandCallback(onCommand);
     serialBridge.setConfigCallback(onConfigWrite);
+    serialBridge.setCapture(&pinCapture);
+
+    xTaskCreate(inputTaskFn,        "input",        INPUT_TASK_STACK,
+                nullptr, INPUT_TASK_PRIORITY,        &inputTask);
+    xTaskCreate(transportTaskFn,    "transport",    TRANSPORT_TASK_STACK,
+                nullptr, TRANSPORT_TASK_PRIORITY,    &transportTask);
+    xTaskCreate(housekeepingTaskFn, "housekeeping", HOUSEKEEPING_TASK_STACK,
+                nullptr, HOUSEKEEPING_TASK_PRIORITY, nullptr);
+
+    scanTimer = timerBegin(SCAN_TIMER_HZ);
+    timerAttachInterrupt(scanTimer, onScanTimer);
+    timerAlarm(scanTimer, SCAN_TIMER_HZ / SCAN_RATE_HZ, true, 0);
+
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    // Tickless idle: the chip light-sleeps whenever no task is due soon and
+    // nothing holds a power-management lock (the scan timer does)
+    esp_pm_config_t pm = { GOV_PM_MAX_MHZ, GOV_PM_MIN_MHZ, true };
+    esp_pm_configure(&pm);
+#endif
 
     lastActivity = millis();
-    Serial.println("====== Ready ======");
+    LOG_I("====== Ready ======\n");
 }
 
+// Everything runs in the tasks created by setup()
 void loop() {
-    keyMatrix.scan();
-    encoder.update();
-    battery.update();
-    serialBridge.update();
-    checkSleep();
-    delay(1);
+    vTaskDelete(NULL);
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+// =============================================================================
+// NotifyQueue.cpp — BLE notifies waiting for the stack's TX buffers
+// =============================================================================
+#include "NotifyQueue.h"
+#include "HidReports.h"
+#include <NimBLEDevice.h>
+
+static uint8_t addSat(uint8_t a, uint8_t b) {
+    int v = (int8_t)a + (int8_t)b;
+    return (uint8_t)(int8_t)(v > 127 ? 127 : v < -127 ? -127 : v);
+}
+
+// Rotations fold only while the steps fit their byte: none may be lost
+static bool canFold(const uint8_t* into, const uint8_t* from) {
+    return into[0] == from[0] && into[1] == from[1] && into[2] + from[2] <= 255;
+}
+
+void NotifyQueue::begin() {
+    for (uint8_t i = 0; i < BLE_TX_QUEUE; i++) _order[i] = i;
+    _count = 0;
+}
+
+void NotifyQueue::clear() { _count = 0; }
+
+bool NotifyQueue::congested() const {
+    return _count || os_msys_num_free() <= BLE_TX_RESERVE;
+}
+
+bool NotifyQueue::notify(NimBLECharacteristic* c, const uint8_t* data, uint16_t len) {
+    c->setValue(data, len);
+    if (c->notify()) return true;
+    _refused = _refused + 1;
+    return false;
+}
+
+uint8_t NotifyQueue::send(NimBLECharacteristic* c, const uint8_t* data, uint16_t len,
+                          uint8_t kind) {
+    if (len > VALUE_MAX) len = VALUE_MAX;
+    // With no buffer free the stack would only refuse it
+    if (!_count && os_msys_num_free() > 0 && notify(c, data, len)) return TX_SENT;
+    if (merge(c, data, len, kind)) return TX_QUEUED;
+    if (_count == BLE_TX_QUEUE && !makeRoom(kind)) {
+        _dropped = _dropped + 1;
+        return TX_DROPPED;
+    }
+    Entry& e = _slot[_order[_count++]];
+    e.chr  = c;
+    e.len  = len;
+    e.kind = kind;
+    memcpy(e.data, data, len);
+    return TX_QUEUED;
+}
+
+// A mouse report adds into the newest waiting one if that is a mouse report
+// with the same buttons and neither moves the pointer.  A per-event rotation
+// [type, dir, steps, seq, speed] takes in the steps of the newest waiting one
+// on its characteristic if that turns the same way and the sum fits, and moves it to the back with
+// its own seq and speed.  A state value drops the waiting value of its
+// characteristic and queues at the back, behind every event notify it may
+// describe.
+bool NotifyQueue::merge(NimBLECharacteristic* c, const uint8_t* d, uint16_t len, uint8_t kind) {
+    if (kind == TX_MOUSE && _count) {
+        Entry& e = _slot[_order[_count - 1]];
+        if (e.kind == TX_MOUSE && e.chr == c && len == HID_MOUSE_BYTES && e.len == len &&
+            e.data[0] == d[0] && !(e.data[1] | e.data[2] | d[1] | d[2])) {
+            e.data[3] = addSat(e.data[3], d[3]);
+            e.data[4] = addSat(e.data[4], d[4]);
+            _coalesced = _coalesced + 1;
+            return true;
+        }
+    }
+    if (kind == TX_ROTATION && len == ROTATION_BYTES)
+        for (uint8_t pos = _count; pos-- > 0;) {
+            Entry& e = _slot[_order[pos]];
+            if (e.chr != c) continue;
+            if (e.kind != TX_ROTATION || e.len != len || !canFold(e.data, d)) break;
+            e.data[2] += d[2];
+            memcpy(e.data + 3, d + 3, 3);
+            remove(pos);
+            _count++;                   // remove() left its slot just past the last
+            _coalesced = _coalesced + 1;
+            return true;
+        }
+    if (kind == TX_STATE)
+        for (uint8_t pos = 0; pos < _count; pos++)
+            if (_slot[_order[pos]].chr == c) {
+                remove(pos);
+                _coalesced = _coalesced + 1;
+                break;
+            }
+    return false;
+}
+
+// A rotation goes only if it cannot fold into a later one turning the same
+// way: the steps are not in the resync snapshot
+bool NotifyQueue::makeRoom(uint8_t kind) {
+    for (uint8_t pos = 0; pos < _count; pos++) {
+        const Entry& e = _slot[_order[pos]];
+        if (e.kind != TX_ROTATION || e.len != ROTATION_BYTES) continue;
+        for (uint8_t later = pos + 1; later < _count; later++) {
+            Entry& l = _slot[_order[later]];
+            if (l.chr == e.chr && l.kind == TX_ROTATION && l.len == e.len && canFold(l.data, e.data)) {
+                l.data[2] += e.data[2];
+                remove(pos);
+                _coalesced = _coalesced + 1;
+                return true;
+            }
+        }
+    }
+    for (uint8_t pos = 0; pos < _count; pos++) {
+        uint8_t k = _slot[_order[pos]].kind;
+        if (k == TX_ROTATION || k == TX_MOUSE) {
+            remove(pos);
+            _dropped = _dropped + 1;
+            return true;
+        }
+    }
+    if (kind != TX_EVENT) return false;
+    for (uint8_t pos = 0; pos < _count; pos++)
+        if (_slot[_order[pos]].kind == TX_STATE) {
+            remove(pos);
+            _dropped = _dropped + 1;
+            return true;
+        }
+    return false;
+}
+
+void NotifyQueue::remove(uint8_t pos) {
+    uint8_t slot = _order[pos];
+    for (uint8_t i = pos; i + 1 < _count; i++) _order[i] = _order[i + 1];
+    _order[--_count] = slot;
+}
+
+void NotifyQueue::pump() {
+    while (_count && os_msys_num_free() > 0) {
+        const Entry& e = _slot[_order[0]];
+        if (!notify(e.chr, e.data, e.len)) return;
+        _retried = _retried + 1;
+        remove(0);
+    }
+}
@@ -0,0 +1,81 @@
+// =============================================================================
+// NotifyQueue.h — BLE notifies waiting for the stack's TX buffers
+// NimBLE refuses a notify while every TX buffer (msys mbuf) holds one the
+// central has not acknowledged: a long connection interval, or a noisy
+// channel where each lost packet waits for the next connection event.
+// BleService hands its event, HID and state notifies to this queue.  One
+// goes straight out when nothing is waiting and a buffer is free; otherwise
+// it waits here and pump() retries, oldest first, on every transport pass.
+// Order is kept: event notifies carry sequence numbers.
+//
+// A mouse report merges into a waiting one behind it (wheel and pan add up),
+// a per-event rotation folds the steps of a waiting one turning the same way
+// into itself, and a state value replaces the waiting value of its
+// characteristic; the last two move to the back.  Only when nothing merges
+// does a full queue make room: by dropping its oldest rotation, then, for a
+// key event, its oldest state value; a key event is dropped only when the
+// queue holds nothing but key events.
+// Transport task only, clear() included: BleService's connection callbacks
+// run on the NimBLE host task and leave the clearing to the transport.
+// =============================================================================
+#ifndef NOTIFY_QUEUE_H
+#define NOTIFY_QUEUE_H
+
+#include "Config.h"
+
+class NimBLECharacteristic;
+
+// What a notify is, for making room
+#define TX_EVENT      0     // key events, batches holding one, HID keyboard / consumer, replies
+#define TX_ROTATION   1     // encoder-only events and batches
+#define TX_MOUSE      2     // HID mouse reports (encoder scroll): a rotation that merges
+#define TX_STATE      3     // snapshot, stats, link, battery: only the newest matters
+
+// send() results
+#define TX_SENT       0
+#define TX_QUEUED     1
+#define TX_DROPPED    2
+
+class NotifyQueue {
+public:
+    static const uint16_t VALUE_MAX      = 244;     // ATT MTU 247 − 3
+    static const uint16_t ROTATION_BYTES = 6;       // a per-event encoder notify
+
+    void    begin();
+    void    clear();                                // disconnected: nothing waits
+    uint8_t send(NimBLECharacteristic* c, const uint8_t* data, uint16_t len, uint8_t kind);
+    void    pump();                                 // oldest first, until one is refused
+
+    uint8_t waiting() const { return _count; }
+    // Waiting notifies, or BLE_TX_RESERVE TX buffers or fewer left
+    bool    congested() const;
+
+    uint32_t refused()   const { return _refused; }     // notify() returned false
+    uint32_t retried()   const { return _retried; }     // went out on a later pass
+    uint32_t dropped()   const { return _dropped; }     // made room for a newer one
+    uint32_t coalesced() const { return _coalesced; }   // merged or replaced while waiting
+
+private:
+    struct Entry {
+        NimBLECharacteristic* chr;
+        uint16_t              len;
+        uint8_t               kind;
+        uint8_t               data[VALUE_MAX];
+    };
+
+    bool notify(NimBLECharacteristic* c, const uint8_t* data, uint16_t len);
+    bool merge(NimBLECharacteristic* c, const uint8_t* data, uint16_t len, uint8_t kind);
+    bool makeRoom(uint8_t kind);
+    void remove(uint8_t pos);                       // the pos-th oldest
+
+    Entry   _slot[BLE_TX_QUEUE];
+    uint8_t _order[BLE_TX_QUEUE];                   // slots: _count waiting, oldest first, then free
+    uint8_t _count = 0;
+
+    volatile uint32_t _refused   = 0;
+    volatile uint32_t _retried   = 0;
+    volatile uint32_t _dropped   = 0;
+    volatile uint32_t _coalesced = 0;
+};
+
+#endif
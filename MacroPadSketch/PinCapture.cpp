@@ -0,0 +1,74 @@
+// =============================================================================
+// PinCapture.cpp — Raw matrix and encoder pin samples for offline replay
+// =============================================================================
+#include "PinCapture.h"
+
+static const uint32_t RING_MASK = CAPTURE_RING_SIZE - 1;
+
+void PinCapture::start(uint32_t tUs, const KeyMask& keys, uint8_t enc) {
+    _lost    = 0;
+    _pending = (uint8_t)(CAP_FIRST | (_pending & CAP_LOST));
+    _on      = true;
+    sample(tUs, keys, enc);
+}
+
+void PinCapture::stop(uint32_t tUs) {
+    if (!_on) return;
+    _pending |= CAP_LAST;
+    push({ tUs, _last.levels, _last.keys });
+    _on = false;
+}
+
+void PinCapture::sample(uint32_t tUs, const KeyMask& keys, uint8_t enc) {
+    if (!_on) return;
+    if (!(_pending & CAP_FIRST) && keys == _last.keys && enc == _last.levels) return;
+    push({ tUs, enc, keys });
+}
+
+// A full ring drops the record and flags the next one that fits.  _last
+// stays at the last record kept, so the level that was lost is retried.
+bool PinCapture::push(const PinSample& s) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= CAPTURE_RING_SIZE) {
+        _lost     = _lost + 1;
+        _pending |= CAP_LOST;
+        return false;
+    }
+    PinSample& slot = _buf[head & RING_MASK];
+    slot         = s;
+    slot.levels |= _pending;
+    _last        = s;
+    _pending     = 0;
+    _head.store(head + 1, std::memory_order_release);   // publish the record
+    return true;
+}
+
+uint16_t PinCapture::count() const {
+    return (uint16_t)(_head.load(std::memory_order_acquire) -
+                      _tail.load(std::memory_order_acquire));
+}
+
+const PinSample& PinCapture::at(uint16_t i) const {
+    return _buf[(_tail.load(std::memory_order_relaxed) + i) & RING_MASK];
+}
+
+void PinCapture::consume(uint16_t n) {
+    _tail.store(_tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
+
+uint16_t PinCapture::build(uint16_t n, uint8_t* out) const {
+    out[0] = (uint8_t)n;
+    out[1] = NUM_KEYS;
+    uint8_t* p = out + CAPTURE_HEADER_BYTES;
+    for (uint16_t i = 0; i < n; i++) {
+        const PinSample& s = at(i);
+        p[0] = (uint8_t)(s.tUs >> 24);
+        p[1] = (uint8_t)(s.tUs >> 16);
+        p[2] = (uint8_t)(s.tUs >> 8);
+        p[3] = (uint8_t)s.tUs;
+        p[4] = s.levels;
+        for (uint8_t b = 0; b < (NUM_KEYS + 7) / 8; b++) p[5 + b] = maskByte(s.keys, b);
+        p += CAPTURE_RECORD_BYTES;
+    }
+    return (uint16_t)(p - out);
+}
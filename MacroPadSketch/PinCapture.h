@@ -0,0 +1,76 @@
+// =============================================================================
+// PinCapture.h — Raw matrix and encoder pin samples for offline replay
+// While capture is on, the input task takes one raw sample per scan timer
+// tick (CAPTURE_RATE_HZ): the contacts KeyMatrix reads before any debounce,
+// and the encoder's A, B and button levels.  Only samples that differ from
+// the one before are kept, so a still board costs nothing and a bouncing
+// contact keeps every level change at the sampling resolution.  Records go
+// into a single-producer / single-consumer ring.  The serial bridge streams
+// them out as PKT_CAPTURE frames:
+//   [count] [key count]  then count × [t µs, u32 BE] [levels] [raw keys, ⌈keys/8⌉ bytes, LSB first]
+// levels: bit 2 A, bit 1 B, bit 0 button (1 = HIGH, i.e. open), plus
+//   CAP_FIRST  the capture started here; every level is as found
+//   CAP_LAST   the capture stopped here; levels are unchanged
+//   CAP_LOST   the ring was full and changes before this record were lost
+// A CAP_FIRST also closes a capture whose CAP_LAST was lost.
+// Input task only, apart from count() / at() / consume() (the serial bridge).
+// =============================================================================
+#ifndef PIN_CAPTURE_H
+#define PIN_CAPTURE_H
+
+#include "Config.h"
+#include "EventRing.h"
+#include <atomic>
+
+static_assert((CAPTURE_RING_SIZE & (CAPTURE_RING_SIZE - 1)) == 0,
+              "CAPTURE_RING_SIZE must be a power of two");
+
+#define CAP_FIRST           0x80
+#define CAP_LAST            0x40
+#define CAP_LOST            0x20
+#define CAP_LEVELS          0x07
+
+#define CAPTURE_HEADER_BYTES 2
+#define CAPTURE_RECORD_BYTES (5 + (NUM_KEYS + 7) / 8)
+#define CAPTURE_PER_FRAME    ((EVENT_BATCH_MAX_BYTES - CAPTURE_HEADER_BYTES) / CAPTURE_RECORD_BYTES)
+
+struct PinSample {
+    uint32_t tUs;
+    uint8_t  levels;     // CAP_* | encoder levels
+    KeyMask  keys;       // raw closed contacts, bit i = key index i
+};
+
+class PinCapture {
+public:
+    void start(uint32_t tUs, const KeyMask& keys, uint8_t enc);   // first record
+    void stop(uint32_t tUs);                                      // last record
+    bool on() const { return _on; }
+
+    // One raw sample; kept only if it differs from the last one kept
+    void sample(uint32_t tUs, const KeyMask& keys, uint8_t enc);
+
+    // Consumer: the i-th oldest record, then give n of them back
+    uint16_t         count() const;
+    const PinSample& at(uint16_t i) const;
+    void             consume(uint16_t n);
+
+    uint32_t lost() const { return _lost; }        // records dropped, this capture
+
+    // PKT_CAPTURE payload of the oldest `n` records; returns payload bytes
+    uint16_t build(uint16_t n, uint8_t* out) const;
+
+private:
+    bool push(const PinSample& s);
+
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+
+    volatile bool     _on      = false;
+    uint8_t           _pending = 0;       // CAP_* flags for the next record kept
+    volatile uint32_t _lost    = 0;
+    PinSample         _last    = {};      // last record kept, without flags
+
+    PinSample _buf[CAPTURE_RING_SIZE];
+};
+
+#endif
@@ -0,0 +1,36 @@
+// =============================================================================
+// ScanGovernor.cpp — Input scan rate: full while in use, stepping down when idle
+// =============================================================================
+#include "ScanGovernor.h"
+#include "Trace.h"
+
+static const uint16_t PERIOD_MS[] = { 0, GOV_IDLE_PERIOD_MS, GOV_DEEP_PERIOD_MS };
+
+uint16_t ScanGovernor::periodMs() const { return PERIOD_MS[_tier]; }
+
+bool ScanGovernor::setTier(uint8_t tier, bool edge) {
+    if (tier == _tier) return false;
+    _tier = tier;
+    TRACE(TR_SCAN_TIER, tier, _mode, edge);
+    return true;
+}
+
+bool ScanGovernor::update(uint32_t nowMs, bool active) {
+    _scans++;
+    if (active || _mode == GOV_MODE_FIXED) _lastActiveMs = nowMs;
+
+    uint32_t quiet = nowMs - _lastActiveMs;
+    uint8_t  tier  = quiet >= GOV_DEEP_AFTER_MS ? GOV_DEEP
+                   : quiet >= GOV_IDLE_AFTER_MS ? GOV_IDLE
+                   :                              GOV_FULL;
+    return setTier(tier, false);
+}
+
+bool ScanGovernor::wake(uint32_t nowMs) {
+    _lastActiveMs = nowMs;
+    return setTier(GOV_FULL, true);
+}
+
+void ScanGovernor::setMode(uint8_t mode) {
+    if (mode <= GOV_MODE_POLL) _mode = mode;
+}
@@ -0,0 +1,50 @@
+// =============================================================================
+// ScanGovernor.h — Input scan rate: full while in use, stepping down when idle
+// The input task reports every scan.  GOV_IDLE_AFTER_MS after the last input
+// the governor drops to one scan per GOV_IDLE_PERIOD_MS, and after
+// GOV_DEEP_AFTER_MS to one per GOV_DEEP_PERIOD_MS.  Full rate runs on the
+// hardware scan timer; the lower tiers pace the input task with a notify
+// timeout instead, so FreeRTOS tickless idle can light-sleep the chip between
+// scans.  In GOV_MODE_AUTO the idle rows stay driven LOW with the column and
+// encoder pins armed, and the first edge calls wake(): full rate is back
+// before the scan that edge triggers.
+// Input task only, apart from setMode() and tier().
+// =============================================================================
+#ifndef SCAN_GOVERNOR_H
+#define SCAN_GOVERNOR_H
+
+#include "Config.h"
+
+#define GOV_FULL   0        // SCAN_RATE_HZ on the hardware timer
+#define GOV_IDLE   1        // every GOV_IDLE_PERIOD_MS
+#define GOV_DEEP   2        // every GOV_DEEP_PERIOD_MS
+
+class ScanGovernor {
+public:
+    // One scan done.  `active` = it queued an event, or a key or the encoder
+    // button is held, a key is still settling, the encoder moved, a pin
+    // capture is running, or a gesture waits on a threshold.  True when the
+    // tier changed.
+    bool update(uint32_t nowMs, bool active);
+
+    // An armed edge, or the end of a light sleep: back to full rate.  True
+    // when the tier changed.
+    bool wake(uint32_t nowMs);
+
+    void     setMode(uint8_t mode);          // GOV_MODE_*; any task
+    uint8_t  mode()     const { return _mode; }
+    uint8_t  tier()     const { return _tier; }
+    uint16_t periodMs() const;               // 0 at full rate
+    bool     edgeWake() const { return _tier != GOV_FULL && _mode == GOV_MODE_AUTO; }
+    uint32_t scans()    const { return _scans; }
+
+private:
+    bool setTier(uint8_t tier, bool edge);
+
+    volatile uint8_t _mode         = DEFAULT_GOV_MODE;
+    volatile uint8_t _tier         = GOV_FULL;
+    uint32_t         _lastActiveMs = 0;
+    uint32_t         _scans        = 0;
+};
+
+#endif
@@ -6,68 +6,119 @@
 void SerialBridge::begin(Stream& serial) {
     _serial     = &serial;
     _handshaked = false;
-    _state      = IDLE;
+    _features   = 0;
+    _rxLen      = 0;
+    _rxSuspect  = 0;
+    _batch.setLimit(EVENT_BATCH_MAX_BYTES);
+    _batch.clear();
+    _traceNext  = _traceEnd = 0;
+    _traceOpen  = false;
 }
 
 // ── Poll incoming bytes ──────────────────────────────────────────────────────
+// Straight from the driver into the frame buffer, as much as fits per call.
+// parse() always leaves room: what it keeps is less than one frame.  A start
+// byte whose frame never completes (noise, or a host that stopped mid-frame)
+// gives way after SERIAL_RX_TIMEOUT_MS.
 void SerialBridge::update() {
     if (!_serial) return;
-    while (_serial->available()) {
-        feedByte((uint8_t)_serial->read());
+    size_t budget = SERIAL_RX_BUDGET;
+    while (budget) {
+        int avail = _serial->available();
+        if (avail <= 0) break;
+        size_t n = min(min((size_t)avail, budget), sizeof(_rx) - _rxLen);
+        if (!_rxLen) _rxSinceMs = millis();
+        _rxReadUs = micros();
+        n = _serial->readBytes(_rx + _rxLen, n);
+        if (!n) break;
+        _rxLen += (uint16_t)n;
+        budget -= n;
+        parse();
     }
+    if (_rxLen && millis() - _rxSinceMs >= SERIAL_RX_TIMEOUT_MS && !_serial->available()) {
+        refuse(frameBytes());
+        parse();
+    }
+    if (_traceOpen || _traceNext != _traceEnd) pumpTrace();
+    if (_capture && _handshaked) pumpCapture();
 }
 
-// ── RX state machine — mirrors the TS parser exactly ─────────────────────────
-void SerialBridge::feedByte(uint8_t b) {
-    switch (_state) {
-    case IDLE:
-        if (b == PKT_START) {
-            _state  = TYPE;
-            _pktXor = 0;
-        }
-        break;
+// ── RX framing ───────────────────────────────────────────────────────────────
+// Whole frames off the front of _rx.  A frame that fails its check, or a
+// header no host sends, drops only its start byte and the search goes on in
+// the bytes after it: noise that looks like a start, or a frame cut short,
+// holds up the frames behind it by at most one frame's length and loses none.
+void SerialBridge::parse() {
+    skip(0);
+    while (_rxLen) {
+        uint16_t need = frameBytes();
+        if (need > _rxLen) return;                 // rest not here yet
 
-    case TYPE:
-        _pktType = b;
-        _pktXor ^= b;
-        _state = LEN_HI;
-        break;
+        if (need && frameValid(need)) {
+            uint8_t type = _rx[1];
+            handlePacket(type, _rx + 4, (uint16_t)(need - 4 - checkBytes(type)));
+            skip(need);
+            continue;
+        }
+        refuse(need);
+    }
+}
 
-    case LEN_HI:
-        _pktLen = (uint16_t)b << 8;
-        _pktXor ^= b;
-        _state = LEN_LO;
-        break;
+// The frame at the front is not one: count it, unless it starts inside one
+// already counted, and search again from its second byte
+void SerialBridge::refuse(uint16_t need) {
+    if (!_rxSuspect) {
+        if (need) _rxBad++;
+        else      _rxOversize++;
+        _rxSuspect = need ? need : 4;
+    }
+    skip(1);
+}
 
-    case LEN_LO:
-        _pktLen |= b;
-        _pktXor ^= b;
-        if (_pktLen > SERIAL_RX_BUF_SIZE) {
-            // Oversized — drop
-            _state = IDLE;
-        } else if (_pktLen > 0) {
-            _pktPos = 0;
-            _state  = DATA;
-        } else {
-            _state = CHECKSUM;
-        }
-        break;
+// Drop n bytes, then everything before the next PKT_START
+void SerialBridge::skip(uint16_t n) {
+    const uint8_t* s = n < _rxLen ? (const uint8_t*)memchr(_rx + n, PKT_START, _rxLen - n)
+                                  : nullptr;
+    uint16_t from = s ? (uint16_t)(s - _rx) : _rxLen;
+    _rxLen -= from;
+    if (_rxLen && from) {
+        memmove(_rx, _rx + from, _rxLen);
+        _rxSinceMs = millis();
+    }
+    _rxSuspect = _rxSuspect > from ? _rxSuspect - from : 0;
+}
 
-    case DATA:
-        _rxBuf[_pktPos++] = b;
-        _pktXor ^= b;
-        if (_pktPos >= _pktLen) {
-            _state = CHECKSUM;
-        }
+// Length of the frame at the front once its header is in (4 until then),
+// or 0 when the header is one the device never receives
+uint16_t SerialBridge::frameBytes() const {
+    if (_rxLen < 4) return 4;
+    uint16_t len = (uint16_t)(_rx[2] << 8 | _rx[3]);
+    switch (_rx[1]) {
+    case PKT_HANDSHAKE:
+        if (len > SERIAL_RX_HS_MAX) return 0;
         break;
-
-    case CHECKSUM:
-        if (b == _pktXor) {
-            handlePacket(_pktType, _rxBuf, _pktLen);
-        }
-        _state = IDLE;
+    case PKT_COMMAND:
+    case PKT_CONFIG_DATA:
+        if (len > SERIAL_RX_BUF_SIZE) return 0;
         break;
+    default:
+        return 0;
     }
+    return (uint16_t)(4 + len + checkBytes(_rx[1]));
+}
+
+uint8_t SerialBridge::checkBytes(uint8_t type) const {
+    return (_features & HS_FLAG_CRC16) && type != PKT_HANDSHAKE ? 2 : 1;
+}
+
+// XOR or CRC-16 over type, length and data, in one pass over the span
+bool SerialBridge::frameValid(uint16_t n) const {
+    uint16_t end = (uint16_t)(n - checkBytes(_rx[1]));
+    if (n - end == 2)
+        return crc16(_rx + 1, end - 1) == (uint16_t)(_rx[end] << 8 | _rx[end + 1]);
+    uint8_t x = 0;
+    for (uint16_t i = 1; i < end; i++) x ^= _rx[i];
+    return x == _rx[end];
 }
 
 // ── Handle a parsed incoming packet ──────────────────────────────────────────
@@ -81,11 +132,18 @@ void SerialBridge::handlePacket(uint8_t type, const uint8_t* data, uint16_t len)
             data[1] == HANDSHAKE_MAGIC_1 &&
             data[2] == HANDSHAKE_MAGIC_2) {
 
+            uint8_t features = (len >= 4) ? (data[3] & HS_FLAGS_SUPPORTED) : 0;
             _handshaked = true;
+            _timesOn    = false;
+            _batch.clear();
 
-            // Reply with ACK
-            uint8_t ack[] = { HANDSHAKE_MAGIC_0, HANDSHAKE_MAGIC_1, HANDSHAKE_MAGIC_2 };
-            sendPacket(PKT_HANDSHAKE_ACK, ack, sizeof(ack));
+            // Reply with ACK (+ enabled features if the app asked for any),
+            // XOR-framed; the agreed framing starts with the next frame
+            uint8_t ack[] = { HANDSHAKE_MAGIC_0, HANDSHAKE_MAGIC_1, HANDSHAKE_MAGIC_2, features };
+            _features = 0;
+            sendPacket(PKT_HANDSHAKE_ACK, ack, len >= 4 ? 4 : 3);
+            _features = features;
+            TRACE(TR_HANDSHAKE, features, 0, 0);
 
             // Immediately send device info so the app can identify the board
             sendDeviceInfo();
@@ -93,6 +151,7 @@ void SerialBridge::handlePacket(uint8_t type, const uint8_t* data, uint16_t len)
         break;
 
     case PKT_COMMAND:
+        if (len >= 1) linkCommand(data[0], data + 1, len - 1);
         if (len >= 1 && _cmdCb) {
             _cmdCb(data[0], data + 1, len - 1);
         }
@@ -106,41 +165,190 @@ void SerialBridge::handlePacket(uint8_t type, const uint8_t* data, uint16_t len)
     }
 }
 
-// ── Send a framed packet ─────────────────────────────────────────────────────
-void SerialBridge::sendPacket(uint8_t type, const uint8_t* data, uint16_t len) {
-    if (!_serial) return;
+// ── Commands this link answers itself ────────────────────────────────────────
+// A clock sync reply has to leave on the link the request came in on, with
+// both stamps as close to the wire as this side gets: t2 is the driver read
+// that completed the frame, t3 is taken just before the write.
+void SerialBridge::linkCommand(uint8_t cmd, const uint8_t* data, uint16_t len) {
+    switch (cmd) {
+    case CMD_TIME_SYNC:
+        if (len >= 4 && _handshaked) {
+            TimeSync t = { (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+                           (uint32_t)data[2] << 8  | data[3],
+                           _rxReadUs, 0 };
+            uint8_t  buf[TIME_SYNC_BYTES];
+            t.txUs = micros();
+            sendPacket(PKT_TIME, buf, t.build(buf));
+        }
+        break;
+    case CMD_SET_LATENCY_TRACE:
+        if (len >= 1) _timesOn = data[0] != 0;
+        break;
+    }
+}
+
+// ── Send a framed packet: one buffer, one driver write ───────────────────────
+bool SerialBridge::sendPacket(uint8_t type, const uint8_t* data, uint16_t len, bool block) {
+    if (!_serial) return false;
+
+    bool   crc = _features & HS_FLAG_CRC16;
+    size_t n   = 4 + len + (crc ? 2 : 1);
+    if (n > sizeof(_txBuf)) return false;
 
-    uint8_t header[4];
-    header[0] = PKT_START;
-    header[1] = type;
-    header[2] = (len >> 8) & 0xFF;
-    header[3] = len & 0xFF;
-    _serial->write(header, 4);
-
-    // Compute XOR over type + lenHi + lenLo + data
-    uint8_t xorChk = type ^ header[2] ^ header[3];
-    for (uint16_t i = 0; i < len; i++) {
-        xorChk ^= data[i];
+    if (!block && _serial->availableForWrite() < (int)n) {
+        _txDeferred++;
+        return false;
     }
 
-    if (len > 0) {
-        _serial->write(data, len);
+    uint8_t* f = _txBuf;
+    f[0] = PKT_START;
+    f[1] = type;
+    f[2] = (len >> 8) & 0xFF;
+    f[3] = len & 0xFF;
+    if (len > 0) memcpy(f + 4, data, len);
+
+    if (crc) {
+        // CRC over type + lenHi + lenLo + data, big-endian
+        uint16_t c = crc16(f + 1, 3 + len);
+        f[4 + len] = (uint8_t)(c >> 8);
+        f[5 + len] = (uint8_t)c;
+    } else {
+        // XOR over type + lenHi + lenLo + data
+        uint8_t x = 0;
+        for (size_t i = 1; i < 4 + (size_t)len; i++) x ^= f[i];
+        f[4 + len] = x;
     }
-    _serial->write(xorChk);
+
+    _serial->write(f, n);
+    return true;
 }
 
 // ── Outgoing helpers — same byte layouts as BleService ───────────────────────
 
-void SerialBridge::sendKeyEvent(uint8_t evt, uint8_t idx) {
+bool SerialBridge::sendKeyEvent(uint8_t evt, uint8_t idx, uint8_t layer, uint8_t seq) {
+    if (!_handshaked) return false;
+    uint8_t pkt[4] = { evt, idx, layer, seq };
+    return sendPacket(PKT_KEY_EVENT, pkt, 4, false);
+}
+
+bool SerialBridge::sendEncoderEvent(uint8_t evt, uint8_t dir, uint8_t steps, uint8_t seq,
+                                    uint16_t speed) {
+    if (!_handshaked) return false;
+    uint8_t pkt[6] = { evt, dir, steps, seq, (uint8_t)(speed >> 8), (uint8_t)speed };
+    return sendPacket(PKT_ENCODER_EVENT, pkt, 6, false);
+}
+
+void SerialBridge::sendSnapshot(const InputSnapshot& s) {
+    if (!_handshaked) return;
+    uint8_t buf[SNAPSHOT_MAX_BYTES];
+    sendPacket(PKT_SNAPSHOT, buf, s.build(buf));
+}
+
+void SerialBridge::sendStats(const DeviceStats& s) {
+    if (!_handshaked) return;
+    uint8_t buf[STATS_MAX_BYTES];
+    sendPacket(PKT_STATS, buf, s.build(buf));
+}
+
+void SerialBridge::sendLink(const LinkParams& p) {
     if (!_handshaked) return;
-    uint8_t pkt[2] = { evt, idx };
-    sendPacket(PKT_KEY_EVENT, pkt, 2);
+    uint8_t buf[LINK_PARAMS_BYTES];
+    sendPacket(PKT_LINK, buf, p.build(buf));
 }
 
-void SerialBridge::sendEncoderEvent(uint8_t evt, uint8_t dir, uint8_t steps) {
+// ── Trace dump ───────────────────────────────────────────────────────────────
+void SerialBridge::sendTrace(uint32_t since) {
     if (!_handshaked) return;
-    uint8_t pkt[3] = { evt, dir, steps };
-    sendPacket(PKT_ENCODER_EVENT, pkt, 3);
+    uint32_t head   = traceRing.head();
+    uint32_t oldest = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    _traceNext = (int32_t)(since - oldest) > 0 ? since : oldest;
+    _traceEnd  = head;
+    if ((int32_t)(_traceEnd - _traceNext) < 0) _traceNext = _traceEnd;
+    _traceOpen = true;
+}
+
+void SerialBridge::pumpTrace() {
+    uint8_t buf[TRACE_HEADER_BYTES + TRACE_PER_FRAME * TRACE_RECORD_BYTES];
+
+    while (_traceOpen || _traceNext != _traceEnd) {
+        // Skip records that were overwritten since the request
+        TraceRecord r;
+        while (_traceNext != _traceEnd && !traceRing.read(_traceNext, r)) _traceNext++;
+
+        uint32_t first = _traceNext, i = first;
+        uint8_t  count = 0;
+        uint8_t* p     = buf + TRACE_HEADER_BYTES;
+        while (i != _traceEnd && count < TRACE_PER_FRAME && traceRing.read(i, r)) {
+            p[0] = (uint8_t)(r.tUs >> 24);
+            p[1] = (uint8_t)(r.tUs >> 16);
+            p[2] = (uint8_t)(r.tUs >> 8);
+            p[3] = (uint8_t)r.tUs;
+            p[4] = r.id;
+            p[5] = r.a;
+            p[6] = r.b;
+            p[7] = r.c;
+            p += TRACE_RECORD_BYTES;
+            count++;
+            i++;
+        }
+        if (count == 0 && !_traceOpen) return;
+
+        buf[0] = (uint8_t)(first >> 24);
+        buf[1] = (uint8_t)(first >> 16);
+        buf[2] = (uint8_t)(first >> 8);
+        buf[3] = (uint8_t)first;
+        buf[4] = (uint8_t)(_traceEnd >> 24);
+        buf[5] = (uint8_t)(_traceEnd >> 16);
+        buf[6] = (uint8_t)(_traceEnd >> 8);
+        buf[7] = (uint8_t)_traceEnd;
+        buf[8] = count;
+        if (!sendPacket(PKT_TRACE, buf, (uint16_t)(p - buf), false)) return;   // retry next update()
+        _traceNext = i;
+        _traceOpen = false;
+    }
+}
+
+void SerialBridge::pumpCapture() {
+    uint8_t buf[CAPTURE_HEADER_BYTES + CAPTURE_PER_FRAME * CAPTURE_RECORD_BYTES];
+    while (uint16_t n = min(_capture->count(), (uint16_t)CAPTURE_PER_FRAME)) {
+        if (!sendPacket(PKT_CAPTURE, buf, _capture->build(n, buf), false)) return;   // retry next update()
+        _capture->consume(n);
+    }
+}
+
+void SerialBridge::queueEvent(const InputEvent& e) {
+    if (!_handshaked) return;
+
+    if (!(_features & HS_FLAG_BATCH)) {
+        bool     key  = isKeyEvent(e.type);
+        uint32_t sent = micros();
+        bool     ok   = key ? sendKeyEvent(e.type, e.id, e.layer, e.seq)
+                            : sendEncoderEvent(e.type, e.value, e.steps, e.seq, e.speed);
+        if (!ok) _txDropped++;
+        else if (_timesOn) {
+            uint8_t buf[EventBatch::TIMES_HEADER_BYTES + EventBatch::TIMES_RECORD_BYTES];
+            sendPacket(PKT_EVENT_TIMES, buf, EventBatch::buildTimes(&e, 1, sent, buf), false);
+        }
+        return;
+    }
+    if (_batch.add(e)) return;
+
+    // Batch full: push it out, or drop this event if the driver is still busy
+    if (flushEvents()) _batch.add(e);
+    else               _txDropped++;
+}
+
+bool SerialBridge::flushEvents() {
+    if (_batch.empty()) return true;
+    uint8_t  buf[EVENT_BATCH_MAX_BYTES];
+    uint16_t n    = _batch.build(buf);
+    uint32_t sent = micros();
+    if (!sendPacket(PKT_EVENT_BATCH, buf, n, false)) return false;
+    // Event times ride behind their frame; with no room in the driver they
+    // are dropped (and counted in txDeferred), the events never are
+    if (_timesOn) sendPacket(PKT_EVENT_TIMES, buf, _batch.buildTimes(sent, buf), false);
+    _batch.clear();
+    return true;
 }
 
 void SerialBridge::updateBatteryLevel(uint8_t pct) {
@@ -154,11 +362,12 @@ void SerialBridge::sendConfigData(const uint8_t* data, size_t len) {
 }
 
 void SerialBridge::sendDeviceInfo() {
-    uint8_t info[7] = {
+    uint8_t info[8] = {
         FW_VERSION_MAJOR, FW_VERSION_MINOR, FW_VERSION_PATCH,
         NUM_ROWS, NUM_COLS,
         1,  // hasEncoder
-        BATTERY_ENABLED ? (uint8_t)1 : (uint8_t)0
+        BATTERY_ENABLED ? (uint8_t)1 : (uint8_t)0,
+        NUM_KEYS    // key indexes 0 … NUM_KEYS−1, row-major
     };
-    sendPacket(PKT_DEVICE_INFO, info, 7);
+    sendPacket(PKT_DEVICE_INFO, info, 8);
 }
@@ -1,13 +1,25 @@
 // =============================================================================
 // SerialBridge.h — Framed serial protocol for USB connection (alternative to BLE)
 // Packet format:  [0xAA] [TYPE] [LEN_HI] [LEN_LO] [DATA…] [XOR-checksum]
+//          or  :  [0xAA] [TYPE] [LEN_HI] [LEN_LO] [DATA…] [CRC_HI] [CRC_LO]
+// once HS_FLAG_CRC16 is agreed (CRC-16/CCITT over TYPE…DATA, see Crc16.h).
 // All packet types & data layouts match the BLE GATT characteristics exactly.
+// RX reads what the driver holds in bulk and parses frames out of the span; a
+// frame that fails its check gives up only its start byte, so the next frame
+// is found again inside the bytes already read.
 // =============================================================================
 #ifndef SERIAL_BRIDGE_H
 #define SERIAL_BRIDGE_H
 
 #include <Arduino.h>
 #include "Config.h"
+#include "EventBatch.h"
+#include "Crc16.h"
+#include "Trace.h"
+#include "Stats.h"
+#include "LinkPolicy.h"
+#include "TimeSync.h"
+#include "PinCapture.h"
 
 // ── Packet type IDs (shared with app serialApi.ts) ───────────────────────────
 #define PKT_START           0xAA
@@ -19,12 +31,42 @@
 #define PKT_COMMAND         0x06
 #define PKT_HANDSHAKE       0x07
 #define PKT_HANDSHAKE_ACK   0x08
+#define PKT_EVENT_BATCH     0x09   // see EventBatch.h for the payload
+#define PKT_SNAPSHOT        0x0A   // see InputSnapshot in EventRing.h
+#define PKT_TRACE           0x0B   // trace dump, see below
+#define PKT_STATS           0x0C   // see DeviceStats in Stats.h
+#define PKT_LINK            0x0D   // see LinkParams in LinkPolicy.h
+#define PKT_TIME            0x0E   // clock sync reply, see TimeSync.h
+#define PKT_EVENT_TIMES     0x0F   // latency trace, see EventBatch.h
+#define PKT_CAPTURE         0x10   // raw pin samples, see PinCapture.h
 
 #define HANDSHAKE_MAGIC_0   0x4D   // 'M'
 #define HANDSHAKE_MAGIC_1   0x50   // 'P'
 #define HANDSHAKE_MAGIC_2   0x44   // 'D'
 
-#define SERIAL_RX_BUF_SIZE  256
+// Optional 4th handshake byte: features the app understands.  The ACK echoes
+// the subset the device enabled; a bare "MPD" keeps the original protocol.
+// PKT_HANDSHAKE and its ACK are always XOR-framed, so a restarted app can
+// renegotiate with a device that is still in CRC mode.
+#define HS_FLAG_BATCH       0x01   // send PKT_EVENT_BATCH instead of per-event packets
+#define HS_FLAG_CRC16       0x02   // CRC-16 instead of the XOR byte, both directions
+#define HS_FLAGS_SUPPORTED  (HS_FLAG_BATCH | HS_FLAG_CRC16)
+
+// PKT_TRACE payload: [first u32 BE] [end u32 BE] [count]
+//   then count × [tUs u32 BE] [id] [a] [b] [c]
+// Records first … first+count−1 of a dump that stops before `end`.  Records
+// overwritten before they were sent are skipped, so a host sees the gap; an
+// empty dump is one frame with count 0.
+#define TRACE_HEADER_BYTES  9
+#define TRACE_RECORD_BYTES  8
+#define TRACE_PER_FRAME     ((EVENT_BATCH_MAX_BYTES - TRACE_HEADER_BYTES) / TRACE_RECORD_BYTES)
+
+#define SERIAL_RX_BUF_SIZE  256                        // largest PKT_COMMAND / PKT_CONFIG_DATA payload
+#define SERIAL_RX_HS_MAX    16                         // largest PKT_HANDSHAKE payload
+#define SERIAL_RX_FRAME_MAX (SERIAL_RX_BUF_SIZE + 6)   // largest frame received
+#define SERIAL_RX_BUDGET    1024                       // bytes parsed per update(); the rest waits
+#define SERIAL_RX_TIMEOUT_MS 50                        // a frame still incomplete after this is dropped
+#define SERIAL_TX_BUF_SIZE  (EVENT_BATCH_MAX_BYTES + 6)   // largest frame sent
 
 // Callbacks — same signature as BLE callbacks
 typedef void (*SerialCommandCb)(uint8_t cmd, const uint8_t* data, size_t len);
@@ -34,41 +76,100 @@ class SerialBridge {
 public:
     void begin(Stream& serial);
 
-    // Poll for incoming packets — call from loop()
+    // Poll for incoming packets — call from the transport task.  Parses at
+    // most SERIAL_RX_BUDGET bytes, so a long upload is spread over passes.
     void update();
 
     // Outgoing data (mirrors BleService API)
-    void sendKeyEvent(uint8_t evt, uint8_t idx);
-    void sendEncoderEvent(uint8_t evt, uint8_t dir, uint8_t steps);
+    bool sendKeyEvent(uint8_t evt, uint8_t idx, uint8_t layer, uint8_t seq);   // false = TX busy
+    bool sendEncoderEvent(uint8_t evt, uint8_t dir, uint8_t steps, uint8_t seq,
+                          uint16_t speed);
+    void sendSnapshot(const InputSnapshot& s);
+    void sendStats(const DeviceStats& s);
+    void sendLink(const LinkParams& p);
     void updateBatteryLevel(uint8_t pct);
     void sendConfigData(const uint8_t* data, size_t len);
     void sendDeviceInfo();
 
+    // Dump trace records from index `since` (clamped to what the ring still
+    // holds) up to the current head.  Frames go out from update() as the TX
+    // buffer has room, so a dump never stalls event delivery.
+    void sendTrace(uint32_t since);
+
+    // Stream pin capture records (CMD_SET_CAPTURE) as PKT_CAPTURE frames from
+    // update(), whole frames as the TX buffer has room; the rest waits in
+    // the capture ring
+    void setCapture(PinCapture* c) { _capture = c; }
+
+    // Input events: batched until flushEvents() when the app opted in,
+    // otherwise sent straight away as PKT_KEY_EVENT / PKT_ENCODER_EVENT.
+    // Event frames never wait for the driver: a frame that does not fit in
+    // its TX buffer is held (batch) or dropped (per-event) and counted.
+    void queueEvent(const InputEvent& e);
+    bool flushEvents();                  // false = back-pressure, batch kept
+    bool hasPendingEvents() const { return !_batch.empty(); }
+
+    uint32_t txDeferred() const { return _txDeferred; }   // frames held back
+    uint32_t txDropped()  const { return _txDropped; }    // events lost
+    uint32_t rxBadFrames() const { return _rxBad; }       // checksum / CRC failures
+    uint32_t rxOversize()  const { return _rxOversize; }  // headers refused: type the device
+                                                          // never receives, or length over its limit
+
     // Register command & config callbacks
     void setCommandCallback(SerialCommandCb cb)  { _cmdCb = cb; }
     void setConfigCallback(SerialConfigCb cb)    { _cfgCb = cb; }
 
-    bool isHandshaked() const { return _handshaked; }
+    bool    isHandshaked() const { return _handshaked; }
+    uint8_t features()     const { return _features; }
+    bool    latencyTrace() const { return _timesOn; }   // CMD_SET_LATENCY_TRACE, until the next handshake
 
 private:
     Stream* _serial = nullptr;
     bool    _handshaked = false;
+    uint8_t _features   = 0;       // HS_FLAG_* agreed in the handshake
+    bool    _timesOn    = false;   // PKT_EVENT_TIMES after each event frame
+
+    EventBatch _batch;
+
+    // Trace dump in progress: next record to send, and where it stops
+    uint32_t   _traceNext = 0;
+    uint32_t   _traceEnd  = 0;
+    bool       _traceOpen = false;    // nothing sent yet for this request
+
+    PinCapture* _capture  = nullptr;
 
     SerialCommandCb _cmdCb = nullptr;
     SerialConfigCb  _cfgCb = nullptr;
 
-    // RX parser state machine
-    enum ParseState { IDLE, TYPE, LEN_HI, LEN_LO, DATA, CHECKSUM };
-    ParseState _state = IDLE;
-    uint8_t    _pktType = 0;
-    uint16_t   _pktLen  = 0;
-    uint16_t   _pktPos  = 0;
-    uint8_t    _pktXor  = 0;
-    uint8_t    _rxBuf[SERIAL_RX_BUF_SIZE];
+    // RX: bytes read but not yet parsed.  _rx[0] is PKT_START whenever
+    // _rxLen > 0; the first _rxSuspect bytes belong to a frame already
+    // refused, so false starts among them are not counted again.
+    uint8_t    _rx[SERIAL_RX_FRAME_MAX];
+    uint16_t   _rxLen     = 0;
+    uint16_t   _rxSuspect = 0;
+    uint32_t   _rxSinceMs = 0;        // when the frame at the front started
+    uint32_t   _rxReadUs  = 0;        // micros() at the read that completed a frame
+
+    // TX: each frame is assembled here and handed to the driver in one write
+    uint8_t    _txBuf[SERIAL_TX_BUF_SIZE];
+    uint32_t   _txDeferred = 0;
+    uint32_t   _txDropped  = 0;
+    uint32_t   _rxBad      = 0;
+    uint32_t   _rxOversize = 0;
 
-    void feedByte(uint8_t b);
+    void     parse();
+    void     refuse(uint16_t need);
+    void     skip(uint16_t n);
+    uint16_t frameBytes() const;
+    uint8_t  checkBytes(uint8_t type) const;
+    bool     frameValid(uint16_t n) const;
+    void pumpTrace();
+    void pumpCapture();
     void handlePacket(uint8_t type, const uint8_t* data, uint16_t len);
-    void sendPacket(uint8_t type, const uint8_t* data, uint16_t len);
+    void linkCommand(uint8_t cmd, const uint8_t* data, uint16_t len);
+    // block = false: return false instead of waiting when the driver's TX
+    // buffer cannot take the whole frame
+    bool sendPacket(uint8_t type, const uint8_t* data, uint16_t len, bool block = true);
 };
 
 #endif // SERIAL_BRIDGE_H
@@ -0,0 +1,62 @@
+// =============================================================================
+// Stats.cpp — On-device performance counters, fetched with CMD_GET_STATS
+// =============================================================================
+#include "Stats.h"
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+void Histogram::record(uint32_t v) {
+    uint8_t b = 0;
+    while (b < HIST_BUCKETS - 1 && v >= _edges[b]) b++;
+    _count[b] = _count[b] + 1;
+    if (v > _max) _max = v;
+}
+
+void Histogram::clear() {
+    for (uint8_t b = 0; b < HIST_BUCKETS; b++) _count[b] = 0;
+    _max = 0;
+}
+
+uint32_t Histogram::total() const {
+    uint32_t n = 0;
+    for (uint8_t b = 0; b < HIST_BUCKETS; b++) n += _count[b];
+    return n;
+}
+
+uint8_t Histogram::build(uint8_t* out) const {
+    uint8_t* p = out;
+    for (uint8_t b = 0; b < HIST_BUCKETS; b++) p = putU32(p, _count[b]);
+    putU32(p, _max);
+    return HIST_BYTES;
+}
+
+uint8_t DeviceStats::build(uint8_t* out) const {
+    uint8_t* p = out;
+    *p++ = STATS_VERSION;
+    p  = putU32(p, uptimeMs);
+    p += scanPeriod.build(p);
+    p  = putU32(p, scanWorkMaxUs);
+    p += eventLatency.build(p);
+    p  = putU32(p, ringDropped);
+    *p++ = (uint8_t)(ringHighWater >> 8);
+    *p++ = (uint8_t)ringHighWater;
+    p  = putU32(p, notifyFailed);
+    p  = putU32(p, notifySkipped);
+    p  = putU32(p, bleTxRetried);
+    p  = putU32(p, bleTxDropped);
+    p  = putU32(p, bleTxCoalesced);
+    p  = putU32(p, serialTxDeferred);
+    p  = putU32(p, serialTxDropped);
+    p  = putU32(p, serialRxBad);
+    p  = putU32(p, serialRxOversize);
+    p  = putU32(p, encoderIsrHits);
+    p  = putU32(p, heapFree);
+    p  = putU32(p, heapMinFree);
+    return (uint8_t)(p - out);
+}
@@ -0,0 +1,78 @@
+// =============================================================================
+// Stats.h — On-device performance counters, fetched with CMD_GET_STATS
+// Each component keeps its own counters (EventRing, SerialBridge, BleService,
+// RotaryEncoder); the tasks add two fixed-bucket histograms.  On request the
+// transport task copies everything into a DeviceStats and sends it as
+// PKT_STATS over serial and on the Stats characteristic over BLE.
+// All counters run from boot and are never reset, so a host diffs two reads.
+// =============================================================================
+#ifndef STATS_H
+#define STATS_H
+
+#include "Config.h"
+
+#define HIST_BUCKETS        8
+#define HIST_BYTES          (HIST_BUCKETS * 4 + 4)   // counts + max, u32 BE each
+
+// Bucket upper bounds in µs; bucket i holds values below edge i and at or
+// above edge i−1, the last bucket everything else.  Part of the wire format.
+static const uint32_t SCAN_PERIOD_EDGES_US[HIST_BUCKETS - 1] =
+    { 900, 1100, 1500, 2000, 5000, 10000, 50000 };
+static const uint32_t EVENT_LATENCY_EDGES_US[HIST_BUCKETS - 1] =
+    { 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+
+// Written by one task, read by another: a copy may be a count or two behind,
+// never corrupt.
+class Histogram {
+public:
+    explicit Histogram(const uint32_t* edges) : _edges(edges) {}
+
+    void     record(uint32_t v);
+    void     clear();
+    uint32_t total() const;
+    uint32_t max()   const { return _max; }
+    uint8_t  build(uint8_t* out) const;   // returns HIST_BYTES
+
+private:
+    const uint32_t*   _edges;
+    volatile uint32_t _count[HIST_BUCKETS] = {};
+    volatile uint32_t _max = 0;
+};
+
+// Wire layout (PKT_STATS payload and the Stats characteristic), all BE:
+//   [version] [uptime ms u32]
+//   [scan period histogram] [scan work max µs u32]
+//   [event → transmit latency histogram]
+//   [ring dropped u32] [ring high-water u16]
+//   [notify failed u32] [notify skipped u32]
+//   [BLE tx retried u32] [BLE tx dropped u32] [BLE tx coalesced u32]
+//   [serial tx deferred u32] [tx dropped u32] [rx bad u32] [rx oversize u32]
+//   [encoder ISR hits u32] [heap free u32] [heap min free u32]
+// A histogram is HIST_BUCKETS counts then the largest value seen.
+#define STATS_VERSION       2
+#define STATS_MAX_BYTES     (1 + 4 + HIST_BYTES + 4 + HIST_BYTES + 4 + 2 + 8 + 12 + 16 + 4 + 8)
+
+struct DeviceStats {
+    uint32_t  uptimeMs;
+    Histogram scanPeriod;         // input task wake to wake
+    uint32_t  scanWorkMaxUs;      // longest scan + encoder pass
+    Histogram eventLatency;       // capture stamp → handed to both links
+    uint32_t  ringDropped;
+    uint16_t  ringHighWater;
+    uint32_t  notifyFailed;       // notify() returned false
+    uint32_t  notifySkipped;      // input events with no BLE client connected
+    uint32_t  bleTxRetried;       // refused notifies that went out on a retry (NotifyQueue)
+    uint32_t  bleTxDropped;       // waiting notifies dropped to make room
+    uint32_t  bleTxCoalesced;     // merged into, or replaced by, a newer one while waiting
+    uint32_t  serialTxDeferred;
+    uint32_t  serialTxDropped;
+    uint32_t  serialRxBad;        // checksum / CRC failures
+    uint32_t  serialRxOversize;   // headers refused: unknown type or length over its limit
+    uint32_t  encoderIsrHits;
+    uint32_t  heapFree;
+    uint32_t  heapMinFree;
+
+    uint8_t build(uint8_t* out) const;    // returns STATS_MAX_BYTES
+};
+
+#endif
@@ -0,0 +1,37 @@
+// =============================================================================
+// TimeSync.h — NTP-style clock sync reply (CMD_TIME_SYNC)
+// The host sends [t1 u32 BE], any 32-bit µs clock of its own.  The link the
+// command came in on answers at once, as PKT_TIME over serial or on the Time
+// characteristic over BLE:
+//   [t1 u32 BE] [t2: micros() at receipt, u32 BE] [t3: micros() at send, u32 BE]
+// With t4 the host clock when the reply arrives:
+//   offset (device − host) = ((t2 − t1) + (t3 − t4)) / 2
+//   delay  (both ways)     = (t4 − t1) − (t3 − t2)
+// The offset is right to within delay / 2; a host keeps the sample with the
+// lowest delay out of a few.  All arithmetic mod 2^32.
+// =============================================================================
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include "Config.h"
+
+#define TIME_SYNC_BYTES     12
+
+struct TimeSync {
+    uint32_t hostUs;       // t1, echoed
+    uint32_t rxUs;         // t2
+    uint32_t txUs;         // t3
+
+    uint8_t build(uint8_t* out) const {    // returns TIME_SYNC_BYTES
+        const uint32_t v[3] = { hostUs, rxUs, txUs };
+        for (uint8_t i = 0; i < 3; i++) {
+            out[i * 4]     = (uint8_t)(v[i] >> 24);
+            out[i * 4 + 1] = (uint8_t)(v[i] >> 16);
+            out[i * 4 + 2] = (uint8_t)(v[i] >> 8);
+            out[i * 4 + 3] = (uint8_t)v[i];
+        }
+        return TIME_SYNC_BYTES;
+    }
+};
+
+#endif
@@ -0,0 +1,25 @@
+// =============================================================================
+// Trace.cpp — Binary trace ring for on-device diagnostics
+// =============================================================================
+#include "Trace.h"
+
+TraceRing traceRing;
+
+void TraceRing::record(uint8_t id, uint8_t a, uint8_t b, uint8_t c) {
+    uint32_t i    = _head.fetch_add(1, std::memory_order_relaxed);
+    uint32_t slot = i & (TRACE_RING_SIZE - 1);
+
+    // Invalidate the slot, fill it, then publish it under its new index
+    _tag[slot].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _buf[slot] = { (uint32_t)micros(), id, a, b, c };
+    _tag[slot].store(i + 1, std::memory_order_release);
+}
+
+bool TraceRing::read(uint32_t index, TraceRecord& out) const {
+    uint32_t slot = index & (TRACE_RING_SIZE - 1);
+    if (_tag[slot].load(std::memory_order_acquire) != index + 1) return false;
+    out = _buf[slot];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return _tag[slot].load(std::memory_order_relaxed) == index + 1;
+}
@@ -0,0 +1,76 @@
+// =============================================================================
+// Trace.h — Binary trace ring for on-device diagnostics
+// TRACE(id, a, b, c) stores an 8-byte record (micros(), id, three bytes) in a
+// RAM ring that keeps the latest TRACE_RING_SIZE entries.  Nothing is
+// formatted on the device: the host fetches the ring with CMD_GET_TRACE and
+// decodes it (PKT_TRACE, see SerialBridge.h).  Any task may record; a record
+// being overwritten while it is read is reported as missing, never torn.
+// =============================================================================
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "Config.h"
+#include <atomic>
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0,
+              "TRACE_RING_SIZE must be a power of two");
+
+// Record ids and what a / b / c carry
+enum TraceId : uint8_t {
+    TR_EVENT          = 0x01,   // EVT_* type, key / signed steps / button, seq
+    TR_COMMAND        = 0x02,   // CMD_*, payload length, —
+    TR_CONFIG_WRITE   = 0x03,   // CFG_* type, payload length, —
+    TR_DEBOUNCE       = 0x04,   // 1 = adaptive, ms hi, ms lo
+    TR_BATTERY        = 0x05,   // percent, mV hi, mV lo
+    TR_SLEEP          = 0x06,
+    TR_WAKE           = 0x07,   // ESP_SLEEP_WAKEUP_* cause, WAKE_* sources, —
+    TR_BLE_CONNECT    = 0x08,   // —, MTU hi, MTU lo
+    TR_BLE_DISCONNECT = 0x09,   // —, reason hi, reason lo
+    TR_BLE_SUBSCRIBE  = 0x0A,   // 1 = Event Batch, on, —
+    TR_HANDSHAKE      = 0x0B,   // HS_FLAG_* agreed, —, —
+    TR_BLE_MTU        = 0x0C,   // —, MTU hi, MTU lo
+    TR_ENCODER_RATE   = 0x0D,   // —, Hz hi, Hz lo
+    TR_LINK_REQUEST   = 0x0E,   // profile, interval min, interval max   (1.25 ms units)
+    TR_LINK_PARAMS    = 0x0F,   // interval hi, interval lo, latency      (as negotiated)
+    TR_LINK_PHY       = 0x10,   // tx PHY, rx PHY, —
+    TR_HID_MODE       = 0x11,   // on, —, —
+    TR_KEYMAP         = 0x12,   // KEYMAP_* status, layers, sequences
+    TR_LAYER          = 0x13,   // active layer mask, top layer, —
+    TR_SCAN_TIER      = 0x14,   // GOV_FULL / GOV_IDLE / GOV_DEEP, GOV_MODE_*, 1 = woken
+    TR_ADVERTISE      = 0x15,   // ADV_* phase, min interval hi, lo       (0.625 ms units)
+    TR_WAKE_EVENT     = 0x16,   // —, µs hi, µs lo: wake → first event handed to the links
+    TR_CAPTURE        = 0x17,   // on, records lost hi, lo               (lost: on stop)
+    TR_CHATTER        = 0x18,   // key, longest burst ms, window ms       (flagged, back to ceiling)
+    TR_GESTURE        = 0x19,   // key (0xFF = all), hold, double-tap     (10 ms units, saturating)
+    TR_BLE_CONGESTION = 0x1A,   // on, notifies waiting, TX buffers free
+};
+
+struct TraceRecord {
+    uint32_t tUs;
+    uint8_t  id;
+    uint8_t  a, b, c;
+};
+
+class TraceRing {
+public:
+    void     record(uint8_t id, uint8_t a, uint8_t b, uint8_t c);
+    uint32_t head() const { return _head.load(std::memory_order_acquire); }
+    // Record number `index` (0 = first ever); false if it was overwritten
+    // or is still being written
+    bool     read(uint32_t index, TraceRecord& out) const;
+
+private:
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tag[TRACE_RING_SIZE] = {};   // index + 1 once complete
+    TraceRecord           _buf[TRACE_RING_SIZE];
+};
+
+extern TraceRing traceRing;
+
+#if TRACE_ENABLED
+#  define TRACE(id, a, b, c) traceRing.record((id), (uint8_t)(a), (uint8_t)(b), (uint8_t)(c))
+#else
+#  define TRACE(id, a, b, c) do { if (0) traceRing.record((id), (uint8_t)(a), (uint8_t)(b), (uint8_t)(c)); } while (0)
+#endif
+
+#endif